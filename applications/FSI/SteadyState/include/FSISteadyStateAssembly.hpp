@@ -26,7 +26,7 @@ namespace femus {
     NumericVector*	        myRES		= myLinEqSolver->_RES;
 
     bool assembleMatrix = my_nnlin_impl_sys.GetAssembleMatrix();
-    adept::Stack& s = FemusInit::_adeptStack;
+    adept::Stack& s = FemusInit::GetAdeptStack();
     if( assembleMatrix ) s.continue_recording();
     else s.pause_recording();
 
@@ -676,7 +676,7 @@ namespace femus {
     NumericVector*              myRES           = myLinEqSolver->_RES;
 
     bool assembleMatrix = my_nnlin_impl_sys.GetAssembleMatrix();
-    adept::Stack& s = FemusInit::_adeptStack;
+    adept::Stack& s = FemusInit::GetAdeptStack();
     if( assembleMatrix ) s.continue_recording();
     else s.pause_recording();
 
@@ -34,7 +34,7 @@ namespace femus
 
     bool assembleMatrix = my_nnlin_impl_sys.GetAssembleMatrix();
     // call the adept stack object
-    adept::Stack& s = FemusInit::_adeptStack;
+    adept::Stack& s = FemusInit::GetAdeptStack();
     if (assembleMatrix) s.continue_recording();
     else s.pause_recording();
 
@@ -1086,7 +1086,7 @@ namespace femus
 
     bool assembleMatrix = my_nnlin_impl_sys.GetAssembleMatrix();
     // call the adept stack object
-    adept::Stack& s = FemusInit::_adeptStack;
+    adept::Stack& s = FemusInit::GetAdeptStack();
     if (assembleMatrix) s.continue_recording();
 
     const unsigned dim = mymsh->GetDimension();
@@ -2077,7 +2077,7 @@ namespace femus
     clock_t start_time, end_time;
     start_time = clock();
 
-    adept::Stack & adeptStack = FemusInit::_adeptStack;
+    adept::Stack & adeptStack = FemusInit::GetAdeptStack();
 
     Solution *mysolution = mlSol.GetSolutionLevel ( level );
     Mesh *mymsh	=  mlSol._mlMesh->GetLevel ( level );
@@ -27,7 +27,7 @@ namespace femus {
     NumericVector*	        myRES		= myLinEqSolver->_RES;
 
     bool assembleMatrix = my_nnlin_impl_sys.GetAssembleMatrix();
-    adept::Stack& s = FemusInit::_adeptStack;
+    adept::Stack& s = FemusInit::GetAdeptStack();
     if ( assembleMatrix ) s.continue_recording();
     else s.pause_recording();
 
@@ -791,7 +791,7 @@ namespace femus {
     NumericVector*              myRES           = myLinEqSolver->_RES;
 
     bool assembleMatrix = my_nnlin_impl_sys.GetAssembleMatrix();
-    adept::Stack& s = FemusInit::_adeptStack;
+    adept::Stack& s = FemusInit::GetAdeptStack();
     if ( assembleMatrix ) s.continue_recording();
     else s.pause_recording();
 
@@ -1438,7 +1438,7 @@ namespace femus {
     clock_t start_time, end_time;
     start_time = clock();
 
-    adept::Stack & adeptStack = FemusInit::_adeptStack;
+    adept::Stack & adeptStack = FemusInit::GetAdeptStack();
 
     Solution *mysolution = mlSol.GetSolutionLevel ( level );
     Mesh *mymsh	=  mlSol._mlMesh->GetLevel ( level );
@@ -14,7 +14,7 @@ namespace femus
     clock_t AssemblyTime = 0;
     clock_t start_time, end_time;
 
-    adept::Stack & s = FemusInit::_adeptStack;
+    adept::Stack & s = FemusInit::GetAdeptStack();
 
     //pointers and references
 
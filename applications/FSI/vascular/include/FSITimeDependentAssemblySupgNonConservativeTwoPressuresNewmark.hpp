@@ -63,7 +63,7 @@ namespace femus
 
     bool assembleMatrix = my_nnlin_impl_sys.GetAssembleMatrix();
     // call the adept stack object
-    adept::Stack& stack = FemusInit::_adeptStack;
+    adept::Stack& stack = FemusInit::GetAdeptStack();
 
     if ( assembleMatrix ) stack.continue_recording();
     else stack.pause_recording();
@@ -993,7 +993,7 @@ namespace femus
     clock_t start_time, end_time;
     start_time = clock();
 
-    adept::Stack& adeptStack = FemusInit::_adeptStack;
+    adept::Stack& adeptStack = FemusInit::GetAdeptStack();
 
     Solution* mysolution = mlSol.GetSolutionLevel ( level );
     Mesh* mymsh	=  mlSol._mlMesh->GetLevel ( level );
@@ -44,7 +44,7 @@ namespace femus
 
     bool assembleMatrix = my_nnlin_impl_sys.GetAssembleMatrix();
     // call the adept stack object
-    adept::Stack& s = FemusInit::_adeptStack;
+    adept::Stack& s = FemusInit::GetAdeptStack();
     if (assembleMatrix) s.continue_recording();
     else s.pause_recording();
 
@@ -1118,7 +1118,7 @@ namespace femus
 
     bool assembleMatrix = my_nnlin_impl_sys.GetAssembleMatrix();
     // call the adept stack object
-    adept::Stack& s = FemusInit::_adeptStack;
+    adept::Stack& s = FemusInit::GetAdeptStack();
     if (assembleMatrix) s.continue_recording();
     else s.pause_recording();
 
@@ -2257,7 +2257,7 @@ namespace femus
     clock_t start_time, end_time;
     start_time = clock();
 
-    adept::Stack & adeptStack = FemusInit::_adeptStack;
+    adept::Stack & adeptStack = FemusInit::GetAdeptStack();
 
     Solution *mysolution = mlSol.GetSolutionLevel(level);
     Mesh *mymsh	=  mlSol._mlMesh->GetLevel(level);
@@ -2608,7 +2608,7 @@ namespace femus
     clock_t start_time, end_time;
     start_time = clock();
 
-    adept::Stack & adeptStack = FemusInit::_adeptStack;
+    adept::Stack & adeptStack = FemusInit::GetAdeptStack();
 
     Solution *mysolution = mlSol.GetSolutionLevel(level);
     Mesh *mymsh	=  mlSol._mlMesh->GetLevel(level);
@@ -3211,7 +3211,7 @@ namespace femus
 
     bool assembleMatrix = my_nnlin_impl_sys.GetAssembleMatrix();
     // call the adept stack object
-    adept::Stack& s = FemusInit::_adeptStack;
+    adept::Stack& s = FemusInit::GetAdeptStack();
     if (assembleMatrix) s.continue_recording();
     else s.pause_recording();
 
@@ -93,6 +93,22 @@ double InitalValueW(const std::vector < double >& x) {
 }
 
 
+void AddVelocity(MultiLevelSolution& mlSol, const unsigned& dim, const double& time)
+{
+  mlSol.AddSolution("U", LAGRANGE, SECOND, 2);
+  mlSol.AddSolution("V", LAGRANGE, SECOND, 2);
+  if (dim == 3) mlSol.AddSolution("W", LAGRANGE, SECOND, 2);
+  mlSol.Initialize("U" , InitalValueU);
+  mlSol.Initialize("V" , InitalValueV);
+  if (dim == 3) mlSol.Initialize("W", InitalValueW);
+  if (time > 0.) {
+    mlSol.UpdateSolution("U" , InitalValueU, time);
+    mlSol.UpdateSolution("V" , InitalValueV, time);
+    if (dim == 3) mlSol.UpdateSolution("W" , InitalValueW, time);
+  }
+}
+
+
 bool SetRefinementFlag(const std::vector < double >& x, const int& elemgroupnumber, const int& level)
 {
 
@@ -188,12 +204,7 @@ int main(int argc, char** args)
 
   MultiLevelSolution mlSol(&mlMsh);
   // add variables to mlSol
-  mlSol.AddSolution("U", LAGRANGE, SECOND, 2);
-  mlSol.AddSolution("V", LAGRANGE, SECOND, 2);
-  if (dim == 3) mlSol.AddSolution("W", LAGRANGE, SECOND, 2);
-  mlSol.Initialize("U" , InitalValueU);
-  mlSol.Initialize("V" , InitalValueV);
-  if (dim == 3) mlSol.Initialize("W", InitalValueW);
+  AddVelocity(mlSol, dim, 0.);
 
   std::cout << " --------------------------------------------------------------------------------------------- " << std::endl;
 // Marker a1Quad(x, VOLUME, mlMsh.GetLevel(0), solType, true);
@@ -265,6 +276,12 @@ int main(int argc, char** args)
  //exit(0);
 
   Line linea(x, markerType, mlSol.GetLevel(numberOfUniformLevels - 1), solType);
+  linea.SetLoadBalanceReport(true);
+
+  // mesh and velocity repartitioned with the marker load, when the markers gather on few processes
+  MultiLevelMesh* mlMshRebalanced = NULL;
+  MultiLevelSolution* mlSolRebalanced = NULL;
+  MultiLevelSolution* velocity = &mlSol;
 
   linea.GetLine(line0[0]);
   PrintLine(DEFAULT_OUTPUTDIR, line0, false, 0);
@@ -282,13 +299,35 @@ int main(int argc, char** args)
   for (unsigned k = 1; k <= n; k++) {
     std::cout << "Iteration = " << k << std::endl;
     //uncomment for  vortex test
-    mlSol.CopySolutionToOldSolution();
-    mlSol.UpdateSolution("U" , InitalValueU, pi * k / n);
-    mlSol.UpdateSolution("V" , InitalValueV, pi * k / n);
-    if (dim == 3) mlSol.UpdateSolution("W" , InitalValueW, pi * k / n);
+    velocity->CopySolutionToOldSolution();
+    velocity->UpdateSolution("U" , InitalValueU, pi * k / n);
+    velocity->UpdateSolution("V" , InitalValueV, pi * k / n);
+    if (dim == 3) velocity->UpdateSolution("W" , InitalValueW, pi * k / n);
     linea.AdvectionParallel(40, T / n, 4);
     linea.GetLine(line[0]);
     PrintLine(DEFAULT_OUTPUTDIR, line, false, k);
+
+    if (k < n && linea.NeedsRebalancing(1.2)) {
+      std::vector < unsigned > weights;
+      linea.GetCoarseElementWeights(weights);
+
+      MultiLevelMesh* newMlMsh = new MultiLevelMesh;
+      newMlMsh->SetCoarseElementWeights(weights);
+      newMlMsh->ReadCoarseMesh("./input/test3Dbis.neu", "seventh", scalingFactor);
+      newMlMsh->RefineMesh(numberOfUniformLevels + numberOfSelectiveLevels, numberOfUniformLevels , SetRefinementFlag);
+
+      // the velocity is known in closed form, it is evaluated again on the new partition
+      MultiLevelSolution* newMlSol = new MultiLevelSolution(newMlMsh);
+      AddVelocity(*newMlSol, dim, pi * k / n);
+
+      linea.Rebalance(newMlSol->GetLevel(numberOfUniformLevels - 1));
+
+      delete mlSolRebalanced;
+      delete mlMshRebalanced;
+      mlMshRebalanced = newMlMsh;
+      mlSolRebalanced = newMlSol;
+      velocity = newMlSol;
+    }
   }
 
 
@@ -312,6 +351,9 @@ int main(int argc, char** args)
 
   std::cout << " ERROR = " << std::setprecision(15) << error << std::endl;
 
+  delete mlSolRebalanced;
+  delete mlMshRebalanced;
+
 //   for(unsigned j = 0; j < size; j++) {
 //     std::vector <double> trial(dim);
 //     trial = linea._particles[linea._printList[j]]->GetIprocMarkerCoordinates();
@@ -1,3 +1,4 @@
+#include "ParticleGridTransfer.hpp"
 
 using namespace femus;
 
@@ -303,8 +304,8 @@ void AssembleMPMSys(MultiLevelProblem& ml_prob) {
   
   //line instances
   std::vector<unsigned> markerOffset = linea->GetMarkerOffset();
-  unsigned markerOffset1 = markerOffset[iproc];
-  unsigned markerOffset2 = markerOffset[iproc + 1];
+  unsigned markerOffset1 = 0; // the particles of iproc are stored locally
+  unsigned markerOffset2 = markerOffset[iproc + 1] - markerOffset[iproc];
   std::vector<Marker*> particles = linea->GetParticles();
   //std::map<unsigned, std::vector < std::vector < std::vector < std::vector < double > > > > > aX;
   
@@ -537,6 +538,24 @@ void AssembleMPMSys(MultiLevelProblem& ml_prob) {
   //END building "soft" stiffness matrix
   
   
+  //BEGIN particle to grid of the gravity and of the inertia terms that do not depend on the displacement
+  // - phi_i * mass_p * (g + VpOld / (beta dt) + (1 - 2 beta) / (2 beta) ApOld), one element bucket at a time
+  ParticleArrays& arrays = linea->GetParticleArrays();
+  std::vector < std::vector < double > > inertiaLoad(dim, std::vector < double > (arrays.size()));
+  std::vector < const double* > inertiaLoadArray(dim);
+  for(int k = 0; k < dim; k++) {
+    const double *mass = arrays.GetMass();
+    const double *vel = arrays.GetVelocity(k);
+    const double *acc = arrays.GetAcceleration(k);
+    for(unsigned ip = 0; ip < arrays.size(); ip++) {
+      inertiaLoad[k][ip] = - mass[ip] * (gravity[k] + 1. / (beta * dt) * vel[ip] + (1. - 2.* beta) / (2. * beta) * acc[ip]);
+    }
+    inertiaLoadArray[k] = &inertiaLoad[k][0];
+  }
+  ParticleGridTransfer transfer(mysolution, solType);
+  transfer.ParticleToGrid(arrays, inertiaLoadArray, indexSolD, indexPdeD, myLinEqSolver, myRES);
+  //END
+  
   //initialization of iel
   unsigned ielOld = UINT_MAX;
   
@@ -660,9 +679,6 @@ void AssembleMPMSys(MultiLevelProblem& ml_prob) {
       std::vector <double> SolVpOld(dim);
       particles[iMarker]->GetMarkerVelocity(SolVpOld);
       
-      std::vector <double> SolApOld(dim);
-      particles[iMarker]->GetMarkerAcceleration(SolApOld);
-      
       double mass = particles[iMarker]->GetMarkerMass();
       
       
@@ -797,9 +813,10 @@ void AssembleMPMSys(MultiLevelProblem& ml_prob) {
           }
         }
           
+        // the gravity and the inertia terms of the old particle velocity and acceleration are added by the particle to grid above
         for(int idim = 0; idim < dim; idim++) {
-          aRhs[idim][i] += (phi[i] * gravity[idim] - J_hat * CauchyDIR[idim] / density_MPM 
-          - phi[i] * (1. / (beta * dt * dt) * SolDp[idim] - 1. / (beta * dt) * SolVpOld[idim] - (1. - 2.* beta) / (2. * beta) * SolApOld[idim])
+          aRhs[idim][i] += (- J_hat * CauchyDIR[idim] / density_MPM 
+          - phi[i] * 1. / (beta * dt * dt) * SolDp[idim]
           ) * mass;
         }
           //}
@@ -890,8 +907,8 @@ void SetNeumannFactor(MultiLevelSolution* ml_sol) {
     
   //line instances
   std::vector<unsigned> markerOffset = linea->GetMarkerOffset();
-  unsigned markerOffset1 = markerOffset[iproc];
-  unsigned markerOffset2 = markerOffset[iproc + 1];
+  unsigned markerOffset1 = 0; // the particles of iproc are stored locally
+  unsigned markerOffset2 = markerOffset[iproc + 1] - markerOffset[iproc];
   std::vector<Marker*> particles = linea->GetParticles();
   
   //initialization of iel
@@ -1038,114 +1055,79 @@ void GridToParticlesProjection(MultiLevelProblem & ml_prob, Line & linea) {
   //unsigned indexSolNF =  ml_sol->GetIndex("NF");
   
   //line instances
-  std::vector<unsigned> markerOffset = linea.GetMarkerOffset();
-  unsigned markerOffset1 = markerOffset[iproc];
-  unsigned markerOffset2 = markerOffset[iproc + 1];
   std::vector<Marker*> particles = linea.GetParticles();
-  //std::map<unsigned, std::vector < std::vector < std::vector < std::vector < double > > > > > aX;
+  ParticleArrays& arrays = linea.GetParticleArrays();
+  
+  //BEGIN displacement of the particles, interpolated from the grid one element bucket at a time
+  std::vector < double* > particleDispArray(dim);
+  for(int i = 0; i < dim; i++) {
+    particleDispArray[i] = arrays.GetDisplacement(i);
+  }
+  ParticleGridTransfer transfer(mysolution, solType);
+  transfer.GridToParticle(arrays, indexSolD, particleDispArray, true);
+  //END
   
-  //initialization of iel
-  unsigned ielOld = UINT_MAX;
   //declaration of element instances
   std::vector < std::vector < double > > SolDd1(dim);
   std::vector < bool > solidMark;
   std::vector < double > velMeshOld;
-  //BEGIN loop on particles
-  for(unsigned iMarker = markerOffset1; iMarker < markerOffset2; iMarker++) {
+  //BEGIN loop on particles, the particles of the same element are consecutive
+  for(unsigned ib = 0; ib < arrays.GetNumberOfBuckets(); ib++) {
     
-    //element of particle iMarker
-    unsigned iel = particles[iMarker]->GetMarkerElement();
+    //element of the particles of the bucket
+    unsigned iel = arrays.GetBucketElement(ib);
     
+    short unsigned ielt = mymsh->GetElementType(iel);
+    unsigned nve = mymsh->GetElementDofNumber(iel, solType);
     
-    if(iel != UINT_MAX) {
-      
-      short unsigned ielt;
-      unsigned nve;
+    for(int i = 0; i < dim; i++) {
+      SolDd[i].resize(nve);
+      SolDdOld[i].resize(nve);
+      vx_hat[i].resize(nve);
+    }
+    
+    //BEGIN copy of the value of Sol at the dofs idof of the element iel
+    for(unsigned inode = 0; inode < nve; inode++) {
+      unsigned idof = mymsh->GetSolutionDof(inode, iel, solType); //local 2 global solution
+      unsigned idofX = mymsh->GetSolutionDof(inode, iel, 2); //local 2 global solution
       
-      //update element related quantities only if we are in a different element
-      if(iel != ielOld) {
-        
-        ielt = mymsh->GetElementType(iel);
-        nve = mymsh->GetElementDofNumber(iel, solType);
-        
-        for(int i = 0; i < dim; i++) {
-          SolDd[i].resize(nve);
-          SolDdOld[i].resize(nve);
-          vx_hat[i].resize(nve);
-        }
-        
-        //BEGIN copy of the value of Sol at the dofs idof of the element iel
-        for(unsigned inode = 0; inode < nve; inode++) {
-          unsigned idof = mymsh->GetSolutionDof(inode, iel, solType); //local 2 global solution
-          unsigned idofX = mymsh->GetSolutionDof(inode, iel, 2); //local 2 global solution
-          
-          for(int i = 0; i < dim; i++) {
-            SolDdOld[i][inode] = (*mysolution->_SolOld[indexSolD[i]])(idof);
-            SolDd[i][inode] = (*mysolution->_Sol[indexSolD[i]])(idof) - SolDdOld[i][inode];
-            
-            //moving domain
-            vx_hat[i][inode] = (*mymsh->_topology->_Sol[i])(idofX) + SolDdOld[i][inode];
-          }
-        }
-        //END
-        
-        if( ml_sol->GetIfFSI() ){
-          solidMark.resize(nve);
-          velMeshOld.resize(nve);
-          for(unsigned i = 0; i < nve; i++) {
-            unsigned idof = mymsh->GetSolutionDof(i, iel, solType);
-            solidMark[i] = mymsh->GetSolidMark(idof);
-            velMeshOld[i] = (*mysolution->_Sol[indexSolV[1]])(idof);
-          }
-        }
-        else {
-          solidMark.assign(nve,false);
-          velMeshOld.assign(nve,0.);
-        }
+      for(int i = 0; i < dim; i++) {
+        SolDdOld[i][inode] = (*mysolution->_SolOld[indexSolD[i]])(idof);
+        SolDd[i][inode] = (*mysolution->_Sol[indexSolD[i]])(idof) - SolDdOld[i][inode];
         
-//         for(int k = 0; k < dim; k++) {
-//           SolDd1[k].resize(nve);
-//           for(unsigned inode = 0; inode < nve; inode++){
-//             SolDd1[k][inode] = SolDd[k][inode];
-//           }
-//         }
-//         
-//         unsigned ii[9][3][3] = { 
-//           { {0,3,7}, {1,2,5}, {4,6,8}},
-//           { {1,0,4}, {2,3,6}, {5,7,8}},
-//           { {2,1,5}, {3,0,7}, {6,4,8}},
-//           { {3,2,6}, {0,1,4}, {7,5,8}} };
-//           
-//           double neumannFactor =  .5 * (*mysolution->_Sol[indexSolNF])(iel);        
-//           if( neumannFactor > 1.0e-10 ){
-//             
-//             for(unsigned iface = 0; iface < 4; iface++ ){
-//               int faceIndex = myel->GetBoundaryIndex(iel, iface);
-//               if( faceIndex == 1 ){
-//                 
-//                 for(unsigned inode = 0;inode < 3; inode++){
-//                   for(int k = 0; k < dim; k++) {
-//                     unsigned i0 = ii[iface][inode][0];
-//                     unsigned i1 = ii[iface][inode][1];
-//                     unsigned i2 = ii[iface][inode][2];  
-//                     SolDd1[k][i0] = neumannFactor * (- 1./3. * SolDd[k][i1] + 4./3 * SolDd[k][ i2 ] ) + (1. - neumannFactor) * SolDd[k][i0];
-//                   }
-//                 }
-//                 break;
-//               }
-//             }
-//             
-//           }
+        //moving domain
+        vx_hat[i][inode] = (*mymsh->_topology->_Sol[i])(idofX) + SolDdOld[i][inode];
       }
-      std::vector <double> xi = particles[iMarker]->GetMarkerLocalCoordinates();
+    }
+    //END
+    
+    if( ml_sol->GetIfFSI() ){
+      solidMark.resize(nve);
+      velMeshOld.resize(nve);
+      for(unsigned i = 0; i < nve; i++) {
+        unsigned idof = mymsh->GetSolutionDof(i, iel, solType);
+        solidMark[i] = mymsh->GetSolidMark(idof);
+        velMeshOld[i] = (*mysolution->_Sol[indexSolV[1]])(idof);
+      }
+    }
+    else {
+      solidMark.assign(nve,false);
+      velMeshOld.assign(nve,0.);
+    }
+    
+    for(unsigned ip = arrays.GetBucketBegin(ib); ip < arrays.GetBucketEnd(ib); ip++) {
+      
+      Marker* particle = particles[arrays.GetMarkerIndex(ip)];
+      
+      std::vector <double> xi = particle->GetMarkerLocalCoordinates();
       
       mymsh->_finiteElement[ielt][solType]->Jacobian(vx_hat, xi, weight, phi_hat, gradphi_hat, nablaphi_hat); //function to evaluate at the particles
       
       std::vector <double> particleVelOld(dim);
-      particles[iMarker]->GetMarkerVelocity(particleVelOld);
+      particle->GetMarkerVelocity(particleVelOld);
       
       std::vector <double> particleAccOld(dim);
-      particles[iMarker]->GetMarkerAcceleration(particleAccOld);
+      particle->GetMarkerAcceleration(particleAccOld);
       
       unsigned ii[9][3][3] = { 
         { {0,3,7}, {1,2,5}, {4,6,8}},
@@ -1154,96 +1136,86 @@ void GridToParticlesProjection(MultiLevelProblem & ml_prob, Line & linea) {
         { {3,2,6}, {0,1,4}, {7,5,8}} };
         
         
-        for(int k = 0; k < dim; k++) {
-          SolDd1[k].resize(nve);
-          for(unsigned inode = 0; inode < nve; inode++){
-            SolDd1[k][inode] = SolDd[k][inode];
-          }
+      for(int k = 0; k < dim; k++) {
+        SolDd1[k].resize(nve);
+        for(unsigned inode = 0; inode < nve; inode++){
+          SolDd1[k][inode] = SolDd[k][inode];
         }
+      }
+      
+      for(unsigned iface = 0; iface < 4; iface++){
+        int faceIndex = myel->GetBoundaryIndex(iel, iface);
+        unsigned im = ii[iface][2][0];
+        bool switchToNeumannBC = ( faceIndex == 1  &&  particleVelOld[1] > 0 ) ? true : false;
         
-       
+        bool switchToNeumannFSI = ( solidMark[im] && (particleVelOld[1] - velMeshOld[im] > 0 ) ) ? true : false;                         
         
-        for(unsigned iface = 0; iface < 4; iface++){
-          int faceIndex = myel->GetBoundaryIndex(iel, iface);
-          unsigned im = ii[iface][2][0];
-          bool switchToNeumannBC = ( faceIndex == 1  &&  particleVelOld[1] > 0 ) ? true : false;
-          
-          bool switchToNeumannFSI = ( solidMark[im] && (particleVelOld[1] - velMeshOld[im] > 0 ) ) ? true : false;                         
+        if(switchToNeumannBC || switchToNeumannFSI){
           
-          if(switchToNeumannBC || switchToNeumannFSI){
-            
-            for(unsigned inode = 0;inode < 3; inode++){
-              for(int k = 0; k < dim; k++) {
-                unsigned i0 = ii[iface][inode][0];
-                unsigned i1 = ii[iface][inode][1];
-                unsigned i2 = ii[iface][inode][2];  
-                SolDd1[k][i0] = NeumannFactor * (- 1./3. * SolDd[k][i1] + 4./3 * SolDd[k][ i2 ] ) + (1. - NeumannFactor) * SolDd[k][i0];
-              }
+          for(unsigned inode = 0;inode < 3; inode++){
+            for(int k = 0; k < dim; k++) {
+              unsigned i0 = ii[iface][inode][0];
+              unsigned i1 = ii[iface][inode][1];
+              unsigned i2 = ii[iface][inode][2];  
+              SolDd1[k][i0] = NeumannFactor * (- 1./3. * SolDd[k][i1] + 4./3 * SolDd[k][ i2 ] ) + (1. - NeumannFactor) * SolDd[k][i0];
             }
           }
         }
+      }
       
-        
-        std::vector <double> particleDisp(dim, 0.);
-        //update displacement and acceleration
-        for(int i = 0; i < dim; i++) {
+      //update displacement and acceleration
+      std::vector <double> particleDisp(dim);
+      for(int i = 0; i < dim; i++) {
+        particleDisp[i] = particleDispArray[i][ip];
+      }
+      
+      particle->SetMarkerDisplacement(particleDisp);
+      particle->UpdateParticleCoordinates();
+      
+      std::vector <double> particleAcc(dim);
+      std::vector <double> particleVel(dim);
+      for(unsigned i = 0; i < dim; i++) {
+        particleAcc[i] = 1. / (beta * dt * dt) * particleDisp[i] - 1. / (beta * dt) * particleVelOld[i] - (1. - 2.* beta) / (2. * beta) * particleAccOld[i];
+        particleVel[i] = particleVelOld[i] + dt * ((1. - Gamma) * particleAccOld[i] + Gamma * particleAcc[i]);
+      }
+      
+      particle->SetMarkerVelocity(particleVel);
+      particle->SetMarkerAcceleration(particleAcc);
+      
+      //   update the deformation gradient
+      
+      for(int i = 0; i < dim; i++) {
+        for(int j = 0; j < dim; j++) {
+          GradSolDpHat[i][j] = 0.;
           for(unsigned inode = 0; inode < nve; inode++) {
-            particleDisp[i] += phi_hat[inode] * SolDd[i][inode];
-          }
-        }
-        
-        particles[iMarker]->SetMarkerDisplacement(particleDisp);
-        particles[iMarker]->UpdateParticleCoordinates();
-        
-        std::vector <double> particleAcc(dim);
-        std::vector <double> particleVel(dim);
-        for(unsigned i = 0; i < dim; i++) {
-          particleAcc[i] = 1. / (beta * dt * dt) * particleDisp[i] - 1. / (beta * dt) * particleVelOld[i] - (1. - 2.* beta) / (2. * beta) * particleAccOld[i];
-          particleVel[i] = particleVelOld[i] + dt * ((1. - Gamma) * particleAccOld[i] + Gamma * particleAcc[i]);
-        }
-        
-        particles[iMarker]->SetMarkerVelocity(particleVel);
-        particles[iMarker]->SetMarkerAcceleration(particleAcc);
-        
-        //   update the deformation gradient
-        
-        for(int i = 0; i < dim; i++) {
-          for(int j = 0; j < dim; j++) {
-            GradSolDpHat[i][j] = 0.;
-            for(unsigned inode = 0; inode < nve; inode++) {
-              GradSolDpHat[i][j] +=  gradphi_hat[inode * dim + j] * SolDd1[i][inode];
-            }
+            GradSolDpHat[i][j] +=  gradphi_hat[inode * dim + j] * SolDd1[i][inode];
           }
         }
-        
-        std::vector < std::vector < double > > FpOld;
-        FpOld = particles[iMarker]->GetDeformationGradient(); //extraction of the deformation gradient
-        
-        double FpNew[3][3] = {{1., 0., 0.}, {0., 1., 0.}, {0., 0., 1.}};
-        std::vector < std::vector < double > > Fp(dim);
-        
-        for(unsigned i = 0; i < dim; i++) {
-          for(unsigned j = 0; j < dim; j++) {
-            FpNew[i][j] += GradSolDpHat[i][j];
-          }
+      }
+      
+      std::vector < std::vector < double > > FpOld;
+      FpOld = particle->GetDeformationGradient(); //extraction of the deformation gradient
+      
+      double FpNew[3][3] = {{1., 0., 0.}, {0., 1., 0.}, {0., 0., 1.}};
+      std::vector < std::vector < double > > Fp(dim);
+      
+      for(unsigned i = 0; i < dim; i++) {
+        for(unsigned j = 0; j < dim; j++) {
+          FpNew[i][j] += GradSolDpHat[i][j];
         }
-        
-        for(unsigned i = 0; i < dim; i++) {
-          Fp[i].resize(dim);
-          for(unsigned j = 0; j < dim; j++) {
-            Fp[i][j] = 0.;
-            for(unsigned k = 0; k < dim; k++) {
-              Fp[i][j] += FpNew[i][k] * FpOld[k][j];
-            }
+      }
+      
+      for(unsigned i = 0; i < dim; i++) {
+        Fp[i].resize(dim);
+        for(unsigned j = 0; j < dim; j++) {
+          Fp[i][j] = 0.;
+          for(unsigned k = 0; k < dim; k++) {
+            Fp[i][j] += FpNew[i][k] * FpOld[k][j];
           }
         }
-        
-        particles[iMarker]->SetDeformationGradient(Fp);
-        
-        ielOld = iel;
-    }
-    else {
-      break;
+      }
+      
+      particle->SetDeformationGradient(Fp);
     }
   }
   //END loop on particles
@@ -1280,7 +1252,10 @@ void GridToParticlesProjection(MultiLevelProblem & ml_prob, Line & linea) {
     }
   }
   //END loop on elements to update grid velocity and acceleration
-  
+
+  // the grid displacement is back to zero
+  mymsh->InvalidateDisplacedGeometryCache();
+
   linea.UpdateLineMPM();
   
   linea.GetParticlesToGridMaterial();
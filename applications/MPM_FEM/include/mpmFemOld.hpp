@@ -129,8 +129,8 @@ void AssembleMPMSys(MultiLevelProblem& ml_prob) {
 
   //line instances
   std::vector<unsigned> markerOffset = linea->GetMarkerOffset();
-  unsigned markerOffset1 = markerOffset[iproc];
-  unsigned markerOffset2 = markerOffset[iproc + 1];
+  unsigned markerOffset1 = 0; // the particles of iproc are stored locally
+  unsigned markerOffset2 = markerOffset[iproc + 1] - markerOffset[iproc];
   std::vector<Marker*> particles = linea->GetParticles();
   //std::map<unsigned, std::vector < std::vector < std::vector < std::vector < double > > > > > aX;
 
@@ -718,8 +718,8 @@ void GridToParticlesProjection(MultiLevelProblem & ml_prob, Line & linea) {
 
   //line instances
   std::vector<unsigned> markerOffset = linea.GetMarkerOffset();
-  unsigned markerOffset1 = markerOffset[iproc];
-  unsigned markerOffset2 = markerOffset[iproc + 1];
+  unsigned markerOffset1 = 0; // the particles of iproc are stored locally
+  unsigned markerOffset2 = markerOffset[iproc + 1] - markerOffset[iproc];
   std::vector<Marker*> particles = linea.GetParticles();
   //std::map<unsigned, std::vector < std::vector < std::vector < std::vector < double > > > > > aX;
 
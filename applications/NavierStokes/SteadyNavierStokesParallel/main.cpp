@@ -387,7 +387,7 @@ static unsigned counter = 0;
 
 void AssembleMatrixResNS ( MultiLevelProblem &ml_prob ) {
 
-  adept::Stack & adeptStack = FemusInit::_adeptStack;
+  adept::Stack & adeptStack = FemusInit::GetAdeptStack();
 
   clock_t AssemblyTime = 0;
   clock_t start_time, end_time;
@@ -955,7 +955,7 @@ void SetLambda ( MultiLevelSolution &mlSol, const unsigned &level, const  FEOrde
   clock_t start_time, end_time;
   start_time = clock();
 
-  adept::Stack & adeptStack = FemusInit::_adeptStack;
+  adept::Stack & adeptStack = FemusInit::GetAdeptStack();
 
   Solution *mysolution = mlSol.GetSolutionLevel ( level );
   Mesh *mymsh	=  mlSol._mlMesh->GetLevel ( level );
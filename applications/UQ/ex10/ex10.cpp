@@ -79,6 +79,7 @@ double muLaplace = 0.;
 //END
 
 unsigned numberOfUniformLevels = 4; //refinement for the PDE mesh
+bool matrixFreeSG = true; // solve the SG system with the matrix free operator instead of assembling the Jp^2 blocks
 
 int main (int argc, char** argv) {
 
@@ -209,7 +210,12 @@ int main (int argc, char** argv) {
 
 
 //BEGIN solve SGM system
-  systemSG.MGsolve();
+  if (matrixFreeSG) {
+    SolveSysSGMatrixFree (ml_prob, ml_probSG, 1.e-10, 1000);
+  }
+  else {
+    systemSG.MGsolve();
+  }
 //END
 
 
@@ -14,6 +14,8 @@
 
 #include "slepceps.h"
 
+#include "MonteCarloSampler.hpp"
+
 #include "../include/sfem_assembly.hpp"
 
 using namespace femus;
@@ -29,6 +31,8 @@ void GetEigenPair(MultiLevelProblem& ml_prob, const int& numberOfEigPairs, std::
 
 void GetQuantityOfInterest(MultiLevelProblem& ml_prob, std::vector < double >&  QoI, const unsigned& m, const double& domainMeasure);
 
+void SampleQuantityOfInterest(MultiLevelProblem& ml_prob, const unsigned& level, const std::vector < double >& y, std::vector < double >& qoi);
+
 void GetStochasticData(std::vector <double>& QoI);
 
 void PlotStochasticData();
@@ -47,6 +51,8 @@ double stdDeviationQoI = 0.; //initialization
 double startPoint = - 3.8;
 double endPoint = 3.8;
 unsigned M = 10000; //number of samples for the Monte Carlo
+std::vector <double> QoI; //quantity of interest of the samples, in the sample order
+unsigned sampleCounter = 0;
 double deltat;
 int pdfHistogramSize;
 //END
@@ -111,6 +117,10 @@ int main(int argc, char** argv) {
   // ******* set MG-Solver *******
   system.SetMgType(V_CYCLE);
 
+  // the samples change the values of the matrix only
+  system.SetCoarseOperatorReuse(true);
+  system.SetDirectMatrixInsertion(true);
+
   system.SetAbsoluteLinearConvergenceTolerance(1.e-50);
   //   system.SetNonLinearConvergenceTolerance(1.e-9);
 //   system.SetMaxNumberOfNonLinearIterations(20);
@@ -155,18 +165,12 @@ int main(int argc, char** argv) {
 
 
 
-  std::vector <double> QoI(M, 0.);
-
-
-  for(unsigned m = 0; m < M; m++) {
+  QoI.assign(M, 0.);
 
-    std::cout << " --------------------------------------------------- m = " << m << " ---------------------------------------------------  " << std::endl;
-
-    system.MGsolve();
-
-    GetQuantityOfInterest(ml_prob, QoI, m, domainMeasure);
-
-  }
+  // one sample group: all the processes solve every sample, the random variables are drawn locally by the sampler
+  MonteCarloSampler sampler(ml_prob, SampleQuantityOfInterest, numberOfEigPairs, 1, static_cast < UqQuadratureType >(quadratureType));
+  sampler.Run(M, numberOfUniformLevels - 1);
+  sampler.PrintStatistics();
 
 //   for(unsigned m = 0; m < M; m++) {
 //     std::cout << "QoI[" << m << "] = " << QoI[m] << std::endl;
@@ -732,6 +736,21 @@ void GetEigenPair(MultiLevelProblem& ml_prob, const int& numberOfEigPairs, std::
 }
 
 
+void SampleQuantityOfInterest(MultiLevelProblem& ml_prob, const unsigned& level, const std::vector < double >& y, std::vector < double >& qoi) {
+
+  std::cout << " --------------------------------------------------- m = " << sampleCounter << " ---------------------------------------------------  " << std::endl;
+
+  yOmega = y;
+
+  ml_prob.get_system<LinearImplicitSystem> ("UQ").MGsolve();
+
+  GetQuantityOfInterest(ml_prob, QoI, sampleCounter, domainMeasure);
+  qoi[0] = QoI[sampleCounter];
+
+  sampleCounter++;
+
+}
+
 void GetQuantityOfInterest(MultiLevelProblem& ml_prob, std::vector < double >&  QoI, const unsigned& m, const double& domainMeasure) {
 
   //  extract pointers to the several objects that we are going to use
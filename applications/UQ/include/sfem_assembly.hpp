@@ -1,6 +1,3 @@
-#include <boost/random.hpp>
-#include <boost/random/normal_distribution.hpp>
-
 //THIS IS THE ASSEMBLY TO RUN MONTE CARLO SIMULATIONS OF POISSON's EQUATION
 
 using namespace femus;
@@ -28,16 +25,21 @@ double amin = 1. / 100.;
 double stdDeviationInput = 0.8;  //standard deviation of the normal distribution (it is the same as the standard deviation of the covariance function in GetEigenPair)
 double meanInput = 0.;
 
-//FOR STD GAUSSIAN SAMPLING
-boost::mt19937 rng; // I don't seed it on purpouse (it's not relevant)
-boost::normal_distribution<> nd ( 0., 1. );
-boost::variate_generator < boost::mt19937&,
-      boost::normal_distribution<> > var_nor ( rng, nd );
+//realization of the random variables assembled by AssembleUQSys, set by the Monte Carlo sample function
+std::vector <double> yOmega ( numberOfEigPairs, 0. );
+
+//deterministic part of the element assembly, computed by the first assembly of each level and reused by all the samples
+struct DeterministicElementData {
+    std::vector < int > l2GMap;
+    std::vector < unsigned > solDof;
+    std::vector < double > weight; // [ig]
+    std::vector < double > phi; // [ig * nDofu + i]
+    std::vector < double > phi_x; // [ ( ig * nDofu + i ) * dim + jdim]
+    std::vector < double > KLmodes; // sqrt(lambda_j) * egnf_j at the gauss points, [ig * numberOfEigPairs + j]
+};
 
-//FOR UNIFORM SAMPLING
-boost::mt19937 rng1; // I don't seed it on purpouse (it's not relevant)
-boost::random::uniform_real_distribution<> un ( - 1., 1. );
-boost::variate_generator < boost::mt19937&, boost::random::uniform_real_distribution<> > var_unif ( rng1, un );
+//[level][iel - elementOffset], it has to be cleared if the eigenpairs are computed again
+std::vector < std::vector < DeterministicElementData > > deterministicData;
 
 double GetExactSolutionLaplace ( const std::vector < double >& x )
 {
@@ -46,17 +48,100 @@ double GetExactSolutionLaplace ( const std::vector < double >& x )
 };
 
 
-void AssembleUQSys ( MultiLevelProblem& ml_prob )
+void BuildDeterministicData ( MultiLevelProblem& ml_prob, const unsigned &level, std::vector < DeterministicElementData > &data )
 {
-    //  ml_prob is the global object from/to where get/set all the data
-    //  level is the level of the PDE system to be assembled
-    //  levelMax is the Maximum level of the MultiLevelProblem
-    //  assembleMatrix is a flag that tells if only the residual or also the matrix should be assembled
+    LinearImplicitSystem* mlPdeSys  = &ml_prob.get_system<LinearImplicitSystem> ( "UQ" );
+
+    Mesh*                    msh = ml_prob._ml_msh->GetLevel ( level );
+    MultiLevelSolution*    mlSol = ml_prob._ml_sol;
+    Solution*                sol = ml_prob._ml_sol->GetSolutionLevel ( level );
+    LinearEquationSolver* pdeSys = mlPdeSys->_LinSolver[level];
+
+    const unsigned  dim = msh->GetDimension();
+    unsigned    iproc = msh->processor_id();
+
+    unsigned soluIndex = mlSol->GetIndex ( "u" );
+    unsigned soluType = mlSol->GetSolutionType ( soluIndex );
+    unsigned soluPdeIndex = mlPdeSys->GetSolPdeIndex ( "u" );
+
+    char name[10];
+    std::vector <unsigned> eigfIndex ( numberOfEigPairs );
+
+    for ( unsigned i = 0; i < numberOfEigPairs; i++ ) {
+        sprintf ( name, "egnf%d", i );
+        eigfIndex[i] = mlSol->GetIndex ( name );
+    }
+
+    vector < vector < double > > x ( dim );
+    unsigned xType = 2;
+
+    vector <double> phi;
+    vector <double> phi_x;
+    double weight;
+
+    data.resize ( msh->_elementOffset[iproc + 1] - msh->_elementOffset[iproc] );
+
+    for ( int iel = msh->_elementOffset[iproc]; iel < msh->_elementOffset[iproc + 1]; iel++ ) {
+
+        DeterministicElementData &d = data[iel - msh->_elementOffset[iproc]];
+
+        short unsigned ielGeom = msh->GetElementType ( iel );
+        unsigned nDofu  = msh->GetElementDofNumber ( iel, soluType );
+        unsigned nDofx = msh->GetElementDofNumber ( iel, xType );
+        unsigned nGauss = msh->_finiteElement[ielGeom][soluType]->GetGaussPointNumber();
+
+        d.l2GMap.resize ( nDofu );
+        d.solDof.resize ( nDofu );
+
+        for ( unsigned i = 0; i < nDofu; i++ ) {
+            d.solDof[i] = msh->GetSolutionDof ( i, iel, soluType );
+            d.l2GMap[i] = pdeSys->GetSystemDof ( soluIndex, soluPdeIndex, i, iel );
+        }
+
+        for ( int i = 0; i < dim; i++ ) {
+            x[i].resize ( nDofx );
+        }
+
+        for ( unsigned i = 0; i < nDofx; i++ ) {
+            unsigned xDof  = msh->GetSolutionDof ( i, iel, xType );
 
-    // call the adept stack object
+            for ( unsigned jdim = 0; jdim < dim; jdim++ ) {
+                x[jdim][i] = ( *msh->_topology->_Sol[jdim] ) ( xDof );
+            }
+        }
+
+        d.weight.resize ( nGauss );
+        d.phi.resize ( nGauss * nDofu );
+        d.phi_x.resize ( nGauss * nDofu * dim );
+        d.KLmodes.assign ( nGauss * numberOfEigPairs, 0. );
+
+        for ( unsigned ig = 0; ig < nGauss; ig++ ) {
+            msh->_finiteElement[ielGeom][soluType]->Jacobian ( x, ig, weight, phi, phi_x, boost::none );
+
+            d.weight[ig] = weight;
+
+            for ( unsigned i = 0; i < nDofu; i++ ) {
+                d.phi[ig * nDofu + i] = phi[i];
 
+                for ( unsigned jdim = 0; jdim < dim; jdim++ ) {
+                    d.phi_x[ ( ig * nDofu + i ) * dim + jdim] = phi_x[i * dim + jdim];
+                }
+
+                for ( unsigned j = 0; j < numberOfEigPairs; j++ ) {
+                    d.KLmodes[ig * numberOfEigPairs + j] += sqrt ( eigenvalues[j].first ) * ( *sol->_Sol[eigfIndex[j]] ) ( d.solDof[i] ) * phi[i];
+                }
+            }
+        }
+    }
+}
 
-    adept::Stack& s = FemusInit::_adeptStack;
+
+void AssembleUQSys ( MultiLevelProblem& ml_prob )
+{
+    //  ml_prob is the global object from/to where get/set all the data
+    //  level is the level of the PDE system to be assembled
+    //  the problem is linear in u: the element matrix is sum_ig a(x_ig, yOmega) * weight * grad phi_i . grad phi_j,
+    //  only the coefficient a depends on the sample, everything else comes from deterministicData
 
     //  extract pointers to the several objects that we are going to use
 
@@ -64,7 +149,6 @@ void AssembleUQSys ( MultiLevelProblem& ml_prob )
     const unsigned level = mlPdeSys->GetLevelToAssemble();
 
     Mesh*                    msh = ml_prob._ml_msh->GetLevel ( level ); // pointer to the mesh (level) object
-    elem*                     el = msh->el;  // pointer to the elem object in msh (level)
 
     MultiLevelSolution*    mlSol = ml_prob._ml_sol;  // pointer to the multilevel solution object
     Solution*                sol = ml_prob._ml_sol->GetSolutionLevel ( level ); // pointer to the solution (level) object
@@ -74,7 +158,6 @@ void AssembleUQSys ( MultiLevelProblem& ml_prob )
     NumericVector*           RES = pdeSys->_RES; // pointer to the global residual vector object in pdeSys (level)
 
     const unsigned  dim = msh->GetDimension(); // get the domain dimension of the problem
-    unsigned dim2 = ( 3 * ( dim - 1 ) + ! ( dim - 1 ) ); // dim2 is the number of second order partial derivatives (1,3,6 depending on the dimension)
     const unsigned maxSize = static_cast< unsigned > ( ceil ( pow ( 3, dim ) ) ); // conservative: based on line3, quad9, hex27
 
     unsigned    iproc = msh->processor_id(); // get the process_id (for parallel computation)
@@ -82,49 +165,14 @@ void AssembleUQSys ( MultiLevelProblem& ml_prob )
     //solution variable
     unsigned soluIndex;
     soluIndex = mlSol->GetIndex ( "u" ); // get the position of "u" in the ml_sol object
-    unsigned soluType = mlSol->GetSolutionType ( soluIndex ); // get the finite element type for "u"
-
-    char name[10];
-    std::vector <unsigned> eigfIndex ( numberOfEigPairs );
-
-    for ( unsigned i = 0; i < numberOfEigPairs; i++ ) {
-        sprintf ( name, "egnf%d", i );
-        eigfIndex[i] = mlSol->GetIndex ( name ); // get the position of "u" in the ml_sol object
-    }
 
+    if ( deterministicData.size() <= level ) deterministicData.resize ( level + 1 );
 
-    unsigned soluPdeIndex;
-    soluPdeIndex = mlPdeSys->GetSolPdeIndex ( "u" ); // get the position of "u" in the pdeSys object
+    if ( deterministicData[level].size() == 0 ) BuildDeterministicData ( ml_prob, level, deterministicData[level] );
 
-    vector < adept::adouble >  solu; // local solution
+    vector < double >  solu; // local solution
     solu.reserve ( maxSize );
 
-
-    vector < double > KLexpansion; // local solution
-    KLexpansion.reserve ( maxSize );
-
-
-    vector < vector < double > > x ( dim ); // local coordinates
-    unsigned xType = 2; // get the finite element type for "x", it is always 2 (LAGRANGE QUADRATIC)
-
-    for ( unsigned i = 0; i < dim; i++ ) {
-        x[i].reserve ( maxSize );
-    }
-
-    vector <double> phi;  // local test function
-    vector <double> phi_x; // local test function first order partial derivatives
-    vector <double> phi_xx; // local test function second order partial derivatives
-    double weight; // gauss point weight
-
-    phi.reserve ( maxSize );
-    phi_x.reserve ( maxSize * dim );
-    phi_xx.reserve ( maxSize * dim2 );
-
-    vector< adept::adouble > aRes; // local redidual vector
-    aRes.reserve ( maxSize );
-
-    vector< int > l2GMap; // local to global mapping
-    l2GMap.reserve ( maxSize );
     vector< double > Res; // local redidual vector
     Res.reserve ( maxSize );
     vector < double > Jac;
@@ -132,154 +180,85 @@ void AssembleUQSys ( MultiLevelProblem& ml_prob )
 
     KK->zero(); // Set to zero all the entries of the Global Matrix
 
-    std::vector <double> yOmega ( numberOfEigPairs, 0. );
-
     for ( unsigned eig = 0; eig < numberOfEigPairs; eig++ ) {
-        if ( iproc == 0 ) {
-            if ( quadratureType == 0 ) {
-                yOmega[eig] = var_nor();
-            }
-
-            else if ( quadratureType == 1 ) {
-                yOmega[eig] = var_unif();
-            }
-        }
-
-        MPI_Bcast ( &yOmega[eig], 1, MPI_DOUBLE, 0, MPI_COMM_WORLD );
         std::cout << " ----------------------------- yOmega =" << yOmega[eig] << " ";
     }
 
     std::cout << std::endl;
 
-
-
-
-
-
     // element loop: each process loops only on the elements that owns
     for ( int iel = msh->_elementOffset[iproc]; iel < msh->_elementOffset[iproc + 1]; iel++ ) {
 
-        short unsigned ielGeom = msh->GetElementType ( iel );
-        unsigned nDofu  = msh->GetElementDofNumber ( iel, soluType ); // number of solution element dofs
-        unsigned nDofx = msh->GetElementDofNumber ( iel, xType ); // number of coordinate element dofs
+        const DeterministicElementData &d = deterministicData[level][iel - msh->_elementOffset[iproc]];
+
+        unsigned nDofu  = d.l2GMap.size(); // number of solution element dofs
+        unsigned nGauss = d.weight.size();
 
         // resize local arrays
-        l2GMap.resize ( nDofu );
         solu.resize ( nDofu );
-        KLexpansion.resize ( nDofu );
-
-        for ( int i = 0; i < dim; i++ ) {
-            x[i].resize ( nDofx );
-        }
-
-        aRes.resize ( nDofu ); //resize
-        std::fill ( aRes.begin(), aRes.end(), 0 ); //set aRes to zero
+        Res.assign ( nDofu, 0. );
+        Jac.assign ( nDofu * nDofu, 0. );
 
-        // local storage of global mapping and solution
         for ( unsigned i = 0; i < nDofu; i++ ) {
-            unsigned solDof = msh->GetSolutionDof ( i, iel, soluType ); // global to global mapping between solution node and solution dof
-            solu[i] = ( *sol->_Sol[soluIndex] ) ( solDof ); // global extraction and local storage for the solution
-            KLexpansion[i] = 0.;
-
-            for ( unsigned j = 0; j < numberOfEigPairs; j++ ) {
-                KLexpansion[i] += sqrt ( eigenvalues[j].first ) * ( *sol->_Sol[eigfIndex[j]] ) ( solDof ) * yOmega[j];
-            }
-
-            l2GMap[i] = pdeSys->GetSystemDof ( soluIndex, soluPdeIndex, i, iel ); // global to global mapping between solution node and pdeSys dof
-        }
-
-        // local storage of coordinates
-        for ( unsigned i = 0; i < nDofx; i++ ) {
-            unsigned xDof  = msh->GetSolutionDof ( i, iel, xType ); // global to global mapping between coordinates node and coordinate dof
-
-            for ( unsigned jdim = 0; jdim < dim; jdim++ ) {
-                x[jdim][i] = ( *msh->_topology->_Sol[jdim] ) ( xDof ); // global extraction and local storage for the element coordinates
-            }
+            solu[i] = ( *sol->_Sol[soluIndex] ) ( d.solDof[i] ); // global extraction and local storage for the solution
         }
 
-
-        // start a new recording of all the operations involving adept::adouble variables
-        s.new_recording();
-
         // *** Gauss point loop ***
-        for ( unsigned ig = 0; ig < msh->_finiteElement[ielGeom][soluType]->GetGaussPointNumber(); ig++ ) {
-            // *** get gauss point weight, test function and test function partial derivatives ***
-            msh->_finiteElement[ielGeom][soluType]->Jacobian ( x, ig, weight, phi, phi_x, boost::none );
-
-            // evaluate the solution, the solution derivatives and the coordinates in the gauss point
+        for ( unsigned ig = 0; ig < nGauss; ig++ ) {
 
             double KLexpansion_gss = 0.;
-            vector < adept::adouble > gradSolu_gss ( dim, 0. );
-            vector < double > x_gss ( dim, 0. );
 
-            for ( unsigned i = 0; i < nDofu; i++ ) {
-
-                KLexpansion_gss += phi[i] * KLexpansion[i];
-
-                for ( unsigned jdim = 0; jdim < dim; jdim++ ) {
-                    gradSolu_gss[jdim] += phi_x[i * dim + jdim] * solu[i];
-                    x_gss[jdim] += x[jdim][i] * phi[i];
-                }
+            for ( unsigned j = 0; j < numberOfEigPairs; j++ ) {
+                KLexpansion_gss += d.KLmodes[ig * numberOfEigPairs + j] * yOmega[j];
             }
 
             //BEGIN log(a-amin) = KL expansion
             double aCoeff = amin + exp ( KLexpansion_gss );
-//       std::cout << "COEEEEEEEEEEEEEEEEEEEEF =  " << aCoeff << std::endl;
             //END log(a-amin) = KL expansion
 
 
-            //BEGIN a = 1 + y1^2 + y2^2 + y3^2 
+            //BEGIN a = 1 + y1^2 + y2^2 + y3^2
 //             double aCoeff = 1.;
 //             for ( unsigned i = 0; i < numberOfEigPairs; i++ ) {
 //                 aCoeff += yOmega[i] * yOmega[i];
 //             }
             //END
 
+            double weight = d.weight[ig];
+            const double *phi = &d.phi[ig * nDofu];
+            const double *phi_x = &d.phi_x[ig * nDofu * dim];
 
             // *** phi_i loop ***
             for ( unsigned i = 0; i < nDofu; i++ ) {
 
-                adept::adouble laplace = 0.;
+                double srcTerm = 1./*- GetExactSolutionLaplace(x_gss)*/ ;
+                Res[i] -= srcTerm * phi[i] * weight;
 
-                for ( unsigned jdim = 0; jdim < dim; jdim++ ) {
-                    laplace   +=  aCoeff * phi_x[i * dim + jdim] * gradSolu_gss[jdim];
-                }
+                for ( unsigned j = 0; j < nDofu; j++ ) {
+                    double laplace = 0.;
 
-                double srcTerm = 1./*- GetExactSolutionLaplace(x_gss)*/ ;
-                aRes[i] += ( srcTerm * phi[i] + laplace ) * weight;
+                    for ( unsigned jdim = 0; jdim < dim; jdim++ ) {
+                        laplace += phi_x[i * dim + jdim] * phi_x[j * dim + jdim];
+                    }
 
+                    Jac[i * nDofu + j] += aCoeff * laplace * weight;
+                }
             } // end phi_i loop
         } // end gauss point loop
 
-        //--------------------------------------------------------------------------------------------------------
-        // Add the local Matrix/Vector into the global Matrix/Vector
-
-        //copy the value of the adept::adoube aRes in double Res and store
-        Res.resize ( nDofu ); //resize
-
-        for ( int i = 0; i < nDofu; i++ ) {
-            Res[i] = - aRes[i].value();
+        for ( unsigned i = 0; i < nDofu; i++ ) {
+            for ( unsigned j = 0; j < nDofu; j++ ) {
+                Res[i] -= Jac[i * nDofu + j] * solu[j];
+            }
         }
 
-        RES->add_vector_blocked ( Res, l2GMap );
-
-
-
-        // define the dependent variables
-        s.dependent ( &aRes[0], nDofu );
-
-        // define the independent variables
-        s.independent ( &solu[0], nDofu );
+        //--------------------------------------------------------------------------------------------------------
+        // Add the local Matrix/Vector into the global Matrix/Vector
 
-        // get the jacobian matrix (ordered by row major )
-        Jac.resize ( nDofu * nDofu ); //resize
-        s.jacobian ( &Jac[0], true );
+        RES->add_vector_blocked ( Res, d.l2GMap );
 
         //store K in the global matrix KK
-        KK->add_matrix_blocked ( Jac, l2GMap, l2GMap );
-
-        s.clear_independents();
-        s.clear_dependents();
+        KK->add_matrix_blocked ( Jac, d.l2GMap, d.l2GMap );
 
     } //end element loop for each process
 
@@ -289,7 +268,3 @@ void AssembleUQSys ( MultiLevelProblem& ml_prob )
 
     // ***************** END ASSEMBLY *******************
 }
-
-
-
-
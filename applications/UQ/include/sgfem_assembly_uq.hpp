@@ -1,4 +1,5 @@
 #include "UqQuadratureTypeEnum.hpp"
+#include "StochasticGalerkinOperator.hpp"
 using namespace femus;
 
 //THIS IS THE MOST UPDATED ASSEMBLY FOR SGM SIMULATIONS OF POISSON's EQUATION with HERMITE or LEGENDRE POLYNOMIALS
@@ -19,6 +20,50 @@ std::vector < std::pair<double, double> > eigenvalues (numberOfEigPairs);
 
 //END Stochastic Input Parameters
 
+void GetStochasticCoefficients (const std::vector <double> &eigVectorGauss, std::vector <double> &aStochastic) {
+
+  //polynomial chaos coefficients a_q(x_ig) of a = amin + exp(KL expansion), from the KL eigenfunctions at the gauss point
+
+  const std::vector < std::vector < std::vector < double > > > & integralMatrix = myuq.GetIntegralMatrix (qIndex, pIndex);
+  const std::vector < std::vector <unsigned> > &Jq = myuq.GetIndexSet (qIndex, numberOfEigPairs);
+
+  aStochastic.resize (Jq.size());
+
+  for (unsigned q1 = 0; q1 < Jq.size(); q1 ++) {
+    std::vector <double> aStochasticTerm2 (numberOfEigPairs);
+
+    unsigned numberOfQuadraturePointsForProjection = 16;
+
+    const double *quadraturePoints = myuq.GetQuadraturePoints (numberOfQuadraturePointsForProjection);
+    const double *quadratureWeights = myuq.GetQuadratureWeights (numberOfQuadraturePointsForProjection);
+
+    const std::vector < std::vector < double > >  &polyProjection = myuq.GetPolynomial (numberOfQuadraturePointsForProjection, qIndex);
+
+    for (unsigned i = 0; i < numberOfEigPairs; i++) {
+      aStochasticTerm2[i] = 0.;
+
+      for (unsigned j = 0; j < numberOfQuadraturePointsForProjection; j++) {
+        aStochasticTerm2[i] += exp (sqrt (eigenvalues[i].first) * eigVectorGauss[i] * quadraturePoints[j])
+                               * polyProjection[Jq[q1][i]][j] * quadratureWeights[j];
+      }
+    }
+
+    double aS1 = 1.;
+    double aS2 = 1.;
+
+    for (unsigned i = 0; i < numberOfEigPairs; i++) {
+      aS1 *= integralMatrix[Jq[q1][i]][0][0];
+      aS2 *= aStochasticTerm2[i];
+    }
+
+    aStochastic[q1] = amin * aS1 + aS2; //a_q(x_ig)
+
+    if (fabs (aStochastic[q1]) > 10.) {
+      std::cout << " coeff =  " << aStochastic[q1] << std::endl;
+    }
+  }
+}
+
 void AssembleSysSG (MultiLevelProblem& ml_prob) {
 
   //  ml_prob is the global object from/to where get/set all the data
@@ -48,7 +93,8 @@ void AssembleSysSG (MultiLevelProblem& ml_prob) {
 
   const std::vector < std::vector < std::vector < double > > > & integralMatrix = myuq.GetIntegralMatrix (qIndex, pIndex);
 
-  const std::vector < std::vector < std::vector < double > > >  &G = myuq.GetStochasticMassMatrix (qIndex, pIndex, numberOfEigPairs);
+  const SparseStochasticTensor &G = myuq.GetSparseStochasticMassMatrix (qIndex, pIndex, numberOfEigPairs);
+  std::vector < double > aG; // sum_q1 aStochastic[q1] G[q1][p1][p2] on the (p1, p2) pattern of G
 
   const std::vector < std::vector <unsigned> > &Jq = myuq.GetIndexSet (qIndex, numberOfEigPairs);
   const std::vector < std::vector <unsigned> > &Jp = myuq.GetIndexSet (pIndex, numberOfEigPairs);
@@ -179,42 +225,7 @@ void AssembleSysSG (MultiLevelProblem& ml_prob) {
       vector< double > aStochastic (Jq.size());
 
 //BEGIN coefficient obtained projecting the exponential of the KL
-      for (unsigned q1 = 0; q1 < Jq.size(); q1 ++) {
-        std::vector <double> aStochasticTerm2 (numberOfEigPairs);
-
-        unsigned numberOfQuadraturePointsForProjection = 16;
-
-        const double *quadraturePoints = myuq.GetQuadraturePoints (numberOfQuadraturePointsForProjection);
-        const double *quadratureWeights = myuq.GetQuadratureWeights (numberOfQuadraturePointsForProjection);
-
-        const std::vector < std::vector < double > >  &polyProjection = myuq.GetPolynomial (numberOfQuadraturePointsForProjection, qIndex);
-
-        for (unsigned i = 0; i < numberOfEigPairs; i++) {
-          aStochasticTerm2[i] = 0.;
-
-          for (unsigned j = 0; j < numberOfQuadraturePointsForProjection; j++) {
-            aStochasticTerm2[i] += exp (sqrt (eigenvalues[i].first) * eigVectorGauss[i] * quadraturePoints[j])
-                                   * polyProjection[Jq[q1][i]][j] * quadratureWeights[j];
-          }
-        }
-
-        double aS1 = 1.;
-        double aS2 = 1.;
-
-        for (unsigned i = 0; i < numberOfEigPairs; i++) {
-//           std::cout << "------------------- " << Jq[q1][i] << " ";
-          aS1 *= integralMatrix[Jq[q1][i]][0][0];
-          aS2 *= aStochasticTerm2[i];
-        }
-
-//         std::cout << " stochastic term 1= " << aS1 << " " << "stochastic term 2= " << aS2 << std::endl;
-
-        aStochastic[q1] = amin * aS1 + aS2; //a_q(x_ig)
-
-        if (fabs (aStochastic[q1]) > 10.) {
-          std::cout << " coeff =  " << aStochastic[q1] << std::endl;
-        }
-      }
+      GetStochasticCoefficients (eigVectorGauss, aStochastic);
 //END coefficient obtained projecting the exponential of the KL
 
 
@@ -272,6 +283,8 @@ void AssembleSysSG (MultiLevelProblem& ml_prob) {
       }
 
 
+      G.Contract (aStochastic, aG);
+
       for (unsigned p1 = 0; p1 < Jp.size(); p1++) {
 
         double srcTermStoch = 1.;
@@ -283,13 +296,11 @@ void AssembleSysSG (MultiLevelProblem& ml_prob) {
         for (unsigned i = 0; i < nDofu; i++) {
           double resU = 1. * phi[i] * srcTermStoch * weight;
 
-          for (unsigned p2 = 0; p2 < Jp.size(); p2++) {
-            for (unsigned j = 0; j < nDofu; j++) {
-              double AG = 0;
+          for (unsigned k = G.GetPatternRowBegin (p1); k < G.GetPatternRowEnd (p1); k++) {
+            unsigned p2 = G.GetPatternColumn (k);
 
-              for (unsigned q1 = 0; q1 < Jq.size(); q1++) {
-                AG += aStochastic[q1] * laplace[i][j] * G[q1][p1][p2];
-              }
+            for (unsigned j = 0; j < nDofu; j++) {
+              double AG = aG[k] * laplace[i][j];
 
               Jac[ (p1 * nDofu + i) * (Jp.size() * nDofu) +  p2 * nDofu + j] -= AG;
               resU +=  AG * solu[p2][j];
@@ -326,6 +337,314 @@ void AssembleSysSG (MultiLevelProblem& ml_prob) {
 // ***************** END ASSEMBLY *******************
 }
 
+void SolveSysSGMatrixFree (MultiLevelProblem& ml_prob, MultiLevelProblem& ml_probSG, const double &tolerance, const unsigned &maxIterations) {
+
+  //  Matrix free alternative to the MGsolve of the SG system on the finest level:
+  //  only the Jq spatial matrices K[q1] = int a_q1 grad(phi_i) grad(phi_j) are assembled, with the pattern of the scalar
+  //  system "UQ" of ml_prob, and the SG system sum_q1 G[q1] (x) K[q1] u = -f is solved with Jacobi preconditioned CG
+  //  applying the StochasticGalerkinOperator. The Dirichlet dofs are masked out with the Bdc vector.
+  //  The scalar system has the single variable u, so its dof layout is the one of the solutions uSG
+
+  LinearImplicitSystem* mlPdeSys  = &ml_prob.get_system<LinearImplicitSystem> ("UQ");
+  const unsigned level = ml_probSG._ml_msh->GetNumberOfLevels() - 1;
+
+  Mesh* msh = ml_probSG._ml_msh->GetLevel (level);
+  MultiLevelSolution* mlSol = ml_probSG._ml_sol;
+  Solution* sol = mlSol->GetSolutionLevel (level);
+
+  LinearEquationSolver* pdeSys = mlPdeSys->_LinSolver[level];
+
+  const unsigned  dim = msh->GetDimension();
+  unsigned iproc = msh->processor_id();
+
+  const std::vector < std::vector < std::vector < double > > > & integralMatrix = myuq.GetIntegralMatrix (qIndex, pIndex);
+  const SparseStochasticTensor &G = myuq.GetSparseStochasticMassMatrix (qIndex, pIndex, numberOfEigPairs);
+
+  const std::vector < std::vector <unsigned> > &Jq = myuq.GetIndexSet (qIndex, numberOfEigPairs);
+  const std::vector < std::vector <unsigned> > &Jp = myuq.GetIndexSet (pIndex, numberOfEigPairs);
+
+  std::vector <unsigned> soluIndex (Jp.size());
+
+  for (unsigned i = 0; i < Jp.size(); i++) {
+    char name[10];
+    sprintf (name, "uSG%d", i);
+    soluIndex[i] = mlSol->GetIndex (name);
+  }
+
+  unsigned soluType = mlSol->GetSolutionType (soluIndex[0]);
+  unsigned scalarIndex = mlSol->GetIndex ("u");
+  unsigned scalarPdeIndex = mlPdeSys->GetSolPdeIndex ("u");
+
+  std::vector <unsigned> eigfIndex (numberOfEigPairs);
+
+  for (unsigned i = 0; i < numberOfEigPairs; i++) {
+    char name[10];
+    sprintf (name, "egnf%d", i);
+    eigfIndex[i] = mlSol->GetIndex (name);
+  }
+
+  //BEGIN spatial matrices and right hand side
+  std::vector < Mat > KMat (Jq.size());
+  std::vector < SparseMatrix* > K (Jq.size());
+
+  for (unsigned q1 = 0; q1 < Jq.size(); q1++) {
+    pdeSys->_KK->close();
+    MatDuplicate ( (static_cast<PetscMatrix*> (pdeSys->_KK))->mat(), MAT_DO_NOT_COPY_VALUES, &KMat[q1]);
+    K[q1] = new PetscMatrix (KMat[q1]);
+  }
+
+  std::vector < NumericVector* > b (Jp.size());
+  std::vector < NumericVector* > x (Jp.size());
+  std::vector < NumericVector* > r (Jp.size());
+  std::vector < NumericVector* > z (Jp.size());
+  std::vector < NumericVector* > p (Jp.size());
+  std::vector < NumericVector* > q (Jp.size());
+  std::vector < NumericVector* > Dinv (Jp.size());
+
+  for (unsigned p1 = 0; p1 < Jp.size(); p1++) {
+    NumericVector** v[7] = {&b[p1], &x[p1], &r[p1], &z[p1], &p[p1], &q[p1], &Dinv[p1]};
+
+    for (unsigned k = 0; k < 7; k++) {
+      *v[k] = NumericVector::build().release();
+      (*v[k])->init (*pdeSys->_RES, false);
+      (*v[k])->zero();
+    }
+  }
+
+  vector < vector < double > > xCoord (dim);
+  unsigned xType = 2;
+
+  vector <double> phi;
+  vector <double> phi_x;
+  double weight;
+
+  vector< int > l2GMap;
+  vector < vector < double > > Kel (Jq.size());
+  vector < vector < double > > bel (Jp.size());
+
+  std::vector <double> eigVectorGauss (numberOfEigPairs);
+  std::vector <double> aStochastic (Jq.size());
+
+  std::vector <double> srcTermStoch (Jp.size(), 1.);
+
+  for (unsigned p1 = 0; p1 < Jp.size(); p1++) {
+    for (unsigned i = 0; i < numberOfEigPairs; i++) {
+      srcTermStoch[p1] *= integralMatrix[0][Jp[p1][i]][0];
+    }
+  }
+
+  for (int iel = msh->_elementOffset[iproc]; iel < msh->_elementOffset[iproc + 1]; iel++) {
+
+    short unsigned ielGeom = msh->GetElementType (iel);
+    unsigned nDofu  = msh->GetElementDofNumber (iel, soluType);
+    unsigned nDofx = msh->GetElementDofNumber (iel, xType);
+
+    l2GMap.resize (nDofu);
+
+    for (unsigned i = 0; i < nDofu; i++) {
+      l2GMap[i] = pdeSys->GetSystemDof (scalarIndex, scalarPdeIndex, i, iel);
+    }
+
+    for (int i = 0; i < dim; i++) {
+      xCoord[i].resize (nDofx);
+    }
+
+    for (unsigned i = 0; i < nDofx; i++) {
+      unsigned xDof  = msh->GetSolutionDof (i, iel, xType);
+
+      for (unsigned jdim = 0; jdim < dim; jdim++) {
+        xCoord[jdim][i] = (*msh->_topology->_Sol[jdim]) (xDof);
+      }
+    }
+
+    for (unsigned q1 = 0; q1 < Jq.size(); q1++) {
+      Kel[q1].assign (nDofu * nDofu, 0.);
+    }
+
+    for (unsigned p1 = 0; p1 < Jp.size(); p1++) {
+      bel[p1].assign (nDofu, 0.);
+    }
+
+    for (unsigned ig = 0; ig < msh->_finiteElement[ielGeom][soluType]->GetGaussPointNumber(); ig++) {
+
+      msh->_finiteElement[ielGeom][soluType]->Jacobian (xCoord, ig, weight, phi, phi_x, boost::none);
+
+      for (unsigned i = 0; i < numberOfEigPairs; i++) {
+        eigVectorGauss[i] = 0.;
+
+        for (unsigned j = 0; j < nDofu; j++) {
+          unsigned solDof = msh->GetSolutionDof (j, iel, soluType);
+          eigVectorGauss[i] += (*sol->_Sol[eigfIndex[i]]) (solDof) * phi[j];
+        }
+      }
+
+      GetStochasticCoefficients (eigVectorGauss, aStochastic);
+
+      for (unsigned i = 0; i < nDofu; i++) {
+        for (unsigned p1 = 0; p1 < Jp.size(); p1++) {
+          bel[p1][i] -= 1. * phi[i] * srcTermStoch[p1] * weight;
+        }
+
+        for (unsigned j = 0; j < nDofu; j++) {
+          double laplace = 0.;
+
+          for (unsigned kdim = 0; kdim < dim; kdim++) {
+            laplace += (phi_x[i * dim + kdim] * phi_x[j * dim + kdim]) * weight;
+          }
+
+          for (unsigned q1 = 0; q1 < Jq.size(); q1++) {
+            Kel[q1][i * nDofu + j] += aStochastic[q1] * laplace;
+          }
+        }
+      }
+    }
+
+    for (unsigned q1 = 0; q1 < Jq.size(); q1++) {
+      K[q1]->add_matrix_blocked (Kel[q1], l2GMap, l2GMap);
+    }
+
+    for (unsigned p1 = 0; p1 < Jp.size(); p1++) {
+      b[p1]->add_vector_blocked (bel[p1], l2GMap);
+    }
+  }
+
+  for (unsigned q1 = 0; q1 < Jq.size(); q1++) {
+    K[q1]->close();
+  }
+
+  NumericVector* mask = NumericVector::build().release();
+  mask->init (*pdeSys->_RES, false);
+
+  for (int i = mask->first_local_index(); i < mask->last_local_index(); i++) {
+    mask->set (i, (*sol->_Bdc[soluIndex[0]]) (i));
+  }
+
+  mask->close();
+
+  for (unsigned p1 = 0; p1 < Jp.size(); p1++) {
+    b[p1]->close();
+    b[p1]->pointwise_mult (*b[p1], *mask);
+  }
+  //END
+
+  //BEGIN Jacobi preconditioner, diagonal of the blocks (p1, p1): sum_q1 G[q1][p1][p1] diag(K[q1])
+  std::vector < NumericVector* > diagK (Jq.size());
+
+  for (unsigned q1 = 0; q1 < Jq.size(); q1++) {
+    diagK[q1] = NumericVector::build().release();
+    diagK[q1]->init (*pdeSys->_RES, false);
+    K[q1]->get_diagonal (*diagK[q1]);
+  }
+
+  for (unsigned blk = 0; blk < G.GetNumberOfBlocks(); blk++) {
+    unsigned p2 = G.GetBlockColumn (blk);
+
+    for (unsigned k = G.GetBlockBegin (blk); k < G.GetBlockEnd (blk); k++) {
+      if (G.GetRow (k) == p2) Dinv[p2]->add (G.GetValue (k), *diagK[G.GetBlockMode (blk)]);
+    }
+  }
+
+  for (unsigned p1 = 0; p1 < Jp.size(); p1++) {
+    Dinv[p1]->close();
+
+    for (int i = Dinv[p1]->first_local_index(); i < Dinv[p1]->last_local_index(); i++) {
+      double d = (*Dinv[p1]) (i);
+      Dinv[p1]->set (i, (d != 0.) ? (*mask) (i) / d : 0.);
+    }
+
+    Dinv[p1]->close();
+  }
+
+  for (unsigned q1 = 0; q1 < Jq.size(); q1++) {
+    delete diagK[q1];
+  }
+  //END
+
+  //BEGIN preconditioned conjugate gradient, x = 0
+  StochasticGalerkinOperator A (G, K);
+
+  double bNorm2 = 0.;
+  double rz = 0.;
+
+  for (unsigned p1 = 0; p1 < Jp.size(); p1++) {
+    *r[p1] = *b[p1];
+    z[p1]->pointwise_mult (*r[p1], *Dinv[p1]);
+    *p[p1] = *z[p1];
+    bNorm2 += b[p1]->dot (*b[p1]);
+    rz += r[p1]->dot (*z[p1]);
+  }
+
+  double rNorm2 = bNorm2;
+  unsigned it = 0;
+
+  while (it < maxIterations && rNorm2 > tolerance * tolerance * bNorm2) {
+
+    A.Apply (p, q);
+
+    double pq = 0.;
+
+    for (unsigned p1 = 0; p1 < Jp.size(); p1++) {
+      q[p1]->pointwise_mult (*q[p1], *mask);
+      pq += p[p1]->dot (*q[p1]);
+    }
+
+    double alpha = rz / pq;
+    double rzNew = 0.;
+    rNorm2 = 0.;
+
+    for (unsigned p1 = 0; p1 < Jp.size(); p1++) {
+      x[p1]->add (alpha, *p[p1]);
+      r[p1]->add (-alpha, *q[p1]);
+      z[p1]->pointwise_mult (*r[p1], *Dinv[p1]);
+      rzNew += r[p1]->dot (*z[p1]);
+      rNorm2 += r[p1]->dot (*r[p1]);
+    }
+
+    double beta = rzNew / rz;
+    rz = rzNew;
+
+    for (unsigned p1 = 0; p1 < Jp.size(); p1++) {
+      p[p1]->scale (beta);
+      p[p1]->add (*z[p1]);
+      p[p1]->close();
+    }
+
+    it++;
+  }
+
+  std::cout << " SG matrix free PCG: " << it << " iterations, relative residual = "
+            << ((bNorm2 > 0.) ? sqrt (rNorm2 / bNorm2) : 0.) << std::endl;
+  //END
+
+  for (unsigned p1 = 0; p1 < Jp.size(); p1++) {
+    x[p1]->close();
+
+    for (int i = x[p1]->first_local_index(); i < x[p1]->last_local_index(); i++) {
+      sol->_Sol[soluIndex[p1]]->set (i, (*x[p1]) (i));
+    }
+
+    sol->_Sol[soluIndex[p1]]->close();
+  }
+
+  for (unsigned p1 = 0; p1 < Jp.size(); p1++) {
+    delete b[p1];
+    delete x[p1];
+    delete r[p1];
+    delete z[p1];
+    delete p[p1];
+    delete q[p1];
+    delete Dinv[p1];
+  }
+
+  delete mask;
+
+  for (unsigned q1 = 0; q1 < Jq.size(); q1++) {
+    delete K[q1];
+    MatDestroy (&KMat[q1]);
+  }
+
+}
+
 
 
 
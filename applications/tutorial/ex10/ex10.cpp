@@ -232,7 +232,7 @@ void AssemblePoissonProblem_AD(MultiLevelProblem& ml_prob) {
   // call the adept stack object
 
 
-  adept::Stack& s = FemusInit::_adeptStack;
+  adept::Stack& s = FemusInit::GetAdeptStack();
 
   //  extract pointers to the several objects that we are going to use
 
@@ -5,6 +5,7 @@
  * on a square domain $\Omega$ with boundary $\Gamma$;
  * all the coarse-level meshes are removed;
  * a multilevel problem and an equation system are initialized;
+ * the system is assembled element by element by a thread-parallel element kernel;
  * a direct solver is used to solve the problem.
  **/
 
@@ -14,7 +15,6 @@
 #include "VTKWriter.hpp"
 #include "GMVWriter.hpp"
 #include "LinearImplicitSystem.hpp"
-#include "adept.h"
 
 
 using namespace femus;
@@ -26,9 +26,7 @@ bool SetBoundaryCondition(const std::vector < double >& x, const char solName[],
   return dirichlet;
 }
 
-void AssemblePoissonProblem(MultiLevelProblem& ml_prob);
-
-void AssemblePoissonProblem_AD(MultiLevelProblem& ml_prob);
+void AssemblePoissonElement(LinearImplicitSystem& mlPdeSys, const unsigned& iel, ElementLoopBuffer& buffer);
 
 std::pair < double, double > GetErrorNorm(MultiLevelSolution* mlSol);
 
@@ -97,8 +95,9 @@ int main(int argc, char** args) {
       // add solution "u" to system
       system.AddSolutionToSystemPDE("u");
 
-      // attach the assembling function to system
-      system.SetAssembleFunction(AssemblePoissonProblem_AD);
+      // attach the element kernel to system, assembled on 2 threads for each process
+      system.SetElementKernel(AssemblePoissonElement);
+      system.SetNumberOfAssemblyThreads(2);
 
       // initilaize and solve the system
       system.init();
@@ -196,39 +195,30 @@ double GetExactSolutionLaplace(const std::vector < double >& x) {
 };
 
 /**
- * This function assemble the stiffnes matrix Jac and the residual vector Res
+ * This element kernel computes the local stiffnes matrix Jac and the local residual vector Res of the element iel
  * such that
  *                  Jac w = RES = F - Jac u0,
  * and consequently
  *        u = u0 + w satisfies Jac u = F
+ * It is called concurrently by the threads of the element loop: it only reads the global objects,
+ * and stores its output in the buffer of the calling thread
  **/
-void AssemblePoissonProblem(MultiLevelProblem& ml_prob) {
-  //  ml_prob is the global object from/to where get/set all the data
-
-  //  level is the level of the PDE system to be assembled
-  //  levelMax is the Maximum level of the MultiLevelProblem
-  //  assembleMatrix is a flag that tells if only the residual or also the matrix should be assembled
+void AssemblePoissonElement(LinearImplicitSystem& mlPdeSys, const unsigned& iel, ElementLoopBuffer& buffer) {
+  //  mlPdeSys is the system to be assembled, from where get all the data
 
   //  extract pointers to the several objects that we are going to use
 
-  LinearImplicitSystem* mlPdeSys  = &ml_prob.get_system<LinearImplicitSystem> ("Poisson");   // pointer to the linear implicit system named "Poisson"
-  const unsigned level = mlPdeSys->GetLevelToAssemble();
+  MultiLevelProblem&   ml_prob = mlPdeSys.GetMLProb();
+  const unsigned level = mlPdeSys.GetLevelToAssemble();
 
   Mesh*                    msh = ml_prob._ml_msh->GetLevel(level);    // pointer to the mesh (level) object
-  elem*                     el = msh->el;  // pointer to the elem object in msh (level)
 
   MultiLevelSolution*    mlSol = ml_prob._ml_sol;  // pointer to the multilevel solution object
   Solution*                sol = ml_prob._ml_sol->GetSolutionLevel(level);    // pointer to the solution (level) object
 
-  LinearEquationSolver* pdeSys = mlPdeSys->_LinSolver[level]; // pointer to the equation (level) object
-  SparseMatrix*             KK = pdeSys->_KK;  // pointer to the global stifness matrix object in pdeSys (level)
-  NumericVector*           RES = pdeSys->_RES; // pointer to the global residual vector object in pdeSys (level)
+  LinearEquationSolver* pdeSys = mlPdeSys._LinSolver[level]; // pointer to the equation (level) object
 
   const unsigned  dim = msh->GetDimension(); // get the domain dimension of the problem
-  
-  const unsigned maxSize = static_cast< unsigned >(ceil(pow(3, dim)));  // conservative: based on line3, quad9, hex27
-
-  unsigned    iproc = msh->processor_id(); // get the process_id (for parallel computation)
 
   //solution variable
   unsigned soluIndex;
@@ -236,333 +226,102 @@ void AssemblePoissonProblem(MultiLevelProblem& ml_prob) {
   unsigned soluType = mlSol->GetSolutionType(soluIndex);    // get the finite element type for "u"
 
   unsigned soluPdeIndex;
-  soluPdeIndex = mlPdeSys->GetSolPdeIndex("u");    // get the position of "u" in the pdeSys object
-
-  vector < double >  solu; // local solution
-  solu.reserve(maxSize);
+  soluPdeIndex = mlPdeSys.GetSolPdeIndex("u");    // get the position of "u" in the pdeSys object
 
-  vector < vector < double > > x (dim);    // local coordinates
   unsigned xType = 2; // get the finite element type for "x", it is always 2 (LAGRANGE BI/TRIQUADRATIC)
 
-  for (unsigned i = 0; i < dim; i++) {
-    x[i].reserve(maxSize);
-  }
+  // weights and gradients are computed once, before the threads start, and reused at each assembly
+  const GeometryCache* geometry = msh->GetGeometryCache(soluType, sol);
 
-  vector <double> phi;  // local test function
-  vector <double> phi_x; // local test function first order partial derivatives
-  
-  double weight; // gauss point weight
+  short unsigned ielGeom = msh->GetElementType(iel);
+  const elem_type* fe = msh->_finiteElement[ielGeom][soluType];
+  unsigned nDofu  = msh->GetElementDofNumber(iel, soluType);    // number of solution element dofs
 
-  phi.reserve(maxSize);
-  phi_x.reserve(maxSize * dim);
-  
+  // local arrays, kept by the thread buffer from one element to the next: no allocation in the element loop
+  vector < double >& solu = buffer.GetLocalArray(0); // local solution
+  vector < double >& x = buffer.GetLocalArray(1);    // local coordinates, x[jdim * nDofu + i]
+  vector < double >& gradSolu_gss = buffer.GetLocalArray(2);
+  vector < double >& x_gss = buffer.GetLocalArray(3);
 
-  vector< double > Res; // local redidual vector
-  Res.reserve(maxSize);
+  solu.resize(nDofu);
+  x.resize(dim * nDofu);
+  gradSolu_gss.resize(dim);
+  x_gss.resize(dim);
 
-  vector < double > Jac; //local Jacobian matrix
-  Jac.reserve(maxSize * maxSize);
-  
-  vector< int > l2GMap; // local to global mapping
-  l2GMap.reserve(maxSize);
-  
+  vector < int >& l2GMap = buffer._sysDof; // local to global mapping
+  vector < double >& Res = buffer._Res; // local redidual vector
+  vector < double >& Jac = buffer._Jac; //local Jacobian matrix
 
-  KK->zero(); // Set to zero all the entries of the Global Matrix
-  RES->zero(); // Set to zero all the entries of the Global Residual Vector
+  l2GMap.resize(nDofu);
+  Res.assign(nDofu, 0.);    //resize and set to zero
+  Jac.assign(nDofu * nDofu, 0.);    //resize and set to zero
 
-  // element loop: each process loops only on the elements that owns
-  for (int iel = msh->_elementOffset[iproc]; iel < msh->_elementOffset[iproc + 1]; iel++) {
+  // local storage of global mapping and solution
+  const unsigned* solDof = msh->GetElementSolutionDofs(iel, soluType);    // local to global solution mapping
+  const unsigned* sysDof = pdeSys->GetElementSystemDofs(soluPdeIndex, iel);    // local to global system solution mapping
 
-    short unsigned ielGeom = msh->GetElementType(iel);
-    unsigned nDofu  = msh->GetElementDofNumber(iel, soluType);    // number of solution element dofs
-    
-    // resize local arrays
-    solu.resize(nDofu);
-    l2GMap.resize(nDofu);
-    
+  sol->_Sol[soluIndex]->get(solDof, nDofu, &solu[0]);      // local storage of solution
 
-    for (int i = 0; i < dim; i++) {
-      x[i].resize(nDofu);
-    }
-
-    Res.assign(nDofu,0.);    //resize and set to zero
-
-    Jac.resize(nDofu * nDofu, 0);    //resize and set to zero
-    
-
-    // local storage of global mapping and solution
-    for (unsigned i = 0; i < nDofu; i++) {
-      unsigned solDof = msh->GetSolutionDof(i, iel, soluType);    // local to global solution mapping
-      solu[i] = (*sol->_Sol[soluIndex])(solDof);      // local storage of solution
-      l2GMap[i] = pdeSys->GetSystemDof(soluIndex, soluPdeIndex, i, iel);   // local to global system solution mapping
-    }
+  for (unsigned i = 0; i < nDofu; i++) {
+    l2GMap[i] = sysDof[i];
+  }
 
-    // local storage of coordinates
-    for (unsigned i = 0; i < nDofu; i++) {
-      unsigned xDof  = msh->GetSolutionDof(i, iel, xType);    // global to global mapping between coordinates node and coordinate dof
+  // local storage of coordinates
+  for (unsigned i = 0; i < nDofu; i++) {
+    unsigned xDof  = msh->GetSolutionDof(i, iel, xType);    // global to global mapping between coordinates node and coordinate dof
 
-      for (unsigned jdim = 0; jdim < dim; jdim++) {
-        x[jdim][i] = (*msh->_topology->_Sol[jdim])(xDof);      // global extraction and local storage for the element coordinates
-      }
+    for (unsigned jdim = 0; jdim < dim; jdim++) {
+      x[jdim * nDofu + i] = (*msh->_topology->_Sol[jdim])(xDof);      // global extraction and local storage for the element coordinates
     }
-
-
-
-    // *** Gauss point loop ***
-    for (unsigned ig = 0; ig < msh->_finiteElement[ielGeom][soluType]->GetGaussPointNumber(); ig++) {
-      // *** get gauss point weight, test function and test function partial derivatives ***
-      msh->_finiteElement[ielGeom][soluType]->Jacobian(x, ig, weight, phi, phi_x);
-
-      //double* gradPhi[][2] = &phi_x[0];
-      
-      // evaluate the solution, the solution derivatives and the coordinates in the gauss point
-    
-      vector < double > gradSolu_gss(dim, 0.);
-      vector < double > x_gss(dim, 0.);
-
-      for (unsigned i = 0; i < nDofu; i++) {
-       
-        for (unsigned jdim = 0; jdim < dim; jdim++) {
-          gradSolu_gss[jdim] += phi_x[i * dim + jdim] * solu[i];
-          x_gss[jdim] += x[jdim][i] * phi[i];
-        }
-      }
-
-      // *** phi_i loop ***
-      for (unsigned i = 0; i < nDofu; i++) {
-
-        double weakLaplace = 0.;
-
-        for (unsigned jdim = 0; jdim < dim; jdim++) {
-          weakLaplace   -=  phi_x[i * dim + jdim] * gradSolu_gss[jdim];
-        }
-        
-        Res[i] += ( - GetExactSolutionLaplace(x_gss) * phi[i] + weakLaplace) * weight;
-
-        // *** phi_j loop ***
-        for (unsigned j = 0; j < nDofu; j++) {
-          double weakLaplacej = 0.;
-
-          for (unsigned kdim = 0; kdim < dim; kdim++) {
-            weakLaplacej -= phi_x[i * dim + kdim] * phi_x[j * dim + kdim];
-          }
-
-          Jac[i * nDofu + j] -= weakLaplacej * weight;
-        } // end phi_j loop
-
-      } // end phi_i loop
-    } // end gauss point loop
-
-
-    //--------------------------------------------------------------------------------------------------------
-    // Add the local Matrix/Vector into the global Matrix/Vector
-
-    //copy the value of the adept::adoube aRes in double Res and store
-    RES->add_vector_blocked(Res, l2GMap);
-
-    //store K in the global matrix KK
-    KK->add_matrix_blocked(Jac, l2GMap, l2GMap);
-
-  } //end element loop for each process
-
-  RES->close();
-
-  KK->close();
-
-  // ***************** END ASSEMBLY *******************
-}
-
-/**
- * This function assemble the stiffnes matrix KK and the residual vector Res
- * Using automatic differentiation for Newton iterative scheme
- *                  J(u0) w =  - F(u0)  ,
- *                  with u = u0 + w
- *                  - F = f(x) - J u = Res
- *                  J = \grad_u F
- *
- * thus
- *                  J w = f(x) - J u0
- **/
-void AssemblePoissonProblem_AD(MultiLevelProblem& ml_prob) {
-  //  ml_prob is the global object from/to where get/set all the data
-  //  level is the level of the PDE system to be assembled
-  //  levelMax is the Maximum level of the MultiLevelProblem
-  //  assembleMatrix is a flag that tells if only the residual or also the matrix should be assembled
-
-  // call the adept stack object
-
-
-  adept::Stack& s = FemusInit::_adeptStack;
-
-  //  extract pointers to the several objects that we are going to use
-
-  LinearImplicitSystem* mlPdeSys  = &ml_prob.get_system<LinearImplicitSystem> ("Poisson");   // pointer to the linear implicit system named "Poisson"
-  const unsigned level = mlPdeSys->GetLevelToAssemble();
-
-  Mesh*                    msh = ml_prob._ml_msh->GetLevel(level);    // pointer to the mesh (level) object
-  elem*                     el = msh->el;  // pointer to the elem object in msh (level)
-
-  MultiLevelSolution*    mlSol = ml_prob._ml_sol;  // pointer to the multilevel solution object
-  Solution*                sol = ml_prob._ml_sol->GetSolutionLevel(level);    // pointer to the solution (level) object
-
-  LinearEquationSolver* pdeSys = mlPdeSys->_LinSolver[level]; // pointer to the equation (level) object
-  SparseMatrix*             KK = pdeSys->_KK;  // pointer to the global stifness matrix object in pdeSys (level)
-  NumericVector*           RES = pdeSys->_RES; // pointer to the global residual vector object in pdeSys (level)
-
-  const unsigned  dim = msh->GetDimension(); // get the domain dimension of the problem
-  unsigned dim2 = (3 * (dim - 1) + !(dim - 1));        // dim2 is the number of second order partial derivatives (1,3,6 depending on the dimension)
-  const unsigned maxSize = static_cast< unsigned >(ceil(pow(3, dim)));          // conservative: based on line3, quad9, hex27
-
-  unsigned    iproc = msh->processor_id(); // get the process_id (for parallel computation)
-
-  //solution variable
-  unsigned soluIndex;
-  soluIndex = mlSol->GetIndex("u");    // get the position of "u" in the ml_sol object
-  unsigned soluType = mlSol->GetSolutionType(soluIndex);    // get the finite element type for "u"
-
-  unsigned soluPdeIndex;
-  soluPdeIndex = mlPdeSys->GetSolPdeIndex("u");    // get the position of "u" in the pdeSys object
-
-  vector < adept::adouble >  solu; // local solution
-  solu.reserve(maxSize);
-
-  vector < vector < double > > x(dim);    // local coordinates
-  unsigned xType = 2; // get the finite element type for "x", it is always 2 (LAGRANGE QUADRATIC)
-
-  for (unsigned i = 0; i < dim; i++) {
-    x[i].reserve(maxSize);
   }
 
-  vector <double> phi;  // local test function
-  vector <double> phi_x; // local test function first order partial derivatives
-  vector <double> phi_xx; // local test function second order partial derivatives
-  double weight; // gauss point weight
-
-  phi.reserve(maxSize);
-  phi_x.reserve(maxSize * dim);
-  phi_xx.reserve(maxSize * dim2);
-
-  vector< adept::adouble > aRes; // local redidual vector
-  aRes.reserve(maxSize);
-
-  vector< int > l2GMap; // local to global mapping
-  l2GMap.reserve(maxSize);
-  vector< double > Res; // local redidual vector
-  Res.reserve(maxSize);
-  vector < double > Jac;
-  Jac.reserve(maxSize * maxSize);
-
-  KK->zero(); // Set to zero all the entries of the Global Matrix
-
-  // element loop: each process loops only on the elements that owns
-  for (int iel = msh->_elementOffset[iproc]; iel < msh->_elementOffset[iproc + 1]; iel++) {
-     
-    short unsigned ielGeom = msh->GetElementType(iel);
-    unsigned nDofu  = msh->GetElementDofNumber(iel, soluType);    // number of solution element dofs
-    unsigned nDofx = msh->GetElementDofNumber(iel, xType);    // number of coordinate element dofs
-
-    // resize local arrays
-    l2GMap.resize(nDofu);
-    solu.resize(nDofu);
-
-    for (int i = 0; i < dim; i++) {
-      x[i].resize(nDofx);
+  // *** Gauss point loop ***
+  for (unsigned ig = 0; ig < fe->GetGaussPointNumber(); ig++) {
+    // *** read gauss point weight, test function and test function partial derivatives, without copying them ***
+    double weight = geometry->GetWeight(iel, ig);
+    const double* phi = fe->GetPhi(ig);
+    const double* phi_x = geometry->GetGradPhi(iel, ig);
+
+    // evaluate the solution, the solution derivatives and the coordinates in the gauss point
+    for (unsigned jdim = 0; jdim < dim; jdim++) {
+      gradSolu_gss[jdim] = 0.;
+      x_gss[jdim] = 0.;
     }
 
-    aRes.resize(nDofu);    //resize
-    std::fill(aRes.begin(), aRes.end(), 0);    //set aRes to zero
-
-    // local storage of global mapping and solution
     for (unsigned i = 0; i < nDofu; i++) {
-      unsigned solDof = msh->GetSolutionDof(i, iel, soluType);    // global to global mapping between solution node and solution dof
-      solu[i] = (*sol->_Sol[soluIndex])(solDof);      // global extraction and local storage for the solution
-      l2GMap[i] = pdeSys->GetSystemDof(soluIndex, soluPdeIndex, i, iel);    // global to global mapping between solution node and pdeSys dof
-    }
-
-    // local storage of coordinates
-    for (unsigned i = 0; i < nDofx; i++) {
-      unsigned xDof  = msh->GetSolutionDof(i, iel, xType);    // global to global mapping between coordinates node and coordinate dof
 
       for (unsigned jdim = 0; jdim < dim; jdim++) {
-        x[jdim][i] = (*msh->_topology->_Sol[jdim])(xDof);      // global extraction and local storage for the element coordinates
+        gradSolu_gss[jdim] += phi_x[i * dim + jdim] * solu[i];
+        x_gss[jdim] += x[jdim * nDofu + i] * phi[i];
       }
     }
 
+    // *** phi_i loop ***
+    for (unsigned i = 0; i < nDofu; i++) {
 
-    // start a new recording of all the operations involving adept::adouble variables
-    s.new_recording();
-
-    // *** Gauss point loop ***
-    for (unsigned ig = 0; ig < msh->_finiteElement[ielGeom][soluType]->GetGaussPointNumber(); ig++) {
-      // *** get gauss point weight, test function and test function partial derivatives ***
-      msh->_finiteElement[ielGeom][soluType]->Jacobian(x, ig, weight, phi, phi_x, phi_xx);
-
-      // evaluate the solution, the solution derivatives and the coordinates in the gauss point
-      adept::adouble solu_gss = 0;
-      vector < adept::adouble > gradSolu_gss(dim, 0.);
-      vector < double > x_gss(dim, 0.);
-
-      for (unsigned i = 0; i < nDofu; i++) {
-        solu_gss += phi[i] * solu[i];
+      double weakLaplace = 0.;
 
-        for (unsigned jdim = 0; jdim < dim; jdim++) {
-          gradSolu_gss[jdim] += phi_x[i * dim + jdim] * solu[i];
-          x_gss[jdim] += x[jdim][i] * phi[i];
-        }
+      for (unsigned jdim = 0; jdim < dim; jdim++) {
+        weakLaplace   -=  phi_x[i * dim + jdim] * gradSolu_gss[jdim];
       }
 
-      // *** phi_i loop ***
-      for (unsigned i = 0; i < nDofu; i++) {
+      Res[i] += ( - GetExactSolutionLaplace(x_gss) * phi[i] + weakLaplace) * weight;
 
-        adept::adouble laplace = 0.;
+      // *** phi_j loop ***
+      for (unsigned j = 0; j < nDofu; j++) {
+        double weakLaplacej = 0.;
 
-        for (unsigned jdim = 0; jdim < dim; jdim++) {
-          laplace   +=  phi_x[i * dim + jdim] * gradSolu_gss[jdim];
+        for (unsigned kdim = 0; kdim < dim; kdim++) {
+          weakLaplacej -= phi_x[i * dim + kdim] * phi_x[j * dim + kdim];
         }
 
-        double srcTerm = - GetExactSolutionLaplace(x_gss);
-        aRes[i] += (srcTerm * phi[i] - laplace) * weight;
-
-      } // end phi_i loop
-    } // end gauss point loop
-
-    //--------------------------------------------------------------------------------------------------------
-    // Add the local Matrix/Vector into the global Matrix/Vector
-
-    //copy the value of the adept::adoube aRes in double Res and store
-    Res.resize(nDofu);    //resize
-
-    for (int i = 0; i < nDofu; i++) {
-      Res[i] = - aRes[i].value();
-    }
-
-    RES->add_vector_blocked(Res, l2GMap);
-
-
-
-    // define the dependent variables
-    s.dependent(&aRes[0], nDofu);
-
-    // define the independent variables
-    s.independent(&solu[0], nDofu);
-
-    // get the jacobian matrix (ordered by row major )
-    Jac.resize(nDofu * nDofu);    //resize
-    s.jacobian(&Jac[0], true);
-
-    //store K in the global matrix KK
-    KK->add_matrix_blocked(Jac, l2GMap, l2GMap);
-
-    s.clear_independents();
-    s.clear_dependents();
-
-  } //end element loop for each process
-
-  RES->close();
+        Jac[i * nDofu + j] -= weakLaplacej * weight;
+      } // end phi_j loop
 
-  KK->close();
+    } // end phi_i loop
+  } // end gauss point loop
 
-  // ***************** END ASSEMBLY *******************
+  // the element loop adds the local Matrix/Vector into the global Matrix/Vector
 }
 
 std::pair < double, double > GetErrorNorm(MultiLevelSolution* mlSol) {
@@ -430,7 +430,7 @@ void AssembleNonlinearProblem_AD(MultiLevelProblem& ml_prob) {
   //  assembleMatrix is a flag that tells if only the residual or also the matrix should be assembled
 
   // call the adept stack object
-  adept::Stack& s = FemusInit::_adeptStack;
+  adept::Stack& s = FemusInit::GetAdeptStack();
 
   //  extract pointers to the several objects that we are going to use
 
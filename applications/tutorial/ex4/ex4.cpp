@@ -225,7 +225,7 @@ void AssembleBilaplaceProblem_AD(MultiLevelProblem& ml_prob) {
   //  level is the level of the PDE system to be assembled
 
   // call the adept stack object
-  adept::Stack& s = FemusInit::_adeptStack;
+  adept::Stack& s = FemusInit::GetAdeptStack();
 
   //  extract pointers to the several objects that we are going to use
 
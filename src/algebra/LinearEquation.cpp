@@ -44,6 +44,7 @@ LinearEquation::LinearEquation(Solution *other_solution){
   _RESC = NULL;
   _KK = NULL;
   _KKamr = NULL;
+  _storeSparsityPattern = false;
 }
 
 //--------------------------------------------------------------------------------
@@ -68,12 +69,46 @@ unsigned LinearEquation::GetSystemDof(const unsigned &index_sol, const unsigned
 				      const unsigned &i, const unsigned &iel) const {
 
   unsigned soltype =  _SolType[index_sol];
+
+  if(kkindex_sol < _elementSystemDof.size() && iel >= _msh->_elementOffset[_iproc] && iel < _msh->_elementOffset[_iproc + 1]) {
+    return _elementSystemDof[kkindex_sol][_msh->GetElementDofOffset(iel, soltype) + i];
+  }
   unsigned idof= _msh->GetSolutionDof(i, iel, soltype);
 
   unsigned isubdom = _msh->IsdomBisectionSearch(idof, soltype);
   return KKoffset[kkindex_sol][isubdom] + idof - _msh->_dofOffset[soltype][isubdom];
 }
 
+//--------------------------------------------------------------------------------
+void LinearEquation::BuildElementSystemDofs() {
+
+  unsigned iel0 = _msh->_elementOffset[_iproc];
+  unsigned iel1 = _msh->_elementOffset[_iproc + 1];
+
+  _elementSystemDof.resize(0); // GetSystemDof has to search while the tables are built
+  vector < vector < unsigned > > elementSystemDof(_SolPdeIndex.size());
+
+  for(unsigned k = 0; k < _SolPdeIndex.size(); k++) {
+    unsigned indexSol = _SolPdeIndex[k];
+    unsigned soltype = _SolType[indexSol];
+
+    // same ordering of the mesh table of soltype
+    for(unsigned iel = iel0; iel < iel1; iel++) {
+      for(unsigned i = 0; i < _msh->GetElementDofNumber(iel, soltype); i++) {
+        elementSystemDof[k].push_back(GetSystemDof(indexSol, k, i, iel));
+      }
+    }
+  }
+
+  _elementSystemDof.swap(elementSystemDof);
+}
+
+//--------------------------------------------------------------------------------
+const unsigned* LinearEquation::GetElementSystemDofs(const unsigned &kkindex_sol, const unsigned &iel) const {
+  return &_elementSystemDof[kkindex_sol][_msh->GetElementDofOffset(iel, _SolType[_SolPdeIndex[kkindex_sol]])];
+}
+
+//--------------------------------------------------------------------------------
 unsigned LinearEquation::GetSystemDof(const unsigned &soltype, const unsigned &kkindex_sol,
 				      const unsigned &i, const unsigned &iel, const vector < vector <unsigned> > &otherKKoffset) const {
 
@@ -186,6 +221,8 @@ void LinearEquation::InitPde(const vector <unsigned> &SolPdeIndex_other, const
   _RESC->init(*_EPS);
 
 
+  BuildElementSystemDofs();
+
   GetSparsityPatternSize();
 
   const unsigned dim = _msh->GetDimension();
@@ -264,122 +301,150 @@ void LinearEquation::DeletePde() {
       exit(0);
     }
 
-    const int dim = _msh->GetDimension();
-
-    const int max_size = static_cast< int > (ceil(pow(3,dim)));
-
-    vector < vector < int > > dofsVAR(_SolPdeIndex.size());
-
-    for(int i=0;i<_SolPdeIndex.size();i++){
-      dofsVAR[i].reserve(max_size);
+    // the pattern of the row r of the variable k is the union, over the elements that contain r, of the element dofs
+    // of the variables coupled with k. The owned rows gather it from their element lists, while the rows of the other
+    // processes are sent to their owners as (row, column) pairs, so that the shared rows are counted exactly.
+
+    unsigned iel0 = _msh->_elementOffset[_iproc];
+    unsigned iel1 = _msh->_elementOffset[_iproc + 1];
+
+    const vector < unsigned > &procEnd = KKoffset[SolPdeSize]; // procEnd[jproc] = end of the rows of jproc
+    int IndexStart = KKoffset[0][_iproc];
+    int IndexEnd = procEnd[_iproc];
+    int owned_dofs = IndexEnd - IndexStart;
+
+    //BEGIN owned row to element lists
+    vector < unsigned > rowElementOffset(owned_dofs + 1, 0);
+    vector < unsigned > sendCount(_nprocs, 0);
+
+    for(unsigned iel = iel0; iel < iel1; iel++) {
+      for(unsigned k = 0; k < SolPdeSize; k++) {
+        unsigned nDofs = _msh->GetElementDofNumber(iel, _SolType[_SolPdeIndex[k]]);
+        const unsigned *dofs = GetElementSystemDofs(k, iel);
+        for(unsigned i = 0; i < nDofs; i++) {
+          int r = dofs[i];
+          if(r >= IndexStart && r < IndexEnd) rowElementOffset[r - IndexStart + 1]++;
+        }
+      }
+    }
+    for(int ir = 0; ir < owned_dofs; ir++) {
+      rowElementOffset[ir + 1] += rowElementOffset[ir];
     }
 
-    // mesh and procs
-    int nel    = _msh->GetNumberOfElements();
-    int igrid  = _msh->GetLevel();
-    int this_proc  = _msh->processor_id();
-    int nprocs=	      _msh->n_processors();
-
-    // *** element loop ***
-
-    int IndexStart= KKoffset[0][this_proc];
-    int IndexEnd  = KKoffset[KKIndex.size()-1][this_proc];
-    int owned_dofs    = IndexEnd-IndexStart;
-
-    vector < std::map < int, bool > > BlgToMe_d(owned_dofs);
-    vector < std::map < int, bool > > BlgToMe_o(owned_dofs);
-    std::map < int, std::map <int, bool > > DnBlgToMe_o;
-    std::map < int, std::map <int, bool > > DnBlgToMe_d;
-
-    for(int kel=_msh->_elementOffset[this_proc]; kel < _msh->_elementOffset[this_proc+1]; kel++) {
-
-      short int kelt = _msh->GetElementType(kel);
-      vector < int > nve(_SolPdeIndex.size());
-      for(int i=0;i<_SolPdeIndex.size();i++){
-	nve[i] = _msh->GetElementDofNumber(kel,_SolType[_SolPdeIndex[i]]);
-      }
-      for(int i=0; i<_SolPdeIndex.size(); i++) {
-	dofsVAR[i].resize(nve[i]);
+    vector < unsigned > rowElement(rowElementOffset[owned_dofs]);
+    vector < unsigned > rowElementFill(rowElementOffset.begin(), rowElementOffset.end() - 1);
+
+    // (row, column) pairs of the rows of the other processes, by owner
+    vector < vector < std::pair < int, int > > > sendPairs(_nprocs);
+
+    for(unsigned iel = iel0; iel < iel1; iel++) {
+      for(unsigned k = 0; k < SolPdeSize; k++) {
+        unsigned nDofs = _msh->GetElementDofNumber(iel, _SolType[_SolPdeIndex[k]]);
+        const unsigned *dofs = GetElementSystemDofs(k, iel);
+        for(unsigned i = 0; i < nDofs; i++) {
+          int r = dofs[i];
+          if(r >= IndexStart && r < IndexEnd) {
+            rowElement[rowElementFill[r - IndexStart]++] = iel;
+          }
+          else {
+            unsigned jproc = std::upper_bound(procEnd.begin(), procEnd.begin() + _nprocs, static_cast < unsigned >(r)) - procEnd.begin();
+            for(unsigned l = 0; l < SolPdeSize; l++) {
+              if(_SparsityPattern[SolPdeSize * k + l]) {
+                unsigned nDofsl = _msh->GetElementDofNumber(iel, _SolType[_SolPdeIndex[l]]);
+                const unsigned *dofsl = GetElementSystemDofs(l, iel);
+                for(unsigned j = 0; j < nDofsl; j++) {
+                  sendPairs[jproc].push_back(std::make_pair(r, static_cast < int >(dofsl[j])));
+                }
+              }
+            }
+          }
+        }
       }
+    }
+    //END
+
+    //BEGIN exchange of the pairs of the shared rows with one all to all
+    vector < int > sendSize(_nprocs), sendOffset(_nprocs + 1, 0);
+    for(int jproc = 0; jproc < _nprocs; jproc++) {
+      std::sort(sendPairs[jproc].begin(), sendPairs[jproc].end());
+      sendPairs[jproc].erase(std::unique(sendPairs[jproc].begin(), sendPairs[jproc].end()), sendPairs[jproc].end());
+      sendSize[jproc] = 2 * sendPairs[jproc].size();
+      sendOffset[jproc + 1] = sendOffset[jproc] + sendSize[jproc];
+    }
 
-      for(int i=0; i<_SolPdeIndex.size(); i++) {
-	int ThisSolType=_SolType[_SolPdeIndex[i]];
-	for (int j=0;j<nve[i];j++) {
-          int inode=_msh->GetSolutionDof(j, kel, ThisSolType);
-	  dofsVAR[i][j]= GetSystemDof(_SolPdeIndex[i],i,j,kel);
-	}
-      }
-      for(int i=0;i<_SolPdeIndex.size();i++){
-	for(int inode=0;inode<nve[i];inode++){
-	  int idof_local=dofsVAR[i][inode] - IndexStart;
-	  for(int j=0;j<_SolPdeIndex.size();j++){
-	    if(_SparsityPattern[_SolPdeIndex.size()*i+j]){
-	      for(int jnode=0;jnode<nve[j];jnode++){
-	        int jdof_local=dofsVAR[j][jnode] - IndexStart;
-
-		if(idof_local >= 0){ // i-row belogns to this proc
-		  if(jdof_local >= 0){ // j-row belongs to this proc (diagonal)
-		    BlgToMe_d[ idof_local ][ jdof_local ] = 1;
-		  }
-		  else { // j-row does not belong to this proc (off-diagonal)
-		    BlgToMe_o[ idof_local ][ dofsVAR[j][jnode] ]=1;
-		  }
-		}
-		else{ // i-row does not belong to this proc
-		  // identify the process the i-row belogns to
-		  int iproc=0;
-		  while (dofsVAR[i][inode] >= KKoffset[KKIndex.size()-1][iproc]) iproc++;
-
-		  // identify the process the j-column belogns to
-		  int jproc=0;
-		  while (dofsVAR[j][jnode] >= KKoffset[KKIndex.size()-1][jproc]) jproc++;
-		  if (iproc != jproc){ // if diagonal
-		    DnBlgToMe_o[dofsVAR[i][inode]][dofsVAR[j][jnode]]=1;
-		  }
-		  else if (iproc == jproc){ // if off-diagonal
-		    DnBlgToMe_d[dofsVAR[i][inode]][dofsVAR[j][jnode]]=1;
-		  }
-		}
-	      }
-	    }
-	  }
-	}
+    vector < int > sendBuffer(sendOffset[_nprocs]);
+    for(int jproc = 0; jproc < _nprocs; jproc++) {
+      for(unsigned i = 0; i < sendPairs[jproc].size(); i++) {
+        sendBuffer[sendOffset[jproc] + 2 * i] = sendPairs[jproc][i].first;
+        sendBuffer[sendOffset[jproc] + 2 * i + 1] = sendPairs[jproc][i].second;
       }
+      vector < std::pair < int, int > >().swap(sendPairs[jproc]);
     }
 
-    NumericVector  *sizeDnBM_o = NumericVector::build().release();
-    sizeDnBM_o->init(*_EPS);
-    sizeDnBM_o->zero();
-    for (std::map < int, std::map <int, bool > >::iterator it=DnBlgToMe_o.begin(); it!=DnBlgToMe_o.end(); ++it){
-      sizeDnBM_o->add(it->first,it->second.size());
+    vector < int > recvSize(_nprocs), recvOffset(_nprocs + 1, 0);
+    MPI_Alltoall(&sendSize[0], 1, MPI_INT, &recvSize[0], 1, MPI_INT, MPI_COMM_WORLD);
+    for(int jproc = 0; jproc < _nprocs; jproc++) {
+      recvOffset[jproc + 1] = recvOffset[jproc] + recvSize[jproc];
     }
-    sizeDnBM_o->close();
 
+    vector < int > recvBuffer(recvOffset[_nprocs]);
+    MPI_Alltoallv((sendBuffer.size() > 0) ? &sendBuffer[0] : NULL, &sendSize[0], &sendOffset[0], MPI_INT,
+                  (recvBuffer.size() > 0) ? &recvBuffer[0] : NULL, &recvSize[0], &recvOffset[0], MPI_INT, MPI_COMM_WORLD);
+    vector < int >().swap(sendBuffer);
 
-    NumericVector  *sizeDnBM_d = NumericVector::build().release();
-    sizeDnBM_d->init(*_EPS);
-    sizeDnBM_d->zero();
-    for (std::map < int, std::map <int, bool > >::iterator it=DnBlgToMe_d.begin(); it!=DnBlgToMe_d.end(); ++it){
-      sizeDnBM_d->add(it->first,it->second.size());
+    // received pairs, sorted by row
+    vector < std::pair < int, int > > recvPairs(recvBuffer.size() / 2);
+    for(unsigned i = 0; i < recvPairs.size(); i++) {
+      recvPairs[i] = std::make_pair(recvBuffer[2 * i], recvBuffer[2 * i + 1]);
     }
-    sizeDnBM_d->close();
-
+    vector < int >().swap(recvBuffer);
+    std::sort(recvPairs.begin(), recvPairs.end());
+    //END
+
+    //BEGIN exact row counts, and the columns if requested
+    d_nnz.assign(owned_dofs, 0);
+    o_nnz.assign(owned_dofs, 0);
+
+    _sparsityRowOffset.assign((_storeSparsityPattern) ? owned_dofs + 1 : 0, 0);
+    _sparsityColumn.resize(0);
+
+    vector < int > columns;
+    unsigned irecv = 0;
+    unsigned k = 0;
+
+    for(int ir = 0; ir < owned_dofs; ir++) {
+      int r = IndexStart + ir;
+      while(r >= static_cast < int >(KKoffset[k + 1][_iproc])) k++; // variable of the row
+
+      columns.resize(0);
+      for(unsigned e = rowElementOffset[ir]; e < rowElementOffset[ir + 1]; e++) {
+        unsigned iel = rowElement[e];
+        for(unsigned l = 0; l < SolPdeSize; l++) {
+          if(_SparsityPattern[SolPdeSize * k + l]) {
+            unsigned nDofsl = _msh->GetElementDofNumber(iel, _SolType[_SolPdeIndex[l]]);
+            const unsigned *dofsl = GetElementSystemDofs(l, iel);
+            columns.insert(columns.end(), dofsl, dofsl + nDofsl);
+          }
+        }
+      }
+      for(; irecv < recvPairs.size() && recvPairs[irecv].first == r; irecv++) {
+        columns.push_back(recvPairs[irecv].second);
+      }
 
-    d_nnz.resize(owned_dofs);
-    o_nnz.resize(owned_dofs);
+      std::sort(columns.begin(), columns.end());
+      columns.erase(std::unique(columns.begin(), columns.end()), columns.end());
 
-    int d_max=owned_dofs;
-    int o_max=KKIndex[KKIndex.size()-1u]-owned_dofs;
+      for(unsigned j = 0; j < columns.size(); j++) {
+        if(columns[j] >= IndexStart && columns[j] < IndexEnd) d_nnz[ir]++;
+        else o_nnz[ir]++;
+      }
 
-    for(int i=0; i<owned_dofs;i++){
-     d_nnz[i]=static_cast <int> ((*sizeDnBM_d)(IndexStart+i))+BlgToMe_d[i].size();
-     if (d_nnz[i] > d_max) d_nnz[i] = d_max;
-     o_nnz[i]=static_cast <int> ((*sizeDnBM_o)(IndexStart+i))+BlgToMe_o[i].size();
-     if (o_nnz[i] > o_max) o_nnz[i] = o_max;
+      if(_storeSparsityPattern) {
+        _sparsityColumn.insert(_sparsityColumn.end(), columns.begin(), columns.end());
+        _sparsityRowOffset[ir + 1] = _sparsityColumn.size();
+      }
     }
-
-    delete sizeDnBM_o;
-    delete sizeDnBM_d;
+    //END
   }
 }
 
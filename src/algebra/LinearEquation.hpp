@@ -54,8 +54,25 @@ public:
                const vector <char*> &SolName, vector <NumericVector*> *Bdc_other,
                const unsigned &other_gridn, vector < bool > &SparsityPattern_other);
 
+  /** Compute the exact number of diagonal and off-diagonal block nonzeros d_nnz, o_nnz of the owned rows from the element dofs,
+   * and, if SetStoreSparsityPattern(true), the columns of the owned rows in CSR form. Collective */
   void GetSparsityPatternSize();
 
+  /** Keep the columns of the owned rows computed by GetSparsityPatternSize, to be set before InitPde */
+  void SetStoreSparsityPattern(const bool &store) {
+    _storeSparsityPattern = store;
+  }
+
+  /** The sorted global columns of the owned row IndexStart + i are
+   * GetSparsityPatternColumns()[GetSparsityPatternRowOffset()[i] ... GetSparsityPatternRowOffset()[i + 1] - 1] */
+  const vector < int > & GetSparsityPatternRowOffset() const {
+    return _sparsityRowOffset;
+  }
+
+  const vector < int > & GetSparsityPatternColumns() const {
+    return _sparsityColumn;
+  }
+
   /** To be Added */
   void DeletePde();
 
@@ -71,6 +88,10 @@ public:
 			
   unsigned GetSystemDof(const unsigned &soltype, const unsigned &kkindex_sol,
 			const unsigned &i, const unsigned &iel, const vector < vector <unsigned> > &otherKKoffset) const;
+
+  /** Get the system dofs of the pde variable kkindex_sol in the owned element iel,
+   * GetElementDofNumber(iel, soltype) contiguous entries */
+  const unsigned* GetElementSystemDofs(const unsigned &kkindex_sol, const unsigned &iel) const;
 			
 
   /** To be Added */
@@ -121,6 +142,15 @@ protected:
   const vector <NumericVector*> *_Bdc;
   vector <bool> _SparsityPattern;
 
+  /** Build the element to system dof tables of the owned elements, with the layout of the mesh element dof tables */
+  void BuildElementSystemDofs();
+
+  vector < vector < unsigned > > _elementSystemDof;
+
+  bool _storeSparsityPattern;
+  vector < int > _sparsityRowOffset;
+  vector < int > _sparsityColumn;
+
 };
 
 } //end namespace femus
@@ -234,6 +234,12 @@ public:
    */
   virtual void get(const std::vector< int>& index, std::vector<double>& values) const;
 
+  /**
+   * Access the \p n components \p index[0], ..., \p index[n-1] and store them in \p values,
+   * which must have room for \p n entries. No memory is allocated.
+   */
+  virtual void get(const unsigned* index, const unsigned& n, double* values) const;
+
   // =====================================
   // algebra FUNCTIONS
   // =====================================
@@ -401,6 +407,11 @@ inline void NumericVector::get(const std::vector<int>& index,
 }
 
 
+inline void NumericVector::get(const unsigned* index, const unsigned& n, double* values) const {
+  for(unsigned i=0; i<n; i++) values[i] = (*this)(index[i]);
+}
+
+
 inline void  NumericVector::swap (NumericVector &v) {
   std::swap(_is_closed, v._is_closed);
   std::swap(_is_initialized, v._is_initialized);
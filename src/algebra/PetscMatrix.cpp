@@ -28,6 +28,8 @@
 #include <mpi.h>
 #include <hdf5.h>
 #include <sstream>
+#include <cstring>
+#include <algorithm>
 
 
 namespace femus {
@@ -375,8 +377,334 @@ namespace femus {
     assert(this->initialized());
     semiparallel_only();
     int ierr = 0;
+
+    if(_directInsertion) {
+      if(_directStatus == DIRECT_REPLAYING) { // zero() without close(), release the value arrays
+        ierr = MatSeqAIJRestoreArray(_directDiagonal, &_directDiagonalArray);
+        CHKERRABORT(MPI_COMM_WORLD, ierr);
+        if(_directOffDiagonal != NULL) {
+          ierr = MatSeqAIJRestoreArray(_directOffDiagonal, &_directOffDiagonalArray);
+          CHKERRABORT(MPI_COMM_WORLD, ierr);
+        }
+        std::vector < unsigned > ().swap(_directDeferredDofOffset);
+        std::vector < int > ().swap(_directDeferredDofs);
+        std::vector < double > ().swap(_directDeferredValues);
+      }
+
+      if(_directMapIsValid) { // the positions refer to the current matrix structure
+        Mat Ad = _mat, Ao = NULL;
+        const PetscInt *colmap;
+        if(_directOffDiagonal != NULL) {
+          ierr = MatMPIAIJGetSeqAIJ(_mat, &Ad, &Ao, &colmap);
+          CHKERRABORT(MPI_COMM_WORLD, ierr);
+        }
+        MatInfo info;
+        ierr = MatGetInfo(_mat, MAT_LOCAL, &info);
+        CHKERRABORT(MPI_COMM_WORLD, ierr);
+        int changed = (_mat != _directMat || Ad != _directDiagonal || Ao != _directOffDiagonal || info.nz_used != _directNonzeros) ? 1 : 0;
+        if(_directOffDiagonal != NULL) {
+          MPI_Allreduce(MPI_IN_PLACE, &changed, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+        }
+        if(changed) _directMapIsValid = false;
+      }
+    }
+
     ierr = MatZeroEntries(_mat);
     CHKERRABORT(MPI_COMM_WORLD, ierr);
+
+    if(_directInsertion) {
+      _directCounter = 0;
+      _directMismatch = false;
+      if(_directMapIsValid) {
+        _directStatus = DIRECT_REPLAYING;
+        _directSendBuffer.assign(_directSendBuffer.size(), 0.);
+        ierr = MatSeqAIJGetArray(_directDiagonal, &_directDiagonalArray);
+        CHKERRABORT(MPI_COMM_WORLD, ierr);
+        if(_directOffDiagonal != NULL) {
+          ierr = MatSeqAIJGetArray(_directOffDiagonal, &_directOffDiagonalArray);
+          CHKERRABORT(MPI_COMM_WORLD, ierr);
+        }
+      }
+      else {
+        _directStatus = DIRECT_RECORDING;
+        _directDofOffset.assign(1, 0);
+        _directDofs.resize(0);
+      }
+    }
+  }
+
+// =========================================================================
+  void PetscMatrix::SetDirectInsertion(const bool &directInsertion) {
+    assert(_directStatus == DIRECT_IDLE);
+    _directInsertion = directInsertion;
+    _directMapIsValid = false;
+    if(!_directInsertion) {
+      std::vector < unsigned > ().swap(_directDofOffset);
+      std::vector < int > ().swap(_directDofs);
+      std::vector < unsigned > ().swap(_directPositionOffset);
+      std::vector < int > ().swap(_directPosition);
+      std::vector < std::pair < int, unsigned > > ().swap(_directCallKey);
+      std::vector < double > ().swap(_directSendBuffer);
+      std::vector < double > ().swap(_directRecvBuffer);
+      std::vector < int > ().swap(_directRecvPosition);
+    }
+  }
+
+// =========================================================================
+  bool PetscMatrix::IsDirectCall(const unsigned &k, const std::vector < int > &rows, const std::vector < int > &cols) const {
+    if(k + 1 >= _directPositionOffset.size()) return false;
+    const unsigned rowBegin = _directDofOffset[2 * k];
+    const unsigned colBegin = _directDofOffset[2 * k + 1];
+    return rows.size() == colBegin - rowBegin && cols.size() == _directDofOffset[2 * k + 2] - colBegin &&
+           std::equal(rows.begin(), rows.end(), _directDofs.begin() + rowBegin) &&
+           std::equal(cols.begin(), cols.end(), _directDofs.begin() + colBegin);
+  }
+
+// =========================================================================
+  int PetscMatrix::GetDirectPosition(const int &r, const int &c, const int &rstart, const int &cstart, const int &cend,
+                                     const PetscInt *iaD, const PetscInt *jaD, const PetscInt *iaO, const PetscInt *jaO,
+                                     const PetscInt *colmap) const {
+    const int lr = r - rstart;
+    if(c >= cstart && c < cend) {
+      // the columns of the diagonal block are sorted
+      const PetscInt *first = jaD + iaD[lr];
+      const PetscInt *last = jaD + iaD[lr + 1];
+      const PetscInt *p = std::lower_bound(first, last, c - cstart);
+      if(p != last && *p == c - cstart) return static_cast < int >(p - jaD);
+    }
+    else if(iaO != NULL) {
+      for(int k = iaO[lr]; k < iaO[lr + 1]; k++) {
+        if(colmap[jaO[k]] == c) return _directDiagonalSize + k;
+      }
+    }
+    return -1;
+  }
+
+// =========================================================================
+  void PetscMatrix::BuildDirectInsertionMap() {
+    int ierr = 0;
+
+    const char *type;
+    ierr = MatGetType(_mat, &type);
+    CHKERRABORT(MPI_COMM_WORLD, ierr);
+    const bool parallel = !strcmp(type, MATMPIAIJ);
+    PetscInt blockSize;
+    ierr = MatGetBlockSize(_mat, &blockSize);
+    CHKERRABORT(MPI_COMM_WORLD, ierr);
+    // the value arrays are accessible only for the AIJ formats, and the positions are those of scalar rows and columns
+    if((!parallel && strcmp(type, MATSEQAIJ)) || blockSize != 1) {
+      int iproc;
+      MPI_Comm_rank(MPI_COMM_WORLD, &iproc);
+      if(iproc == 0) std::cout << " Direct insertion is available only for AIJ matrices with block size 1, it is switched off" << std::endl;
+      _directStatus = DIRECT_IDLE;
+      SetDirectInsertion(false);
+      return;
+    }
+
+    _directDiagonal = _mat;
+    _directOffDiagonal = NULL;
+    const PetscInt *colmap = NULL;
+    if(parallel) {
+      ierr = MatMPIAIJGetSeqAIJ(_mat, &_directDiagonal, &_directOffDiagonal, &colmap);
+      CHKERRABORT(MPI_COMM_WORLD, ierr);
+    }
+
+    PetscInt nrows = 0;
+    const PetscInt *iaD = NULL, *jaD = NULL, *iaO = NULL, *jaO = NULL;
+    PetscBool done;
+    ierr = MatGetRowIJ(_directDiagonal, 0, PETSC_FALSE, PETSC_FALSE, &nrows, &iaD, &jaD, &done);
+    CHKERRABORT(MPI_COMM_WORLD, ierr);
+    _directDiagonalSize = iaD[nrows];
+    _directOffDiagonalSize = 0;
+    if(parallel) {
+      ierr = MatGetRowIJ(_directOffDiagonal, 0, PETSC_FALSE, PETSC_FALSE, &nrows, &iaO, &jaO, &done);
+      CHKERRABORT(MPI_COMM_WORLD, ierr);
+      _directOffDiagonalSize = iaO[nrows];
+    }
+
+    int rstart, rend, cstart, cend;
+    ierr = MatGetOwnershipRange(_mat, &rstart, &rend);
+    CHKERRABORT(MPI_COMM_WORLD, ierr);
+    ierr = MatGetOwnershipRangeColumn(_mat, &cstart, &cend);
+    CHKERRABORT(MPI_COMM_WORLD, ierr);
+
+    int failed = 0;
+
+    //BEGIN positions of the entries of the owned rows
+    const unsigned nCalls = (_directDofOffset.size() - 1) / 2;
+    _directPositionOffset.resize(nCalls + 1);
+    _directPositionOffset[0] = 0;
+    for(unsigned k = 0; k < nCalls; k++) {
+      const unsigned m = _directDofOffset[2 * k + 1] - _directDofOffset[2 * k];
+      const unsigned n = _directDofOffset[2 * k + 2] - _directDofOffset[2 * k + 1];
+      _directPositionOffset[k + 1] = _directPositionOffset[k] + m * n;
+    }
+    _directPosition.resize(_directPositionOffset[nCalls]);
+
+    _directCallKey.resize(0);
+    for(unsigned k = 0; k < nCalls; k++) {
+      if(_directDofOffset[2 * k + 1] > _directDofOffset[2 * k]) {
+        _directCallKey.push_back(std::make_pair(_directDofs[_directDofOffset[2 * k]], k));
+      }
+    }
+    std::sort(_directCallKey.begin(), _directCallKey.end());
+
+    // off-process entries (row, column) and their index in _directPosition
+    std::vector < std::pair < std::pair < int, int >, unsigned > > offProcess;
+    for(unsigned k = 0; k < nCalls; k++) {
+      const int *rows = _directDofs.data() + _directDofOffset[2 * k];
+      const int *cols = _directDofs.data() + _directDofOffset[2 * k + 1];
+      const unsigned m = _directDofOffset[2 * k + 1] - _directDofOffset[2 * k];
+      const unsigned n = _directDofOffset[2 * k + 2] - _directDofOffset[2 * k + 1];
+      for(unsigned i = 0; i < m; i++) {
+        for(unsigned j = 0; j < n; j++) {
+          const unsigned ij = _directPositionOffset[k] + i * n + j;
+          if(rows[i] < 0 || cols[j] < 0) { // ignored by MatSetValues
+            _directPosition[ij] = -1;
+          }
+          else if(rows[i] >= rstart && rows[i] < rend) {
+            _directPosition[ij] = GetDirectPosition(rows[i], cols[j], rstart, cstart, cend, iaD, jaD, iaO, jaO, colmap);
+            if(_directPosition[ij] < 0) failed = 1;
+          }
+          else {
+            offProcess.push_back(std::make_pair(std::make_pair(rows[i], cols[j]), ij));
+          }
+        }
+      }
+    }
+    //END
+
+    //BEGIN send buffer slots of the off-process entries, sorted by row and then by destination process
+    int nprocs = 1;
+    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+    const PetscInt *ranges;
+    ierr = MatGetOwnershipRanges(_mat, &ranges);
+    CHKERRABORT(MPI_COMM_WORLD, ierr);
+
+    std::sort(offProcess.begin(), offProcess.end());
+    _directSendCount.assign(nprocs, 0);
+    std::vector < int > sendPairs;
+    const int offset = _directDiagonalSize + _directOffDiagonalSize;
+    int slot = -1;
+    for(unsigned i = 0; i < offProcess.size(); i++) {
+      if(i == 0 || offProcess[i].first != offProcess[i - 1].first) {
+        slot++;
+        const int r = offProcess[i].first.first;
+        _directSendCount[std::upper_bound(ranges, ranges + nprocs + 1, r) - ranges - 1]++;
+        sendPairs.push_back(r);
+        sendPairs.push_back(offProcess[i].first.second);
+      }
+      _directPosition[offProcess[i].second] = offset + slot;
+    }
+    _directSendBuffer.assign(slot + 1, 0.);
+    //END
+
+    //BEGIN receive the off-process entries of the owned rows
+    _directRecvPosition.resize(0);
+    if(parallel) {
+      _directRecvCount.resize(nprocs);
+      MPI_Alltoall(&_directSendCount[0], 1, MPI_INT, &_directRecvCount[0], 1, MPI_INT, MPI_COMM_WORLD);
+
+      _directSendOffset.resize(nprocs);
+      _directRecvOffset.resize(nprocs);
+      std::vector < int > pairSendCount(nprocs), pairSendOffset(nprocs), pairRecvCount(nprocs), pairRecvOffset(nprocs);
+      int sendSize = 0, recvSize = 0;
+      for(int p = 0; p < nprocs; p++) {
+        _directSendOffset[p] = sendSize;
+        _directRecvOffset[p] = recvSize;
+        pairSendCount[p] = 2 * _directSendCount[p];
+        pairSendOffset[p] = 2 * sendSize;
+        pairRecvCount[p] = 2 * _directRecvCount[p];
+        pairRecvOffset[p] = 2 * recvSize;
+        sendSize += _directSendCount[p];
+        recvSize += _directRecvCount[p];
+      }
+
+      std::vector < int > recvPairs(2 * recvSize);
+      MPI_Alltoallv(sendPairs.data(), &pairSendCount[0], &pairSendOffset[0], MPI_INT,
+                    recvPairs.data(), &pairRecvCount[0], &pairRecvOffset[0], MPI_INT, MPI_COMM_WORLD);
+
+      _directRecvPosition.resize(recvSize);
+      for(int i = 0; i < recvSize; i++) {
+        _directRecvPosition[i] = GetDirectPosition(recvPairs[2 * i], recvPairs[2 * i + 1], rstart, cstart, cend, iaD, jaD, iaO, jaO, colmap);
+        if(_directRecvPosition[i] < 0) failed = 1;
+      }
+      _directRecvBuffer.resize(recvSize);
+
+      MPI_Allreduce(MPI_IN_PLACE, &failed, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+    }
+    //END
+
+    ierr = MatRestoreRowIJ(_directDiagonal, 0, PETSC_FALSE, PETSC_FALSE, &nrows, &iaD, &jaD, &done);
+    CHKERRABORT(MPI_COMM_WORLD, ierr);
+    if(parallel) {
+      ierr = MatRestoreRowIJ(_directOffDiagonal, 0, PETSC_FALSE, PETSC_FALSE, &nrows, &iaO, &jaO, &done);
+      CHKERRABORT(MPI_COMM_WORLD, ierr);
+    }
+
+    MatInfo info;
+    ierr = MatGetInfo(_mat, MAT_LOCAL, &info);
+    CHKERRABORT(MPI_COMM_WORLD, ierr);
+    _directNonzeros = info.nz_used;
+    _directMat = _mat;
+
+    // the recorded dofs stay to check the calls of the next assemblies
+    _directMapIsValid = !failed;
+  }
+
+// =========================================================================
+  void PetscMatrix::CloseDirectInsertion() {
+    int ierr = 0;
+
+    if(_directStatus == DIRECT_REPLAYING) {
+      if(_directOffDiagonal != NULL) {
+        MPI_Alltoallv(_directSendBuffer.data(), &_directSendCount[0], &_directSendOffset[0], MPI_DOUBLE,
+                      _directRecvBuffer.data(), &_directRecvCount[0], &_directRecvOffset[0], MPI_DOUBLE, MPI_COMM_WORLD);
+        for(unsigned i = 0; i < _directRecvPosition.size(); i++) {
+          const int p = _directRecvPosition[i];
+          if(p < _directDiagonalSize) _directDiagonalArray[p] += _directRecvBuffer[i];
+          else _directOffDiagonalArray[p - _directDiagonalSize] += _directRecvBuffer[i];
+        }
+        ierr = MatSeqAIJRestoreArray(_directOffDiagonal, &_directOffDiagonalArray);
+        CHKERRABORT(MPI_COMM_WORLD, ierr);
+      }
+      ierr = MatSeqAIJRestoreArray(_directDiagonal, &_directDiagonalArray);
+      CHKERRABORT(MPI_COMM_WORLD, ierr);
+
+      // the calls not recorded, now that the positions are no longer used
+      const unsigned nDeferred = (_directDeferredDofOffset.size() > 0) ? (_directDeferredDofOffset.size() - 1) / 2 : 0;
+      unsigned valueOffset = 0;
+      for(unsigned k = 0; k < nDeferred; k++) {
+        const int m = _directDeferredDofOffset[2 * k + 1] - _directDeferredDofOffset[2 * k];
+        const int n = _directDeferredDofOffset[2 * k + 2] - _directDeferredDofOffset[2 * k + 1];
+        ierr = MatSetValuesBlocked(_mat, m, &_directDeferredDofs[_directDeferredDofOffset[2 * k]],
+                                   n, &_directDeferredDofs[_directDeferredDofOffset[2 * k + 1]],
+                                   &_directDeferredValues[valueOffset], ADD_VALUES);
+        CHKERRABORT(MPI_COMM_WORLD, ierr);
+        valueOffset += m * n;
+      }
+      std::vector < unsigned > ().swap(_directDeferredDofOffset);
+      std::vector < int > ().swap(_directDeferredDofs);
+      std::vector < double > ().swap(_directDeferredValues);
+    }
+
+    // the off-process contributions of the deferred calls are in the PETSc stash
+    ierr = MatAssemblyBegin(_mat, MAT_FINAL_ASSEMBLY);
+    CHKERRABORT(MPI_COMM_WORLD, ierr);
+    ierr = MatAssemblyEnd(_mat, MAT_FINAL_ASSEMBLY);
+    CHKERRABORT(MPI_COMM_WORLD, ierr);
+
+    if(_directStatus == DIRECT_RECORDING) {
+      BuildDirectInsertionMap();
+    }
+    else {
+      int mismatch = (_directMismatch || _directCounter + 1 != _directPositionOffset.size()) ? 1 : 0;
+      if(_directOffDiagonal != NULL) {
+        MPI_Allreduce(MPI_IN_PLACE, &mismatch, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+      }
+      if(mismatch) _directMapIsValid = false; // record again at the next assembly
+    }
+    _directStatus = DIRECT_IDLE;
   }
 
 // =========================================================================
@@ -399,6 +727,11 @@ namespace femus {
       CHKERRABORT(MPI_COMM_WORLD, ierr);
       this->_is_initialized = false;
     }
+    _directMapIsValid = false;
+    _directStatus = DIRECT_IDLE;
+    std::vector < unsigned > ().swap(_directDeferredDofOffset);
+    std::vector < int > ().swap(_directDeferredDofs);
+    std::vector < double > ().swap(_directDeferredValues);
   }
 
 // ============================================
@@ -627,6 +960,7 @@ void PetscMatrix::print_matlab(const std::string& name, const std::string& forma
                                const std::vector<unsigned int>& rows,
                                const std::vector<unsigned int>& cols) {
     assert(this->initialized());
+    CheckNoDirectInsertion("add_matrix");
     const  int m = dm.m();
     assert((int)rows.size() == m);
     const  int n = dm.n();
@@ -664,6 +998,48 @@ void PetscMatrix::print_matlab(const std::string& name, const std::string& forma
     const  int n = (int)cols.size();
     assert(m * n == mat_values.size());
 
+    if(_directStatus == DIRECT_REPLAYING) {
+      // the calls usually come in the recorded order, otherwise (e.g. threaded element loops) search them by first row
+      unsigned k = _directCounter++;
+      bool found = IsDirectCall(k, rows, cols);
+      if(!found && m > 0) {
+        typedef std::vector < std::pair < int, unsigned > >::const_iterator KeyIterator;
+        std::pair < KeyIterator, KeyIterator > range = std::equal_range(_directCallKey.begin(), _directCallKey.end(), std::make_pair(rows[0], 0u), CompareFirst);
+        for(KeyIterator it = range.first; it != range.second && !found; it++) {
+          k = it->second;
+          found = IsDirectCall(k, rows, cols);
+        }
+      }
+      if(found) {
+        const int *position = _directPosition.data() + _directPositionOffset[k];
+        const int nD = _directDiagonalSize;
+        const int nDO = _directDiagonalSize + _directOffDiagonalSize;
+        for(int ij = 0; ij < m * n; ij++) {
+          const int p = position[ij];
+          if(p < 0) continue;
+          else if(p < nD) _directDiagonalArray[p] += mat_values[ij];
+          else if(p < nDO) _directOffDiagonalArray[p - nD] += mat_values[ij];
+          else _directSendBuffer[p - nDO] += mat_values[ij];
+        }
+        return;
+      }
+      // not recorded: it may add new nonzeros and move the positions of the value arrays, so close() inserts it
+      _directMismatch = true;
+      if(_directDeferredDofOffset.size() == 0) _directDeferredDofOffset.assign(1, 0);
+      _directDeferredDofs.insert(_directDeferredDofs.end(), rows.begin(), rows.end());
+      _directDeferredDofOffset.push_back(_directDeferredDofs.size());
+      _directDeferredDofs.insert(_directDeferredDofs.end(), cols.begin(), cols.end());
+      _directDeferredDofOffset.push_back(_directDeferredDofs.size());
+      _directDeferredValues.insert(_directDeferredValues.end(), mat_values.begin(), mat_values.end());
+      return;
+    }
+    else if(_directStatus == DIRECT_RECORDING) {
+      _directDofs.insert(_directDofs.end(), rows.begin(), rows.end());
+      _directDofOffset.push_back(_directDofs.size());
+      _directDofs.insert(_directDofs.end(), cols.begin(), cols.end());
+      _directDofOffset.push_back(_directDofs.size());
+    }
+
     //These casts are required for PETSc <= 2.1.5
     ierr = MatSetValuesBlocked(_mat, m, &rows[0], n, &cols[0],
                                (PetscScalar*) &mat_values[0], ADD_VALUES);
@@ -777,6 +1153,7 @@ void PetscMatrix::print_matlab(const std::string& name, const std::string& forma
 // ===========================================================
 
   void PetscMatrix::matrix_set_diagonal_values(const std::vector< int > &index, const double &value) {
+    CheckNoDirectInsertion("matrix_set_diagonal_values");
     for(int i = 0; i < index.size(); i++) {
       int ierr = MatSetValuesBlocked(_mat, 1, &index[i], 1, &index[i], &value, INSERT_VALUES);
       CHKERRABORT(MPI_COMM_WORLD, ierr);
@@ -786,6 +1163,7 @@ void PetscMatrix::print_matlab(const std::string& name, const std::string& forma
 // ===========================================================
 
   void PetscMatrix::matrix_set_diagonal_values(const std::vector< int > &index, const std::vector<double> &value) {
+    CheckNoDirectInsertion("matrix_set_diagonal_values");
     assert(index.size() == value.size());
     for(int i = 0; i < index.size(); i++) {
       int ierr = MatSetValuesBlocked(_mat, 1, &index[i], 1, &index[i], &value[i], INSERT_VALUES);
@@ -74,6 +74,55 @@ private:
   Mat _mat;                 ///< Petsc matrix pointer
   bool _destroy_mat_on_exit;///< Boolean value (false)
 
+  // direct insertion ------------------------------------
+  enum DirectInsertionStatus {DIRECT_IDLE, DIRECT_RECORDING, DIRECT_REPLAYING};
+  bool _directInsertion;             ///< add the element matrices directly into the local value arrays
+  bool _directMapIsValid;            ///< the positions of the recorded assembly can be replayed
+  DirectInsertionStatus _directStatus;
+  bool _directMismatch;              ///< an add_matrix_blocked call differs from the recorded one
+  unsigned _directCounter;           ///< index of the next add_matrix_blocked call of the assembly
+  Mat _directMat;                    ///< matrix the positions refer to
+  double _directNonzeros;            ///< local nonzeros of the matrix the positions refer to
+  std::vector < unsigned > _directDofOffset;      ///< rows of the call k in [2k, 2k+1), columns in [2k+1, 2k+2)
+  std::vector < int > _directDofs;
+  std::vector < unsigned > _directPositionOffset; ///< positions of the call k in [k, k+1)
+  /** position of each entry of the recorded calls: [0, nD) diagonal block values, [nD, nD + nO) off-diagonal block values,
+   * nD + nO + s the slot s of the send buffer, -1 skipped */
+  std::vector < int > _directPosition;
+  std::vector < std::pair < int, unsigned > > _directCallKey; ///< (first row, call) sorted
+  int _directDiagonalSize;
+  int _directOffDiagonalSize;
+  Mat _directDiagonal;               ///< local diagonal block (the matrix itself for SEQAIJ)
+  Mat _directOffDiagonal;            ///< local off-diagonal block, NULL for SEQAIJ
+  PetscScalar *_directDiagonalArray;
+  PetscScalar *_directOffDiagonalArray;
+  std::vector < double > _directSendBuffer;       ///< off-process contributions, by destination process
+  std::vector < double > _directRecvBuffer;
+  std::vector < int > _directSendCount;
+  std::vector < int > _directSendOffset;
+  std::vector < int > _directRecvCount;
+  std::vector < int > _directRecvOffset;
+  std::vector < int > _directRecvPosition;        ///< local positions of the received contributions
+  std::vector < unsigned > _directDeferredDofOffset; ///< calls not recorded, inserted by close() as _directDofOffset
+  std::vector < int > _directDeferredDofs;
+  std::vector < double > _directDeferredValues;
+
+  /// True if rows and cols are those of the recorded call k
+  bool IsDirectCall(const unsigned &k, const std::vector < int > &rows, const std::vector < int > &cols) const;
+  static bool CompareFirst(const std::pair < int, unsigned > &a, const std::pair < int, unsigned > &b) {
+    return a.first < b.first;
+  }
+  /// Local position of the entry (r, c) of an owned row, -1 if not in the matrix structure
+  int GetDirectPosition(const int &r, const int &c, const int &rstart, const int &cstart, const int &cend,
+                        const PetscInt *iaD, const PetscInt *jaD, const PetscInt *iaO, const PetscInt *jaO,
+                        const PetscInt *colmap) const;
+  /// Build the positions of the recorded calls in the assembled matrix, collective
+  void BuildDirectInsertionMap();
+  /// Exchange and add the off-process contributions, release the value arrays, insert the deferred calls and assemble, collective
+  void CloseDirectInsertion();
+  /// Abort if the insertion function name is called between zero() and close() of the direct insertion mode
+  void CheckNoDirectInsertion(const char name[]) const;
+
 public:
   // Constructor ---------------------------------------------------------
   /// Constructor I;  initialize the matrix before usage with \p init(...).
@@ -101,6 +150,17 @@ public:
   void zero_rows(std::vector<int> & rows, double diag_value = 0.0);///< set  rows to zero
   void close() const;///< close
 
+  /** Direct insertion mode: the first assembly after zero() records the add_matrix_blocked calls and, when closed,
+   * maps each element dof pair to its offset in the local value arrays or to a slot of a preallocated send buffer of
+   * the off-process contributions. The following assemblies with the same calls add the element matrices directly
+   * into the value arrays and close() exchanges the send buffer. A call that is not recorded is kept aside and inserted
+   * with MatSetValuesBlocked by close(), after the value arrays are released, since a new nonzero would move the
+   * positions; the next assembly then records again, as it does after any change of the matrix structure.
+   * While the mode is active, between zero() and close(), add_matrix_blocked is the only insertion function, the others abort.
+   * The positions take one int per element matrix entry and assume an AIJ matrix with block size 1, otherwise the mode
+   * is switched off at the first close(). zero() and close() have to be called by all the processes */
+  void SetDirectInsertion(const bool &directInsertion);
+
 
   // Returns -------------------------------------------
   /// PETSc matrix context pointer
@@ -207,10 +267,12 @@ protected:
 // ===============================================
 
 // ===============================================
-inline PetscMatrix::PetscMatrix()  : _destroy_mat_on_exit(true) {}
+inline PetscMatrix::PetscMatrix()  : _destroy_mat_on_exit(true), _directInsertion(false), _directMapIsValid(false),
+  _directStatus(DIRECT_IDLE), _directMismatch(false), _directCounter(0), _directMat(NULL) {}
 
 // =================================================================
-inline PetscMatrix::PetscMatrix(Mat m): _destroy_mat_on_exit(false) {
+inline PetscMatrix::PetscMatrix(Mat m): _destroy_mat_on_exit(false), _directInsertion(false), _directMapIsValid(false),
+  _directStatus(DIRECT_IDLE), _directMismatch(false), _directCounter(0), _directMat(NULL) {
   this->_mat = m;
   this->_is_initialized = true;
 }
@@ -220,10 +282,24 @@ inline PetscMatrix::~PetscMatrix() {
   this->clear();
 }
 
+// ==========================================
+inline void PetscMatrix::CheckNoDirectInsertion(const char name[]) const {
+  if(_directStatus != DIRECT_IDLE) {
+    std::cout << "Error in PetscMatrix::" << name << ", the matrix is assembled in direct insertion mode: "
+              << "between zero() and close() only add_matrix_blocked can be used" << std::endl;
+    abort();
+  }
+}
+
 // ==========================================
 /// This function checks if the matrix is closed
 inline void PetscMatrix::close() const {
   parallel_only();
+  if(_directStatus != DIRECT_IDLE) {
+    // the direct insertion state is not part of the matrix value
+    const_cast < PetscMatrix* >(this)->CloseDirectInsertion();
+    return;
+  }
   int ierr=0;
   ierr = MatAssemblyBegin(_mat, MAT_FINAL_ASSEMBLY);
   CHKERRABORT(MPI_COMM_WORLD,ierr);
@@ -276,6 +352,7 @@ inline void PetscMatrix::set(const int i,
                               const int j,
                               const double value) {
   assert(this->initialized());
+  CheckNoDirectInsertion("set");
   int ierr=0, i_val=i, j_val=j;
   PetscScalar petsc_value = static_cast<PetscScalar>(value);
   ierr = MatSetValues(_mat, 1, &i_val, 1, &j_val,
@@ -290,6 +367,7 @@ inline void PetscMatrix::add(const int i,    // index i
                               const double value      // value
                              ) {
   assert(this->initialized());
+  CheckNoDirectInsertion("add");
   int ierr=0, i_val=i, j_val=j;
 
   PetscScalar petsc_value = static_cast<PetscScalar>(value);
@@ -313,6 +391,7 @@ inline void PetscMatrix::add(const double a_in,      // double constant
                               SparseMatrix &X_in  // sparse matrix
                              ) {
   assert(this->initialized());
+  CheckNoDirectInsertion("add");
 
   // crash due to incompatible sparsity structure...
   assert(this->m() == X_in.m());
@@ -428,6 +507,7 @@ inline void PetscMatrix::swap(
 
 inline void PetscMatrix::matrix_add (const double a_in, SparseMatrix &X_in, const char pattern_type []) {
   assert (this->initialized());
+  CheckNoDirectInsertion("matrix_add");
 
   // sanity check. but this cannot avoid
   // crash due to incompatible sparsity structure...
@@ -468,6 +548,7 @@ inline void PetscMatrix::insert_row(const int row, const int ncols,
 				    const std::vector<int>& cols, double* values) {
   
   assert (this->initialized());
+  CheckNoDirectInsertion("insert_row");
   int ierr=0;
    
   ierr=MatSetValues(_mat,1,(PetscInt*) &row,(PetscInt) ncols, (PetscInt*) &cols[0],
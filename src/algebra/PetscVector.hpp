@@ -25,6 +25,7 @@
 
 // C++ includes
 #include <map>
+#include <algorithm>
 #include <vector>
 #include <cstdio>
 // Local includes
@@ -188,6 +189,12 @@ public:
   /// operator() individually for each index.
   void get(const std::vector<int>& index, std::vector<double>& values) const;
 
+  /// Access the \p n components \p index[0], ..., \p index[n-1] and store them
+  /// in \p values, which must have room for \p n entries. It does not allocate and
+  /// the ownership range is read only once, so it is the preferred way to extract
+  /// the element local values.
+  void get(const unsigned* index, const unsigned& n, double* values) const;
+
   // ===========================
   // ALGEBRA FUNCTIONS
   // ===========================
@@ -296,11 +303,21 @@ private:
   /// doublehis pointer is only valid if \p _array_is_present is \p true.
   mutable PetscScalar* _values;
 
-  /// doubleype for map that maps global to local ghost cells.
-  typedef std::map<int,int> GlobalToLocalMap;
+  /// Global indices of the ghost cells, sorted, and the corresponding local ghost
+  /// cells (both empty if not in ghost cell mode). A binary search on the flat array
+  /// replaces the former std::map lookup.
+  std::vector<int> _ghost_global_index;
+  std::vector<int> _ghost_local_index;
+
+  /// Ownership range, valid only if \p _array_is_present is \p true.
+  mutable int _first;
+  mutable int _last;
 
-  /// Map that maps global to local ghost cells (will be empty if not in ghost cell mode
-  GlobalToLocalMap _global_to_local_map;
+  /// Build the sorted ghost index arrays from the list of the ghost cells, in local order.
+  void _build_ghost_index(const std::vector<int>& ghost);
+
+  /// Same as \p map_global_to_local_index, using the ownership range stored by \p _get_array().
+  int _local_index(const int i) const;
 
   /// doublehis boolean value should only be set to false
   /// for the constructor which takes a PETSc Vec object.
@@ -324,7 +341,10 @@ inline PetscVector::PetscVector (const ParallelType type)
   : _array_is_present(false),
     _local_form(NULL),
     _values(NULL),
-    _global_to_local_map(),
+    _ghost_global_index(),
+    _ghost_local_index(),
+    _first(0),
+    _last(0),
     _destroy_vec_on_exit(true) {
   this->_type = type;
 }
@@ -333,7 +353,10 @@ inline PetscVector::PetscVector (const int n,const ParallelType type)
   : _array_is_present(false),
     _local_form(NULL),
     _values(NULL),
-    _global_to_local_map(),
+    _ghost_global_index(),
+    _ghost_local_index(),
+    _first(0),
+    _last(0),
     _destroy_vec_on_exit(true) {
   this->init(n, n, false, type);
 }
@@ -344,7 +367,10 @@ inline PetscVector::PetscVector (const int n,
   : _array_is_present(false),
     _local_form(NULL),
     _values(NULL),
-    _global_to_local_map(),
+    _ghost_global_index(),
+    _ghost_local_index(),
+    _first(0),
+    _last(0),
     _destroy_vec_on_exit(true) {
   this->init(n, n_local, false, type);
 }
@@ -356,7 +382,10 @@ inline PetscVector::PetscVector (const int n,
   : _array_is_present(false),
     _local_form(NULL),
     _values(NULL),
-    _global_to_local_map(),
+    _ghost_global_index(),
+    _ghost_local_index(),
+    _first(0),
+    _last(0),
     _destroy_vec_on_exit(true) {
   this->init(n, n_local, ghost, false, type);
 }
@@ -365,7 +394,10 @@ inline PetscVector::PetscVector (Vec v)
   : _array_is_present(false),
     _local_form(NULL),
     _values(NULL),
-    _global_to_local_map(),
+    _ghost_global_index(),
+    _ghost_local_index(),
+    _first(0),
+    _last(0),
     _destroy_vec_on_exit(false) {
   this->_vec = v;
   this->_is_closed = true;
@@ -426,8 +458,8 @@ inline PetscVector::PetscVector (Vec v)
       ierr = ISLocalToGlobalMappingGetIndices(mapping,&indices);
       CHKERRABORT(MPI_COMM_WORLD,ierr);
 #endif
-      for(unsigned int i=ghost_begin; i<ghost_end; i++)
-        _global_to_local_map[indices[i]] = i-local_size;
+      std::vector<int> ghost(indices + ghost_begin, indices + ghost_end);
+      _build_ghost_index(ghost);
       this->_type = GHOSTED;
 #if !PETSC_VERSION_RELEASE || !PETSC_VERSION_LESS_THAN(3,1,1)
       ierr = ISLocalToGlobalMappingRestoreIndices(mapping, &indices);
@@ -540,9 +572,7 @@ inline void PetscVector::init (const int n,
   this->_type = GHOSTED;
 
   /* Make the global-to-local ghost cell map.  */
-  for (int i=0; i<(int)ghost.size(); i++){
-    _global_to_local_map[ghost[i]] = i;
-  }
+  _build_ghost_index(ghost);
 
   /* Create vector.  */
   ierr = VecCreateGhost (MPI_COMM_WORLD, petsc_n_local, petsc_n,
@@ -568,7 +598,8 @@ inline void PetscVector::init(const NumericVector& other, const bool fast) {
     v._restore_array();
   }
 
-  this->_global_to_local_map = v._global_to_local_map;
+  this->_ghost_global_index = v._ghost_global_index;
+  this->_ghost_local_index = v._ghost_local_index;
   this->_is_closed      = v._is_closed;
   this->_is_initialized = v._is_initialized;
   this->_type = v._type;
@@ -607,7 +638,8 @@ inline void PetscVector::clear () {
     CHKERRABORT(MPI_COMM_WORLD,ierr);
   }
   this->_is_closed = this->_is_initialized = false;
-  _global_to_local_map.clear();
+  _ghost_global_index.clear();
+  _ghost_local_index.clear();
 }
 
 
@@ -692,15 +724,28 @@ inline int PetscVector::map_global_to_local_index (const int i) const {
     return i-first;
   }
 
-  GlobalToLocalMap::const_iterator it = _global_to_local_map.find(i);
-  assert (it!=_global_to_local_map.end());
-  return it->second+last-first;
+  std::vector<int>::const_iterator it = std::lower_bound(_ghost_global_index.begin(), _ghost_global_index.end(), i);
+  assert (it!=_ghost_global_index.end() && *it==i);
+  return _ghost_local_index[it - _ghost_global_index.begin()]+last-first;
+}
+
+
+inline int PetscVector::_local_index (const int i) const {
+  assert (_array_is_present);
+
+  if ((i>=_first) && (i<_last))    {
+    return i-_first;
+  }
+
+  std::vector<int>::const_iterator it = std::lower_bound(_ghost_global_index.begin(), _ghost_global_index.end(), i);
+  assert (it!=_ghost_global_index.end() && *it==i);
+  return _ghost_local_index[it - _ghost_global_index.begin()]+_last-_first;
 }
 
 
 inline double PetscVector::operator() (const int i) const {
   this->_get_array();
-  const int local_index = this->map_global_to_local_index(i);
+  const int local_index = this->_local_index(i);
 #ifndef NDEBUG
     if (this->type() == GHOSTED) assert(local_index<_local_size);
 #endif
@@ -721,7 +766,7 @@ inline void PetscVector::get(const std::vector<int>& index, std::vector<double>&
   values.resize(num);
 
   for (int i=0; i<num; i++) {
-    const int local_index = this->map_global_to_local_index(index[i]);
+    const int local_index = this->_local_index(index[i]);
 #ifndef NDEBUG
     if (this->type() == GHOSTED) assert(local_index<_local_size);
 #endif
@@ -729,6 +774,35 @@ inline void PetscVector::get(const std::vector<int>& index, std::vector<double>&
   }
 }
 
+
+inline void PetscVector::get(const unsigned* index, const unsigned& n, double* values) const {
+  this->_get_array();
+
+  for (unsigned i=0; i<n; i++) {
+    const int local_index = this->_local_index(static_cast<int>(index[i]));
+#ifndef NDEBUG
+    if (this->type() == GHOSTED) assert(local_index<_local_size);
+#endif
+    values[i] = static_cast<double>(_values[local_index]);
+  }
+}
+
+
+inline void PetscVector::_build_ghost_index(const std::vector<int>& ghost) {
+  std::vector< std::pair<int,int> > ghost_pair(ghost.size());
+  for (unsigned i=0; i<ghost.size(); i++) {
+    ghost_pair[i] = std::make_pair(ghost[i], static_cast<int>(i));
+  }
+  std::sort(ghost_pair.begin(), ghost_pair.end());
+
+  _ghost_global_index.resize(ghost.size());
+  _ghost_local_index.resize(ghost.size());
+  for (unsigned i=0; i<ghost_pair.size(); i++) {
+    _ghost_global_index[i] = ghost_pair[i].first;
+    _ghost_local_index[i] = ghost_pair[i].second;
+  }
+}
+
 inline double PetscVector::min () const {
   this->_restore_array();
   int index=0, ierr=0;
@@ -756,10 +830,13 @@ inline void PetscVector::swap (NumericVector &other) {
   PetscVector& v = libmeshM_cast_ref<PetscVector&>(other);
   std::swap(_vec, v._vec);
   std::swap(_destroy_vec_on_exit, v._destroy_vec_on_exit);
-  std::swap(_global_to_local_map, v._global_to_local_map);
+  std::swap(_ghost_global_index, v._ghost_global_index);
+  std::swap(_ghost_local_index, v._ghost_local_index);
   std::swap(_array_is_present, v._array_is_present);
   std::swap(_local_form, v._local_form);
   std::swap(_values, v._values);
+  std::swap(_first, v._first);
+  std::swap(_last, v._last);
 }
 
 
@@ -767,6 +844,8 @@ inline void PetscVector::_get_array(void) const {
   assert (this->initialized());
   if (!_array_is_present) {
     int ierr=0;
+    ierr = VecGetOwnershipRange (_vec, &_first, &_last);
+    CHKERRABORT(MPI_COMM_WORLD,ierr);
     if (this->type() != GHOSTED) {
       ierr = VecGetArray(_vec, &_values);
       CHKERRABORT(MPI_COMM_WORLD,ierr);
@@ -98,6 +98,9 @@ public:
     /** set close flag */
     virtual void close () const = 0;
 
+    /** Add the element matrices directly into the storage, if supported (see PetscMatrix) */
+    virtual void SetDirectInsertion (const bool &) {};
+
     // Return data -------------------------------------------------
     // matrix values
 
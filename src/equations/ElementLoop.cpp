@@ -0,0 +1,341 @@
+/*=========================================================================
+
+ Program: FEMUS
+ Module: ElementLoop
+ Authors: Eugenio Aulisa
+
+ Copyright (c) FEMTTU
+ All rights reserved.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+//----------------------------------------------------------------------------
+// includes :
+//----------------------------------------------------------------------------
+#include "ElementLoop.hpp"
+#include "Mesh.hpp"
+#include "Solution.hpp"
+#include "SparseMatrix.hpp"
+#include "NumericVector.hpp"
+#include "FemusInit.hpp"
+#include "LinearImplicitSystem.hpp"
+
+#include <cassert>
+
+namespace femus {
+
+  // ********************************************
+
+  void ElementLoopBuffer::Stage(const bool &assembleMatrix) {
+
+    unsigned nDofs = _sysDof.size();
+
+    if(nDofs == 0) return;
+
+    assert(_Res.size() == nDofs);
+    _stagedDof.insert(_stagedDof.end(), _sysDof.begin(), _sysDof.end());
+    _stagedRes.insert(_stagedRes.end(), _Res.begin(), _Res.end());
+
+    if(assembleMatrix) {
+      assert(_Jac.size() == nDofs * nDofs);
+      _stagedJac.insert(_stagedJac.end(), _Jac.begin(), _Jac.end());
+    }
+
+    _stagedOffset.push_back(_stagedDof.size());
+  }
+
+  // ********************************************
+
+  void ElementLoopBuffer::ClearStage() {
+    _stagedOffset.assign(1, 0);
+    _stagedDof.resize(0);
+    _stagedRes.resize(0);
+    _stagedJac.resize(0);
+  }
+
+  // ********************************************
+
+  ElementLoop::ElementLoop() :
+    _nThreads(1),
+    _generation(0),
+    _busyThreads(0),
+    _stopPool(false),
+    _nextElement(0),
+    _elementEnd(0),
+    _chunkSize(1),
+    _kernel(NULL),
+    _system(NULL),
+    _KK(NULL),
+    _RES(NULL),
+    _assembleMatrix(true) {
+    _buffer.resize(1);
+  }
+
+  // ********************************************
+
+  ElementLoop::~ElementLoop() {
+    StopPool();
+  }
+
+  // ********************************************
+
+  void ElementLoop::SetNumberOfThreads(const unsigned &nThreads) {
+
+    unsigned n = (nThreads > 0) ? nThreads : 1;
+
+    if(n == _nThreads) return;
+
+    StopPool();
+
+    _nThreads = n;
+    _buffer.resize(_nThreads);
+
+    for(unsigned ithread = 0; ithread < _nThreads; ithread++) {
+      _buffer[ithread]._threadId = ithread;
+    }
+
+    // each worker records the automatic differentiation of its kernels into its own stack
+    if(FemusInit::_adeptStackPool.GetNumberOfStacks() < _nThreads) {
+      FemusInit::_adeptStackPool.Resize(_nThreads);
+    }
+
+    if(_nThreads > 1) StartPool();
+  }
+
+  // ********************************************
+
+  void ElementLoop::StartPool() {
+    _stopPool = false;
+    _pool.reserve(_nThreads - 1);
+
+    for(unsigned ithread = 1; ithread < _nThreads; ithread++) {
+      _pool.push_back(std::thread(&ElementLoop::WorkerLoop, this, ithread));
+    }
+  }
+
+  // ********************************************
+
+  void ElementLoop::StopPool() {
+    if(_pool.size() == 0) return;
+
+    {
+      std::unique_lock < std::mutex > lock(_poolMutex);
+      _stopPool = true;
+    }
+    _workReady.notify_all();
+
+    for(unsigned i = 0; i < _pool.size(); i++) {
+      _pool[i].join();
+    }
+
+    _pool.clear();
+  }
+
+  // ********************************************
+
+  void ElementLoop::WorkerLoop(const unsigned ithread) {
+
+    unsigned generation = 0;
+
+    while(true) {
+      std::unique_lock < std::mutex > lock(_poolMutex);
+      while(!_stopPool && _generation == generation) _workReady.wait(lock);
+
+      if(_stopPool) return;
+
+      generation = _generation;
+      lock.unlock();
+
+      // the stack is bound only while working, the pool stacks are shared by all the element loops
+      FemusInit::_adeptStackPool.Activate(ithread);
+      ProcessElements(ithread);
+      FemusInit::_adeptStackPool.Deactivate(ithread);
+
+      lock.lock();
+      _busyThreads--;
+      if(_busyThreads == 0) _workDone.notify_one();
+    }
+  }
+
+  // ********************************************
+
+  void ElementLoop::ProcessElements(const unsigned &ithread) {
+
+    ElementLoopBuffer &buffer = _buffer[ithread];
+
+    while(true) {
+      unsigned begin = _nextElement.fetch_add(_chunkSize);
+      if(begin >= _elementEnd) break;
+      unsigned end = (begin + _chunkSize < _elementEnd) ? begin + _chunkSize : _elementEnd;
+
+      for(unsigned iel = begin; iel < end; iel++) {
+        buffer._sysDof.resize(0);
+        _kernel(*_system, iel, buffer);
+        buffer.Stage(_assembleMatrix);
+
+        if(buffer._stagedRes.size() + buffer._stagedJac.size() >= _maxStagedValues) {
+          std::lock_guard < std::mutex > lock(_insertMutex);
+          Flush(buffer);
+        }
+      }
+    }
+  }
+
+  // ********************************************
+
+  void ElementLoop::PrefetchArrays(Mesh *msh, Solution *sol, LinearImplicitSystem &system) {
+
+    // NumericVector::operator() lazily fetches the local array at its first call:
+    // do it here, on the calling thread, so that the kernels only read from it
+    std::vector < NumericVector* > vec(msh->_topology->_Sol);
+
+    vec.insert(vec.end(), sol->_Sol.begin(), sol->_Sol.end());
+    vec.insert(vec.end(), sol->_SolOld.begin(), sol->_SolOld.end());
+    vec.insert(vec.end(), sol->_Res.begin(), sol->_Res.end());
+    vec.insert(vec.end(), sol->_Eps.begin(), sol->_Eps.end());
+    vec.insert(vec.end(), sol->_AMREps.begin(), sol->_AMREps.end());
+    vec.insert(vec.end(), sol->_Bdc.begin(), sol->_Bdc.end());
+
+    for(unsigned k = 0; k < sol->_GradVec.size(); k++) {
+      vec.insert(vec.end(), sol->_GradVec[k].begin(), sol->_GradVec[k].end());
+    }
+
+    for(unsigned k = 0; k < vec.size(); k++) {
+      if(vec[k] && vec[k]->local_size() > 0) {
+        (*vec[k])(vec[k]->first_local_index());
+      }
+    }
+
+    // the geometry caches are built at the first call as well
+    const std::vector < unsigned > &solPdeIndex = system.GetSolPdeIndex();
+
+    for(unsigned k = 0; k < solPdeIndex.size(); k++) {
+      unsigned solType = sol->GetSolutionType(solPdeIndex[k]);
+      if(solType < 3) msh->GetGeometryCache(solType, sol);
+    }
+  }
+
+  // ********************************************
+
+  void ElementLoop::ReserveAdeptStacks(Mesh *msh, Solution *sol, LinearImplicitSystem &system) {
+
+    unsigned iproc = msh->processor_id();
+    unsigned dim = msh->GetDimension();
+    const std::vector < unsigned > &solPdeIndex = system.GetSolPdeIndex();
+
+    unsigned nDofsMax = 0;
+    unsigned nGaussMax = 0;
+
+    for(unsigned iel = msh->_elementOffset[iproc]; iel < msh->_elementOffset[iproc + 1]; iel++) {
+      short unsigned ielGeom = msh->GetElementType(iel);
+      unsigned nDofs = 0;
+
+      for(unsigned k = 0; k < solPdeIndex.size(); k++) {
+        unsigned solType = sol->GetSolutionType(solPdeIndex[k]);
+        nDofs += msh->GetElementDofNumber(iel, solType);
+
+        unsigned nGauss = msh->_finiteElement[ielGeom][solType]->GetGaussPointNumber();
+        if(nGauss > nGaussMax) nGaussMax = nGauss;
+      }
+
+      if(nDofs > nDofsMax) nDofsMax = nDofs;
+    }
+
+    // the residual of a kernel records, at each Gauss point, about one statement per dof and per direction
+    // for the gradients and one per dof for the residual, each with a few operations
+    unsigned nStatements = nGaussMax * nDofsMax * (dim + 1);
+    FemusInit::_adeptStackPool.Reserve(nStatements, 4 * nStatements);
+  }
+
+  // ********************************************
+
+  void ElementLoop::Flush(ElementLoopBuffer &buffer) {
+
+    unsigned jacOffset = 0;
+
+    for(unsigned e = 0; e + 1 < buffer._stagedOffset.size(); e++) {
+      unsigned begin = buffer._stagedOffset[e];
+      unsigned nDofs = buffer._stagedOffset[e + 1] - begin;
+
+      _flushDof.assign(buffer._stagedDof.begin() + begin, buffer._stagedDof.begin() + begin + nDofs);
+      _flushRes.assign(buffer._stagedRes.begin() + begin, buffer._stagedRes.begin() + begin + nDofs);
+      _RES->add_vector_blocked(_flushRes, _flushDof);
+
+      if(_assembleMatrix) {
+        _flushJac.assign(buffer._stagedJac.begin() + jacOffset, buffer._stagedJac.begin() + jacOffset + nDofs * nDofs);
+        _KK->add_matrix_blocked(_flushJac, _flushDof, _flushDof);
+        jacOffset += nDofs * nDofs;
+      }
+    }
+
+    buffer.ClearStage();
+  }
+
+  // ********************************************
+
+  void ElementLoop::Run(Mesh *msh, Solution *sol, ElementKernelType kernel, LinearImplicitSystem &system,
+                        SparseMatrix *KK, NumericVector *RES, const bool &assembleMatrix) {
+
+    unsigned iproc = msh->processor_id();
+
+    _kernel = kernel;
+    _system = &system;
+    _KK = KK;
+    _RES = RES;
+    _assembleMatrix = assembleMatrix;
+
+    if(_nThreads == 1) {
+      ElementLoopBuffer &buffer = _buffer[0];
+
+      for(unsigned iel = msh->_elementOffset[iproc]; iel < msh->_elementOffset[iproc + 1]; iel++) {
+        buffer._sysDof.resize(0);
+        _kernel(system, iel, buffer);
+
+        if(buffer._sysDof.size() > 0) {
+          RES->add_vector_blocked(buffer._Res, buffer._sysDof);
+          if(assembleMatrix) KK->add_matrix_blocked(buffer._Jac, buffer._sysDof, buffer._sysDof);
+        }
+      }
+      return;
+    }
+
+    PrefetchArrays(msh, sol, system);
+    ReserveAdeptStacks(msh, sol, system);
+
+    for(unsigned ithread = 0; ithread < _nThreads; ithread++) {
+      _buffer[ithread].ClearStage();
+    }
+
+    unsigned elementBegin = msh->_elementOffset[iproc];
+    unsigned nel = msh->_elementOffset[iproc + 1] - elementBegin;
+
+    // a few chunks per thread balance the load without contending on the counter
+    _chunkSize = nel / (16 * _nThreads);
+    if(_chunkSize < 1) _chunkSize = 1;
+    _nextElement = elementBegin;
+    _elementEnd = msh->_elementOffset[iproc + 1];
+
+    {
+      std::unique_lock < std::mutex > lock(_poolMutex);
+      _busyThreads = _nThreads - 1;
+      _generation++;
+    }
+    _workReady.notify_all();
+
+    ProcessElements(0);
+
+    {
+      std::unique_lock < std::mutex > lock(_poolMutex);
+      while(_busyThreads > 0) _workDone.wait(lock);
+    }
+
+    for(unsigned ithread = 0; ithread < _nThreads; ithread++) {
+      Flush(_buffer[ithread]);
+    }
+  }
+
+} //end namespace femus
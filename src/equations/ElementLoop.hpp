@@ -0,0 +1,189 @@
+/*=========================================================================
+
+ Program: FEMUS
+ Module: ElementLoop
+ Authors: Eugenio Aulisa
+
+ Copyright (c) FEMTTU
+ All rights reserved.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+#ifndef __femus_equations_ElementLoop_hpp__
+#define __femus_equations_ElementLoop_hpp__
+
+//----------------------------------------------------------------------------
+// includes :
+//----------------------------------------------------------------------------
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+namespace femus {
+
+//------------------------------------------------------------------------------
+// Forward declarations
+//------------------------------------------------------------------------------
+  class Mesh;
+  class Solution;
+  class SparseMatrix;
+  class NumericVector;
+  class LinearImplicitSystem;
+  class ElementLoopBuffer;
+
+  /** Element kernel type: computes the local residual (and Jacobian) of the element iel
+   * and stores them, together with the element system dofs, in the thread buffer */
+  typedef void (* ElementKernelType)(LinearImplicitSystem &system, const unsigned &iel, ElementLoopBuffer &buffer);
+
+  /**
+   * Thread local buffer handed to an element kernel. The kernel fills _sysDof, _Res and,
+   * when the matrix is assembled, _Jac (row ordered, nDofs x nDofs, PETSc ordering).
+   * An empty _sysDof means that the element does not contribute.
+   */
+  class ElementLoopBuffer {
+
+    public:
+
+      ElementLoopBuffer() : _threadId(0) {};
+
+      /** Get the index of the thread owning this buffer, 0 is the calling thread */
+      unsigned GetThreadId() const {
+        return _threadId;
+      }
+
+      /** Get the local array i of the kernel. It is kept from one element to the next of the thread,
+       * so that resizing it does not allocate once the largest element has been processed */
+      std::vector < double >& GetLocalArray(const unsigned &i) {
+        if(i >= _localArray.size()) _localArray.resize(i + 1);
+        return _localArray[i];
+      }
+
+      /** local to global pdeSys dofs */
+      std::vector < int > _sysDof;
+      /** local residual vector */
+      std::vector < double > _Res;
+      /** local Jacobian matrix (ordered by row, PETSc) */
+      std::vector < double > _Jac;
+
+    private:
+
+      friend class ElementLoop;
+
+      /** Copy the current element contribution into the staging area */
+      void Stage(const bool &assembleMatrix);
+
+      /** Empty the staging area, keeping its memory */
+      void ClearStage();
+
+      unsigned _threadId;
+
+      // a deque, so that the references to the arrays already handed out stay valid when it grows
+      std::deque < std::vector < double > > _localArray;
+
+      std::vector < unsigned > _stagedOffset;
+      std::vector < int > _stagedDof;
+      std::vector < double > _stagedRes;
+      std::vector < double > _stagedJac;
+  };
+
+  /**
+   * Thread-parallel driver for the element loop of an assembly routine.
+   * The owned elements are dynamically distributed in chunks to a persistent pool of threads,
+   * each computing into its own buffer. Since PETSc insertion is not thread safe, each thread stages its element
+   * contributions and, when they exceed _maxStagedValues, adds them to the global matrix and residual holding
+   * the insertion lock, while the other threads keep computing. The staging memory is then bounded by
+   * _nThreads * _maxStagedValues, and the remainders are added by the calling thread once all the elements are computed.
+   * Before the threads start, the local arrays of all the solution and topology vectors and the geometry
+   * caches (Mesh::GetGeometryCache(solType, sol)) of the Lagrange unknowns of the system are fetched, so that kernels only read them.
+   * Worker ithread records automatic differentiation into FemusInit::_adeptStackPool.GetStack(ithread):
+   * kernels get the stack of their thread with FemusInit::GetAdeptStack(). The stacks are preallocated for the largest
+   * element before the threads start, so that they do not grow inside the loop.
+   */
+  class ElementLoop {
+
+    public:
+
+      /** Constructor */
+      ElementLoop();
+
+      /** Destructor */
+      ~ElementLoop();
+
+      /** Set the number of threads used in the element loop (the calling thread included) */
+      void SetNumberOfThreads(const unsigned &nThreads);
+
+      /** Get the number of threads used in the element loop */
+      unsigned GetNumberOfThreads() const {
+        return _nThreads;
+      }
+
+      /** Loop on the owned elements of msh and add the kernel contributions to RES and, if assembleMatrix, to KK */
+      void Run(Mesh *msh, Solution *sol, ElementKernelType kernel, LinearImplicitSystem &system,
+               SparseMatrix *KK, NumericVector *RES, const bool &assembleMatrix);
+
+    private:
+
+      /** Start the worker threads of the pool */
+      void StartPool();
+
+      /** Join the worker threads of the pool */
+      void StopPool();
+
+      /** Body of the worker thread ithread */
+      void WorkerLoop(const unsigned ithread);
+
+      /** Process the owned elements in chunks, until none is left */
+      void ProcessElements(const unsigned &ithread);
+
+      /** Add the staged element contributions of buffer to the global objects and clear its staging area,
+       * the caller has to hold _insertMutex when other threads are working */
+      void Flush(ElementLoopBuffer &buffer);
+
+      /** Fetch the local arrays of the vectors and the geometry caches the kernels can read before entering the parallel region */
+      void PrefetchArrays(Mesh *msh, Solution *sol, LinearImplicitSystem &system);
+
+      /** Preallocate the adept stacks of all the threads for the recording of the largest owned element of the system */
+      void ReserveAdeptStacks(Mesh *msh, Solution *sol, LinearImplicitSystem &system);
+
+      unsigned _nThreads;
+      std::vector < ElementLoopBuffer > _buffer;
+
+      // pool data
+      std::vector < std::thread > _pool;
+      std::mutex _poolMutex;
+      std::condition_variable _workReady;
+      std::condition_variable _workDone;
+      unsigned _generation;
+      unsigned _busyThreads;
+      bool _stopPool;
+
+      // current work
+      std::atomic < unsigned > _nextElement;
+      unsigned _elementEnd;
+      unsigned _chunkSize;
+      ElementKernelType _kernel;
+      LinearImplicitSystem *_system;
+      SparseMatrix *_KK;
+      NumericVector *_RES;
+      bool _assembleMatrix;
+
+      // staged values (residual and Jacobian) above which a thread inserts its buffer
+      static const unsigned _maxStagedValues = 1u << 18;
+
+      // insertion lock and flush scratch, used by the thread holding it
+      std::mutex _insertMutex;
+      std::vector < int > _flushDof;
+      std::vector < double > _flushRes;
+      std::vector < double > _flushJac;
+  };
+
+} //end namespace femus
+
+#endif
@@ -20,6 +20,7 @@
 #include "ElemType.hpp"
 #include <iomanip>
 #include "MeshRefinement.hpp"
+#include "Profiler.hpp"
 
 namespace femus {
 
@@ -44,7 +45,12 @@ namespace femus {
     _MGmatrixFineReuse(false),
     _MGmatrixCoarseReuse(false),
     _printSolverInfo(false),
-    _assembleMatrix(true) {
+    _assembleMatrix(true),
+    _elementKernel(NULL),
+    _directMatrixInsertion(false),
+    _coarseOperatorReuse(false),
+    _coarseOperatorFreeze(0),
+    _coarseOperatorAge(0) {
     _SparsityPattern.resize(0);
     _outer_ksp_solver = "gmres";
     _totalAssemblyTime = 0.;
@@ -92,6 +98,14 @@ namespace femus {
 
   // ********************************************
 
+  void LinearImplicitSystem::SetDirectMatrixInsertion(const bool &directInsertion) {
+    _directMatrixInsertion = directInsertion;
+    for(unsigned i = 0; i < _LinSolver.size(); i++) {
+      _LinSolver[i]->_KK->SetDirectInsertion(directInsertion);
+    }
+  }
+  // ********************************************
+
   void LinearImplicitSystem::init() {
 
     _LinSolver.resize(_gridn);
@@ -105,6 +119,7 @@ namespace femus {
     for(unsigned i = 0; i < _gridn; i++) {
       _LinSolver[i]->InitPde(_SolSystemPdeIndex, _ml_sol->GetSolType(),
                              _ml_sol->GetSolName(), &_solution[i]->_Bdc, _gridn, _SparsityPattern);
+      if(_directMatrixInsertion) _LinSolver[i]->_KK->SetDirectInsertion(true);
     }
 
     _PP.resize(_gridn);
@@ -114,6 +129,8 @@ namespace femus {
       _RR[i] = NULL;
     }
 
+    _coarseOperatorIsProduct.assign(_gridn, false);
+
     for(unsigned ig = 1; ig < _gridn; ig++) {
       BuildProlongatorMatrix(ig);
     }
@@ -155,7 +172,7 @@ namespace femus {
 
     _bitFlipCounter = 0;
     
-    clock_t start_mg_time = clock();
+    Profiler::Start("linear solve");
 
     unsigned grid0;
 
@@ -182,14 +199,14 @@ namespace femus {
 restart:
       if(ThisIsAMR) _solution[igridn]->InitAMREps();
 
-      clock_t start_preparation_time = clock();
+      Profiler::Start("preparation");
 
       _levelToAssemble = igridn; //Be carefull!!!! this is needed in the _assemble_function
       _LinSolver[igridn]->SetResZero();
       _assembleMatrix = true;
-      clock_t start_assembly_time = clock();
-      _assemble_system_function(_equation_systems);
-      std::cout << std::endl << " ****** Level Max " << igridn + 1 << " ASSEMBLY TIME:\t" << static_cast<double>((clock() - start_assembly_time)) / CLOCKS_PER_SEC << std::endl;  
+      Profiler::Start("assembly");
+      AssembleSystem();
+      std::cout << std::endl << " ****** Level Max " << igridn + 1 << " ASSEMBLY TIME:\t" << Profiler::Stop("assembly") << std::endl;  
       
       
       if(!_ml_msh->GetLevel(igridn)->GetIfHomogeneous()) {
@@ -210,34 +227,12 @@ restart:
 
       _MGmatrixFineReuse = false;
       _MGmatrixCoarseReuse = (igridn - grid0 > 0) ?  true : _MGmatrixFineReuse;
-      for(unsigned i = igridn; i > 0; i--) {
-        if(_RR[i]) {
-          if(i == igridn)
-            _LinSolver[i - 1u]->_KK->matrix_ABC(*_RR[i], *_LinSolver[i]->_KK, *_PP[i], _MGmatrixFineReuse);
-          else {
-            _LinSolver[i - 1u]->_KK->matrix_ABC(*_RR[i], *_LinSolver[i]->_KK, *_PP[i], _MGmatrixCoarseReuse);
-            if(_LinSolver[i - 1u]->_KKamr) {
-              delete _LinSolver[i - 1u]->_KKamr;
-              _LinSolver[i - 1u]->_KKamr = NULL;
-            }
-          }
-        }
-        else {
-          if(i == igridn)
-            _LinSolver[i - 1u]->_KK->matrix_PtAP(*_PP[i], *_LinSolver[i]->_KK, _MGmatrixFineReuse);
-          else {
-            _LinSolver[i - 1u]->_KK->matrix_PtAP(*_PP[i], *_LinSolver[i]->_KK, _MGmatrixCoarseReuse);
-            if(_LinSolver[i - 1u]->_KKamr) {
-              delete _LinSolver[i - 1u]->_KKamr;
-              _LinSolver[i - 1u]->_KKamr = NULL;
-            }
-          }
-        }
-      }
+      BuildCoarseOperators(igridn, _MGmatrixFineReuse, _MGmatrixCoarseReuse);
 
-      std::cout << std::endl << " ****** Level Max " << igridn + 1 << " PREPARATION TIME:\t" << static_cast<double>((clock() - start_preparation_time)) / CLOCKS_PER_SEC << std::endl;
+      std::cout << std::endl << " ****** Level Max " << igridn + 1 << " PREPARATION TIME:\t" << Profiler::Stop("preparation") << std::endl;
 
       if(_MGsolver) {
+        Profiler::Start("mg setup");
         _LinSolver[igridn]->MGInit(mgSmootherType, igridn + 1, _outer_ksp_solver.c_str());
 
         for(unsigned i = 0; i < igridn + 1; i++) {
@@ -246,6 +241,7 @@ restart:
           else
             _LinSolver[i]->MGSetLevel(_LinSolver[igridn], igridn, _VariablesToBeSolvedIndex, _PP[i], _PP[i], _npre, _npost);
         }
+        Profiler::Stop("mg setup");
 
         MGVcycle(igridn, mgSmootherType);
 
@@ -269,11 +265,77 @@ restart:
 
     }
 
+    double totalSolverTime = Profiler::Stop("linear solve");
     std::cout << std::endl << " *** Linear " << _solverType << " TIME: " << std::setw(11) << std::setprecision(6) << std::fixed
-              << static_cast<double>((clock() - start_mg_time)) / CLOCKS_PER_SEC << std::endl;
+              << totalSolverTime << std::endl;
 	      
     _totalAssemblyTime += 0.;
-    _totalSolverTime += static_cast<double>((clock() - start_mg_time)) / CLOCKS_PER_SEC;     
+    _totalSolverTime += totalSolverTime;
+  }
+
+  // ********************************************
+
+  void LinearImplicitSystem::AssembleSystem() {
+
+    // the matrix of the level is no longer a Galerkin product
+    if(_assembleMatrix) _coarseOperatorIsProduct[_levelToAssemble] = false;
+
+    if(!_elementKernel) {
+      _assemble_system_function(_equation_systems);
+      return;
+    }
+
+    unsigned level = _levelToAssemble;
+    SparseMatrix* KK = _LinSolver[level]->_KK;
+    NumericVector* RES = _LinSolver[level]->_RES;
+
+    if(_assembleMatrix) KK->zero();
+
+    _elementLoop.Run(_msh[level], _solution[level], _elementKernel, *this, KK, RES, _assembleMatrix);
+
+    RES->close();
+    if(_assembleMatrix) KK->close();
+  }
+
+  // ********************************************
+
+  void LinearImplicitSystem::BuildCoarseOperators(const unsigned &igridn, const bool &fineReuse, const bool &coarseReuse) {
+
+    ProfileRegion region("coarse operators");
+
+    if(_coarseOperatorReuse && igridn > 0) {
+      bool allProducts = true;
+      for(unsigned i = 0; i < igridn; i++) {
+        if(!_coarseOperatorIsProduct[i]) allProducts = false;
+      }
+
+      if(allProducts && _coarseOperatorAge < _coarseOperatorFreeze) {
+        _coarseOperatorAge++;
+        return;
+      }
+    }
+
+    for(unsigned i = igridn; i > 0; i--) {
+
+      bool reuse = (i == igridn) ? fineReuse : coarseReuse;
+      if(_coarseOperatorReuse && _coarseOperatorIsProduct[i - 1u]) reuse = true;
+
+      if(_RR[i]) {
+        _LinSolver[i - 1u]->_KK->matrix_ABC(*_RR[i], *_LinSolver[i]->_KK, *_PP[i], reuse);
+      }
+      else {
+        _LinSolver[i - 1u]->_KK->matrix_PtAP(*_PP[i], *_LinSolver[i]->_KK, reuse);
+      }
+
+      if(i != igridn && _LinSolver[i - 1u]->_KKamr) {
+        delete _LinSolver[i - 1u]->_KKamr;
+        _LinSolver[i - 1u]->_KKamr = NULL;
+      }
+
+      _coarseOperatorIsProduct[i - 1u] = true;
+    }
+
+    _coarseOperatorAge = 0;
   }
 
   // ********************************************
@@ -317,6 +379,8 @@ restart:
 
   void LinearImplicitSystem::ProlongatorSol(unsigned gridf) {
 
+    ProfileRegion region("solution prolongation");
+
     for(unsigned k = 0; k < _SolSystemPdeIndex.size(); k++) {
 
       unsigned SolIndex = _SolSystemPdeIndex[k];
@@ -326,13 +390,16 @@ restart:
           *_msh[gridf]->GetCoarseToFineProjection(solType));
       _solution[gridf]->_Sol[SolIndex]->close();
     }
+
+    // the mesh displacement may have changed
+    if(_ml_sol->GetIfFSI()) _msh[gridf]->InvalidateDisplacedGeometryCache();
   }
 
   // ********************************************
 
   bool LinearImplicitSystem::MGVcycle(const unsigned& level, const MgSmootherType& mgSmootherType) {
 
-    clock_t start_mg_time = clock();
+    Profiler::Start("linear cycle");
 
     _LinSolver[level]->SetEpsZero();
 
@@ -342,7 +409,9 @@ restart:
 
       std::cout << "       *************** Linear iteration " << linearIterator + 1 << " ***********" << std::endl;
       bool ksp_clean = !linearIterator * _assembleMatrix;
+      Profiler::Start("mg solve");
       _LinSolver[level]->MGSolve(ksp_clean);
+      Profiler::Stop("mg solve");
       _solution[level]->UpdateRes(_SolSystemPdeIndex, _LinSolver[level]->_RES, _LinSolver[level]->KKoffset);
       linearIsConverged = IsLinearConverged(level);
 
@@ -357,7 +426,7 @@ restart:
       _solution[level]->UpdateSol(_SolSystemPdeIndex, _LinSolver[level]->_EPS, _LinSolver[level]->KKoffset);
     }
     std::cout << "       *************** Linear-Cycle TIME:\t" << std::setw(11) << std::setprecision(6) << std::fixed
-              << static_cast<double>((clock() - start_mg_time)) / CLOCKS_PER_SEC << std::endl;
+              << Profiler::Stop("linear cycle") << std::endl;
     return linearIsConverged;
   }
 
@@ -365,7 +434,7 @@ restart:
 
   bool LinearImplicitSystem::MLVcycle(const unsigned& level) {
 
-    clock_t start_mg_time = clock();
+    Profiler::Start("linear cycle");
 
     _LinSolver[level]->SetEpsZero();
 
@@ -379,24 +448,30 @@ restart:
 
       for(unsigned ig = level; ig > 0; ig--) {
         // ============== Presmoothing ==============
+        Profiler::Start("smoothing");
         for(unsigned k = 0; k < _npre*(0*ig*ig+1); k++) {
           _LinSolver[ig]->Solve(_VariablesToBeSolvedIndex, ksp_clean * (!k));
         }
+        Profiler::Stop("smoothing");
         // ============== Restriction ==============
         Restrictor(ig);
       }
 
       // ============== Direct Solver ==============
+      Profiler::Start("coarse solve");
       _LinSolver[0]->Solve(_VariablesToBeSolvedIndex, ksp_clean);
+      Profiler::Stop("coarse solve");
 
       for(unsigned ig = 1; ig <= level; ig++) {
         // ============== Prolongation ==============
         Prolongator(ig);
 
         // ============== PostSmoothing ==============
+        Profiler::Start("smoothing");
         for(unsigned k = 0; k < _npost*(0*ig*ig+1); k++) {
           _LinSolver[ig]->Solve(_VariablesToBeSolvedIndex, ksp_clean * (!_npre) * (!k));
         }
+        Profiler::Stop("smoothing");
       }
 
       // ============== Update Fine Residual ==============
@@ -415,7 +490,7 @@ restart:
     }
 
     std::cout << "\n ************ Linear-Cycle TIME:\t" << std::setw(11) << std::setprecision(6) << std::fixed
-              << static_cast<double>((clock() - start_mg_time)) / CLOCKS_PER_SEC << std::endl;
+              << Profiler::Stop("linear cycle") << std::endl;
 
     return linearIsConverged;
   }
@@ -424,6 +499,8 @@ restart:
 
   void LinearImplicitSystem::Restrictor(const unsigned& gridf) {
 
+    ProfileRegion region("restriction");
+
     _LinSolver[gridf - 1u]->SetEpsZero();
     _LinSolver[gridf - 1u]->SetResZero();
 
@@ -442,6 +519,8 @@ restart:
 
   void LinearImplicitSystem::Prolongator(const unsigned& gridf) {
 
+    ProfileRegion region("prolongation");
+
     _LinSolver[gridf]->_EPSC->matrix_mult(*_LinSolver[gridf - 1]->_EPS, *_PP[gridf]);
     _LinSolver[gridf]->UpdateResidual();
     _LinSolver[gridf]->SumEpsCToEps();
@@ -502,11 +581,15 @@ restart:
 
     _LinSolver[_gridn]->InitPde(_SolSystemPdeIndex, _ml_sol->GetSolType(),
                                 _ml_sol->GetSolName(), &_solution[_gridn]->_Bdc,  _gridn + 1, _SparsityPattern);
+    if(_directMatrixInsertion) _LinSolver[_gridn]->_KK->SetDirectInsertion(true);
 
     _PP.resize(_gridn + 1);
     _RR.resize(_gridn + 1);
     _PP[_gridn] = NULL;
     _RR[_gridn] = NULL;
+
+    // the finest level changes: the products have to be rebuilt
+    _coarseOperatorIsProduct.assign(_gridn + 1, false);
     BuildProlongatorMatrix(_gridn);
     if(!_ml_msh->GetLevel(_gridn - 1)->GetIfHomogeneous()) {
       _PP[_gridn]->matrix_RightMatMult(*_PPamr[_gridn - 1]);
@@ -25,6 +25,7 @@
 #include "DirichletBCTypeEnum.hpp"
 #include "MgSmootherEnum.hpp"
 #include "FemusDefault.hpp"
+#include "ElementLoop.hpp"
 
 #include <petscksp.h>
 
@@ -175,6 +176,33 @@ namespace femus {
 	std::cout << "Total Computational Time = " << _totalAssemblyTime + _totalSolverTime <<std::endl;
       }
 
+      /** Register a user element kernel: the system is then assembled by the thread-parallel
+       * element loop instead of the assemble function */
+      void SetElementKernel(ElementKernelType kernel) {
+        _elementKernel = kernel;
+      }
+
+      /** Set the number of threads used by the element loop, the calling thread included */
+      void SetNumberOfAssemblyThreads(const unsigned &nThreads) {
+        _elementLoop.SetNumberOfThreads(nThreads);
+      }
+
+      /** Keep the coarse Galerkin operators alive across solves: once computed, the products
+       * P^T A P (R A P) are recomputed numerically only, reusing their symbolic part */
+      void SetCoarseOperatorReuse(const bool &reuse) {
+        _coarseOperatorReuse = reuse;
+      }
+
+      /** With coarse operator reuse, skip the recomputation of the coarse operators for nFrozen
+       * consecutive matrix builds (Newton iterations or time steps) after each recomputation */
+      void SetCoarseOperatorFreeze(const unsigned &nFrozen) {
+        _coarseOperatorFreeze = nFrozen;
+      }
+
+      /** Add the element matrices directly into the local value arrays of the level matrices: the first assembly of
+       * each level records the element to value array positions, see PetscMatrix::SetDirectInsertion */
+      void SetDirectMatrixInsertion(const bool &directInsertion);
+
       void SetOuterKSPSolver(const std::string outer_ksp_solver) {
         _outer_ksp_solver = outer_ksp_solver;
       };
@@ -304,6 +332,23 @@ namespace femus {
 
       /** Solves the system. */
       virtual void solve(const MgSmootherType& mgSmootherType = MULTIPLICATIVE);
+
+      /** Assemble the system on _levelToAssemble, with the element kernel if set, otherwise with the assemble function */
+      void AssembleSystem();
+
+      /** Compute the coarse operators of the levels below igridn with the Galerkin products, fineReuse and
+       * coarseReuse tell if the product matrices of the finest and of the other levels already exist */
+      void BuildCoarseOperators(const unsigned &igridn, const bool &fineReuse, const bool &coarseReuse);
+
+      ElementKernelType _elementKernel;
+      ElementLoop _elementLoop;
+
+      bool _directMatrixInsertion;
+      bool _coarseOperatorReuse;
+      unsigned _coarseOperatorFreeze;
+      unsigned _coarseOperatorAge;
+      /** true if the matrix of the level is a Galerkin product not modified since */
+      vector < bool > _coarseOperatorIsProduct;
             
       double _richardsonScaleFactor;
       double _richardsonScaleFactorDecrease;
@@ -16,6 +16,7 @@
 #include "NonLinearImplicitSystem.hpp"
 #include "LinearEquationSolver.hpp"
 #include "NumericVector.hpp"
+#include "Profiler.hpp"
 #include "iomanip"
 
 namespace femus {
@@ -88,7 +89,7 @@ namespace femus {
 
     _bitFlipCounter = 0;
     
-    clock_t start_mg_time = clock();
+    Profiler::Start("nonlinear solve");
 
     double totalAssembyTime = 0.;
 
@@ -111,7 +112,7 @@ namespace femus {
 
     for(unsigned igridn = grid0; igridn < _gridn; igridn++) {     //_igridn
       std::cout << std::endl << "   ****** Start Level Max " << igridn + 1 << " ******" << std::endl;
-      clock_t start_nl_time = clock();
+      double start_nl_time = Profiler::GetTime();
 
       bool ThisIsAMR = (_mg_type == F_CYCLE && _AMRtest &&  AMRCounter < _maxAMRlevels && igridn == _gridn - 1u) ? 1 : 0;
 restart:
@@ -121,14 +122,14 @@ restart:
 
         std::cout << std::endl << "   ********* Nonlinear iteration " << nonLinearIterator + 1 << " *********" << std::endl;
 
-	clock_t start_preparation_time = clock();
-        clock_t start_assembly_time = clock();
+        Profiler::Start("preparation");
+        Profiler::Start("assembly");
         _levelToAssemble = igridn; //Be carefull!!!! this is needed in the _assemble_function
         _LinSolver[igridn]->SetResZero();
         _assembleMatrix = _buildSolver;
-        _assemble_system_function(_equation_systems);
+        AssembleSystem();
         std::cout << "   ********* Level Max " << igridn + 1 << " ASSEMBLY TIME:\t" << \
-                  static_cast<double>((clock() - start_assembly_time)) / CLOCKS_PER_SEC << std::endl;
+                  Profiler::Stop("assembly") << std::endl;
 	
         if(!_ml_msh->GetLevel(igridn)->GetIfHomogeneous()) {
           if(!_RRamr[igridn]) {
@@ -155,35 +156,12 @@ restart:
             }
           }
 
-          clock_t mg_proj_mat_time = clock();
-          for(unsigned i = igridn; i > 0; i--) {
-            if(_RR[i]) {
-              if(i == igridn)
-                _LinSolver[i - 1u]->_KK->matrix_ABC(*_RR[i], *_LinSolver[i]->_KK, *_PP[i], _MGmatrixFineReuse);
-              else {
-                _LinSolver[i - 1u]->_KK->matrix_ABC(*_RR[i], *_LinSolver[i]->_KK, *_PP[i], _MGmatrixCoarseReuse);
-                if(_LinSolver[i - 1u]->_KKamr) {
-                  delete _LinSolver[i - 1u]->_KKamr;
-                  _LinSolver[i - 1u]->_KKamr = NULL;
-                }
-              }
-            }
-            else {
-              if(i == igridn)
-                _LinSolver[i - 1u]->_KK->matrix_PtAP(*_PP[i], *_LinSolver[i]->_KK, _MGmatrixFineReuse);
-              else {
-                _LinSolver[i - 1u]->_KK->matrix_PtAP(*_PP[i], *_LinSolver[i]->_KK, _MGmatrixCoarseReuse);
-                if(_LinSolver[i - 1u]->_KKamr) {
-                  delete _LinSolver[i - 1u]->_KKamr;
-                  _LinSolver[i - 1u]->_KKamr = NULL;
-                }
-              }
-            }
-          }
+          double mg_proj_mat_time = Profiler::GetTime();
+          BuildCoarseOperators(igridn, _MGmatrixFineReuse, _MGmatrixCoarseReuse);
           std::cout << "   ********* Level Max " << igridn + 1 << " MG PROJECTION MATRICES TIME:\t" \
-                    << static_cast<double>((clock() - mg_proj_mat_time)) / CLOCKS_PER_SEC << std::endl;
+                    << Profiler::GetTime() - mg_proj_mat_time << std::endl;
 
-          clock_t mg_init_time = clock();
+          Profiler::Start("mg setup");
           if(_MGsolver) {
             _LinSolver[igridn]->MGInit(mgSmootherType, igridn + 1, _outer_ksp_solver.c_str());
 
@@ -195,12 +173,13 @@ restart:
             }
           }
           std::cout << "   ********* Level Max " << igridn + 1 << " MGINIT TIME:\t" \
-                    << static_cast<double>((clock() - mg_init_time)) / CLOCKS_PER_SEC << std::endl;
+                    << Profiler::Stop("mg setup") << std::endl;
         }
-        totalAssembyTime += static_cast<double>((clock() - start_assembly_time)) / CLOCKS_PER_SEC;
+        double preparationTime = Profiler::Stop("preparation");
+        totalAssembyTime += preparationTime;
         std::cout << "   ********* Level Max " << igridn + 1 << " PREPARATION TIME:\t" << \
-                  static_cast<double>((clock() - start_preparation_time)) / CLOCKS_PER_SEC << std::endl;
-        clock_t startUpdateResidualTime = clock();
+                  preparationTime << std::endl;
+        double startUpdateResidualTime = Profiler::GetTime();
 
         for(unsigned updateResidualIterator = 0; updateResidualIterator < _maxNumberOfResidualUpdateIterations; updateResidualIterator++) {
 
@@ -215,7 +194,9 @@ restart:
 
           _LinSolver[igridn]->SetResZero();
           _assembleMatrix = false;
-          _assemble_system_function(_equation_systems);
+          Profiler::Start("residual assembly");
+          AssembleSystem();
+          Profiler::Stop("residual assembly");
           if(!_ml_msh->GetLevel(igridn)->GetIfHomogeneous()) {
             if(!_RRamr[igridn]) {
               (_LinSolver[igridn]->_RESC)->matrix_mult_transpose(*_LinSolver[igridn]->_RES, *_PPamr[igridn]);
@@ -241,7 +222,7 @@ restart:
         bool nonLinearIsConverged = IsNonLinearConverged(igridn, nonLinearEps);
 
         std::cout << "     ********* Linear Cycle + Residual Update-Cycle TIME:\t" << std::setw(11) << std::setprecision(6) << std::fixed
-                  << static_cast<double>((clock() - startUpdateResidualTime)) / CLOCKS_PER_SEC << std::endl;
+                  << Profiler::GetTime() - startUpdateResidualTime << std::endl;
 
         if(nonLinearIsConverged || _bitFlipOccurred) break;
 
@@ -257,12 +238,12 @@ restart:
 
 
       std::cout << std::endl << "   ****** Nonlinear-Cycle TIME: " << std::setw(11) << std::setprecision(6) << std::fixed
-                << static_cast<double>((clock() - start_nl_time)) / CLOCKS_PER_SEC << std::endl;
+                << Profiler::GetTime() - start_nl_time << std::endl;
 
       std::cout << std::endl << "   ****** End Level Max " << igridn + 1 << " ******" << std::endl;
     }
 
-    double totalSolverTime = static_cast<double>((clock() - start_mg_time)) / CLOCKS_PER_SEC;
+    double totalSolverTime = Profiler::Stop("nonlinear solve");
     std::cout << std::endl << "   *** Nonlinear " << _solverType << " TIME: " << std::setw(11) << std::setprecision(6) << std::fixed
               << totalSolverTime <<  " = assembly TIME( " << totalAssembyTime << " ) + "
               << " solver TIME( " << totalSolverTime - totalAssembyTime << " ) " << std::endl;
@@ -32,6 +32,7 @@ namespace femus
   const unsigned elem_type::_fe_old_to_new[QL] = {2, 0, 3};
 
   unsigned elem_type::_refindex = 1;
+  const unsigned elem_type::_maxBatchSize;
 
 //   Constructor
   elem_type::elem_type(const char* geom_elem, const char* order_gauss) : _gauss(geom_elem, order_gauss)
@@ -1452,7 +1453,7 @@ namespace femus
   {
 
     jacobianMatrix.resize(1);
-    jacobianMatrix[1].resize(1);
+    jacobianMatrix[0].resize(1);
 
 
     type Jac = 0.;
@@ -1515,6 +1516,44 @@ namespace femus
 
   //---------------------------------------------------------------------------------------------------------
 
+  void elem_type_1D::JacobianBatch(const double* x, const unsigned& nBlock, const unsigned& ig, double* weight,
+                                   double* gradphi, double* inverseJacobian) const
+  {
+
+    assert(nBlock <= _maxBatchSize);
+
+    double Jac[_maxBatchSize];
+    double JacI[_maxBatchSize];
+
+    const double* dxi = _dphidxi[ig];
+
+    for(unsigned e = 0; e < nBlock; e++) Jac[e] = 0.;
+
+    for(int inode = 0; inode < _nc; inode++) {
+      const double* x0 = x + inode * nBlock;
+      for(unsigned e = 0; e < nBlock; e++) Jac[e] += dxi[inode] * x0[e];
+    }
+
+    const double gaussWeight = _gauss.GetGaussWeightsPointer()[ig];
+
+    for(unsigned e = 0; e < nBlock; e++) {
+      weight[e] = Jac[e] * gaussWeight;
+      JacI[e] = 1. / Jac[e];
+    }
+
+    if(inverseJacobian) {
+      for(unsigned e = 0; e < nBlock; e++) inverseJacobian[e] = JacI[e];
+    }
+
+    for(int inode = 0; inode < _nc; inode++) {
+      double* g0 = gradphi + inode * nBlock;
+      for(unsigned e = 0; e < nBlock; e++) g0[e] = dxi[inode] * JacI[e];
+    }
+
+  }
+
+//---------------------------------------------------------------------------------------------------------
+
   template <class type>
   void elem_type_1D::Jacobian_type(const vector < vector < type > >& vt, const vector<double>& xi, type& Weight,
                                    vector < double >& phi, vector < type >& gradphi,
@@ -1712,6 +1751,67 @@ namespace femus
     }
   }
 
+//---------------------------------------------------------------------------------------------------------
+
+  void elem_type_2D::JacobianBatch(const double* x, const unsigned& nBlock, const unsigned& ig, double* weight,
+                                   double* gradphi, double* inverseJacobian) const
+  {
+
+    assert(nBlock <= _maxBatchSize);
+
+    double Jac[2][2][_maxBatchSize];
+    double JacI[2][2][_maxBatchSize];
+
+    const double* dxi = _dphidxi[ig];
+    const double* deta = _dphideta[ig];
+
+    for(unsigned e = 0; e < nBlock; e++) {
+      Jac[0][0][e] = Jac[0][1][e] = Jac[1][0][e] = Jac[1][1][e] = 0.;
+    }
+
+    for(int inode = 0; inode < _nc; inode++) {
+      const double* x0 = x + inode * nBlock;
+      const double* x1 = x + (_nc + inode) * nBlock;
+      for(unsigned e = 0; e < nBlock; e++) {
+        Jac[0][0][e] += dxi[inode] * x0[e];
+        Jac[0][1][e] += dxi[inode] * x1[e];
+        Jac[1][0][e] += deta[inode] * x0[e];
+        Jac[1][1][e] += deta[inode] * x1[e];
+      }
+    }
+
+    const double gaussWeight = _gauss.GetGaussWeightsPointer()[ig];
+
+    for(unsigned e = 0; e < nBlock; e++) {
+      double det = Jac[0][0][e] * Jac[1][1][e] - Jac[0][1][e] * Jac[1][0][e];
+      double detI = 1. / det;
+      weight[e] = det * gaussWeight;
+      JacI[0][0][e] = Jac[1][1][e] * detI;
+      JacI[0][1][e] = -Jac[0][1][e] * detI;
+      JacI[1][0][e] = -Jac[1][0][e] * detI;
+      JacI[1][1][e] = Jac[0][0][e] * detI;
+    }
+
+    if(inverseJacobian) {
+      for(unsigned k = 0; k < 2; k++) {
+        for(unsigned l = 0; l < 2; l++) {
+          double* invJ = inverseJacobian + (k * 2 + l) * nBlock;
+          for(unsigned e = 0; e < nBlock; e++) invJ[e] = JacI[k][l][e];
+        }
+      }
+    }
+
+    for(int inode = 0; inode < _nc; inode++) {
+      double* g0 = gradphi + (2 * inode + 0) * nBlock;
+      double* g1 = gradphi + (2 * inode + 1) * nBlock;
+      for(unsigned e = 0; e < nBlock; e++) {
+        g0[e] = dxi[inode] * JacI[0][0][e] + deta[inode] * JacI[0][1][e];
+        g1[e] = dxi[inode] * JacI[1][0][e] + deta[inode] * JacI[1][1][e];
+      }
+    }
+
+  }
+
 //---------------------------------------------------------------------------------------------------------
 
   template <class type>
@@ -1991,6 +2091,75 @@ namespace femus
 
 //---------------------------------------------------------------------------------------------------------
 
+  void elem_type_3D::JacobianBatch(const double* x, const unsigned& nBlock, const unsigned& ig, double* weight,
+                                   double* gradphi, double* inverseJacobian) const
+  {
+
+    assert(nBlock <= _maxBatchSize);
+
+    double Jac[3][3][_maxBatchSize];
+    double JacI[3][3][_maxBatchSize];
+
+    const double* dphi[3] = {_dphidxi[ig], _dphideta[ig], _dphidzeta[ig]};
+
+    for(unsigned k = 0; k < 3; k++) {
+      for(unsigned l = 0; l < 3; l++) {
+        for(unsigned e = 0; e < nBlock; e++) Jac[k][l][e] = 0.;
+      }
+    }
+
+    for(int inode = 0; inode < _nc; inode++) {
+      for(unsigned l = 0; l < 3; l++) {
+        const double* xl = x + (l * _nc + inode) * nBlock;
+        for(unsigned e = 0; e < nBlock; e++) {
+          Jac[0][l][e] += dphi[0][inode] * xl[e];
+          Jac[1][l][e] += dphi[1][inode] * xl[e];
+          Jac[2][l][e] += dphi[2][inode] * xl[e];
+        }
+      }
+    }
+
+    const double gaussWeight = _gauss.GetGaussWeightsPointer()[ig];
+
+    for(unsigned e = 0; e < nBlock; e++) {
+      double det = (Jac[0][0][e] * (Jac[1][1][e] * Jac[2][2][e] - Jac[1][2][e] * Jac[2][1][e]) +
+                    Jac[0][1][e] * (Jac[1][2][e] * Jac[2][0][e] - Jac[1][0][e] * Jac[2][2][e]) +
+                    Jac[0][2][e] * (Jac[1][0][e] * Jac[2][1][e] - Jac[1][1][e] * Jac[2][0][e]));
+      double detI = 1. / det;
+      weight[e] = det * gaussWeight;
+      JacI[0][0][e] = (-Jac[1][2][e] * Jac[2][1][e] + Jac[1][1][e] * Jac[2][2][e]) * detI;
+      JacI[0][1][e] = (Jac[0][2][e] * Jac[2][1][e] - Jac[0][1][e] * Jac[2][2][e]) * detI;
+      JacI[0][2][e] = (-Jac[0][2][e] * Jac[1][1][e] + Jac[0][1][e] * Jac[1][2][e]) * detI;
+      JacI[1][0][e] = (Jac[1][2][e] * Jac[2][0][e] - Jac[1][0][e] * Jac[2][2][e]) * detI;
+      JacI[1][1][e] = (-Jac[0][2][e] * Jac[2][0][e] + Jac[0][0][e] * Jac[2][2][e]) * detI;
+      JacI[1][2][e] = (Jac[0][2][e] * Jac[1][0][e] - Jac[0][0][e] * Jac[1][2][e]) * detI;
+      JacI[2][0][e] = (-Jac[1][1][e] * Jac[2][0][e] + Jac[1][0][e] * Jac[2][1][e]) * detI;
+      JacI[2][1][e] = (Jac[0][1][e] * Jac[2][0][e] - Jac[0][0][e] * Jac[2][1][e]) * detI;
+      JacI[2][2][e] = (-Jac[0][1][e] * Jac[1][0][e] + Jac[0][0][e] * Jac[1][1][e]) * detI;
+    }
+
+    if(inverseJacobian) {
+      for(unsigned k = 0; k < 3; k++) {
+        for(unsigned l = 0; l < 3; l++) {
+          double* invJ = inverseJacobian + (k * 3 + l) * nBlock;
+          for(unsigned e = 0; e < nBlock; e++) invJ[e] = JacI[k][l][e];
+        }
+      }
+    }
+
+    for(int inode = 0; inode < _nc; inode++) {
+      for(unsigned k = 0; k < 3; k++) {
+        double* gk = gradphi + (3 * inode + k) * nBlock;
+        for(unsigned e = 0; e < nBlock; e++) {
+          gk[e] = dphi[0][inode] * JacI[k][0][e] + dphi[1][inode] * JacI[k][1][e] + dphi[2][inode] * JacI[k][2][e];
+        }
+      }
+    }
+
+  }
+
+//---------------------------------------------------------------------------------------------------------
+
 
 
   template <class type>
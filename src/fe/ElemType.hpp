@@ -95,6 +95,18 @@ namespace femus
 
       virtual void JacobianSur(const vector < vector < double > >& vt, const unsigned& ig, double& Weight,
                                vector < double >& other_phi, vector < double >& gradphi, vector < double >& normal) const = 0;
+
+      /** Batched Jacobian at the Gauss point ig for a block of nBlock <= _maxBatchSize elements of this type,
+       * in structure of arrays layout: x[(k * nDofs + i) * nBlock + e] is the coordinate k of the node i of the element e,
+       * nDofs = GetNDofs(). It returns weight[e], gradphi[(i * dim + k) * nBlock + e] and, if not NULL, the inverse
+       * coordinate Jacobian inverseJacobian[(k * dim + l) * nBlock + e]. The inner loops run over the elements
+       * of the block with unit stride, so that the compiler vectorizes them */
+      virtual void JacobianBatch(const double* x, const unsigned& nBlock, const unsigned& ig, double* weight,
+                                 double* gradphi, double* inverseJacobian = NULL) const = 0;
+
+      /** Maximum number of elements in a JacobianBatch block */
+      static const unsigned _maxBatchSize = 16;
+
       /** To be Added */
       virtual double* GetPhi(const unsigned& ig) const = 0;
 
@@ -284,6 +296,9 @@ namespace femus
         JacobianSur_type(vt, ig, Weight, phi, gradphi, normal);
       }
 
+      void JacobianBatch(const double* x, const unsigned& nBlock, const unsigned& ig, double* weight,
+                         double* gradphi, double* inverseJacobian = NULL) const;
+
       inline double* GetPhi(const unsigned& ig) const {
         return _phi[ig];
       }
@@ -392,6 +407,9 @@ namespace femus
         JacobianSur_type(vt, ig, Weight, phi, gradphi, normal);
       }
 
+      void JacobianBatch(const double* x, const unsigned& nBlock, const unsigned& ig, double* weight,
+                         double* gradphi, double* inverseJacobian = NULL) const;
+
       inline double* GetPhi(const unsigned& ig) const {
         return _phi[ig];
       }
@@ -514,6 +532,9 @@ namespace femus
         abort();
       }
 
+      void JacobianBatch(const double* x, const unsigned& nBlock, const unsigned& ig, double* weight,
+                         double* gradphi, double* inverseJacobian = NULL) const;
+
 
       //---------------------------------------------------------------------------------------------------------
       inline double* GetPhi(const unsigned& ig) const {
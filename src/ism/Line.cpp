@@ -21,6 +21,8 @@
 #include "NumericVector.hpp"
 #include <cmath>
 #include "PolynomialBases.hpp"
+#include "ElementSearchGrid.hpp"
+#include <algorithm>
 #include <boost/math/special_functions/ellint_1.hpp>
 #include <boost/math/special_functions/ellint_2.hpp>
 
@@ -62,6 +64,15 @@ namespace femus
   };
 
 
+  // sort criterion of the local markers, by element and then by id, the markers outside the domain go last
+  static bool MarkerElementIsLess(Marker* a, Marker* b)
+  {
+    unsigned aElem = a->GetMarkerElement();
+    unsigned bElem = b->GetMarkerElement();
+    return (aElem < bElem) || (aElem == bElem && a->GetMarkerId() < b->GetMarkerId());
+  }
+
+
   Line::Line(const std::vector < std::vector < double > > x, const std::vector < double > &mass,
              const std::vector <MarkerType>& markerType,
              Solution* sol, const unsigned& solType)
@@ -73,20 +84,15 @@ namespace femus
 
     _size = x.size();
 
-    std::vector < Marker*> particles(_size);
-
     _dim = _mesh->GetDimension();
 
     _markerOffset.resize(_nprocs + 1);
-    _markerOffset[_nprocs] = _size;
 
-    _particles.resize(_size);
-    _printList.resize(_size);
+    _particleImbalance = 1.;
+    _advectionImbalance = 1.;
+    _loadBalanceReport = false;
 
-    for(unsigned j = 0; j < _size; j++) {
-      particles[j] = new Marker(x[j], mass[j], markerType[j], _sol, solType, true);
-    }
-    Reorder(particles);
+    CreateMarkers(x, mass, markerType, solType);
 
   }
 
@@ -102,347 +108,66 @@ namespace femus
 
     _size = x.size();
 
-    std::vector < Marker*> particles(_size);
-
     _dim = _mesh->GetDimension();
 
     _markerOffset.resize(_nprocs + 1);
-    _markerOffset[_nprocs] = _size;
 
-    _particles.resize(_size);
-    _printList.resize(_size);
+    _particleImbalance = 1.;
+    _advectionImbalance = 1.;
+    _loadBalanceReport = false;
 
-    for(unsigned j = 0; j < _size; j++) {
-      particles[j] = new Marker(x[j], 0., markerType[j], _sol, solType, true);
-    }
-    Reorder(particles);
+    CreateMarkers(x, std::vector < double > (_size, 0.), markerType, solType);
   }
 
-  void Line::Reorder(std::vector < Marker*> &particles)
+  void Line::CreateMarkers(const std::vector < std::vector < double > > &x, const std::vector < double > &mass,
+                           const std::vector <MarkerType>& markerType, const unsigned& solType)
   {
 
-    //BEGIN TEST ASSIGNATION
-
-//     std::vector <double> xtry(_dim);
-//     std::vector <double> xitry(_dim);
-//
-//
-//     for(unsigned j = 0; j < _size; j++) {
-//
-//       unsigned proc;
-//       unsigned elem;
-//       proc = particles[j]->GetMarkerProc();
-//       elem = particles[j]->GetMarkerElement();
-//
-//       std::cout << "proc = " << proc << " , " << "elem = " << elem <<
-//                 " , " << std::endl;
-//       particles[j]->GetMarkerCoordinates(xtry);
-//       for(unsigned i = 0 ; i < _dim; i++) {
-//         std::cout << "x[" << i << "]=" << xtry[i] << std::endl;
-//       }
-//       particles[j]->GetMarkerLocalCoordinatesLine(xitry);
-//       for(unsigned i = 0 ; i < _dim; i++) {
-//         std::cout << "xi[" << i << "]=" << xitry[i] << std::endl;
-//       }
-//     }
-//
-//
-//     for(unsigned j = 0; j < _size; j++) {
-//       _particles[j] = particles[j];
-//     }
-//
-//     std::cout << " ------------------------------------------------------------------------------------------------ " << std::endl;
-//
-//     for(unsigned j = 0; j < _size; j++) {
-//
-//       unsigned proc;
-//       unsigned elem;
-//       proc = _particles[j]->GetMarkerProc();
-//       elem = _particles[j]->GetMarkerElement();
-//       std::cout << "proc = " << proc << " , " << "elem = " << elem <<
-//                 " , " << std::endl;
-//       _particles[j]->GetMarkerCoordinates(xtry);
-//       for(unsigned i = 0 ; i < _dim; i++) {
-//         std::cout << "x[" << i << "]=" << xtry[i] << std::endl;
-//       }
-//       _particles[j]->GetMarkerLocalCoordinatesLine(xitry);
-//       for(unsigned i = 0 ; i < _dim; i++) {
-//         std::cout << "xi[" << i << "]=" << xitry[i] << std::endl;
-//       }
-//     }
-
-
-    //END TEST ASSIGNATION
-
-
-//     std::cout << "FIRST OF ALL" << std::endl;
-//     for(unsigned i = 0; i < _size; i++) {
-//       unsigned proc;
-//       particles[i]->GetMarkerProcLine(proc);
-//       unsigned elem;
-//       particles[i]->GetMarkerElementLine(elem);
-//       std::cout << "Particle: " << i << " , " << "Processor: " << proc << " , "
-//                 << "Element: " << elem << " " << std::endl;
-//     }
-
-    //BEGIN reorder the markers by proc
-    unsigned counter = 0;
-
-    for(unsigned iproc = 0; iproc < _nprocs; iproc++) {
-      _markerOffset[iproc] = counter;
-
-      //unsigned  offsetCounter = counter;
-      for(unsigned j = 0; j < _size; j++) {
-        unsigned markerProc = particles[j]->GetMarkerProc(_sol);
-
-        if(markerProc == iproc) {
-          _particles[counter] = particles[j];
-          _printList[j] = counter;
-          counter++;
-        }
-      }
-    }
-
-    //END reorder the markers by proc
-
-
-
-
-//     std::cout << "AFTER THE REORDERING BY PROC" << std::endl;
-//     for(unsigned i = 0; i < _size; i++) {
-//       unsigned proc;
-//       _particles[i]->GetMarkerProcLine(proc);
-//       unsigned elem;
-//       _particles[i]->GetMarkerElementLine(elem);
-//       std::cout << "Particle: " << i << " , " << "Processor: " << proc << " , "
-//                 << "Element: " << elem << " " << std::endl;
-//     }
-//
-//     for(unsigned iproc = 0; iproc <= _nprocs; iproc++) {
-//       std::cout << "_markerOffset[" << iproc << "]= " << _markerOffset[iproc] << std::endl;
-//     }
-
-//         for(unsigned i = 0; i < _size; i++) {
-//           std::cout << "_printList[ " << i << "] = " << _printList[i] << std::endl;
-//         }
-//
-//
-//         std::cout << " ------------------------------------------------------------------------------------------------ " << std::endl;
-
-
-    //BEGIN reorder markers also by element
-
-    for(unsigned j = 0; j < _size; j++) {
-      particles[j] = _particles[j];
-    }
-
-    std::vector < unsigned> printList(_size);
-    printList = _printList;
-
-    unsigned meshElements = _mesh->GetNumberOfElements();
-    std::vector< bool > elementList(meshElements, false);
-
-
-    //flags to see if we already ordered by that element, 0 = not considered yet
-//     for(unsigned iFlag = 0; iFlag < meshElements; iFlag++) {
-//       elementList[iFlag] = 0;
-//     }
-
-    for(unsigned iproc = 0; iproc < _nprocs; iproc++) {
-
-      bool someMarkersOutsideDomain = false;
-      counter = 0;
-
-      for(unsigned jp = _markerOffset[iproc]; jp < _markerOffset[iproc + 1]; jp++) {
-
-        unsigned jel;
-        jel = particles[jp]->GetMarkerElement();
-
-        if(jel != UINT_MAX) {
-
-          if(elementList[jel] == false) {
-
-            elementList[jel] = true;
-
-            _particles[_markerOffset[iproc] + counter] = particles[jp];
-
-            for(unsigned iList = 0; iList < _size; iList++) {
-              if(printList[iList] == jp) {
-                _printList[iList] = _markerOffset[iproc] + counter;
-                break;
-              }
-            }
-
-            counter++;
+    const ElementSearchGrid* searchGrid = _mesh->GetElementSearchGrid();
 
+    //BEGIN each process creates a block of markers, seeding their element search with the point location index
+    unsigned jBegin = static_cast < unsigned >((static_cast < unsigned long >(_size) * _iproc) / _nprocs);
+    unsigned jEnd = static_cast < unsigned >((static_cast < unsigned long >(_size) * (_iproc + 1)) / _nprocs);
 
-            for(unsigned ip = jp + 1; ip < _markerOffset[iproc + 1]; ip++) {
-              unsigned iel;
-              iel = particles[ip]->GetMarkerElement();
+    for(unsigned j = jBegin; j < jEnd; j++) {
 
-              if(iel == jel) {
-                _particles[_markerOffset[iproc] + counter] = particles[ip];
-
-                for(unsigned iList = 0; iList < _size; iList++) {
-                  if(printList[iList] == ip) {
-                    _printList[iList] = _markerOffset[iproc] + counter;
-                    break;
-                  }
-                }
-
-                counter++;
-              }
-            }
-          }
-        }
-        else {
-          someMarkersOutsideDomain = true;
+      // a point outside the boxes of all the processes is outside the domain
+      unsigned seed = searchGrid->GetSeedElement(x[j]);
+      for(unsigned jproc = 0; seed == UINT_MAX && jproc < _nprocs; jproc++) {
+        if(_mesh->_elementOffset[jproc] < _mesh->_elementOffset[jproc + 1] && searchGrid->IsInsideProcessBox(x[j], jproc)) {
+          seed = _mesh->_elementOffset[jproc];
         }
       }
 
-      if(someMarkersOutsideDomain == true) {
-        if(iproc == 0) {
-          for(unsigned i = 0; i < _size; i++) {
-            unsigned iel = particles[i]->GetMarkerElement();
-
-            if(iel == UINT_MAX) {
-
-              _particles[_markerOffset[0] + counter] = particles[i];
+      Marker* marker = new Marker(x[j], mass[j], markerType[j], solType, seed, _sol);
+      marker->SetMarkerId(j);
 
-              for(unsigned iList = 0; iList < _size; iList++) {
-                if(printList[iList] == i) {
-                  _printList[iList] = _markerOffset[0] + counter;
-                  break;
-                }
-              }
-
-              counter++;
-            }
-          }
-        }
-        else {
-          std::cout << "warning" << std::endl;
-          std::cout << "the marker is outside the domain but not in iproc 0" << std::endl;
-          abort();
-        }
+      if(seed != UINT_MAX && marker->GetMarkerProc(_sol) == _iproc) {
+        unsigned previousElem = UINT_MAX;
+        marker->GetElementSerial(previousElem, _sol, 0.);
+        marker->SetIprocMarkerPreviousElement(previousElem);
       }
 
+      _particles.push_back(marker);
     }
+    //END
 
+    // the markers continue the search on the processes owning their elements
+    MigrateMarkers(0, 0);
 
-
-
-    //END reorder markers also by element
-
-
-
-//     //BEGIN reorder markers also by element
-//
-//     for(unsigned j = 0; j < _size; j++) {
-//       particles[j] = _particles[j];
-//     }
-//
-//     unsigned* elementList = new unsigned [_sol->GetMesh()->GetNumberOfElements()];
-//
-//     std::cout << "number of elements = " <<  _sol->GetMesh()->GetNumberOfElements() << std::endl;
-//
-//     std::vector < unsigned> printList(_size);
-//
-//     //flags to see if we already ordered by that element, 0 = not considered yet
-//     for(unsigned iFlag = 0; iFlag < _mesh->GetNumberOfElements(); iFlag++) {
-//       elementList[iFlag] = 0;
-//     }
-//
-//     printList = _printList;
-//
-//     for(unsigned iproc = 0; iproc < _nprocs; iproc++) {
-//
-//       counter = 0;
-//
-//       for(unsigned jp = _markerOffset[iproc]; jp < _markerOffset[iproc + 1]; jp++) {
-//
-//         unsigned jel;
-//         jel = particles[jp]->GetMarkerElement();
-//
-// 	std::cout<< " Marker in element jel = " << jel << std::endl;
-//
-//         if(elementList[jel] == 0) {
-//
-//           elementList[jel] = 1;
-//
-//           _particles[_markerOffset[iproc] + counter] = particles[jp];
-//           for(unsigned iList = 0; iList < _size; iList++) {
-//             if(printList[iList] == jp) {
-//               _printList[iList] = _markerOffset[iproc] + counter;
-//               break;
-//             }
-//           }
-//           counter++;
-//
-//
-//           for(unsigned ip = _markerOffset[iproc]; ip < _markerOffset[iproc + 1]; ip++) {
-//             unsigned iel;
-//             iel = particles[ip]->GetMarkerElement();
-//             if(ip != jp && iel == jel) {
-//               //std::cout << " jel =" << jel << " , " << "ip = " << ip << " , " << "jp = " << jp <<  std::endl;
-//               elementList[iel] = 1;
-//               _particles[_markerOffset[iproc] + counter] = particles[ip];
-//               for(unsigned iList = 0; iList < _size; iList++) {
-//                 if(printList[iList] == ip) {
-//                   _printList[iList] = _markerOffset[iproc] + counter;
-//                   break;
-//                 }
-//               }
-//               counter++;
-//             }
-//           }
-//         }
-//       }
-//     }
-//
-//     //END reorder markers also by element
-
-//         for(unsigned i = 0; i < _size; i++) {
-//           std::cout << "_printList[ " << i << "] = " << _printList[i] << std::endl;
-//         }
-
-
-//     std::cout << "AFTER THE REORDERING BY ELEM" << std::endl;
-//     for(unsigned i = 0; i < _size; i++) {
-//       unsigned proc;
-//       _particles[i]->GetMarkerProcLine(proc);
-//       unsigned elem;
-//       _particles[i]->GetMarkerElementLine(elem);
-//       std::cout << "Particle: " << i << " , " << "Processor: " << proc << " , "
-//                 << "Element: " << elem << " " << "Pointer: " << _particles[i] << std::endl;
-//     }
-
-
-    _line.resize(_size + 1);
-
-    for(unsigned j = 0; j < _size; j++) {
-      _particles[_printList[j]]->GetMarkerCoordinates(_line[j]);
+    std::vector < std::vector < std::vector < std::vector < double > > > > aX;
+    for(unsigned i = 0; i < _particles.size(); i++) {
+      if(_particles[i]->GetMarkerElement() != UINT_MAX) {
+        _particles[i]->FindLocalCoordinates(solType, aX, true, _sol, 0.);
+      }
     }
 
-    _particles[_printList[0]]->GetMarkerCoordinates(_line[_size]);
-
-    // delete[] elementList;
-    // std::vector < unsigned > ().swap(printList);
-
-
-//     for(unsigned i=0;i<_size;i++){
-//       if(_printList[i] == 3395){
-// 	std::cout << i<< std::endl;
-//       }
-//     }
-//
-//     exit(0);
-  };
+    UpdateLine();
+  }
 
   Line::~Line()
   {
-    for(unsigned j = 0; j < _size; j++) {
-      //std::cout << j << " " << _particles[j] << std::endl<< std::flush;
+    for(unsigned j = 0; j < _particles.size(); j++) {
       delete _particles[j];
     }
   }
@@ -450,267 +175,176 @@ namespace femus
   void Line::UpdateLine()
   {
 
-    std::vector < Marker*> particles(_size);
-    std::vector < unsigned> printList(_size);
-
-    for(unsigned j = 0; j < _size; j++) {
-      particles[j] = _particles[j];
-    }
-
-    printList = _printList;
-
-
-    //BEGIN TEST ASSIGNATION
-
-//     std::vector <double> xtry(_dim);
-//     std::vector <double> xitry(_dim);
-//
-//
-//     for(unsigned j = 0; j < _size; j++) {
-//
-//       unsigned proc;
-//       unsigned elem;
-//       proc = particles[j]->GetMarkerProc();
-//       elem = particles[j]->GetMarkerElement();
-//
-//       std::cout << "proc = " << proc << " , " << "elem = " << elem <<
-//                 " , " << std::endl;
-//       particles[j]->GetMarkerCoordinates(xtry);
-//       for(unsigned i = 0 ; i < _dim; i++) {
-//         std::cout << "x[" << i << "]=" << xtry[i] << std::endl;
-//       }
-//       particles[j]->GetMarkerLocalCoordinatesLine(xitry);
-//       for(unsigned i = 0 ; i < _dim; i++) {
-//         std::cout << "xi[" << i << "]=" << xitry[i] << std::endl;
-//       }
-//     }
-//
-//
-//     for(unsigned j = 0; j < _size; j++) {
-//       _particles[j] = particles[j];
-//     }
-//
-//     std::cout << " ------------------------------------------------------------------------------------------------ " << std::endl;
-//
-//     for(unsigned j = 0; j < _size; j++) {
-//
-//       unsigned proc;
-//       unsigned elem;
-//       proc = _particles[j]->GetMarkerProc();
-//       elem = _particles[j]->GetMarkerElement();
-//       std::cout << "proc = " << proc << " , " << "elem = " << elem <<
-//                 " , " << std::endl;
-//       _particles[j]->GetMarkerCoordinates(xtry);
-//       for(unsigned i = 0 ; i < _dim; i++) {
-//         std::cout << "x[" << i << "]=" << xtry[i] << std::endl;
-//       }
-//       _particles[j]->GetMarkerLocalCoordinatesLine(xitry);
-//       for(unsigned i = 0 ; i < _dim; i++) {
-//         std::cout << "xi[" << i << "]=" << xitry[i] << std::endl;
-//       }
-//     }
-
-
-    //END TEST ASSIGNATION
-
-
-
-
-
+    //BEGIN reorder the local markers by element
+    std::sort(_particles.begin(), _particles.end(), MarkerElementIsLess);
+    //END
 
+    //BEGIN global offsets
+    unsigned localSize = _particles.size();
+    std::vector < unsigned > size(_nprocs);
+    MPI_Allgather(&localSize, 1, MPI_UNSIGNED, &size[0], 1, MPI_UNSIGNED, PETSC_COMM_WORLD);
 
-//     std::cout << "FIRST OF ALL ----------------------- UPDATE LINE" << std::endl;
-//     for(unsigned i = 0; i < _size; i++) {
-//       unsigned proc;
-//       unsigned elem;
-//       std::vector <double> chiappe;
-//       chiappe = _particles[_printList[i]]->GetIprocMarkerCoordinates();
-//       proc = _particles[_printList[i]]->GetMarkerProc();
-//       elem = _particles[_printList[i]]->GetMarkerElement();
-//       std::cout << "Particle: " << i << " , " << "Processor: " << proc << " , "
-//                 << "Element: " << elem << " ";
-//       for(unsigned i = 0; i < _dim; i++) {
-//         std::cout << "x[" << i << "]=" << chiappe[i] << " ";
-//       }
-//       std::cout << std::endl;
-//     }
+    _markerOffset[0] = 0;
+    for(unsigned jproc = 0; jproc < _nprocs; jproc++) {
+      _markerOffset[jproc + 1] = _markerOffset[jproc] + size[jproc];
+    }
 
-    //BEGIN reorder the markers by proc
-    unsigned counter = 0;
+    if(_markerOffset[_nprocs] != _size) {
+      std::cout << "Error in Line::UpdateLine(): " << _markerOffset[_nprocs] << " markers found instead of " << _size << std::endl;
+      abort();
+    }
+    //END
 
-    for(unsigned iproc = 0; iproc < _nprocs; iproc++) {
-      _markerOffset[iproc] = counter;
+    // the coordinates are gathered and the particle arrays rebuilt only when requested
+    _lineIsOutdated = true;
+    _arraysAreOutdated = true;
 
-      for(unsigned j = 0; j < _size; j++) {
-        unsigned markerProc = particles[j]->GetMarkerProc(_sol);
+  }
 
-        if(markerProc == iproc) {
-          _particles[counter] = particles[j];
+  void Line::GatherLine()
+  {
 
-          for(unsigned iList = 0; iList < _size; iList++) {
-            if(printList[iList] == j) {
-              _printList[iList] = counter;
-              break;
-            }
-          }
+    //BEGIN gather the line, ordered by marker id
+    unsigned localSize = _particles.size();
+    unsigned stride = _dim + 1;
 
-          counter++;
-        }
+    std::vector < double > localLine(localSize * stride);
+    for(unsigned i = 0; i < localSize; i++) {
+      std::vector < double > x = _particles[i]->GetIprocMarkerCoordinates();
+      localLine[i * stride] = _particles[i]->GetMarkerId();
+      for(unsigned k = 0; k < _dim; k++) {
+        localLine[i * stride + 1 + k] = x[k];
       }
     }
 
-    //END reorder the markers by proc
-
-//     for(unsigned iproc = 0; iproc <= _nprocs; iproc++) {
-//       std::cout << "_markerOffset[" << iproc << "]= " << _markerOffset[iproc] << std::endl;
-//     }
-
-//     std::cout << "-----------------------------------------  UPDATE LINE  BY PROCS  -----------------------------------------" << std::endl;
-//     for(unsigned i = 0; i < _size; i++) {
-//       unsigned proc;
-//       unsigned elem;
-//       proc = _particles[i]->GetMarkerProc();
-//       elem = _particles[i]->GetMarkerElement();
-//       std::cout << "Particle: " << i << " , " << "Processor: " << proc << " , "
-//                 << "Element: " << elem << " " << std::endl;
-//     }
-
-
+    std::vector < int > recvCount(_nprocs);
+    std::vector < int > recvOffset(_nprocs);
+    for(unsigned jproc = 0; jproc < _nprocs; jproc++) {
+      recvCount[jproc] = (_markerOffset[jproc + 1] - _markerOffset[jproc]) * stride;
+      recvOffset[jproc] = _markerOffset[jproc] * stride;
+    }
 
-    //BEGIN reorder markers also by element
+    std::vector < double > line(_size * stride);
+    MPI_Allgatherv(localLine.data(), localSize * stride, MPI_DOUBLE,
+                   line.data(), &recvCount[0], &recvOffset[0], MPI_DOUBLE, PETSC_COMM_WORLD);
 
+    _line.resize(_size + 1);
     for(unsigned j = 0; j < _size; j++) {
-      particles[j] = _particles[j];
+      unsigned id = static_cast < unsigned >(line[j * stride]);
+      _line[id].assign(line.begin() + j * stride + 1, line.begin() + (j + 1) * stride);
     }
 
-    printList = _printList;
-
-    unsigned meshElements = _mesh->GetNumberOfElements();
-    std::vector< bool > elementList(meshElements, false);
-
-
-    //flags to see if we already ordered by that element, 0 = not considered yet
-//     for(unsigned iFlag = 0; iFlag < meshElements; iFlag++) {
-//       elementList[iFlag] = 0;
-//     }
-
-    for(unsigned iproc = 0; iproc < _nprocs; iproc++) {
-
-      bool someMarkersOutsideDomain = false;
-      counter = 0;
-
-      for(unsigned jp = _markerOffset[iproc]; jp < _markerOffset[iproc + 1]; jp++) {
-
-        unsigned jel;
-        jel = particles[jp]->GetMarkerElement();
+    if(_size > 0) {
+      _line[_size] = _line[0];
+    }
+    //END
 
-        if(jel != UINT_MAX) {
+    _lineIsOutdated = false;
 
-          if(elementList[jel] == false) {
+  }
 
-            elementList[jel] = true;
+  void Line::MigrateMarkers(const unsigned& n, const unsigned& order, const bool &seedReceived)
+  {
 
-            _particles[_markerOffset[iproc] + counter] = particles[jp];
+    const int migrationTag = 101;
 
-            for(unsigned iList = 0; iList < _size; iList++) {
-              if(printList[iList] == jp) {
-                _printList[iList] = _markerOffset[iproc] + counter;
-                break;
-              }
-            }
-
-            counter++;
+    std::vector < std::vector < double > > sendBuffer(_nprocs);
+    std::vector < int > sendFlag(_nprocs);
+    std::vector < MPI_Request > sendRequest;
+    std::vector < double > recvBuffer;
 
+    const ElementSearchGrid* searchGrid = (seedReceived) ? _mesh->GetElementSearchGrid() : NULL;
 
-            for(unsigned ip = jp + 1; ip < _markerOffset[iproc + 1]; ip++) {
-              unsigned iel;
-              iel = particles[ip]->GetMarkerElement();
+    while(true) {
 
-              if(iel == jel) {
-                _particles[_markerOffset[iproc] + counter] = particles[ip];
+      //BEGIN pack the markers owned by other processes, the markers outside the domain go to process 0
+      for(unsigned jproc = 0; jproc < _nprocs; jproc++) {
+        sendBuffer[jproc].clear();
+      }
 
-                for(unsigned iList = 0; iList < _size; iList++) {
-                  if(printList[iList] == ip) {
-                    _printList[iList] = _markerOffset[iproc] + counter;
-                    break;
-                  }
-                }
+      unsigned localMigrants = 0;
+      unsigned counter = 0;
+      for(unsigned i = 0; i < _particles.size(); i++) {
+        unsigned mproc = _particles[i]->GetMarkerProc(_sol);
 
-                counter++;
-              }
-            }
-          }
+        if(mproc != _iproc) {
+          _particles[i]->Pack(sendBuffer[mproc]);
+          delete _particles[i];
+          localMigrants++;
         }
         else {
-          someMarkersOutsideDomain = true;
+          _particles[counter] = _particles[i];
+          counter++;
         }
       }
+      _particles.resize(counter);
 
-      if(someMarkersOutsideDomain == true) {
-        if(iproc == 0) {
-          for(unsigned i = 0; i < _size; i++) {
-            unsigned iel = particles[i]->GetMarkerElement();
+      unsigned migrants;
+      MPI_Allreduce(&localMigrants, &migrants, 1, MPI_UNSIGNED, MPI_SUM, PETSC_COMM_WORLD);
 
-            if(iel == UINT_MAX) {
+      if(migrants == 0) break;
+      //END
 
-              _particles[_markerOffset[0] + counter] = particles[i];
+      //BEGIN one non-blocking message per destination
+      for(unsigned jproc = 0; jproc < _nprocs; jproc++) {
+        sendFlag[jproc] = (sendBuffer[jproc].size() > 0) ? 1 : 0;
+      }
 
-              for(unsigned iList = 0; iList < _size; iList++) {
-                if(printList[iList] == i) {
-                  _printList[iList] = _markerOffset[0] + counter;
-                  break;
-                }
-              }
+      int nRecv;
+      MPI_Reduce_scatter_block(&sendFlag[0], &nRecv, 1, MPI_INT, MPI_SUM, PETSC_COMM_WORLD);
 
-              counter++;
-            }
-          }
-        }
-        else {
-          std::cout << "warning" << std::endl;
-          std::cout << "the marker is outside the domain but not in iproc 0" << std::endl;
-          abort();
+      sendRequest.resize(0);
+      for(unsigned jproc = 0; jproc < _nprocs; jproc++) {
+        if(sendFlag[jproc]) {
+          sendRequest.resize(sendRequest.size() + 1);
+          MPI_Isend(&sendBuffer[jproc][0], sendBuffer[jproc].size(), MPI_DOUBLE, jproc, migrationTag, PETSC_COMM_WORLD, &sendRequest.back());
         }
       }
+      //END
 
-    }
-
-
+      //BEGIN receive, unpack and continue the element search inside this process
+      for(int irecv = 0; irecv < nRecv; irecv++) {
+        MPI_Status status;
+        MPI_Probe(MPI_ANY_SOURCE, migrationTag, PETSC_COMM_WORLD, &status);
 
+        int recvSize;
+        MPI_Get_count(&status, MPI_DOUBLE, &recvSize);
+        recvBuffer.resize(recvSize);
+        MPI_Recv(&recvBuffer[0], recvSize, MPI_DOUBLE, status.MPI_SOURCE, migrationTag, PETSC_COMM_WORLD, MPI_STATUS_IGNORE);
 
-    //END reorder markers also by element
+        const double* buffer = &recvBuffer[0];
+        const double* bufferEnd = buffer + recvSize;
 
-    for(unsigned j = 0; j < _size; j++) {
+        while(buffer < bufferEnd) {
+          Marker* marker = new Marker(buffer, _sol);
 
-      _particles[_printList[j]]->GetMarkerCoordinates(_line[j]);
-    }
+          if(marker->GetMarkerElement() != UINT_MAX) {
+            if(seedReceived) {
+              unsigned seed = searchGrid->GetSeedElement(marker->GetIprocMarkerCoordinates());
+              if(seed != UINT_MAX) marker->SetMarkerElement(seed);
+            }
 
-    _particles[_printList[0]]->GetMarkerCoordinates(_line[_size]);
-
-    //delete[] elementList;
-    //std::vector < unsigned > ().swap(printList);
-    //std::vector < unsigned > ().swap(elementList);
-
-
-//     std::cout << "-----------------------------------------  UPDATE LINE  BY ELEMENTS-----------------------------------------" << std::endl;
-//     for(unsigned i = 0; i < _size; i++) {
-//       unsigned proc;
-//       unsigned elem;
-//       //std::vector <double> chiappe;
-//       //chiappe = _particles[_printList[i]]->GetIprocMarkerCoordinates();
-//       proc = _particles[i]->GetMarkerProc(_sol);
-//       elem = _particles[i]->GetMarkerElement();
-//       std::cout << "Particle: " << i << " , " << "Processor: " << proc << " , "
-//                 << "Element: " << elem << " " <<  " "  ;
-// //       for(unsigned j = 0; j < _dim; j++) {
-// //         std::cout << "x[" << j << "]=" << chiappe[j] << " " ;
-// //       }
-//       std::cout << std::endl;
-//     }
+            double s = 0.;
+            if(order > 0) {
+              marker->GetMarkerS(n, order, s);
+            }
+            unsigned previousElem = marker->GetIprocMarkerPreviousElement();
+            marker->GetElementSerial(previousElem, _sol, s);
+            marker->SetIprocMarkerPreviousElement(previousElem);
+          }
 
+          _particles.push_back(marker);
+        }
+      }
 
+      if(sendRequest.size() > 0) {
+        MPI_Waitall(sendRequest.size(), &sendRequest[0], MPI_STATUSES_IGNORE);
+      }
+      //END
+    }
   }
 
+
   void Line::AdvectionParallel(const unsigned& n, const double& T, const unsigned& order, ForceFunction force)
   {
 
@@ -753,29 +387,20 @@ namespace femus
 
     //BEGIN Numerical integration scheme
 
-    for(unsigned iMarker = _markerOffset[_iproc]; iMarker < _markerOffset[_iproc + 1]; iMarker++) {
+    for(unsigned iMarker = 0; iMarker < _particles.size(); iMarker++) {
       _particles[iMarker]->InitializeMarkerForAdvection(order);
     }
 
-//     unsigned maxload = 0;
-//     for(unsigned jproc=0; jproc<_nprocs;jproc++){
-//       unsigned temp = (_markerOffset[jproc + 1] - _markerOffset[jproc]);
-//       maxload = ( temp > maxload) ? temp : maxload;
-//     }
-//     maxload *= (n * order)/(_nprocs * _nprocs);
+    double advectionTime = 0.;
 
     while(integrationIsOverCounter != _size) {
 
-      MyVector <unsigned> integrationIsOverCounterProc(1, 0);
-      integrationIsOverCounterProc.stack();
-
       //BEGIN LOCAL ADVECTION INSIDE IPROC
       clock_t startTime = clock();
+      double wallTime = MPI_Wtime();
       unsigned counter = 0;
 
-      for(unsigned iMarker = _markerOffset[_iproc]; iMarker < _markerOffset[_iproc + 1]; iMarker++) {
-
-        //std::cout << _printList[iMarker] <<" "<<std::flush;
+      for(unsigned iMarker = 0; iMarker < _particles.size(); iMarker++) {
 
         unsigned currentElem = _particles[iMarker]->GetMarkerElement();
         bool markerOutsideDomain = (currentElem != UINT_MAX) ? false : true;
@@ -809,24 +434,11 @@ namespace femus
               }
             }
 
-            // double s = (tstep + _c[order - 1][istep]) / n;
-
-
-            //std::cout<<"AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA";
-
             if(force != NULL) {
-              //else if (_sol->GetIfFSI()) {
               unsigned material = _sol->GetMesh()->GetElementMaterial(currentElem);
-//               MagneticForce(x, Fm, material, 0);
               force(x, Fm, material);
             }
 
-            //std::cout<<"AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA"<<std::flush;
-
-//             for(unsigned l = 0; l < Fm.size(); l++) {
-//               std::cout << "Fm[" << l << "]=" << Fm[l] << std::endl;
-//             }
-
             for(unsigned k = 0; k < _dim; k++) {
               K[istep][k] = (s * V[0][k] + (1. - s) * V[1][k] + Fm[k]) * h;
             }
@@ -863,13 +475,10 @@ namespace femus
             _particles[iMarker]->SetIprocMarkerStep(step);
             _particles[iMarker]->GetMarkerS(n, order, s);
 
-            //std::cout << step <<" "<< istep<< " AAAAAAAAAAAAA"<<std::endl<<std::flush;
             unsigned previousElem = currentElem;
             localTime = clock();
             _particles[iMarker]->GetElementSerial(previousElem, _sol, s);
             _time[4] += static_cast<double>((clock() - localTime)) / CLOCKS_PER_SEC;
-            localTime = clock();
-            // std::cout << step <<" "<< istep<< " BBBBBBBBBBBBB"<<std::endl<<std::flush;
 
             _particles[iMarker]->SetIprocMarkerPreviousElement(previousElem);
 
@@ -896,198 +505,163 @@ namespace femus
           step = UINT_MAX;
           _particles[iMarker]->SetIprocMarkerStep(step);
         }
-
-        if(step == UINT_MAX || markerOutsideDomain) {
-          integrationIsOverCounterProc[_iproc] += 1;
-        }
-
-        //if(counter > maxload) break;
       }
 
       _time[5] += static_cast<double>((clock() - startTime)) / CLOCKS_PER_SEC;
+      advectionTime += MPI_Wtime() - wallTime;
       MPI_Barrier(PETSC_COMM_WORLD);
       _time[0] += static_cast<double>((clock() - startTime)) / CLOCKS_PER_SEC;
       startTime = clock();
       //END LOCAL ADVECTION INSIDE IPROC
 
-      integrationIsOverCounter = 0;
+      //BEGIN exchange of the markers that left the process
+      MigrateMarkers(n, order);
 
-      for(unsigned jproc = 0; jproc < _nprocs; jproc++) {
-        integrationIsOverCounterProc.broadcast(jproc);
-        integrationIsOverCounter += integrationIsOverCounterProc[jproc];
-        integrationIsOverCounterProc.clearBroadcast();
+      unsigned integrationIsOverCounterProc = 0;
+      for(unsigned iMarker = 0; iMarker < _particles.size(); iMarker++) {
+        if(_particles[iMarker]->GetIprocMarkerStep() == UINT_MAX) {
+          integrationIsOverCounterProc++;
+        }
       }
+      MPI_Allreduce(&integrationIsOverCounterProc, &integrationIsOverCounter, 1, MPI_UNSIGNED, MPI_SUM, PETSC_COMM_WORLD);
 
-//       MPI_Barrier( PETSC_COMM_WORLD );
-//       _time[1] += static_cast<double>((clock() - startTime)) / CLOCKS_PER_SEC;
-//       startTime = clock();
-
-      // std::cout << "DOPO integrationIsOverCounter = " << integrationIsOverCounter << std::endl;
+      _time[1] += static_cast<double>((clock() - startTime)) / CLOCKS_PER_SEC;
+      //END exchange of the markers that left the process
 
-      //BEGIN exchange on information
+    }
 
-      //std::cout << " ----------------------------------PROCESSES EXCHANGE INFO ---------------------------------- " << std::endl;
-      for(unsigned jproc = 0; jproc < _nprocs; jproc++) {
-        for(unsigned iMarker = _markerOffset[jproc]; iMarker < _markerOffset[jproc + 1]; iMarker++) {
-          unsigned elem =  _particles[iMarker]->GetMarkerElement();
-          MPI_Bcast(& elem, 1, MPI_UNSIGNED, jproc, PETSC_COMM_WORLD);
-          _particles[iMarker]->SetMarkerElement(elem);
+    clock_t startTime = clock();
+    UpdateLine();
+    _time[2] += static_cast<double>((clock() - startTime)) / CLOCKS_PER_SEC;
 
-          unsigned step =  _particles[iMarker]->GetIprocMarkerStep();
-          MPI_Bcast(& step, 1, MPI_UNSIGNED, jproc, PETSC_COMM_WORLD);
-          _particles[iMarker]->SetIprocMarkerStep(step);
+    ComputeLoadImbalance(advectionTime);
 
-          if(elem != UINT_MAX) {    // if it is outside jproc, ACTUALLY IF WE ARE HERE IT COULD STILL BE IN JPROC but not outside the domain
-            unsigned mproc = _particles[iMarker]->GetMarkerProc(_sol);
-            _particles[iMarker]->SetMarkerProc(mproc);
+  }
 
-            if(mproc != jproc) {
-              unsigned prevElem = _particles[iMarker]->GetIprocMarkerPreviousElement();
-              _particles[iMarker]->GetMarkerS(n, order, s);
-              _particles[iMarker]->GetElement(prevElem, jproc, _sol, s);
-              _particles[iMarker]->SetIprocMarkerPreviousElement(prevElem);
-            }
 
-            elem = _particles[iMarker]->GetMarkerElement();
+  void Line::ComputeLoadImbalance(const double& advectionTime)
+  {
 
-            if(elem != UINT_MAX) {    // if it is not outside the domain
-              unsigned mproc = _particles[iMarker]->GetMarkerProc(_sol);
+    unsigned insideTheDomain = 0;
+    for(unsigned i = 0; i < _particles.size(); i++) {
+      if(_particles[i]->GetMarkerElement() != UINT_MAX) insideTheDomain++;
+    }
 
-              if(mproc != jproc) {
-                if(jproc == _iproc) {
+    double localLoad[2] = {static_cast < double >(insideTheDomain), advectionTime};
+    double maxLoad[2];
+    double sumLoad[2];
+    MPI_Allreduce(localLoad, maxLoad, 2, MPI_DOUBLE, MPI_MAX, PETSC_COMM_WORLD);
+    MPI_Allreduce(localLoad, sumLoad, 2, MPI_DOUBLE, MPI_SUM, PETSC_COMM_WORLD);
 
-                  unsigned step =  _particles[iMarker]->GetIprocMarkerStep();
-                  MPI_Send(& step, 1, MPI_UNSIGNED, mproc, order + 1, PETSC_COMM_WORLD);
+    _particleImbalance = (sumLoad[0] > 0.) ? maxLoad[0] * _nprocs / sumLoad[0] : 1.;
+    _advectionImbalance = (sumLoad[1] > 0.) ? maxLoad[1] * _nprocs / sumLoad[1] : 1.;
 
-                  unsigned istep = step % order;
+    if(_loadBalanceReport && _iproc == 0) {
+      std::cout << "Line load imbalance (max / mean): markers " << _particleImbalance
+                << ", advection time " << _advectionImbalance << std::endl;
+    }
+  }
 
-                  if(istep != 0) {
-                    K = _particles[iMarker]->GetIprocMarkerK();
 
-                    for(int i = 0; i < order; i++) {
-                      MPI_Send(&K[i][0], _dim, MPI_DOUBLE, mproc, i , PETSC_COMM_WORLD);
-                    }
+  void Line::GetCoarseElementWeights(std::vector < unsigned >& weights, const double& particleWeight)
+  {
 
-                    x0 = _particles[iMarker]->GetIprocMarkerOldCoordinates();
-                    MPI_Send(&x0[0], _dim, MPI_DOUBLE, mproc, order , PETSC_COMM_WORLD);
-                  }
+    Mesh* coarseMsh = _mesh;
+    while(coarseMsh->GetCoarseMesh() != NULL) {
+      coarseMsh = coarseMsh->GetCoarseMesh();
+    }
 
-                  _particles[iMarker]->FreeVariables();
+    std::vector < unsigned > localCount(coarseMsh->GetNumberOfElements(), 0);
+    for(unsigned i = 0; i < _particles.size(); i++) {
+      unsigned iel = _particles[i]->GetMarkerElement();
+      if(iel != UINT_MAX) {
+        localCount[_mesh->GetCoarseOriginalElementIndex(iel)]++;
+      }
+    }
 
-                }
-                else if(mproc == _iproc) {
+    std::vector < unsigned > count(localCount.size());
+    MPI_Allreduce(&localCount[0], &count[0], count.size(), MPI_UNSIGNED, MPI_SUM, PETSC_COMM_WORLD);
 
-                  _particles[iMarker]->InitializeVariables(order);
+    weights.resize(count.size());
+    for(unsigned i = 0; i < count.size(); i++) {
+      weights[i] = 1 + static_cast < unsigned >(particleWeight * count[i] + 0.5);
+    }
+  }
 
-                  unsigned step;
-                  MPI_Recv(& step, 1, MPI_UNSIGNED, jproc, order + 1, PETSC_COMM_WORLD, MPI_STATUS_IGNORE);
-                  _particles[iMarker]->SetIprocMarkerStep(step);
 
-                  unsigned istep = step % order;
+  void Line::Rebalance(Solution* sol)
+  {
 
-                  if(istep != 0) {
-                    for(int i = 0; i < order; i++) {
-                      MPI_Recv(&K[i][0], _dim, MPI_DOUBLE, jproc, i , PETSC_COMM_WORLD, MPI_STATUS_IGNORE);
-                      _particles[iMarker]->SetIprocMarkerK(K);
-                    }
+    Mesh* msh = sol->GetMesh();
 
-                    MPI_Recv(&x0[0], _dim, MPI_DOUBLE, jproc, order , PETSC_COMM_WORLD, MPI_STATUS_IGNORE);
-                    _particles[iMarker]->SetIprocMarkerOldCoordinates(x0);
+    Mesh* coarseMsh = msh;
+    while(coarseMsh->GetCoarseMesh() != NULL) {
+      coarseMsh = coarseMsh->GetCoarseMesh();
+    }
 
-                  }
-                }
-              }
-            }
-          }
+    std::vector < unsigned > coarseElement(coarseMsh->GetNumberOfElements());
+    for(unsigned iel = 0; iel < coarseElement.size(); iel++) {
+      coarseElement[coarseMsh->GetOriginalElementIndex(iel)] = iel;
+    }
 
-          if(elem == UINT_MAX && jproc != 0) {    // elem = UINT_MAX, but not yet in jproc = 0
-            if(jproc == _iproc) {
-              x = _particles[iMarker]->GetIprocMarkerCoordinates();
-              MPI_Send(&x[0], _dim, MPI_DOUBLE, 0, 1 , PETSC_COMM_WORLD);
-              _particles[iMarker]->FreeVariables();
-            }
-            else if(_iproc == 0) {
-              _particles[iMarker]->InitializeX();
-              MPI_Recv(&x[0], _dim, MPI_DOUBLE, jproc, 1 , PETSC_COMM_WORLD, MPI_STATUS_IGNORE);
-              _particles[iMarker]->SetIprocMarkerCoordinates(x);
-            }
-          }
-        }
+    //BEGIN new owner of the markers, from the coarse element on the current mesh
+    std::vector < unsigned > markerProc(_particles.size(), UINT_MAX);
+    for(unsigned i = 0; i < _particles.size(); i++) {
+      unsigned iel = _particles[i]->GetMarkerElement();
+      if(iel != UINT_MAX) {
+        markerProc[i] = coarseMsh->IsdomBisectionSearch(coarseElement[_mesh->GetCoarseOriginalElementIndex(iel)], 3);
       }
+    }
+    //END
 
-      MPI_Barrier(PETSC_COMM_WORLD);
-      _time[1] += static_cast<double>((clock() - startTime)) / CLOCKS_PER_SEC;
-      startTime = clock();
-
-      //std::cout << " ----------------------------------END PROCESSES EXCHANGE INFO ---------------------------------- " << std::endl;
-
-      //END exchange of information
-
-
-//       //BEGIN to be removed
-//       std::vector<double> tr;
-//       unsigned step;
-//       for(unsigned j = 0; j < _size; j++) {
-//         _particles[j]->GetMarkerCoordinates(tr);
-//         step = _particles[j]->GetIprocMarkerStep();
-//         for(unsigned i = 0; i < _dim; i++) {
-//           std::cout << "x[ " << j << " ][ " << i << " ] = " << tr[i] ;
-//         }
-//         tr = _particles[j]->GetIprocMarkerOldCoordinates();
-//         for(unsigned i = 0; i < _dim; i++) {
-//           std::cout << "x0[ " << j << " ][ " << i << " ] = " << tr[i] ;
-//         }
-//
-//
-//         std::cout << " step = " << step << "currentElem = " << _particles[j]->GetMarkerElement() << " previousElem = " <<  _particles[j]->GetIprocMarkerPreviousElement() << std::endl;
-//       }
-//       //END to be removed
-
+    _sol = sol;
+    _mesh = msh;
 
+    const ElementSearchGrid* searchGrid = _mesh->GetElementSearchGrid();
 
-      UpdateLine();
+    //BEGIN the markers start the search from the point location index of their new owner:
+    // the local ones here, the others on the receiving process, where they are routed through its first element
+    for(unsigned i = 0; i < _particles.size(); i++) {
+      if(markerProc[i] != UINT_MAX) {
+        _particles[i]->SetIprocMarkerPreviousElement(UINT_MAX);
 
-      MPI_Barrier(PETSC_COMM_WORLD);
-      _time[2] += static_cast<double>((clock() - startTime)) / CLOCKS_PER_SEC;
-      startTime = clock();
-
-//       //BEGIN to removed
-//       for(unsigned j = 0; j < _size; j++) {
-//         _particles[j]->GetMarkerCoordinates(tr);
-//         step = _particles[j]->GetIprocMarkerStep();
-//         for(unsigned i = 0; i < _dim; i++) {
-//           std::cout << "x[ " << j << " ][ " << i << " ] = " << tr[i] ;
-//         }
-//         tr = _particles[j]->GetIprocMarkerOldCoordinates();
-//         for(unsigned i = 0; i < _dim; i++) {
-//           std::cout << "x0[ " << j << " ][ " << i << " ] = " << tr[i] ;
-//         }
-//         std::cout << " step = " << step << "currentElem = " << _particles[j]->GetMarkerElement() << " previousElem = " <<  _particles[j]->GetIprocMarkerPreviousElement() << std::endl;
-//       }
-//
-//       //END to be remove
-
-      // std::cout << " END integrationIsOverCounter = " << integrationIsOverCounter <<  std::endl;
+        if(markerProc[i] == _iproc) {
+          unsigned seed = searchGrid->GetSeedElement(_particles[i]->GetIprocMarkerCoordinates());
+          _particles[i]->SetMarkerElement((seed != UINT_MAX) ? seed : _mesh->_elementOffset[_iproc]);
 
+          unsigned previousElem = UINT_MAX;
+          _particles[i]->GetElementSerial(previousElem, _sol, 0.);
+          _particles[i]->SetIprocMarkerPreviousElement(previousElem);
+        }
+        else {
+          _particles[i]->SetMarkerElement(_mesh->_elementOffset[markerProc[i]]);
+        }
+      }
     }
+    //END
+
+    MigrateMarkers(0, 0, true);
 
-    //std::cout<<_time[0]<<" "<<_time[1]<<" "<<_time[2]<<" "<<_time[3]<<" "<<_time[4]<<" "<<_time[5]<<std::endl<<std::flush;
+    UpdateLine();
   }
 
 
   unsigned Line::NumberOfParticlesOutsideTheDomain()
   {
 
-    unsigned counter = 0;
+    unsigned localCounter = 0;
 
-    for(unsigned iMarker = _markerOffset[0]; iMarker < _markerOffset[1]; iMarker++) {
+    for(unsigned iMarker = 0; iMarker < _particles.size(); iMarker++) {
       unsigned elem =  _particles[iMarker]->GetMarkerElement();
 
       if(elem == UINT_MAX) {
-        counter++;
+        localCounter++;
       }
     }
 
+    unsigned counter;
+    MPI_Allreduce(&localCounter, &counter, 1, MPI_UNSIGNED, MPI_SUM, PETSC_COMM_WORLD);
+
     return counter;
   }
 
@@ -1104,24 +678,59 @@ namespace femus
     unsigned solIndexMat = _sol->GetIndex("Mat"); // element
     unsigned solTypeMat = _sol->GetSolutionType(solIndexMat);
 
-    std::map<unsigned, std::vector < std::vector < std::vector < std::vector < double > > > > > aX;
-
     _sol->_Sol[solIndexM]->zero();
     _sol->_Sol[solIndexMat]->zero();
 
+    // set all element with at least one marker to 3 and all nodes of the element to 1,
+    // and update the local coordinates of the markers one element bucket at a time
+    UpdateParticleArrays();
 
-    // set all element with at least one marker to 3 and all nodes of the element to 1
-    for(unsigned iMarker = _markerOffset[_iproc]; iMarker < _markerOffset[_iproc + 1]; iMarker++) {
+    const double *x[3];
+    double *xi[3];
+    for(unsigned k = 0; k < _dim; k++) {
+      x[k] = _arrays.GetCoordinates(k);
+      xi[k] = _arrays.GetLocalCoordinates(k);
+    }
 
-      unsigned iel = _particles[iMarker]->GetMarkerElement();
-      unsigned ielType =  _mesh->GetElementType(iel);
-      bool elementUpdate = (aX.find(iel) != aX.end()) ? false : true;     //update if iel was never updated
+    std::vector < std::vector < double > > xv(_dim);
+    std::vector < std::vector < double > > aX;
+    std::vector < double > xp(_dim);
+    std::vector < double > xip;
+    ElementInverseMapping inverseMapping;
 
-      std::vector <double> xi1 = _particles[iMarker]->GetMarkerLocalCoordinates();
+    for(unsigned ib = 0; ib < _arrays.GetNumberOfBuckets(); ib++) {
 
-      _particles[iMarker]->FindLocalCoordinates(2., aX[iel], elementUpdate, _sol, s);
+      unsigned iel = _arrays.GetBucketElement(ib);
+      short unsigned ielType = _mesh->GetElementType(iel);
+      unsigned nDofsX = _mesh->GetElementDofNumber(iel, 2);
 
-      std::vector <double> xi = _particles[iMarker]->GetMarkerLocalCoordinates();
+      Marker *marker = _particles[_arrays.GetMarkerIndex(_arrays.GetBucketBegin(ib))];
+      for(unsigned k = 0; k < _dim; k++) {
+        xv[k].resize(nDofsX);
+        for(unsigned i = 0; i < nDofsX; i++) {
+          unsigned iDof = _mesh->GetSolutionDof(i, iel, 2);
+          xv[k][i] = marker->GetCoordinates(_sol, k, iDof, s);
+        }
+      }
+      ProjectNodalToPolynomialCoefficients(aX, xv, ielType, 2);
+      inverseMapping.SetCoefficients(aX, ielType, 2);
+
+      // the Newton iteration starts from the closest node of the element
+      for(unsigned i = _arrays.GetBucketBegin(ib); i < _arrays.GetBucketEnd(ib); i++) {
+        for(unsigned k = 0; k < _dim; k++) {
+          xp[k] = x[k][i];
+        }
+        GetClosestPointInReferenceElement(xv, xp, ielType, xip);
+        for(unsigned k = 0; k < _dim; k++) {
+          xi[k][i] = xip[k];
+        }
+      }
+
+      unsigned notConverged = inverseMapping.GetLocalCoordinates(x, xi, _arrays.GetBucketBegin(ib), _arrays.GetBucketEnd(ib));
+      if(notConverged > 0) {
+        std::cout << "Warning in Line::GetParticlesToGridMaterial(): the inverse mapping of " << notConverged
+                  << " markers in the element " << iel << " did not converge" << std::endl;
+      }
 
       for(unsigned j = 0; j < _mesh->GetElementDofNumber(iel, solTypeM); j++) {
         unsigned jdof = _mesh->GetSolutionDof(j, iel, solTypeM);
@@ -1130,7 +739,6 @@ namespace femus
 
       unsigned idofMat = _mesh->GetSolutionDof(0, iel, solTypeMat);
       _sol->_Sol[solIndexMat]->set(idofMat, 3.);
-
     }
     _sol->_Sol[solIndexM]->close();
     _sol->_Sol[solIndexMat]->close();
@@ -1192,10 +800,9 @@ namespace femus
     _sol->_Sol[solIndexMat]->close();
 
 
-    for(unsigned iMarker = _markerOffset[_iproc]; iMarker < _markerOffset[_iproc + 1]; iMarker++) {
+    for(unsigned ib = 0; ib < _arrays.GetNumberOfBuckets(); ib++) {
 
-      unsigned iel = _particles[iMarker]->GetMarkerElement();
-      unsigned ielType =  _mesh->GetElementType(iel);
+      unsigned iel = _arrays.GetBucketElement(ib);
       for(unsigned j = 0; j < _mesh->GetElementDofNumber(iel, solTypeM); j++) {
 
         unsigned jdof = _mesh->GetSolutionDof(j, iel, solTypeM);
@@ -1204,101 +811,24 @@ namespace femus
     }
     _sol->_Sol[solIndexM]->close();
 
+    // copy back the updated local coordinates
+    _arrays.Store(_particles);
+
   }
 
 
   void Line::UpdateLineMPM()
   {
 
-
-    for(unsigned iMarker = _markerOffset[_iproc]; iMarker < _markerOffset[_iproc + 1]; iMarker++) {
+    for(unsigned iMarker = 0; iMarker < _particles.size(); iMarker++) {
       unsigned elem =  _particles[iMarker]->GetMarkerElement();
-      _particles[iMarker]->GetElementSerial(elem, _sol, 0.);
-      _particles[iMarker]->SetIprocMarkerPreviousElement(elem);
-    }
-
-    for(unsigned jproc = 0; jproc < _nprocs; jproc++) {
-      for(unsigned iMarker = _markerOffset[jproc]; iMarker < _markerOffset[jproc + 1]; iMarker++) {
-
-        unsigned elem =  _particles[iMarker]->GetMarkerElement();
-        MPI_Bcast(& elem, 1, MPI_UNSIGNED, jproc, PETSC_COMM_WORLD);
-        _particles[iMarker]->SetMarkerElement(elem);
-
-        if(elem != UINT_MAX) {
-          unsigned mproc = _particles[iMarker]->GetMarkerProc(_sol); //WARNING you don't know if this is your real process
-          _particles[iMarker]->SetMarkerProc(mproc);
-
-          if(mproc != jproc) {  //this means, if we think the particle moved from jproc (which means element serial shouldn't have found the actual element)
-            unsigned prevElem = _particles[iMarker]->GetIprocMarkerPreviousElement();
-            _particles[iMarker]->GetElement(prevElem, jproc, _sol, 0.);
-            _particles[iMarker]->SetIprocMarkerPreviousElement(prevElem);
-          }
-
-          elem = _particles[iMarker]->GetMarkerElement(); //TODO shouldn't this be inside the if ? If we don't go in the if I think we already know who elem is
-
-          if(elem != UINT_MAX) {    // if it is not outside the domain
-            unsigned mproc = _particles[iMarker]->GetMarkerProc(_sol);  //actual mproc
-
-            if(mproc != jproc) {  //there is no need to send/receive if the particle didn't change process (which is when mproc == jproc)
-              if(jproc == _iproc) {
-
-                unsigned order = 0;
-                std::vector <double> MPMQuantities = _particles[iMarker]->GetMPMQuantities();
-                unsigned MPMsize =  _particles[iMarker]->GetMPMSize();
-                MPI_Send(&MPMQuantities[0], MPMsize, MPI_DOUBLE, mproc, order, PETSC_COMM_WORLD);
-
-                std::vector < std::vector < double > > Fp = _particles[iMarker]->GetDeformationGradient();
-                for(unsigned i = 0; i < _dim; i++) {
-                  MPI_Send(&Fp[i][0], _dim, MPI_DOUBLE, mproc, order + 1, PETSC_COMM_WORLD);
-                }
-
-                _particles[iMarker]->FreeVariables();
-
-              }
-              else if(mproc == _iproc) {
-
-                unsigned order = 0;
-                _particles[iMarker]->InitializeVariables(order);
-
-                unsigned MPMsize =  _particles[iMarker]->GetMPMSize();
-                std::vector <double> MPMQuantities(MPMsize);
-
-                MPI_Recv(&MPMQuantities[0], MPMsize, MPI_DOUBLE, jproc, order, PETSC_COMM_WORLD, MPI_STATUS_IGNORE);
-                _particles[iMarker]->SetMPMQuantities(MPMQuantities);
-
-                std::vector < std::vector < double > > Fp(_dim);
-                for(unsigned i = 0; i < _dim; i++) {
-                  Fp[i].resize(_dim);
-                }
-
-                for(unsigned i = 0; i < _dim; i++) {
-                  MPI_Recv(&Fp[i][0], _dim, MPI_DOUBLE, jproc, order + 1, PETSC_COMM_WORLD, MPI_STATUS_IGNORE);
-                }
-                _particles[iMarker]->SetDeformationGradient(Fp);
-
-              }
-            }
-          }
-        }
-
-        if(elem == UINT_MAX && jproc != 0) {    // elem = UINT_MAX, but not yet in jproc = 0
-          if(jproc == _iproc) {
-            std::vector<double> x(_dim);
-            x = _particles[iMarker]->GetIprocMarkerCoordinates();
-            MPI_Send(&x[0], _dim, MPI_DOUBLE, 0, 1 , PETSC_COMM_WORLD);
-            _particles[iMarker]->FreeVariables();
-          }
-          else if(_iproc == 0) {
-            std::vector<double> x(_dim);
-            _particles[iMarker]->InitializeX();
-            MPI_Recv(&x[0], _dim, MPI_DOUBLE, jproc, 1 , PETSC_COMM_WORLD, MPI_STATUS_IGNORE);
-            _particles[iMarker]->SetIprocMarkerCoordinates(x);
-          }
-        }
+      if(elem != UINT_MAX) {
+        _particles[iMarker]->GetElementSerial(elem, _sol, 0.);
+        _particles[iMarker]->SetIprocMarkerPreviousElement(elem);
       }
     }
 
-    //END find new _elem and _mproc
+    MigrateMarkers(0, 0);
 
     UpdateLine();
 
@@ -1307,20 +837,22 @@ namespace femus
   void Line::SetParticlesMass(const double& volume, const double& density)
   {
     double particlesMass = density * volume / _size;
-    for(unsigned i = _markerOffset[_iproc]; i < _markerOffset[_iproc  + 1]; i++) {
+    for(unsigned i = 0; i < _particles.size(); i++) {
       _particles[i]->SetMarkerMass(particlesMass);
     }
+    _arraysAreOutdated = true;
   }
 
 
   void Line::ScaleParticleMass(double scale(const std::vector <double>& x))
   {
-    for(unsigned i = _markerOffset[_iproc]; i < _markerOffset[_iproc  + 1]; i++) {
+    for(unsigned i = 0; i < _particles.size(); i++) {
       std::vector<double> x(_dim);
       x = _particles[i]->GetIprocMarkerCoordinates();
       double mass = _particles[i]->GetMarkerMass();
       _particles[i]->SetMarkerMass(mass * scale(x));
     }
+    _arraysAreOutdated = true;
 
   }
 
@@ -1332,7 +864,7 @@ namespace femus
     std::vector < double > xMinLocal(_dim, 1.0e100);
     std::vector < double > xMaxLocal(_dim, -1.0e100);
     std::vector< double > x;
-    for(unsigned i = _markerOffset[_iproc]; i < _markerOffset[_iproc  + 1]; i++) {
+    for(unsigned i = 0; i < _particles.size(); i++) {
       x = _particles[i]->GetIprocMarkerCoordinates();
       for(unsigned k = 0; k < _dim; k++) {
 	xMinLocal[k] = (x[k] < xMinLocal[k]) ? x[k] : xMinLocal[k];
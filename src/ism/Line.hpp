@@ -24,6 +24,7 @@
 #include "ParallelObject.hpp"
 #include "Mesh.hpp"
 #include "Marker.hpp"
+#include "ParticleArrays.hpp"
 
 #include "vector"
 #include "map"
@@ -49,26 +50,50 @@ namespace femus
 
       typedef void (*ForceFunction)(const std::vector <double>& xMarker, std::vector <double>& Fm, const unsigned& material);
 
+      /** Get the coordinates of all the markers, ordered by id and closed by the first one.
+       * The markers are gathered from all the processes at the first request after they moved, so it is collective */
       void GetLine(std::vector < std::vector < double > >& line) {
+        if(_lineIsOutdated) GatherLine();
         line = _line;
       }
-      
 
+      /** Store the coordinates of all the markers as the point step of their streamlines, collective as GetLine */
       void GetStreamLine(std::vector < std::vector < std::vector < double > > >& line, const unsigned& step) {
+        if(_lineIsOutdated) GatherLine();
         for(unsigned i = 0; i < _size; i++) {
           line[i].resize(step + 1);
           line[i][step] = _line[i];
         }
       }
 
+      /** Global offsets, the markers of the process iproc are the global positions _markerOffset[iproc] ... _markerOffset[iproc + 1] - 1 */
       std::vector <unsigned> GetMarkerOffset() {
         return _markerOffset;
       }
 
+      /** The markers owned by this process, sorted by element */
       std::vector <Marker*> GetParticles() {
         return _particles;
       }
 
+      /** Structure of arrays copy of the local markers inside the domain, sorted by element.
+       * It is rebuilt from the markers, which remain the primary storage, at the first request after Line changed them */
+      ParticleArrays& GetParticleArrays() {
+        if(_arraysAreOutdated) UpdateParticleArrays();
+        return _arrays;
+      }
+
+      /** Rebuild the particle arrays, to be called after changing the markers directly */
+      void UpdateParticleArrays() {
+        _arrays.Build(_particles, _dim);
+        _arraysAreOutdated = false;
+      }
+
+      /** Copy back to the markers the coordinates, the local coordinates and the MPM state changed in the particle arrays */
+      void StoreParticleArrays() {
+        _arrays.Store(_particles);
+      }
+
       void AdvectionParallel(const unsigned& n, const double& T, const unsigned& order, ForceFunction Force = NULL);
 
       void UpdateLine();
@@ -85,15 +110,65 @@ namespace femus
       
       void GetExtrema( std::vector <double>& xMin, std::vector <double>& xMax);
 
+      /** Load imbalance of the last AdvectionParallel, max / mean over the processes of the markers inside the domain, 1 if balanced */
+      double GetParticleImbalance() const {
+        return _particleImbalance;
+      }
+
+      /** Load imbalance of the last AdvectionParallel, max / mean over the processes of the local advection wall time */
+      double GetAdvectionImbalance() const {
+        return _advectionImbalance;
+      }
+
+      /** Print the load imbalance of each AdvectionParallel on the process 0 */
+      void SetLoadBalanceReport(const bool &report) {
+        _loadBalanceReport = report;
+      }
+
+      /** Return true if the load imbalance of the last AdvectionParallel is larger than threshold, e.g. 1.2 */
+      bool NeedsRebalancing(const double &threshold) const {
+        return _particleImbalance > threshold || _advectionImbalance > threshold;
+      }
+
+      /** Get the weights of the coarse mesh elements, 1 + particleWeight * (number of markers inside the element),
+       * in the original order of the coarse mesh, for MultiLevelMesh::SetCoarseElementWeights. Collective */
+      void GetCoarseElementWeights(std::vector < unsigned > &weights, const double &particleWeight = 1.);
+
+      /** Move the markers to the mesh of sol, generated from the same coarse mesh with a different partitioning.
+       * Each marker goes to the process of its coarse element and there continues the element search.
+       * The current mesh must still exist. Collective */
+      void Rebalance(Solution* sol);
+
     private:
+
+      /** Create the markers of this process: each process seeds the element search of a block of markers
+       * with the point location index, then the markers move to the processes owning their elements */
+      void CreateMarkers(const std::vector < std::vector < double > > &x, const std::vector < double > &mass,
+                         const std::vector <MarkerType>& markerType, const unsigned& solType);
+
+      /** Gather in _line the coordinates of the markers of all the processes */
+      void GatherLine();
+
       std::vector < std::vector < double > > _line;
-      std::vector < Marker*> _particles;
+      bool _lineIsOutdated;
+      std::vector < Marker*> _particles; // only the markers owned by this process
       std::vector < unsigned > _markerOffset;
-      std::vector < unsigned > _printList;
+      ParticleArrays _arrays;
+      bool _arraysAreOutdated;
       unsigned _size;
       unsigned _dim;
-      
-      void Reorder(std::vector < Marker*> &particles);
+
+      /** Move the markers to the processes owning their elements, and the markers outside the domain to the process 0.
+       * In each round every process packs its leaving markers in one buffer per destination, sent with MPI_Isend,
+       * and the receivers continue the element search, if seedReceived starting from the seed element of the point location index */
+      void MigrateMarkers(const unsigned& n, const unsigned& order, const bool &seedReceived = false);
+
+      /** Compute, and report if required, the load imbalance of the markers and of the advection time */
+      void ComputeLoadImbalance(const double& advectionTime);
+
+      double _particleImbalance;
+      double _advectionImbalance;
+      bool _loadBalanceReport;
 
       static const double _a[4][4][4];
       static const double _b[4][4];
@@ -174,6 +174,116 @@ namespace femus
     {0.}
   };
 
+  // packed layout: id, type, solType, elem, previousElem, step, MPMSize, then x, x0, xi, K, MPMQuantities and Fp,
+  // each one preceded by its number of entries (K and Fp by their number of rows of size _dim)
+  // all the unsigned fields are exactly representable as doubles
+
+  Marker::Marker(const std::vector < double > &x, const double &mass, const MarkerType &markerType, const unsigned &solType,
+                 const unsigned &initialElem, Solution *sol)
+  {
+
+    _x = x;
+    _markerType = markerType;
+    _solType = solType;
+    _dim = sol->GetMesh()->GetDimension();
+    _step = 0;
+
+    _MPMSize = 3 * _dim + 1;
+    _id = UINT_MAX;
+    _elem = initialElem;
+    _previousElem = UINT_MAX;
+    _mproc = _iproc;
+
+    _MPMQuantities.assign(_MPMSize, 0.);
+    _MPMQuantities[3 * _dim] = mass;
+
+    // the deformation gradient starts from the identity matrix
+    _Fp.resize(_dim);
+    for(unsigned i = 0; i < _dim; i++) {
+      _Fp[i].assign(_dim, 0.);
+      _Fp[i][i] = 1.;
+    }
+  }
+
+  void Marker::Pack(std::vector < double > &buffer)
+  {
+
+    buffer.push_back(_id);
+    buffer.push_back(_markerType);
+    buffer.push_back(_solType);
+    buffer.push_back(_elem);
+    buffer.push_back(_previousElem);
+    buffer.push_back(_step);
+    buffer.push_back(_MPMSize);
+
+    buffer.push_back(_x.size());
+    buffer.insert(buffer.end(), _x.begin(), _x.end());
+
+    buffer.push_back(_x0.size());
+    buffer.insert(buffer.end(), _x0.begin(), _x0.end());
+
+    buffer.push_back(_xi.size());
+    buffer.insert(buffer.end(), _xi.begin(), _xi.end());
+
+    buffer.push_back(_K.size());
+    for(unsigned j = 0; j < _K.size(); j++) {
+      buffer.insert(buffer.end(), _K[j].begin(), _K[j].end());
+    }
+
+    buffer.push_back(_MPMQuantities.size());
+    buffer.insert(buffer.end(), _MPMQuantities.begin(), _MPMQuantities.end());
+
+    buffer.push_back(_Fp.size());
+    for(unsigned i = 0; i < _Fp.size(); i++) {
+      buffer.insert(buffer.end(), _Fp[i].begin(), _Fp[i].end());
+    }
+  }
+
+  Marker::Marker(const double * &buffer, Solution* sol)
+  {
+
+    _dim = sol->GetMesh()->GetDimension();
+
+    _id = static_cast < unsigned >(*buffer++);
+    _markerType = static_cast < MarkerType >(static_cast < int >(*buffer++));
+    _solType = static_cast < unsigned >(*buffer++);
+    _elem = static_cast < unsigned >(*buffer++);
+    _previousElem = static_cast < unsigned >(*buffer++);
+    _step = static_cast < unsigned >(*buffer++);
+    _MPMSize = static_cast < unsigned >(*buffer++);
+    _mproc = _iproc;
+
+    unsigned size = static_cast < unsigned >(*buffer++);
+    _x.assign(buffer, buffer + size);
+    buffer += size;
+
+    size = static_cast < unsigned >(*buffer++);
+    _x0.assign(buffer, buffer + size);
+    buffer += size;
+
+    size = static_cast < unsigned >(*buffer++);
+    _xi.assign(buffer, buffer + size);
+    buffer += size;
+
+    size = static_cast < unsigned >(*buffer++);
+    _K.resize(size);
+    for(unsigned j = 0; j < size; j++) {
+      _K[j].assign(buffer, buffer + _dim);
+      buffer += _dim;
+    }
+
+    size = static_cast < unsigned >(*buffer++);
+    _MPMQuantities.assign(buffer, buffer + size);
+    buffer += size;
+
+    size = static_cast < unsigned >(*buffer++);
+    _Fp.resize(size);
+    for(unsigned i = 0; i < size; i++) {
+      _Fp[i].assign(buffer, buffer + _dim);
+      buffer += _dim;
+    }
+  }
+
   void Marker::GetElement(const bool &useInitialSearch, const unsigned &initialElem, Solution* sol, const double &s)
   {
 
@@ -184,13 +294,29 @@ namespace femus
     unsigned ielProc = (initialElem < sol->GetMesh()->_elementOffset[_nprocs]) ?
                        sol->GetMesh()->IsdomBisectionSearch(iel, 3) : _nprocs;
 
+    // the point location index is built at the first call by all the processes
+    // it refers to the mesh coordinates, with a moving mesh it gives only the seed
+    const ElementSearchGrid* searchGrid = sol->GetMesh()->GetElementSearchGrid();
+    bool searchThisProcess = true;
+
     if (useInitialSearch || _iproc != ielProc) {
 
+      //BEGIN index search
+
+      if (!sol->GetIfFSI() && !searchGrid->IsInsideProcessBox(_x, _iproc)) {
+        searchThisProcess = false;
+      }
+
+      iel = searchGrid->GetSeedElement(_x);
+      //END index search
+
+    }
+
+    if (searchThisProcess && iel == UINT_MAX) {
+
       //BEGIN SMART search
       // look to the closest element among a restricted list
 
-      iel = UINT_MAX;
-
       double modulus = 1.e10;
 
       for (int jel = sol->GetMesh()->_elementOffset[_iproc]; jel < sol->GetMesh()->_elementOffset[_iproc + 1]; jel += 25) {
@@ -234,6 +360,11 @@ namespace femus
     previousElem[_iproc] = iel;
     unsigned nextProc = _iproc;
 
+    if (!searchThisProcess || iel == UINT_MAX) { // the point is not in the elements of this process
+      pointIsOutsideTheDomain = true;
+      processorMarkerFlag[_iproc] = 0;
+    }
+
     while (!elementHasBeenFound) {
 
       //BEGIN next element search
@@ -2026,29 +2157,26 @@ namespace femus
     }
 
 
-    std::vector < std::vector < std::vector < double > > > aXs;
-    if (sol->GetIfFSI()) {
-      InterpolatePolynomialCoefficients(aXs, aX[0], aX[1], s);
+    ElementInverseMapping inverseMapping;
+    if (!sol->GetIfFSI()) {
+      inverseMapping.SetCoefficients(aX[0][solType], elemType, solType);
+    }
+    else {
+      inverseMapping.SetCoefficients(aX[0][solType], aX[1][solType], s, elemType, solType);
     }
 
 
-    //BEGIN Inverse mapping loop
-    for (unsigned j = 0; j < solType; j++) {
-
-      std::vector < double > phi;
-      std::vector < std::vector < double > > gradPhi;
-      bool convergence = false;
-      while (!convergence) {
-        GetPolynomialShapeFunctionGradient(phi, gradPhi, _xi, elemType, solType);
-        if (!sol->GetIfFSI()) {
-          convergence = GetNewLocalCoordinates(_xi, _x, phi, gradPhi, aX[0][solType]);
-        }
-        else {
-          convergence = GetNewLocalCoordinates(_xi, _x, phi, gradPhi, aXs[solType]);
-        }
+    //BEGIN Inverse mapping, restarted from the center of the element if the Newton iteration does not converge
+    if (solType > 0 && !inverseMapping.GetLocalCoordinates(&_x[0], &_xi[0])) {
+      for (unsigned k = 0; k < _dim; k++) {
+        _xi[k] = _localCentralNode[elemType][k];
+      }
+      if (!inverseMapping.GetLocalCoordinates(&_x[0], &_xi[0])) {
+        std::cout << "Warning in Marker::FindLocalCoordinates(): the inverse mapping of the marker " << _id
+                  << " in the element " << _elem << " did not converge" << std::endl;
       }
     }
-    //END Inverse mapping loop
+    //END Inverse mapping
 
 
 //    std::cout << "ED USCIAMO" << std::endl;
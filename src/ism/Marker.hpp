@@ -29,6 +29,9 @@
 namespace femus {
 
   class Marker : public ParallelObject {
+
+      friend class ParticleArrays;
+
     public:
       Marker(std::vector < double > x, const double &mass, const MarkerType &markerType, Solution *sol, const unsigned & solType, const bool &debug = false) {
         double s1 = 0.;
@@ -39,6 +42,8 @@ namespace femus {
         _step = 0;
 
         _MPMSize = 3 * _dim + 1; //removed density
+        _id = UINT_MAX;
+        _previousElem = UINT_MAX;
         GetElement(1, UINT_MAX, sol, s1);
 
         if(_iproc == _mproc) {
@@ -75,6 +80,26 @@ namespace femus {
         }
       };
 
+      /** Create on this process the marker at x, starting the element search from initialElem (UINT_MAX outside the domain),
+       * no communication is involved. The search is then continued with GetElementSerial and the local coordinates found with FindLocalCoordinates */
+      Marker(const std::vector < double > &x, const double &mass, const MarkerType &markerType, const unsigned &solType,
+             const unsigned &initialElem, Solution *sol);
+
+      /** Rebuild on this process a marker packed by Pack() on another process, no communication is involved */
+      Marker(const double * &buffer, Solution *sol);
+
+      /** Append to buffer the state of the marker owned by this process, to be moved to another process */
+      void Pack(std::vector < double > &buffer);
+
+      /** Set the global index of the marker, its position in the input list */
+      void SetMarkerId(const unsigned &id) {
+        _id = id;
+      }
+
+      unsigned GetMarkerId() {
+        return _id;
+      }
+
       double GetCoordinates(Solution *sol, const unsigned &k, const unsigned &i , const double &s) {
         if(!sol->GetIfFSI()) {
           return (*sol->GetMesh()->_topology->_Sol[k])(i);
@@ -382,6 +407,7 @@ namespace femus {
       unsigned _elem;
       unsigned _previousElem; //for advection reasons
       unsigned _dim;
+      unsigned _id; //global index of the marker
 
       unsigned _mproc; //processor who has the marker
       std::vector < std::vector < double > > _K;
@@ -0,0 +1,126 @@
+/*=========================================================================
+
+ Program: FEMUS
+ Module: ParticleArrays
+ Authors: Eugenio Aulisa
+
+ Copyright (c) FEMTTU
+ All rights reserved.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+//----------------------------------------------------------------------------
+// includes :
+//----------------------------------------------------------------------------
+#include "ParticleArrays.hpp"
+#include "Marker.hpp"
+
+#include <climits>
+
+namespace femus {
+
+  // ********************************************
+
+  void ParticleArrays::Build(const std::vector < Marker* > &particles, const unsigned &dim) {
+
+    _dim = dim;
+
+    _markerIndex.resize(0);
+    _markerIndex.reserve(particles.size());
+    for(unsigned j = 0; j < particles.size(); j++) {
+      if(particles[j]->_elem != UINT_MAX) {
+        _markerIndex.push_back(j);
+      }
+    }
+    _size = _markerIndex.size();
+
+    _bucketElement.resize(0);
+    _bucketOffset.assign(1, 0);
+
+    _x.resize(_dim * _size);
+    _xi.assign(_dim * _size, 0.);
+    _mass.assign(_size, 0.);
+    _displacement.assign(_dim * _size, 0.);
+    _velocity.assign(_dim * _size, 0.);
+    _acceleration.assign(_dim * _size, 0.);
+    _Fp.assign(_dim * _dim * _size, 0.);
+
+    for(unsigned i = 0; i < _size; i++) {
+      const Marker *marker = particles[_markerIndex[i]];
+
+      if(_bucketElement.size() == 0 || marker->_elem != _bucketElement.back()) {
+        if(_bucketElement.size() > 0) _bucketOffset.push_back(i);
+        _bucketElement.push_back(marker->_elem);
+      }
+
+      for(unsigned k = 0; k < _dim; k++) {
+        _x[k * _size + i] = marker->_x[k];
+      }
+
+      if(marker->_xi.size() == _dim) {
+        for(unsigned k = 0; k < _dim; k++) {
+          _xi[k * _size + i] = marker->_xi[k];
+        }
+      }
+
+      // _MPMQuantities = displacement, velocity, acceleration, mass
+      if(marker->_MPMQuantities.size() > 3 * _dim) {
+        const std::vector < double > &MPM = marker->_MPMQuantities;
+        for(unsigned k = 0; k < _dim; k++) {
+          _displacement[k * _size + i] = MPM[k];
+          _velocity[k * _size + i] = MPM[_dim + k];
+          _acceleration[k * _size + i] = MPM[2 * _dim + k];
+        }
+        _mass[i] = MPM[3 * _dim];
+      }
+
+      if(marker->_Fp.size() == _dim) {
+        for(unsigned k = 0; k < _dim; k++) {
+          for(unsigned l = 0; l < _dim; l++) {
+            _Fp[(k * _dim + l) * _size + i] = marker->_Fp[k][l];
+          }
+        }
+      }
+    }
+
+    if(_size > 0) _bucketOffset.push_back(_size);
+  }
+
+  // ********************************************
+
+  void ParticleArrays::Store(const std::vector < Marker* > &particles) const {
+
+    for(unsigned i = 0; i < _size; i++) {
+      Marker *marker = particles[_markerIndex[i]];
+
+      marker->_xi.resize(_dim);
+      for(unsigned k = 0; k < _dim; k++) {
+        marker->_x[k] = _x[k * _size + i];
+        marker->_xi[k] = _xi[k * _size + i];
+      }
+
+      if(marker->_MPMQuantities.size() > 3 * _dim) {
+        std::vector < double > &MPM = marker->_MPMQuantities;
+        for(unsigned k = 0; k < _dim; k++) {
+          MPM[k] = _displacement[k * _size + i];
+          MPM[_dim + k] = _velocity[k * _size + i];
+          MPM[2 * _dim + k] = _acceleration[k * _size + i];
+        }
+        MPM[3 * _dim] = _mass[i];
+      }
+
+      if(marker->_Fp.size() == _dim) {
+        for(unsigned k = 0; k < _dim; k++) {
+          for(unsigned l = 0; l < _dim; l++) {
+            marker->_Fp[k][l] = _Fp[(k * _dim + l) * _size + i];
+          }
+        }
+      }
+    }
+  }
+
+} //end namespace femus
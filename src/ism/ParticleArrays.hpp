@@ -0,0 +1,129 @@
+/*=========================================================================
+
+ Program: FEMUS
+ Module: ParticleArrays
+ Authors: Eugenio Aulisa
+
+ Copyright (c) FEMTTU
+ All rights reserved.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+#ifndef __femus_ism_ParticleArrays_hpp__
+#define __femus_ism_ParticleArrays_hpp__
+
+//----------------------------------------------------------------------------
+// includes :
+//----------------------------------------------------------------------------
+#include <vector>
+
+namespace femus {
+
+  class Marker;
+
+  /**
+   * Structure of arrays copy of the state of the markers of a process inside the domain, sorted by element.
+   * The markers keep owning their state: Build gathers it from them and Store scatters it back, so each use of the arrays
+   * pays one copy of the particles in each direction, and the per-marker vectors are not replaced.
+   * Each attribute is a contiguous array and the vector attributes are stored by component,
+   * e.g. the coordinate k of the particle i is GetCoordinates(k)[i], so that the particle loops stream through memory.
+   * The particles of the same element form a bucket, bucket ib collects the particles
+   * GetBucketBegin(ib) ... GetBucketEnd(ib) - 1 of the element GetBucketElement(ib).
+   * The particle i is the marker particles[GetMarkerIndex(i)] of the list it was built from.
+   */
+  class ParticleArrays {
+
+    public:
+
+      ParticleArrays() : _dim(0), _size(0) {};
+
+      /** Copy the state of the markers, that have to be sorted by element, the markers outside the domain are skipped */
+      void Build(const std::vector < Marker* > &particles, const unsigned &dim);
+
+      /** Copy back to the markers the coordinates, the local coordinates and the MPM state: displacement, velocity, acceleration, mass and deformation gradient */
+      void Store(const std::vector < Marker* > &particles) const;
+
+      /** Get the number of particles */
+      unsigned size() const {
+        return _size;
+      }
+
+      unsigned GetDimension() const {
+        return _dim;
+      }
+
+      /** Get the number of buckets, i.e. of elements with at least one particle */
+      unsigned GetNumberOfBuckets() const {
+        return _bucketElement.size();
+      }
+
+      unsigned GetBucketElement(const unsigned &ib) const {
+        return _bucketElement[ib];
+      }
+
+      unsigned GetBucketBegin(const unsigned &ib) const {
+        return _bucketOffset[ib];
+      }
+
+      unsigned GetBucketEnd(const unsigned &ib) const {
+        return _bucketOffset[ib + 1];
+      }
+
+      unsigned GetMarkerIndex(const unsigned &i) const {
+        return _markerIndex[i];
+      }
+
+      double* GetCoordinates(const unsigned &k) {
+        return _x.data() + k * _size;
+      }
+
+      double* GetLocalCoordinates(const unsigned &k) {
+        return _xi.data() + k * _size;
+      }
+
+      double* GetMass() {
+        return _mass.data();
+      }
+
+      double* GetDisplacement(const unsigned &k) {
+        return _displacement.data() + k * _size;
+      }
+
+      double* GetVelocity(const unsigned &k) {
+        return _velocity.data() + k * _size;
+      }
+
+      double* GetAcceleration(const unsigned &k) {
+        return _acceleration.data() + k * _size;
+      }
+
+      /** Get the entry (k, l) of the deformation gradient of all the particles */
+      double* GetDeformationGradient(const unsigned &k, const unsigned &l) {
+        return _Fp.data() + (k * _dim + l) * _size;
+      }
+
+    private:
+
+      unsigned _dim;
+      unsigned _size;
+
+      std::vector < unsigned > _markerIndex;
+      std::vector < unsigned > _bucketElement;
+      std::vector < unsigned > _bucketOffset;
+
+      std::vector < double > _x;
+      std::vector < double > _xi;
+      std::vector < double > _mass;
+      std::vector < double > _displacement;
+      std::vector < double > _velocity;
+      std::vector < double > _acceleration;
+      std::vector < double > _Fp;
+  };
+
+} //end namespace femus
+
+#endif
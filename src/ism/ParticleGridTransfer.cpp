@@ -0,0 +1,192 @@
+/*=========================================================================
+
+ Program: FEMUS
+ Module: ParticleGridTransfer
+ Authors: Eugenio Aulisa
+
+ Copyright (c) FEMTTU
+ All rights reserved.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+//----------------------------------------------------------------------------
+// includes :
+//----------------------------------------------------------------------------
+#include "ParticleGridTransfer.hpp"
+#include "ParticleArrays.hpp"
+#include "Solution.hpp"
+#include "Mesh.hpp"
+#include "NumericVector.hpp"
+#include "LinearEquation.hpp"
+
+#include <iostream>
+#include <cstdlib>
+
+namespace femus {
+
+  // ********************************************
+
+  ParticleGridTransfer::ParticleGridTransfer(Solution *sol, const unsigned &solType) :
+    _sol(sol),
+    _msh(sol->GetMesh()),
+    _solType(solType),
+    _nDofs(0) {
+
+    if(solType > 2) {
+      std::cout << "Error in ParticleGridTransfer: only the Lagrange families 0, 1 and 2 can be transferred" << std::endl;
+      abort();
+    }
+
+    _dim = _msh->GetDimension();
+  }
+
+  // ********************************************
+
+  void ParticleGridTransfer::EvaluateBucket(ParticleArrays &arrays, const unsigned &ib) {
+
+    unsigned iel = arrays.GetBucketElement(ib);
+    unsigned begin = arrays.GetBucketBegin(ib);
+    unsigned end = arrays.GetBucketEnd(ib);
+
+    const basis *pt_basis = _msh->_finiteElement[_msh->GetElementType(iel)][_solType]->GetBasis();
+    _nDofs = _msh->GetElementDofNumber(iel, _solType);
+
+    _dofs.resize(_nDofs);
+    for(unsigned a = 0; a < _nDofs; a++) {
+      _dofs[a] = _msh->GetSolutionDof(a, iel, _solType);
+    }
+
+    const double *xi[3];
+    for(unsigned k = 0; k < _dim; k++) {
+      xi[k] = arrays.GetLocalCoordinates(k);
+    }
+
+    _phi.resize((end - begin) * _nDofs);
+    double xii[3];
+    for(unsigned i = begin; i < end; i++) {
+      for(unsigned k = 0; k < _dim; k++) {
+        xii[k] = xi[k][i];
+      }
+      double *phi = &_phi[(i - begin) * _nDofs];
+      for(unsigned a = 0; a < _nDofs; a++) {
+        phi[a] = pt_basis->eval_phi(pt_basis->GetIND(a), xii);
+      }
+    }
+  }
+
+  // ********************************************
+
+  void ParticleGridTransfer::CheckSolutionType(const std::vector < unsigned > &solIndex, const char function[]) const {
+    for(unsigned c = 0; c < solIndex.size(); c++) {
+      if(_sol->GetSolutionType(solIndex[c]) != _solType) {
+        std::cout << "Error in ParticleGridTransfer::" << function << "(): the solution " << solIndex[c] << " is not of type " << _solType << std::endl;
+        abort();
+      }
+    }
+  }
+
+  // ********************************************
+
+  void ParticleGridTransfer::ScatterBucket(ParticleArrays &arrays, const unsigned &ib, const double *q) {
+
+    unsigned begin = arrays.GetBucketBegin(ib);
+    unsigned end = arrays.GetBucketEnd(ib);
+
+    _local.assign(_nDofs, 0.);
+    for(unsigned i = begin; i < end; i++) {
+      const double *phi = &_phi[(i - begin) * _nDofs];
+      for(unsigned a = 0; a < _nDofs; a++) {
+        _local[a] += phi[a] * q[i];
+      }
+    }
+  }
+
+  // ********************************************
+
+  void ParticleGridTransfer::ParticleToGrid(ParticleArrays &arrays, const std::vector < const double* > &q,
+                                            const std::vector < unsigned > &solIndex, const bool &zero) {
+
+    CheckSolutionType(solIndex, "ParticleToGrid");
+
+    if(zero) {
+      for(unsigned c = 0; c < solIndex.size(); c++) {
+        _sol->_Sol[solIndex[c]]->zero();
+      }
+    }
+
+    for(unsigned ib = 0; ib < arrays.GetNumberOfBuckets(); ib++) {
+      EvaluateBucket(arrays, ib);
+
+      for(unsigned c = 0; c < solIndex.size(); c++) {
+        ScatterBucket(arrays, ib, q[c]);
+        _sol->_Sol[solIndex[c]]->add_vector_blocked(_local, _dofs);
+      }
+    }
+
+    for(unsigned c = 0; c < solIndex.size(); c++) {
+      _sol->_Sol[solIndex[c]]->close();
+    }
+  }
+
+  // ********************************************
+
+  void ParticleGridTransfer::ParticleToGrid(ParticleArrays &arrays, const std::vector < const double* > &q,
+                                            const std::vector < unsigned > &solIndex, const std::vector < unsigned > &solPdeIndex,
+                                            LinearEquation *pdeSys, NumericVector *RES) {
+
+    CheckSolutionType(solIndex, "ParticleToGrid");
+
+    for(unsigned ib = 0; ib < arrays.GetNumberOfBuckets(); ib++) {
+      EvaluateBucket(arrays, ib);
+      unsigned iel = arrays.GetBucketElement(ib);
+
+      for(unsigned c = 0; c < solIndex.size(); c++) {
+        ScatterBucket(arrays, ib, q[c]);
+
+        _sysDofs.resize(_nDofs);
+        for(unsigned a = 0; a < _nDofs; a++) {
+          _sysDofs[a] = pdeSys->GetSystemDof(solIndex[c], solPdeIndex[c], a, iel);
+        }
+        RES->add_vector_blocked(_local, _sysDofs);
+      }
+    }
+  }
+
+  // ********************************************
+
+  void ParticleGridTransfer::GridToParticle(ParticleArrays &arrays, const std::vector < unsigned > &solIndex,
+                                            const std::vector < double* > &q, const bool &increment) {
+
+    CheckSolutionType(solIndex, "GridToParticle");
+
+    for(unsigned ib = 0; ib < arrays.GetNumberOfBuckets(); ib++) {
+      EvaluateBucket(arrays, ib);
+
+      unsigned begin = arrays.GetBucketBegin(ib);
+      unsigned end = arrays.GetBucketEnd(ib);
+
+      for(unsigned c = 0; c < solIndex.size(); c++) {
+        _local.resize(_nDofs);
+        for(unsigned a = 0; a < _nDofs; a++) {
+          _local[a] = (*_sol->_Sol[solIndex[c]])(_dofs[a]);
+          if(increment) _local[a] -= (*_sol->_SolOld[solIndex[c]])(_dofs[a]);
+        }
+
+        double *qc = q[c];
+        for(unsigned i = begin; i < end; i++) {
+          const double *phi = &_phi[(i - begin) * _nDofs];
+          double value = 0.;
+          for(unsigned a = 0; a < _nDofs; a++) {
+            value += phi[a] * _local[a];
+          }
+          qc[i] = value;
+        }
+      }
+    }
+  }
+
+} //end namespace femus
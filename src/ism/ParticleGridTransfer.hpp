@@ -0,0 +1,88 @@
+/*=========================================================================
+
+ Program: FEMUS
+ Module: ParticleGridTransfer
+ Authors: Eugenio Aulisa
+
+ Copyright (c) FEMTTU
+ All rights reserved.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+#ifndef __femus_ism_ParticleGridTransfer_hpp__
+#define __femus_ism_ParticleGridTransfer_hpp__
+
+//----------------------------------------------------------------------------
+// includes :
+//----------------------------------------------------------------------------
+#include <vector>
+
+namespace femus {
+
+  class Solution;
+  class Mesh;
+  class ParticleArrays;
+  class LinearEquation;
+  class NumericVector;
+
+  /**
+   * Particle to grid and grid to particle transfer of nodal Lagrange fields, on the particle arrays of a Line.
+   * The particles are processed by element bucket: the dofs of the element are gathered once, the shape functions are
+   * evaluated at all the particles of the bucket, and the element contributions are added with one blocked insertion.
+   * The particle quantities are arrays indexed as the particles of the ParticleArrays, e.g. arrays.GetMass().
+   */
+  class ParticleGridTransfer {
+
+    public:
+
+      /** Constructor, for the solutions of sol of the Lagrange family solType (0, 1 or 2) */
+      ParticleGridTransfer(Solution *sol, const unsigned &solType);
+
+      /** Add to the solution solIndex[c] the particle quantity q[c] distributed with the shape functions,
+       * U_a += sum_i phi_a(xi_i) q[c][i], e.g. the mass or the momentum. If zero the solutions are first set to zero.
+       * The solutions are closed */
+      void ParticleToGrid(ParticleArrays &arrays, const std::vector < const double* > &q, const std::vector < unsigned > &solIndex,
+                          const bool &zero = true);
+
+      /** Add to RES, at the system dofs of the unknown solPdeIndex[c] (solution solIndex[c]) of pdeSys, the particle quantity q[c]
+       * distributed with the shape functions, R_a += sum_i phi_a(xi_i) q[c][i], e.g. the inertia load of a residual.
+       * RES is not closed */
+      void ParticleToGrid(ParticleArrays &arrays, const std::vector < const double* > &q, const std::vector < unsigned > &solIndex,
+                          const std::vector < unsigned > &solPdeIndex, LinearEquation *pdeSys, NumericVector *RES);
+
+      /** Interpolate the solution solIndex[c] at the particles, q[c][i] = sum_a phi_a(xi_i) U_a,
+       * or, if increment, its increment over the time step, U_a = _Sol - _SolOld */
+      void GridToParticle(ParticleArrays &arrays, const std::vector < unsigned > &solIndex, const std::vector < double* > &q,
+                          const bool &increment = false);
+
+    private:
+
+      /** Gather the dofs of the element of the bucket ib and evaluate the shape functions at its particles */
+      void EvaluateBucket(ParticleArrays &arrays, const unsigned &ib);
+
+      /** Sum in _local the particle quantity q distributed with the shape functions of the current bucket */
+      void ScatterBucket(ParticleArrays &arrays, const unsigned &ib, const double *q);
+
+      /** Check that the solutions solIndex are of the transfer family */
+      void CheckSolutionType(const std::vector < unsigned > &solIndex, const char function[]) const;
+
+      Solution *_sol;
+      Mesh *_msh;
+      unsigned _solType;
+      unsigned _dim;
+
+      // current bucket, _phi[(i - begin) * _nDofs + a]
+      unsigned _nDofs;
+      std::vector < int > _dofs;
+      std::vector < int > _sysDofs;
+      std::vector < double > _phi;
+      std::vector < double > _local;
+  };
+
+} //end namespace femus
+
+#endif
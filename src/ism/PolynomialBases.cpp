@@ -137,6 +137,17 @@ namespace femus {
   }
 //END Interface
 
+  // copy the flat basis and gradient of the fixed size kernels to the vectors of the Get*PolynomialShapeFunctionGradient interface
+  static void CopyFlatShapeFunctionGradient(const double *phiF, const double *gradPhiF, const unsigned &nDofs, const unsigned &dim,
+      std::vector < double >& phi, std::vector < std::vector < double > >& gradPhi) {
+
+    phi.assign(phiF, phiF + nDofs);
+    gradPhi.resize(nDofs);
+    for(unsigned i = 0; i < nDofs; i++) {
+      gradPhi[i].assign(gradPhiF + i * dim, gradPhiF + (i + 1) * dim);
+    }
+  }
+
 //BEGIN QUAD specialized functions
   const unsigned quadNumberOfDofs[3] = {4, 8, 9};
 
@@ -219,47 +230,79 @@ namespace femus {
 
   }
 
-  void GetQuadPolynomialShapeFunctionGradient(std::vector < double >& phi, std::vector < std::vector < double > >& gradPhi,
-      const std::vector < double >& xi, const unsigned & solType) {
-
-    GetQuadPolynomialShapeFunction(phi,  xi, solType);
+  // flat fixed size evaluation of the QUAD basis and of its gradient, gradPhi[i * 2 + k] = d phi_i / d xi_k
+  template < unsigned solType >
+  void QuadPolynomialShapeFunctionGradient(double *phi, double *gradPhi, const double *xi) {
 
     const unsigned dim = 2;
 
     const unsigned nDofs = quadNumberOfDofs[solType];
 
-    gradPhi.resize(nDofs);
+    for(unsigned i = 0; i < nDofs * dim; i++) {
+      gradPhi[i] = 0.;
+    }
 
-    for(int i = 0; i < nDofs; i++) {
-      gradPhi[i].assign(dim, 0.);
+    phi[0] = 1.;
+    phi[1] = xi[0]; // x
+    phi[2] = xi[1];  // y
+    phi[3] = xi[0] * xi[1];  // x y
+
+    if(solType > 0) {
+      phi[4] = xi[0] * xi[0]; // x x
+      phi[5] = xi[1] * xi[1]; // y y
+      phi[6] = phi[4] * xi[1]; // xx y
+      phi[7] = phi[5] * xi[0]; // x yy
+
+      if(solType > 1) {
+        phi[8] = phi[3] * phi[3]; // xx yy
+      }
     }
 
     //phi_x
-    gradPhi[1][0] = 1.; // 1
-    gradPhi[3][0] = xi[1];  //  y
+    gradPhi[1 * dim + 0] = 1.; // 1
+    gradPhi[3 * dim + 0] = xi[1];  //  y
     //phi_y
-    gradPhi[2][1] = 1.;  // 1
-    gradPhi[3][1] = xi[0];  // x
+    gradPhi[2 * dim + 1] = 1.;  // 1
+    gradPhi[3 * dim + 1] = xi[0];  // x
 
     if(solType > 0) {
       //phi_x
-      gradPhi[4][0] = 2. * xi[0]; // 2 x
-      gradPhi[6][0] = 2. * phi[3]; // 2 x y
-      gradPhi[7][0] = phi[5]; //  yy
+      gradPhi[4 * dim + 0] = 2. * xi[0]; // 2 x
+      gradPhi[6 * dim + 0] = 2. * phi[3]; // 2 x y
+      gradPhi[7 * dim + 0] = phi[5]; //  yy
       //phi_y
-      gradPhi[5][1] = 2. * xi[1]; // 2 y
-      gradPhi[6][1] = phi[4]; // xx
-      gradPhi[7][1] = 2. * phi[3]; // 2 x y
+      gradPhi[5 * dim + 1] = 2. * xi[1]; // 2 y
+      gradPhi[6 * dim + 1] = phi[4]; // xx
+      gradPhi[7 * dim + 1] = 2. * phi[3]; // 2 x y
 
       if(solType > 1) {
         //phi_x
-        gradPhi[8][0] = 2. * phi[7]; // 2 x yy
+        gradPhi[8 * dim + 0] = 2. * phi[7]; // 2 x yy
         //phi_y
-        gradPhi[8][1] = 2. * phi[6]; // 2 xx y
+        gradPhi[8 * dim + 1] = 2. * phi[6]; // 2 xx y
       }
     }
   }
 
+  void GetQuadPolynomialShapeFunctionGradient(std::vector < double >& phi, std::vector < std::vector < double > >& gradPhi,
+      const std::vector < double >& xi, const unsigned & solType) {
+
+    double phiF[9];
+    double gradPhiF[9 * 2];
+
+    if(solType == 0) {
+      QuadPolynomialShapeFunctionGradient < 0 > (phiF, gradPhiF, &xi[0]);
+    }
+    else if(solType == 1) {
+      QuadPolynomialShapeFunctionGradient < 1 > (phiF, gradPhiF, &xi[0]);
+    }
+    else {
+      QuadPolynomialShapeFunctionGradient < 2 > (phiF, gradPhiF, &xi[0]);
+    }
+
+    CopyFlatShapeFunctionGradient(phiF, gradPhiF, quadNumberOfDofs[solType], 2, phi, gradPhi);
+  }
+
   void GetQuadPolynomialShapeFunctionGradientHessian(std::vector < double >& phi, std::vector < std::vector < double > >& gradPhi,
       std::vector < std::vector < std::vector < double > > >& hessPhi, const std::vector < double >& xi, const unsigned & solType) {
 
@@ -377,44 +420,74 @@ namespace femus {
 
   }
 
-  void GetTriPolynomialShapeFunctionGradient(std::vector < double >& phi, std::vector < std::vector < double > >& gradPhi,
-      const std::vector < double >& xi, const unsigned & solType) {
-
-    GetTriPolynomialShapeFunction(phi,  xi, solType);
+  // flat fixed size evaluation of the TRI basis and of its gradient, gradPhi[i * 2 + k] = d phi_i / d xi_k
+  template < unsigned solType >
+  void TriPolynomialShapeFunctionGradient(double *phi, double *gradPhi, const double *xi) {
 
     const unsigned dim = 2;
 
     const unsigned nDofs = triNumberOfDofs[solType];
 
-    gradPhi.resize(nDofs);
+    for(unsigned i = 0; i < nDofs * dim; i++) {
+      gradPhi[i] = 0.;
+    }
 
-    for(int i = 0; i < nDofs; i++) {
-      gradPhi[i].assign(dim, 0.);
+    phi[0] = 1.;
+    phi[1] = xi[0]; // x
+    phi[2] = xi[1]; // y
+
+    if(solType > 0) {
+      phi[3] = xi[0] * xi[1]; // x y
+      phi[4] = xi[0] * xi[0];  // x x
+      phi[5] = xi[1] * xi[1]; // y y
+
+      if(solType > 1) {
+        phi[6] = phi[4] * xi[1] + phi[5] * xi[0]; // xx y + x yy
+      }
     }
 
     //phi_x
-    gradPhi[1][0] = 1.; // 1
+    gradPhi[1 * dim + 0] = 1.; // 1
     //phi_y
-    gradPhi[2][1] = 1.;  // 1
+    gradPhi[2 * dim + 1] = 1.;  // 1
 
     if(solType > 0) {
       //phi_x
-      gradPhi[3][0] = xi[1]; // y
-      gradPhi[4][0] = 2.*xi[0] ;  // 2 x
+      gradPhi[3 * dim + 0] = xi[1]; // y
+      gradPhi[4 * dim + 0] = 2.*xi[0] ;  // 2 x
       //phi_y
-      gradPhi[3][1] = xi[0]; // x
-      gradPhi[5][1] = 2.*xi[1]; // 2*y
+      gradPhi[3 * dim + 1] = xi[0]; // x
+      gradPhi[5 * dim + 1] = 2.*xi[1]; // 2*y
 
 
       if(solType > 1) {
         //phi_x
-        gradPhi[6][0] = gradPhi[4][0] * xi[1] + phi[5]; // 2 x y + y y
+        gradPhi[6 * dim + 0] = gradPhi[4 * dim + 0] * xi[1] + phi[5]; // 2 x y + y y
         //phi_y
-        gradPhi[6][1] = phi[4] + gradPhi[5][1] * xi[0]; // xx  + 2 x y
+        gradPhi[6 * dim + 1] = phi[4] + gradPhi[5 * dim + 1] * xi[0]; // xx  + 2 x y
       }
     }
   }
 
+  void GetTriPolynomialShapeFunctionGradient(std::vector < double >& phi, std::vector < std::vector < double > >& gradPhi,
+      const std::vector < double >& xi, const unsigned & solType) {
+
+    double phiF[7];
+    double gradPhiF[7 * 2];
+
+    if(solType == 0) {
+      TriPolynomialShapeFunctionGradient < 0 > (phiF, gradPhiF, &xi[0]);
+    }
+    else if(solType == 1) {
+      TriPolynomialShapeFunctionGradient < 1 > (phiF, gradPhiF, &xi[0]);
+    }
+    else {
+      TriPolynomialShapeFunctionGradient < 2 > (phiF, gradPhiF, &xi[0]);
+    }
+
+    CopyFlatShapeFunctionGradient(phiF, gradPhiF, triNumberOfDofs[solType], 2, phi, gradPhi);
+  }
+
   void GetTriPolynomialShapeFunctionGradientHessian(std::vector < double >& phi, std::vector < std::vector < double > >& gradPhi,
       std::vector < std::vector < std::vector < double > > >& hessPhi, const std::vector < double >& xi, const unsigned & solType) {
 
@@ -618,100 +691,150 @@ namespace femus {
 
   }
 
-  void GetHexPolynomialShapeFunctionGradient(std::vector < double >& phi, std::vector < std::vector < double > >& gradPhi,
-      const std::vector < double >& xi, const unsigned & solType) {
-
-    GetHexPolynomialShapeFunction(phi,  xi, solType);
+  // flat fixed size evaluation of the HEX basis and of its gradient, gradPhi[i * 3 + k] = d phi_i / d xi_k
+  template < unsigned solType >
+  void HexPolynomialShapeFunctionGradient(double *phi, double *gradPhi, const double *xi) {
 
     const unsigned dim = 3;
 
     const unsigned nDofs = hexNumberOfDofs[solType];
 
-    gradPhi.resize(nDofs);
+    for(unsigned i = 0; i < nDofs * dim; i++) {
+      gradPhi[i] = 0.;
+    }
 
-    for(int i = 0; i < nDofs; i++) {
-      gradPhi[i].assign(dim, 0.);
+    //common for linear, quadratic and biquadratic
+    phi[0] = 1.;
+    phi[1] = xi[0]; // x
+    phi[2] = xi[1]; // y
+    phi[3] = xi[2]; // z
+    phi[4] = phi[1] * phi[2]; // x y
+    phi[5] = phi[1] * phi[3]; // x z
+    phi[6] = phi[2] * phi[3]; // y z
+    if(solType < 1) { //only linear
+      phi[7] = phi[4] * phi[3];  // x y z
+    }
+    else { //only quadratic and biquadratic
+      phi[7] = phi[1] * phi[1];   // x x
+      phi[8] = phi[2] * phi[2];   // y y
+      phi[9] = phi[3] * phi[3];   // z z
+      phi[10] = phi[4] * phi[3];  // x y z
+      phi[11] = phi[7] * phi[2];  // xx y
+      phi[12] = phi[7] * phi[3];  // xx z
+      phi[13] = phi[8] * phi[3];  // yy z
+      phi[14] = phi[1] * phi[8];  // x yy
+      phi[15] = phi[1] * phi[9];  // x zz
+      phi[16] = phi[2] * phi[9];  // y zz
+      phi[17] = phi[11] * phi[3]; // xx y z
+      phi[18] = phi[1] * phi[13]; // x yy z
+      phi[19] = phi[1] * phi[16]; // x y zz
+
+      if(solType > 1) { //only biquadratic
+        phi[20] = phi[7] * phi[8];  // xx yy
+        phi[21] = phi[7] * phi[9];  // xx zz
+        phi[22] = phi[8] * phi[9];  // yy zz
+        phi[23] = phi[11] * phi[9]; // xx y zz
+        phi[24] = phi[7] * phi[13]; // xx yy z
+        phi[25] = phi[14] * phi[9]; // x yy zz
+        phi[26] = phi[20] * phi[9]; // xx yy zz
+      }
     }
 
     //common for linear, quadratic and biquadratic
     //phi_x
-    gradPhi[1][0] = 1.; // 1
-    gradPhi[4][0] = xi[1] ; // y
-    gradPhi[5][0] = xi[2] ; // z
+    gradPhi[1 * dim + 0] = 1.; // 1
+    gradPhi[4 * dim + 0] = xi[1] ; // y
+    gradPhi[5 * dim + 0] = xi[2] ; // z
     //phi_y
-    gradPhi[2][1] = 1.; // 1
-    gradPhi[4][1] = xi[0]; // x
-    gradPhi[6][1] = xi[2]; // z
+    gradPhi[2 * dim + 1] = 1.; // 1
+    gradPhi[4 * dim + 1] = xi[0]; // x
+    gradPhi[6 * dim + 1] = xi[2]; // z
 
     //phi_z
-    gradPhi[3][2] = 1.; // 1
-    gradPhi[5][2] = xi[0]; // x
-    gradPhi[6][2] = xi[1]; // y
+    gradPhi[3 * dim + 2] = 1.; // 1
+    gradPhi[5 * dim + 2] = xi[0]; // x
+    gradPhi[6 * dim + 2] = xi[1]; // y
 
     if(solType < 1) {  //only linear
-      gradPhi[7][0] = phi[6];  // y z
-      gradPhi[7][1] = phi[5];  // x z
-      gradPhi[7][2] = phi[4];  // x y
+      gradPhi[7 * dim + 0] = phi[6];  // y z
+      gradPhi[7 * dim + 1] = phi[5];  // x z
+      gradPhi[7 * dim + 2] = phi[4];  // x y
     }
     else { //only quadratic and biquadratic
       //phi_x
-      gradPhi[7][0] = 2 * xi[0];   // 2 x
-      gradPhi[10][0] = phi[6];  // y z
-      gradPhi[11][0] = 2 * phi[4];  // 2 x y
-      gradPhi[12][0] = 2 * phi[5];  // 2 x z
-      gradPhi[14][0] = phi[8];  // yy
-      gradPhi[15][0] = phi[9];  // zz
-      gradPhi[17][0] = 2 * phi[10]; // 2 x y z
-      gradPhi[18][0] = phi[13]; //  yy z
-      gradPhi[19][0] = phi[16]; // y zz
+      gradPhi[7 * dim + 0] = 2 * xi[0];   // 2 x
+      gradPhi[10 * dim + 0] = phi[6];  // y z
+      gradPhi[11 * dim + 0] = 2 * phi[4];  // 2 x y
+      gradPhi[12 * dim + 0] = 2 * phi[5];  // 2 x z
+      gradPhi[14 * dim + 0] = phi[8];  // yy
+      gradPhi[15 * dim + 0] = phi[9];  // zz
+      gradPhi[17 * dim + 0] = 2 * phi[10]; // 2 x y z
+      gradPhi[18 * dim + 0] = phi[13]; //  yy z
+      gradPhi[19 * dim + 0] = phi[16]; // y zz
       //phi_y
-      gradPhi[8][1] = 2 * xi[1];   // 2 y
-      gradPhi[10][1] = phi[5];  // x z
-      gradPhi[11][1] = phi[7];  // xx
-      gradPhi[13][1] = 2 * phi[6];  // 2 y z
-      gradPhi[14][1] = 2 * phi[4];  // 2 x y
-      gradPhi[16][1] = phi[9];  // zz
-      gradPhi[17][1] = phi[12]; // xx  z
-      gradPhi[18][1] = 2 * phi[10]; // 2 x y z
-      gradPhi[19][1] = phi[15]; // x zz
+      gradPhi[8 * dim + 1] = 2 * xi[1];   // 2 y
+      gradPhi[10 * dim + 1] = phi[5];  // x z
+      gradPhi[11 * dim + 1] = phi[7];  // xx
+      gradPhi[13 * dim + 1] = 2 * phi[6];  // 2 y z
+      gradPhi[14 * dim + 1] = 2 * phi[4];  // 2 x y
+      gradPhi[16 * dim + 1] = phi[9];  // zz
+      gradPhi[17 * dim + 1] = phi[12]; // xx  z
+      gradPhi[18 * dim + 1] = 2 * phi[10]; // 2 x y z
+      gradPhi[19 * dim + 1] = phi[15]; // x zz
       //phi_z
-      gradPhi[9][2] = 2 * xi[2];   // 2 z
-      gradPhi[10][2] = phi[4];  // x y
-      gradPhi[12][2] = phi[7];  // xx
-      gradPhi[13][2] = phi[8];  // yy
-      gradPhi[15][2] = 2 * phi[5];  // 2 x z
-      gradPhi[16][2] = 2 * phi[6];  // 2 y z
-      gradPhi[17][2] = phi[11]; // xx y
-      gradPhi[18][2] = phi[14]; // x yy
-      gradPhi[19][2] = 2 * phi[10]; // 2 x y z
+      gradPhi[9 * dim + 2] = 2 * xi[2];   // 2 z
+      gradPhi[10 * dim + 2] = phi[4];  // x y
+      gradPhi[12 * dim + 2] = phi[7];  // xx
+      gradPhi[13 * dim + 2] = phi[8];  // yy
+      gradPhi[15 * dim + 2] = 2 * phi[5];  // 2 x z
+      gradPhi[16 * dim + 2] = 2 * phi[6];  // 2 y z
+      gradPhi[17 * dim + 2] = phi[11]; // xx y
+      gradPhi[18 * dim + 2] = phi[14]; // x yy
+      gradPhi[19 * dim + 2] = 2 * phi[10]; // 2 x y z
 
       if(solType > 1) { //only biquadratic
         //phi_x
-        gradPhi[20][0] = 2 * phi[14];  // 2 x yy
-        gradPhi[21][0] = 2 * phi[15];  // 2 x zz
-        gradPhi[23][0] = 2 * phi[19]; // 2 x y zz
-        gradPhi[24][0] = 2 * phi[18]; // 2 x yy z
-        gradPhi[25][0] = phi[22]; //  yy zz
-        gradPhi[26][0] = 2 * phi[25]; // 2 x yy zz
+        gradPhi[20 * dim + 0] = 2 * phi[14];  // 2 x yy
+        gradPhi[21 * dim + 0] = 2 * phi[15];  // 2 x zz
+        gradPhi[23 * dim + 0] = 2 * phi[19]; // 2 x y zz
+        gradPhi[24 * dim + 0] = 2 * phi[18]; // 2 x yy z
+        gradPhi[25 * dim + 0] = phi[22]; //  yy zz
+        gradPhi[26 * dim + 0] = 2 * phi[25]; // 2 x yy zz
         //phi_y
-        gradPhi[20][1] = 2 * phi[11];  // 2 xx y
-        gradPhi[22][1] = 2 * phi[16];  // 2 y zz
-        gradPhi[23][1] = phi[21]; // xx zz
-        gradPhi[24][1] = 2 * phi[17]; // 2 xx y z
-        gradPhi[25][1] = 2 * phi[19]; // 2 x y zz
-        gradPhi[26][1] = 2 * phi[23]; // 2 xx y zz
+        gradPhi[20 * dim + 1] = 2 * phi[11];  // 2 xx y
+        gradPhi[22 * dim + 1] = 2 * phi[16];  // 2 y zz
+        gradPhi[23 * dim + 1] = phi[21]; // xx zz
+        gradPhi[24 * dim + 1] = 2 * phi[17]; // 2 xx y z
+        gradPhi[25 * dim + 1] = 2 * phi[19]; // 2 x y zz
+        gradPhi[26 * dim + 1] = 2 * phi[23]; // 2 xx y zz
         //phi_z
-        gradPhi[21][2] = 2 * phi[12];  // 2 xx z
-        gradPhi[22][2] = 2 * phi[13];  // 2 yy z
-        gradPhi[23][2] = 2 * phi[17]; // 2 xx y z
-        gradPhi[24][2] = phi[20]; // xx yy
-        gradPhi[25][2] = 2 * phi[18]; // 2 x yy z
-        gradPhi[26][2] = 2 * phi[24]; // 2 xx yy z
+        gradPhi[21 * dim + 2] = 2 * phi[12];  // 2 xx z
+        gradPhi[22 * dim + 2] = 2 * phi[13];  // 2 yy z
+        gradPhi[23 * dim + 2] = 2 * phi[17]; // 2 xx y z
+        gradPhi[24 * dim + 2] = phi[20]; // xx yy
+        gradPhi[25 * dim + 2] = 2 * phi[18]; // 2 x yy z
+        gradPhi[26 * dim + 2] = 2 * phi[24]; // 2 xx yy z
       }
     }
+  }
 
+  void GetHexPolynomialShapeFunctionGradient(std::vector < double >& phi, std::vector < std::vector < double > >& gradPhi,
+      const std::vector < double >& xi, const unsigned & solType) {
 
+    double phiF[27];
+    double gradPhiF[27 * 3];
 
+    if(solType == 0) {
+      HexPolynomialShapeFunctionGradient < 0 > (phiF, gradPhiF, &xi[0]);
+    }
+    else if(solType == 1) {
+      HexPolynomialShapeFunctionGradient < 1 > (phiF, gradPhiF, &xi[0]);
+    }
+    else {
+      HexPolynomialShapeFunctionGradient < 2 > (phiF, gradPhiF, &xi[0]);
+    }
+
+    CopyFlatShapeFunctionGradient(phiF, gradPhiF, hexNumberOfDofs[solType], 3, phi, gradPhi);
   }
 
   void GetHexPolynomialShapeFunctionGradientHessian(std::vector < double >& phi, std::vector < std::vector < double > >& gradPhi,
@@ -924,62 +1047,101 @@ namespace femus {
   }
 
 
-  void GetTetPolynomialShapeFunctionGradient(std::vector < double >& phi, std::vector < std::vector < double > >& gradPhi,
-      const std::vector < double >& xi, const unsigned & solType) {
-
-    GetTetPolynomialShapeFunction(phi,  xi, solType);
+  // flat fixed size evaluation of the TET basis and of its gradient, gradPhi[i * 3 + k] = d phi_i / d xi_k
+  template < unsigned solType >
+  void TetPolynomialShapeFunctionGradient(double *phi, double *gradPhi, const double *xi) {
 
     const unsigned dim = 3;
 
     const unsigned nDofs = tetNumberOfDofs[solType];
 
-    gradPhi.resize(nDofs);
+    for(unsigned i = 0; i < nDofs * dim; i++) {
+      gradPhi[i] = 0.;
+    }
 
-    for(int i = 0; i < nDofs; i++) {
-      gradPhi[i].assign(dim, 0.);
+    phi[0] = 1.;
+    phi[1] = xi[0]; // x
+    phi[2] = xi[1];  // y
+    phi[3] = xi[2]; // z
+
+    if(solType > 0) {
+      phi[4] = phi[1] * phi[2];  // x y
+      phi[5] = phi[1] * phi[3];  // x z
+      phi[6] = phi[2] * phi[3];  // y z
+      phi[7] = phi[1] * phi[1]; // x x
+      phi[8] = phi[2] * phi[2]; // y y
+      phi[9] = phi[3] * phi[3]; // z z
+
+
+      if(solType > 1) {
+        phi[10] = phi[4] * phi[3]; // x y z
+        phi[11] = phi[1] * phi[8] + phi[7] * phi[2] ; // x y y + x x y
+        phi[12] = phi[1] * phi[9] + phi[7] * phi[3] ; // x z z + x x z
+        phi[13] = phi[2] * phi[9] + phi[8] * phi[3] ; // y z z + y y z
+        phi[14] = phi[4] * phi[9] + phi[4] * phi[6] + phi[7] * phi[6]; // x y z z + x y y z + x x y z
+      }
     }
 
     //phi_x
-    gradPhi[1][0] = 1.; // 1
+    gradPhi[1 * dim + 0] = 1.; // 1
     //phi_y
-    gradPhi[2][1] = 1.;  // 1
+    gradPhi[2 * dim + 1] = 1.;  // 1
     //phi_z
-    gradPhi[3][2] = 1.; // 1
+    gradPhi[3 * dim + 2] = 1.; // 1
 
     if(solType > 0) {
       //phi_x
-      gradPhi[4][0] = xi[1] ;  //  y
-      gradPhi[5][0] = xi[2] ;  //  z
-      gradPhi[7][0] = 2 * xi[0] ; // 2 x
+      gradPhi[4 * dim + 0] = xi[1] ;  //  y
+      gradPhi[5 * dim + 0] = xi[2] ;  //  z
+      gradPhi[7 * dim + 0] = 2 * xi[0] ; // 2 x
       //phi_y
-      gradPhi[4][1] = xi[0] ;  // x
-      gradPhi[6][1] = xi[2] ;  //  z
-      gradPhi[8][1] = 2 * xi[1]; // 2 y
+      gradPhi[4 * dim + 1] = xi[0] ;  // x
+      gradPhi[6 * dim + 1] = xi[2] ;  //  z
+      gradPhi[8 * dim + 1] = 2 * xi[1]; // 2 y
       //phi_z
-      gradPhi[5][2] = xi[0];  // x
-      gradPhi[6][2] = xi[1];  // y
-      gradPhi[9][2] = 2 * xi[2]; // 2 z
+      gradPhi[5 * dim + 2] = xi[0];  // x
+      gradPhi[6 * dim + 2] = xi[1];  // y
+      gradPhi[9 * dim + 2] = 2 * xi[2]; // 2 z
 
       if(solType > 1) {
         //phi_x
-        gradPhi[10][0] = phi[6]; //  y z
-        gradPhi[11][0] = phi[8] + 2 * phi[4] ; //  y y + 2 x y
-        gradPhi[12][0] = phi[9] + 2 * phi[5] ; // z z + 2 x z
-        gradPhi[14][0] = xi[1] * (gradPhi[12][0] + phi[6]) ; //  y z z +  y y z + 2 x y z
+        gradPhi[10 * dim + 0] = phi[6]; //  y z
+        gradPhi[11 * dim + 0] = phi[8] + 2 * phi[4] ; //  y y + 2 x y
+        gradPhi[12 * dim + 0] = phi[9] + 2 * phi[5] ; // z z + 2 x z
+        gradPhi[14 * dim + 0] = xi[1] * (gradPhi[12 * dim + 0] + phi[6]) ; //  y z z +  y y z + 2 x y z
         //phi_y
-        gradPhi[10][1] = phi[5]; // x z
-        gradPhi[11][1] = 2 * phi[4] + phi[7] ; //  2 x y + x x
-        gradPhi[13][1] = phi[9] + 2 * phi[6]; //  z z + 2 y z
-        gradPhi[14][1] = xi[0] * (gradPhi[13][1] + phi[5]); // x z z + 2 x y z + x x z
+        gradPhi[10 * dim + 1] = phi[5]; // x z
+        gradPhi[11 * dim + 1] = 2 * phi[4] + phi[7] ; //  2 x y + x x
+        gradPhi[13 * dim + 1] = phi[9] + 2 * phi[6]; //  z z + 2 y z
+        gradPhi[14 * dim + 1] = xi[0] * (gradPhi[13 * dim + 1] + phi[5]); // x z z + 2 x y z + x x z
         //phi_z
-        gradPhi[10][2] = phi[4]; // x y
-        gradPhi[12][2] = 2 * phi[5] + phi[7]; // 2 x z  + x x
-        gradPhi[13][2] = 2 * phi[6] + phi[8]; // 2 y z  + y y
-        gradPhi[14][2] = xi[0] * (gradPhi[13][2] + phi[4]); //  2 x y z  + x y y  + x x y
+        gradPhi[10 * dim + 2] = phi[4]; // x y
+        gradPhi[12 * dim + 2] = 2 * phi[5] + phi[7]; // 2 x z  + x x
+        gradPhi[13 * dim + 2] = 2 * phi[6] + phi[8]; // 2 y z  + y y
+        gradPhi[14 * dim + 2] = xi[0] * (gradPhi[13 * dim + 2] + phi[4]); //  2 x y z  + x y y  + x x y
       }
     }
   }
 
+  void GetTetPolynomialShapeFunctionGradient(std::vector < double >& phi, std::vector < std::vector < double > >& gradPhi,
+      const std::vector < double >& xi, const unsigned & solType) {
+
+    double phiF[15];
+    double gradPhiF[15 * 3];
+
+    if(solType == 0) {
+      TetPolynomialShapeFunctionGradient < 0 > (phiF, gradPhiF, &xi[0]);
+    }
+    else if(solType == 1) {
+      TetPolynomialShapeFunctionGradient < 1 > (phiF, gradPhiF, &xi[0]);
+    }
+    else {
+      TetPolynomialShapeFunctionGradient < 2 > (phiF, gradPhiF, &xi[0]);
+    }
+
+    CopyFlatShapeFunctionGradient(phiF, gradPhiF, tetNumberOfDofs[solType], 3, phi, gradPhi);
+  }
+
   void GetTetPolynomialShapeFunctionGradientHessian(std::vector < double >& phi, std::vector < std::vector < double > >& gradPhi,
       std::vector < std::vector < std::vector < double > > >& hessPhi, const std::vector < double >& xi, const unsigned & solType) {
 
@@ -1166,105 +1328,158 @@ namespace femus {
     }
   }
 
-  void GetWedgePolynomialShapeFunctionGradient(std::vector < double >& phi, std::vector < std::vector < double > >& gradPhi,
-      const std::vector < double >& xi, const unsigned & solType) {
-
-    GetWedgePolynomialShapeFunction(phi,  xi, solType);
+  // flat fixed size evaluation of the WEDGE basis and of its gradient, gradPhi[i * 3 + k] = d phi_i / d xi_k
+  template < unsigned solType >
+  void WedgePolynomialShapeFunctionGradient(double *phi, double *gradPhi, const double *xi) {
 
     const unsigned dim = 3;
 
     const unsigned nDofs = wedgeNumberOfDofs[solType];
 
-    gradPhi.resize(nDofs);
+    for(unsigned i = 0; i < nDofs * dim; i++) {
+      gradPhi[i] = 0.;
+    }
 
-    for(int i = 0; i < nDofs; i++) {
-      gradPhi[i].assign(dim, 0.);
+    //common for linear, quadratic and biquadratic
+    phi[0] = 1.;
+    phi[1] = xi[0]; // x
+    phi[2] = xi[1];  // y
+    phi[3] = xi[2]; // z
+    if(solType < 1) {  //only linear
+      phi[4] = phi[1] * phi[3];  // x z
+      phi[5] = phi[2] * phi[3];  // y z
+    }
+    else {  //only quadratic and biquadratic
+      phi[4] = xi[0] * xi[1];  // x y
+      phi[5] = xi[0] * xi[2];  // x z
+      phi[6] = xi[1] * xi[2];  // y z
+      phi[7] = xi[0] * xi[0]; // x x
+      phi[8] = xi[1] * xi[1]; // y y
+      phi[9] = xi[2] * xi[2]; // z z
+      phi[10] = phi[4] * xi[2]; // x y z
+      if(solType < 2) {  //only quadratic
+        phi[11] = phi[7] * xi[2]; // x x z
+        phi[12] = phi[8] * xi[2]; // y y z
+        phi[13] = xi[0] * phi[9]; // x z z
+        phi[14] = xi[1] * phi[9]; // y z z;
+      }
+      else { //only biquadratic
+        phi[11] = phi[7] * xi[1] + xi[0] * phi[8]; // xx y + x yy
+        phi[12] = phi[7] * xi[2]; // x x z
+        phi[13] = phi[8] * xi[2]; // y y z
+        phi[14] = xi[0]  * phi[9]; // x z z
+        phi[15] = xi[1] * phi[9]; // y z z
+        phi[16] = phi[7] * phi[9]; // xx zz
+        phi[17] = phi[8] * phi[9]; // yy zz
+        phi[18] = phi[11] * xi[2]; // x yy z + xx y z
+        phi[19] = phi[10] * xi[2]; // x y zz
+        phi[20] = phi[18] * xi[2]; // x yy zz + xx y zz
+      }
     }
 
     //common for linear, quadratic and biquadratic
     //phi_x
-    gradPhi[1][0] = 1.; // 1
+    gradPhi[1 * dim + 0] = 1.; // 1
     //phi_y
-    gradPhi[2][1] = 1.;  // 1
+    gradPhi[2 * dim + 1] = 1.;  // 1
     //phi_z
-    gradPhi[3][2] = 1.; // 1
+    gradPhi[3 * dim + 2] = 1.; // 1
     if(solType < 1) { //only linear
       //phi_x
-      gradPhi[4][0] = xi[2] ;  //  z
+      gradPhi[4 * dim + 0] = xi[2] ;  //  z
       //phi_y
-      gradPhi[5][1] = xi[2] ;  // z
+      gradPhi[5 * dim + 1] = xi[2] ;  // z
       //phi_z
-      gradPhi[4][2] = xi[0] ;  // x
-      gradPhi[5][2] = xi[1] ;  // y
+      gradPhi[4 * dim + 2] = xi[0] ;  // x
+      gradPhi[5 * dim + 2] = xi[1] ;  // y
 
     }
     else { //only quadratic and biquadratic
       //phi_x
-      gradPhi[4][0] = xi[1] ;  //  y
-      gradPhi[5][0] = xi[2] ;  //  z
-      gradPhi[7][0] = 2 * xi[0] ; // 2 x
-      gradPhi[10][0] = phi[6]; //  y z
+      gradPhi[4 * dim + 0] = xi[1] ;  //  y
+      gradPhi[5 * dim + 0] = xi[2] ;  //  z
+      gradPhi[7 * dim + 0] = 2 * xi[0] ; // 2 x
+      gradPhi[10 * dim + 0] = phi[6]; //  y z
 
       //phi_y
-      gradPhi[4][1] = xi[0] ;  //  x
-      gradPhi[6][1] = xi[2] ;  // z
-      gradPhi[8][1] = 2 * xi[1]; // 2 y
-      gradPhi[10][1] = phi[5]; // x z
+      gradPhi[4 * dim + 1] = xi[0] ;  //  x
+      gradPhi[6 * dim + 1] = xi[2] ;  // z
+      gradPhi[8 * dim + 1] = 2 * xi[1]; // 2 y
+      gradPhi[10 * dim + 1] = phi[5]; // x z
 
       //phi_z
-      gradPhi[5][2] = xi[0] ;  // x
-      gradPhi[6][2] = xi[1] ;  // y
-      gradPhi[9][2] = 2 * xi[2]; // 2 z
-      gradPhi[10][2] = phi[4]; // x y
+      gradPhi[5 * dim + 2] = xi[0] ;  // x
+      gradPhi[6 * dim + 2] = xi[1] ;  // y
+      gradPhi[9 * dim + 2] = 2 * xi[2]; // 2 z
+      gradPhi[10 * dim + 2] = phi[4]; // x y
 
       if(solType < 2) {  //only quadratic
         //phi_x
-        gradPhi[11][0] = 2 * phi[5]; // 2 x z
-        gradPhi[13][0] = phi[9]; //  z z
+        gradPhi[11 * dim + 0] = 2 * phi[5]; // 2 x z
+        gradPhi[13 * dim + 0] = phi[9]; //  z z
 
         //phi_y
-        gradPhi[12][1] = 2 * phi[6]; // 2 y z
-        gradPhi[14][1] = phi[9]; //  z z;
+        gradPhi[12 * dim + 1] = 2 * phi[6]; // 2 y z
+        gradPhi[14 * dim + 1] = phi[9]; //  z z;
 
 
         //phi_z
-        gradPhi[11][2] = phi[7]; // x x
-        gradPhi[12][2] = phi[8]; // y y
+        gradPhi[11 * dim + 2] = phi[7]; // x x
+        gradPhi[12 * dim + 2] = phi[8]; // y y
 
-        gradPhi[13][2] = 2 * phi[5]; // 2 x z
-        gradPhi[14][2] = 2 * phi[6]; // 2 y z;
+        gradPhi[13 * dim + 2] = 2 * phi[5]; // 2 x z
+        gradPhi[14 * dim + 2] = 2 * phi[6]; // 2 y z;
       }
       else { //only biquadratic
         //phi_x
-        gradPhi[11][0] = 2 * phi[4] + phi[8]; // 2 x y +  yy
-        gradPhi[12][0] = 2 * phi[5]; // 2 x z
-        gradPhi[14][0] = phi[9]; //  z z
-        gradPhi[16][0] = 2 * phi[14]; // 2 x zz
-        gradPhi[18][0] = phi[13] + 2 * phi[10]; //  yy z + 2 x y z
-        gradPhi[19][0] = phi[15]; // y zz
-        gradPhi[20][0] = gradPhi[18][0] * xi[2]; //  yy zz + 2 x y zz
+        gradPhi[11 * dim + 0] = 2 * phi[4] + phi[8]; // 2 x y +  yy
+        gradPhi[12 * dim + 0] = 2 * phi[5]; // 2 x z
+        gradPhi[14 * dim + 0] = phi[9]; //  z z
+        gradPhi[16 * dim + 0] = 2 * phi[14]; // 2 x zz
+        gradPhi[18 * dim + 0] = phi[13] + 2 * phi[10]; //  yy z + 2 x y z
+        gradPhi[19 * dim + 0] = phi[15]; // y zz
+        gradPhi[20 * dim + 0] = gradPhi[18 * dim + 0] * xi[2]; //  yy zz + 2 x y zz
         //phi_y
-        gradPhi[11][1] = phi[7] + 2 * phi[4]; // xx + 2 x y
-        gradPhi[13][1] = 2 * phi[6]; // 2 y z
-        gradPhi[15][1] = phi[9]; //  z z
-        gradPhi[17][1] = 2 * phi[15]; // 2 y zz
-        gradPhi[18][1] = 2 * phi[10] + phi[12]; // 2 x y z + xx z
-        gradPhi[19][1] = phi[14]; // x zz
-        gradPhi[20][1] = gradPhi[18][1] * xi[2]; // 2 x y zz + xx zz
+        gradPhi[11 * dim + 1] = phi[7] + 2 * phi[4]; // xx + 2 x y
+        gradPhi[13 * dim + 1] = 2 * phi[6]; // 2 y z
+        gradPhi[15 * dim + 1] = phi[9]; //  z z
+        gradPhi[17 * dim + 1] = 2 * phi[15]; // 2 y zz
+        gradPhi[18 * dim + 1] = 2 * phi[10] + phi[12]; // 2 x y z + xx z
+        gradPhi[19 * dim + 1] = phi[14]; // x zz
+        gradPhi[20 * dim + 1] = gradPhi[18 * dim + 1] * xi[2]; // 2 x y zz + xx zz
         //phi_z
-        gradPhi[12][2] = phi[7]; // x x
-        gradPhi[13][2] = phi[8]; // y y
-        gradPhi[14][2] = 2  * phi[5]; // 2 x z
-        gradPhi[15][2] = 2 * phi[6]; // 2 y z
-        gradPhi[16][2] = 2 * phi[12]; // 2 xx z
-        gradPhi[17][2] = 2 * phi[13]; // 2 yy z
-        gradPhi[18][2] = xi[1] * (phi[4] + phi[7]); // x yy + xx y
-        gradPhi[19][2] = 2 * phi[10]; // 2 x y z
-        gradPhi[20][2] = 2 * xi[2] * gradPhi[18][2]; // 2 x yy z + 2 xx y z
+        gradPhi[12 * dim + 2] = phi[7]; // x x
+        gradPhi[13 * dim + 2] = phi[8]; // y y
+        gradPhi[14 * dim + 2] = 2  * phi[5]; // 2 x z
+        gradPhi[15 * dim + 2] = 2 * phi[6]; // 2 y z
+        gradPhi[16 * dim + 2] = 2 * phi[12]; // 2 xx z
+        gradPhi[17 * dim + 2] = 2 * phi[13]; // 2 yy z
+        gradPhi[18 * dim + 2] = xi[1] * (phi[4] + phi[7]); // x yy + xx y
+        gradPhi[19 * dim + 2] = 2 * phi[10]; // 2 x y z
+        gradPhi[20 * dim + 2] = 2 * xi[2] * gradPhi[18 * dim + 2]; // 2 x yy z + 2 xx y z
       }
     }
   }
 
+  void GetWedgePolynomialShapeFunctionGradient(std::vector < double >& phi, std::vector < std::vector < double > >& gradPhi,
+      const std::vector < double >& xi, const unsigned & solType) {
+
+    double phiF[21];
+    double gradPhiF[21 * 3];
+
+    if(solType == 0) {
+      WedgePolynomialShapeFunctionGradient < 0 > (phiF, gradPhiF, &xi[0]);
+    }
+    else if(solType == 1) {
+      WedgePolynomialShapeFunctionGradient < 1 > (phiF, gradPhiF, &xi[0]);
+    }
+    else {
+      WedgePolynomialShapeFunctionGradient < 2 > (phiF, gradPhiF, &xi[0]);
+    }
+
+    CopyFlatShapeFunctionGradient(phiF, gradPhiF, wedgeNumberOfDofs[solType], 3, phi, gradPhi);
+  }
+
   void GetWedgePolynomialShapeFunctionGradientHessian(std::vector < double >& phi, std::vector < std::vector < double > >& gradPhi,
       std::vector < std::vector < std::vector < double > > >& hessPhi, const std::vector < double >& xi, const unsigned & solType) {
 
@@ -1748,18 +1963,265 @@ namespace femus {
     }
   }
 
-  void GetInverseMapping(const unsigned &solType, short unsigned &ielType, const std::vector < std::vector < std::vector <double > > > &aP,
+//BEGIN allocation free inverse mapping
+  const unsigned inverseMappingMaxIterations = 100;
+
+  // inverse of a fixed size matrix stored by rows, false if the matrix is singular
+  template < unsigned dim >
+  bool InverseFixedSizeMatrix(const double *A, double *invA);
+
+  template <>
+  bool InverseFixedSizeMatrix < 2 > (const double *A, double *invA) {
+
+    double detA = A[0] * A[3] - A[1] * A[2];
+    if(detA == 0.) return false;
+
+    invA[0] = A[3] / detA;
+    invA[1] = -A[1] / detA;
+    invA[2] = -A[2] / detA;
+    invA[3] = A[0] / detA;
+
+    return true;
+  }
+
+  template <>
+  bool InverseFixedSizeMatrix < 3 > (const double *A, double *invA) {
+
+    double detA = (A[0] * A[4] * A[8] + A[1] * A[5] * A[6] + A[2] * A[3] * A[7])
+                  - (A[6] * A[4] * A[2] + A[7] * A[5] * A[0] + A[8] * A[3] * A[1]);
+    if(detA == 0.) return false;
+
+    invA[0] = (A[4] * A[8] - A[7] * A[5]) / detA;
+    invA[1] = (A[2] * A[7] - A[8] * A[1]) / detA;
+    invA[2] = (A[1] * A[5] - A[4] * A[2]) / detA;
+    invA[3] = (A[5] * A[6] - A[8] * A[3]) / detA;
+    invA[4] = (A[0] * A[8] - A[6] * A[2]) / detA;
+    invA[5] = (A[2] * A[3] - A[0] * A[5]) / detA;
+    invA[6] = (A[3] * A[7] - A[6] * A[4]) / detA;
+    invA[7] = (A[1] * A[6] - A[7] * A[0]) / detA;
+    invA[8] = (A[0] * A[4] - A[3] * A[1]) / detA;
+
+    return true;
+  }
+
+  // Newton iteration of the inverse mapping with the flat kernel of an element type and order, a[k * nDofs + i],
+  // same update and stopping criterion of GetNewLocalCoordinates, everything lives on the stack
+  template < unsigned dim, unsigned nDofs, void (*ShapeFunctionGradient)(double *, double *, const double *) >
+  bool NewtonInverseMapping(const double *a, const double *x, double *xi, const unsigned &maxIterations) {
+
+    double phi[27];
+    double gradPhi[27 * 3];
+    double F[dim];
+    double J[dim * dim];
+    double Jm1[dim * dim];
+
+    for(unsigned it = 0; it < maxIterations; it++) {
+
+      ShapeFunctionGradient(phi, gradPhi, xi);
+
+      for(unsigned k = 0; k < dim; k++) {
+        F[k] = -x[k];
+        for(unsigned l = 0; l < dim; l++) {
+          J[k * dim + l] = 0.;
+        }
+        const double *ak = a + k * nDofs;
+        for(unsigned i = 0; i < nDofs; i++) {
+          F[k] += ak[i] * phi[i];
+          for(unsigned l = 0; l < dim; l++) {
+            J[k * dim + l] += ak[i] * gradPhi[i * dim + l];
+          }
+        }
+      }
+
+      if(!InverseFixedSizeMatrix < dim > (J, Jm1)) return false;
+
+      double delta2 = 0.;
+      for(unsigned k = 0; k < dim; k++) {
+        double deltak = 0.;
+        for(unsigned l = 0; l < dim; l++) {
+          deltak -= Jm1[k * dim + l] * F[l];
+        }
+        xi[k] += deltak;
+        delta2 += deltak * deltak;
+      }
+
+      if(delta2 < 1.0e-9) return true;
+    }
+
+    return false;
+  }
+
+  ElementInverseMapping::ElementInverseMapping() :
+    _dim(0),
+    _nDofs(0),
+    _affine(false),
+    _newton(NULL) {
+  }
+
+  void ElementInverseMapping::SetKernel(const short unsigned &ielType, const unsigned &solType) {
+
+    if(solType > 2) {
+      std::cout << "Error in ElementInverseMapping::SetKernel(...) the mapping order " << solType << " is not supported" << std::endl;
+      abort();
+    }
+
+    static const NewtonFunction quadNewton[3] = {
+      NewtonInverseMapping < 2, 4, QuadPolynomialShapeFunctionGradient < 0 > >,
+      NewtonInverseMapping < 2, 8, QuadPolynomialShapeFunctionGradient < 1 > >,
+      NewtonInverseMapping < 2, 9, QuadPolynomialShapeFunctionGradient < 2 > >
+    };
+    static const NewtonFunction triNewton[3] = {
+      NewtonInverseMapping < 2, 3, TriPolynomialShapeFunctionGradient < 0 > >,
+      NewtonInverseMapping < 2, 6, TriPolynomialShapeFunctionGradient < 1 > >,
+      NewtonInverseMapping < 2, 7, TriPolynomialShapeFunctionGradient < 2 > >
+    };
+    static const NewtonFunction hexNewton[3] = {
+      NewtonInverseMapping < 3, 8, HexPolynomialShapeFunctionGradient < 0 > >,
+      NewtonInverseMapping < 3, 20, HexPolynomialShapeFunctionGradient < 1 > >,
+      NewtonInverseMapping < 3, 27, HexPolynomialShapeFunctionGradient < 2 > >
+    };
+    static const NewtonFunction tetNewton[3] = {
+      NewtonInverseMapping < 3, 4, TetPolynomialShapeFunctionGradient < 0 > >,
+      NewtonInverseMapping < 3, 10, TetPolynomialShapeFunctionGradient < 1 > >,
+      NewtonInverseMapping < 3, 15, TetPolynomialShapeFunctionGradient < 2 > >
+    };
+    static const NewtonFunction wedgeNewton[3] = {
+      NewtonInverseMapping < 3, 6, WedgePolynomialShapeFunctionGradient < 0 > >,
+      NewtonInverseMapping < 3, 15, WedgePolynomialShapeFunctionGradient < 1 > >,
+      NewtonInverseMapping < 3, 21, WedgePolynomialShapeFunctionGradient < 2 > >
+    };
+
+    if(ielType == QUAD) {
+      _dim = 2;
+      _nDofs = quadNumberOfDofs[solType];
+      _newton = quadNewton[solType];
+    }
+    else if(ielType == TRI) {
+      _dim = 2;
+      _nDofs = triNumberOfDofs[solType];
+      _newton = triNewton[solType];
+    }
+    else if(ielType == HEX) {
+      _dim = 3;
+      _nDofs = hexNumberOfDofs[solType];
+      _newton = hexNewton[solType];
+    }
+    else if(ielType == TET) {
+      _dim = 3;
+      _nDofs = tetNumberOfDofs[solType];
+      _newton = tetNewton[solType];
+    }
+    else if(ielType == WEDGE) {
+      _dim = 3;
+      _nDofs = wedgeNumberOfDofs[solType];
+      _newton = wedgeNewton[solType];
+    }
+    else {
+      std::cout << "Error in ElementInverseMapping::SetKernel(...) the element type " << ielType << " is not supported" << std::endl;
+      abort();
+    }
+  }
+
+  void ElementInverseMapping::SetCoefficients(const std::vector < std::vector <double > > &aP, const short unsigned &ielType, const unsigned &solType) {
+
+    SetKernel(ielType, solType);
+
+    for(unsigned k = 0; k < _dim; k++) {
+      for(unsigned i = 0; i < _nDofs; i++) {
+        _a[k * _nDofs + i] = aP[k][i];
+      }
+    }
+
+    CheckAffine();
+  }
+
+  void ElementInverseMapping::SetCoefficients(const std::vector < std::vector <double > > &aP0, const std::vector < std::vector <double > > &aP1,
+                                              const double &s, const short unsigned &ielType, const unsigned &solType) {
+
+    SetKernel(ielType, solType);
+
+    for(unsigned k = 0; k < _dim; k++) {
+      for(unsigned i = 0; i < _nDofs; i++) {
+        _a[k * _nDofs + i] = (1. - s) * aP0[k][i] + s * aP1[k][i];
+      }
+    }
+
+    CheckAffine();
+  }
+
+  void ElementInverseMapping::CheckAffine() {
+
+    // the monomials 1 ... dim are 1, x, y, z for all the element types, all the others are nonlinear
+    double linearScale = 0.;
+    double nonlinearScale = 0.;
+    for(unsigned k = 0; k < _dim; k++) {
+      for(unsigned i = 1; i <= _dim; i++) {
+        linearScale += fabs(_a[k * _nDofs + i]);
+      }
+      for(unsigned i = _dim + 1; i < _nDofs; i++) {
+        nonlinearScale += fabs(_a[k * _nDofs + i]);
+      }
+    }
+
+    _affine = false;
+    if(nonlinearScale <= 1.0e-12 * linearScale) {
+      double J[9];
+      for(unsigned k = 0; k < _dim; k++) {
+        for(unsigned l = 0; l < _dim; l++) {
+          J[k * _dim + l] = _a[k * _nDofs + 1 + l];
+        }
+      }
+      _affine = (_dim == 2) ? InverseFixedSizeMatrix < 2 > (J, _Jm1) : InverseFixedSizeMatrix < 3 > (J, _Jm1);
+    }
+  }
+
+  bool ElementInverseMapping::GetLocalCoordinates(const double *x, double *xi) const {
+
+    if(_affine) {
+      for(unsigned k = 0; k < _dim; k++) {
+        xi[k] = 0.;
+        for(unsigned l = 0; l < _dim; l++) {
+          xi[k] += _Jm1[k * _dim + l] * (x[l] - _a[l * _nDofs]);
+        }
+      }
+      return true;
+    }
+
+    return _newton(_a, x, xi, inverseMappingMaxIterations);
+  }
+
+  unsigned ElementInverseMapping::GetLocalCoordinates(const double * const *x, double * const *xi, const unsigned &begin, const unsigned &end) const {
+
+    unsigned notConverged = 0;
+    double xp[3];
+    double xip[3];
+
+    for(unsigned p = begin; p < end; p++) {
+      for(unsigned k = 0; k < _dim; k++) {
+        xp[k] = x[k][p];
+        xip[k] = xi[k][p];
+      }
+      if(!GetLocalCoordinates(xp, xip)) notConverged++;
+      for(unsigned k = 0; k < _dim; k++) {
+        xi[k][p] = xip[k];
+      }
+    }
+
+    return notConverged;
+  }
+//END allocation free inverse mapping
+
+  bool GetInverseMapping(const unsigned &solType, short unsigned &ielType, const std::vector < std::vector < std::vector <double > > > &aP,
                          const std::vector <double > &xl, std::vector <double > &xi) {
 
+    // the lower order mappings only improve the guess of the mapping of order solType
+    ElementInverseMapping inverseMapping;
+    bool convergence = false;
     for(short unsigned jtype = 0; jtype < solType + 1; jtype++) {
-      std::vector < double > phi;
-      std::vector < std::vector < double > > gradPhi;
-      bool convergence = false;
-      while(!convergence) {
-        GetPolynomialShapeFunctionGradient(phi, gradPhi, xi, ielType, jtype);
-        convergence = GetNewLocalCoordinates(xi, xl, phi, gradPhi, aP[jtype]);
-      }
+      inverseMapping.SetCoefficients(aP[jtype], ielType, jtype);
+      convergence = inverseMapping.GetLocalCoordinates(&xl[0], &xi[0]);
     }
+    return convergence;
   }
 
   const double XI[6][27][3] = {{
@@ -84,7 +84,54 @@ namespace femus {
 
   void GetConvexHullSphere(const std::vector< std::vector < double > > &xv, std::vector <double> &xc, double & r, const double tolerance = 1.0e-10);
   void GetBoundingBox(const std::vector< std::vector < double > > &xv, std::vector< std::vector < double > > &xe, const double tolerance = 1.0e-10);
-  void GetInverseMapping(const unsigned &solType, short unsigned &ielType, const std::vector < std::vector < std::vector <double > > > &aP,
+  /**
+   * Allocation free inverse mapping x -> xi of one element, to locate many points in the same element.
+   * The polynomial coefficients of the mapping are copied in fixed size arrays and the Newton iteration uses
+   * the flat basis kernel of the element type and order, selected once in SetCoefficients.
+   * If the mapping is affine, e.g. a straight-sided simplex, the local coordinates are found with one linear solve.
+   */
+  class ElementInverseMapping {
+
+    public:
+
+      ElementInverseMapping();
+
+      /** Set the coefficients aP[k][i] of the mapping of order solType of an element of type ielType, see ProjectNodalToPolynomialCoefficients */
+      void SetCoefficients(const std::vector < std::vector <double > > &aP, const short unsigned &ielType, const unsigned &solType);
+
+      /** Set the coefficients (1 - s) aP0 + s aP1, see InterpolatePolynomialCoefficients */
+      void SetCoefficients(const std::vector < std::vector <double > > &aP0, const std::vector < std::vector <double > > &aP1,
+                           const double &s, const short unsigned &ielType, const unsigned &solType);
+
+      /** Get the local coordinates xi of x starting from the guess xi, return false if the Newton iteration did not converge */
+      bool GetLocalCoordinates(const double *x, double *xi) const;
+
+      /** Batched version for the points p = begin ... end - 1 stored by component, x[k][p] and xi[k][p],
+       * return the number of points whose Newton iteration did not converge */
+      unsigned GetLocalCoordinates(const double * const *x, double * const *xi, const unsigned &begin, const unsigned &end) const;
+
+      bool IsAffine() const {
+        return _affine;
+      }
+
+    private:
+
+      typedef bool (*NewtonFunction)(const double *a, const double *x, double *xi, const unsigned &maxIterations);
+
+      void SetKernel(const short unsigned &ielType, const unsigned &solType);
+      void CheckAffine();
+
+      unsigned _dim;
+      unsigned _nDofs;
+      bool _affine;
+      NewtonFunction _newton;
+      double _a[3 * 27]; // _a[k * _nDofs + i]
+      double _Jm1[3 * 3]; // inverse of the constant jacobian of an affine mapping
+  };
+
+  /** Get the local coordinates xi of xl, with the mappings of order 0 ... solType starting from the guess xi,
+   * return false if the Newton iteration of the order solType did not converge */
+  bool GetInverseMapping(const unsigned &solType, short unsigned &ielType, const std::vector < std::vector < std::vector <double > > > &aP,
                          const std::vector <double > &xl, std::vector <double > &xi);
   void GetClosestPointInReferenceElement(const std::vector< std::vector < double > > &xv, const std::vector <double> &x,
                                          const short unsigned &ieltype, std::vector < double > &xi);
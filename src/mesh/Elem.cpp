@@ -25,6 +25,7 @@
 
 #include "Elem.hpp"
 #include "GeomElTypeEnum.hpp"
+#include "BinaryIO.hpp"
 
 namespace femus
 {
@@ -209,6 +210,66 @@ namespace femus
   {
   }
 
+  void elem::Write(std::ostream& os) const
+  {
+    BinaryWrite(os, _iproc);
+    BinaryWrite(os, _nprocs);
+    BinaryWrite(os, _nvt);
+    BinaryWrite(os, _nel);
+    for (unsigned i = 0; i < 6; i++) {
+      BinaryWrite(os, _nelt[i]);
+    }
+    BinaryWrite(os, _nelr);
+    BinaryWrite(os, _ngroup);
+    BinaryWrite(os, _level);
+    BinaryWrite(os, _elementOffset);
+    BinaryWrite(os, _elementOwned);
+
+    _elementLevel.write(os);
+    _elementType.write(os);
+    _elementGroup.write(os);
+    _elementMaterial.write(os);
+    BinaryWrite(os, _materialElementCounter);
+
+    _elementDof.write(os);
+    _elementNearFace.write(os);
+    _childElem.write(os);
+    _childElemDof.write(os);
+    _elementNearVertex.write(os);
+    _elementNearElement.write(os);
+  }
+
+  void elem::Read(std::istream& is, elem* coarseElem)
+  {
+    _coarseElem = coarseElem;
+
+    BinaryRead(is, _iproc);
+    BinaryRead(is, _nprocs);
+    BinaryRead(is, _nvt);
+    BinaryRead(is, _nel);
+    for (unsigned i = 0; i < 6; i++) {
+      BinaryRead(is, _nelt[i]);
+    }
+    BinaryRead(is, _nelr);
+    BinaryRead(is, _ngroup);
+    BinaryRead(is, _level);
+    BinaryRead(is, _elementOffset);
+    BinaryRead(is, _elementOwned);
+
+    _elementLevel.read(is);
+    _elementType.read(is);
+    _elementGroup.read(is);
+    _elementMaterial.read(is);
+    BinaryRead(is, _materialElementCounter);
+
+    _elementDof.read(is);
+    _elementNearFace.read(is);
+    _childElem.read(is);
+    _childElemDof.read(is);
+    _elementNearVertex.read(is);
+    _elementNearElement.read(is);
+  }
+
   void elem::DeleteElementNearVertex()
   {
     _elementNearVertex.clear();
@@ -754,9 +815,9 @@ namespace femus
 
                         std::vector <double> xi;
                         GetClosestPointInReferenceElement(xv, xl, ielType, xi);
-                        GetInverseMapping(2, ielType, aP, xl, xi);
-
-                        bool insideDomain = CheckIfPointIsInsideReferenceDomain(xi, ielType, 0.0001);
+                        // a point whose inverse mapping did not converge is not taken as inside the element
+                        bool insideDomain = GetInverseMapping(2, ielType, aP, xl, xi)
+                                            && CheckIfPointIsInsideReferenceDomain(xi, ielType, 0.0001);
                         if (insideDomain) {
                           for (unsigned j = interfaceDof[soltype][ilevel].begin(i); j < interfaceDof[soltype][ilevel].end(i); j++) {
                             unsigned jloc = interfaceLocalDof[ilevel][i][j];
@@ -237,6 +237,12 @@ namespace femus {
       std::vector<unsigned> GetMaterialElementCounter(){
         return _materialElementCounter;
       }
+
+      /** Write the element structure to the binary stream os, for the mesh cache */
+      void Write(std::ostream& os) const;
+
+      /** Read the element structure written by Write, coarseElem is the element structure of the coarser level, NULL for the coarse level */
+      void Read(std::istream& is, elem* coarseElem);
       
       
     private:
@@ -0,0 +1,116 @@
+/*=========================================================================
+
+ Program: FEMUS
+ Module: ElementBatch
+ Authors: Eugenio Aulisa
+
+ Copyright (c) FEMTTU
+ All rights reserved.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+//----------------------------------------------------------------------------
+// includes :
+//----------------------------------------------------------------------------
+#include "ElementBatch.hpp"
+#include "Mesh.hpp"
+#include "NumericVector.hpp"
+
+#include <iostream>
+#include <cstdlib>
+
+namespace femus {
+
+  // ********************************************
+
+  ElementBatch::ElementBatch(Mesh *msh, const unsigned &solType, const std::vector < NumericVector* > &displacement) :
+    _msh(msh),
+    _solType(solType),
+    _displacement(displacement),
+    _block(0),
+    _nBlock(0),
+    _nDofs(0),
+    _fe(NULL) {
+
+    if(solType > 2) {
+      std::cout << "Error in ElementBatch: only the Lagrange families 0, 1 and 2 can be batched" << std::endl;
+      abort();
+    }
+
+    _dim = msh->GetDimension();
+
+    if(!_displacement.empty() && _displacement.size() != _dim) {
+      std::cout << "Error in ElementBatch: the displacement needs one vector for each dimension" << std::endl;
+      abort();
+    }
+
+    unsigned iproc = msh->processor_id();
+    unsigned iel0 = msh->_elementOffset[iproc];
+    unsigned iel1 = msh->_elementOffset[iproc + 1];
+
+    _element.reserve(iel1 - iel0);
+    _blockOffset.assign(1, 0);
+
+    // the elements keep the mesh order inside each geometric type
+    for(unsigned ielType = 0; ielType < 6; ielType++) {
+      unsigned blockSize = 0;
+
+      for(unsigned iel = iel0; iel < iel1; iel++) {
+        if(msh->GetElementType(iel) == ielType) {
+          _element.push_back(iel);
+          blockSize++;
+
+          if(blockSize == elem_type::_maxBatchSize) {
+            _blockOffset.push_back(_element.size());
+            blockSize = 0;
+          }
+        }
+      }
+
+      if(blockSize > 0) _blockOffset.push_back(_element.size());
+    }
+  }
+
+  // ********************************************
+
+  void ElementBatch::SetBlock(const unsigned &ib) {
+
+    _block = ib;
+    _nBlock = _blockOffset[ib + 1] - _blockOffset[ib];
+    _fe = _msh->_finiteElement[_msh->GetElementType(_element[_blockOffset[ib]])][_solType];
+    _nDofs = _fe->GetNDofs();
+
+    _x.resize(_dim * _nDofs * _nBlock);
+
+    for(unsigned e = 0; e < _nBlock; e++) {
+      unsigned iel = _element[_blockOffset[ib] + e];
+
+      for(unsigned i = 0; i < _nDofs; i++) {
+        unsigned xDof = _msh->GetSolutionDof(i, iel, 2);
+
+        for(unsigned k = 0; k < _dim; k++) {
+          _x[(k * _nDofs + i) * _nBlock + e] = (*_msh->_topology->_Sol[k])(xDof);
+        }
+
+        for(unsigned k = 0; k < _displacement.size(); k++) {
+          _x[(k * _nDofs + i) * _nBlock + e] += (*_displacement[k])(xDof);
+        }
+      }
+    }
+
+    _weight.resize(_nBlock);
+    _gradPhi.resize(_nDofs * _dim * _nBlock);
+    _inverseJacobian.resize(_dim * _dim * _nBlock);
+  }
+
+  // ********************************************
+
+  void ElementBatch::Evaluate(const unsigned &ig, const bool &inverseJacobian) {
+    _fe->JacobianBatch(&_x[0], _nBlock, ig, &_weight[0], &_gradPhi[0], (inverseJacobian) ? &_inverseJacobian[0] : NULL);
+  }
+
+} //end namespace femus
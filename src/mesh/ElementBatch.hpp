@@ -0,0 +1,122 @@
+/*=========================================================================
+
+ Program: FEMUS
+ Module: ElementBatch
+ Authors: Eugenio Aulisa
+
+ Copyright (c) FEMTTU
+ All rights reserved.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+#ifndef __femus_mesh_ElementBatch_hpp__
+#define __femus_mesh_ElementBatch_hpp__
+
+//----------------------------------------------------------------------------
+// includes :
+//----------------------------------------------------------------------------
+#include <vector>
+
+namespace femus {
+
+  class Mesh;
+  class elem_type;
+  class NumericVector;
+
+  /**
+   * Batched evaluation of the element geometry for an assembly routine.
+   * The owned elements are grouped by geometric type in blocks of at most elem_type::_maxBatchSize elements.
+   * For the current block the node coordinates are gathered in structure of arrays layout, and
+   * elem_type::JacobianBatch evaluates weights and physical gradients for all its elements at once.
+   *
+   * Usage:
+   *   for(ib = 0; ib < batch.GetNumberOfBlocks(); ib++) {
+   *     batch.SetBlock(ib);
+   *     for(ig = 0; ig < batch.GetFiniteElement()->GetGaussPointNumber(); ig++) {
+   *       batch.Evaluate(ig);
+   *       for(e = 0; e < batch.GetBlockSize(); e++) ... batch.GetWeight(e), batch.GetGradPhi(e, i, k) ...
+   *     }
+   *   }
+   */
+  class ElementBatch {
+
+    public:
+
+      /** Constructor, blocks the owned elements of msh for the Lagrange solType.
+       * If displacement is not empty, its dim vectors of biquadratic/triquadratic dofs are added to the node coordinates */
+      ElementBatch(Mesh *msh, const unsigned &solType,
+                   const std::vector < NumericVector* > &displacement = std::vector < NumericVector* > ());
+
+      /** Get the number of blocks */
+      unsigned GetNumberOfBlocks() const {
+        return _blockOffset.size() - 1u;
+      }
+
+      /** Gather the node coordinates of the elements of the block ib, that becomes the current block */
+      void SetBlock(const unsigned &ib);
+
+      /** Get the number of elements of the current block */
+      unsigned GetBlockSize() const {
+        return _nBlock;
+      }
+
+      /** Get the mesh element e of the current block */
+      unsigned GetElement(const unsigned &e) const {
+        return _element[_blockOffset[_block] + e];
+      }
+
+      /** Get the finite element object of the current block */
+      const elem_type* GetFiniteElement() const {
+        return _fe;
+      }
+
+      /** Evaluate weights, physical gradients and, if inverseJacobian, the inverse coordinate Jacobians
+       * at the Gauss point ig for all the elements of the current block */
+      void Evaluate(const unsigned &ig, const bool &inverseJacobian = false);
+
+      /** Get the weight of the element e at the last evaluated Gauss point */
+      double GetWeight(const unsigned &e) const {
+        return _weight[e];
+      }
+
+      /** Get the derivative in the direction k of the shape function i of the element e at the last evaluated Gauss point */
+      double GetGradPhi(const unsigned &e, const unsigned &i, const unsigned &k) const {
+        return _gradPhi[(i * _dim + k) * _nBlock + e];
+      }
+
+      /** Get the entry (k, l) of the inverse coordinate Jacobian of the element e at the last evaluated Gauss point */
+      double GetInverseJacobian(const unsigned &e, const unsigned &k, const unsigned &l) const {
+        return _inverseJacobian[(k * _dim + l) * _nBlock + e];
+      }
+
+    private:
+
+      Mesh *_msh;
+      unsigned _solType;
+      unsigned _dim;
+      std::vector < NumericVector* > _displacement;
+
+      // the elements of block ib are _element[_blockOffset[ib]] ... _element[_blockOffset[ib + 1] - 1]
+      std::vector < unsigned > _element;
+      std::vector < unsigned > _blockOffset;
+
+      // current block
+      unsigned _block;
+      unsigned _nBlock;
+      unsigned _nDofs;
+      const elem_type *_fe;
+
+      // structure of arrays buffers
+      std::vector < double > _x;
+      std::vector < double > _weight;
+      std::vector < double > _gradPhi;
+      std::vector < double > _inverseJacobian;
+  };
+
+} //end namespace femus
+
+#endif
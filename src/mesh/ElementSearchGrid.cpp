@@ -0,0 +1,207 @@
+/*=========================================================================
+
+ Program: FEMUS
+ Module: ElementSearchGrid
+ Authors: Eugenio Aulisa
+
+ Copyright (c) FEMTTU
+ All rights reserved.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+//----------------------------------------------------------------------------
+// includes :
+//----------------------------------------------------------------------------
+#include "ElementSearchGrid.hpp"
+#include "Mesh.hpp"
+#include "NumericVector.hpp"
+
+#include <mpi.h>
+#include <cmath>
+#include <climits>
+
+namespace femus {
+
+  // relative enlargement of the element boxes, it covers the curved edges of the quadratic elements
+  const double boxTolerance = 0.05;
+
+  // ********************************************
+
+  ElementSearchGrid::ElementSearchGrid(Mesh *msh) {
+
+    _dim = msh->GetDimension();
+
+    _iproc = msh->processor_id();
+    unsigned nprocs = msh->n_processors();
+    _elementOffset = msh->_elementOffset[_iproc];
+    unsigned elementEnd = msh->_elementOffset[_iproc + 1];
+    unsigned nel = elementEnd - _elementOffset;
+
+    //BEGIN element and process boxes
+    std::vector < double > localBox(2 * _dim);
+    for(unsigned k = 0; k < _dim; k++) {
+      localBox[k] = 1.0e100;
+      localBox[_dim + k] = -1.0e100;
+    }
+
+    _elementBox.resize(2 * _dim * nel);
+
+    for(unsigned iel = _elementOffset; iel < elementEnd; iel++) {
+      double *box = &_elementBox[2 * _dim * (iel - _elementOffset)];
+
+      for(unsigned k = 0; k < _dim; k++) {
+        box[k] = 1.0e100;
+        box[_dim + k] = -1.0e100;
+      }
+
+      unsigned nDofs = msh->GetElementDofNumber(iel, 2);
+      for(unsigned i = 0; i < nDofs; i++) {
+        unsigned xDof = msh->GetSolutionDof(i, iel, 2);
+        for(unsigned k = 0; k < _dim; k++) {
+          double xk = (*msh->_topology->_Sol[k])(xDof);
+          box[k] = (xk < box[k]) ? xk : box[k];
+          box[_dim + k] = (xk > box[_dim + k]) ? xk : box[_dim + k];
+        }
+      }
+
+      for(unsigned k = 0; k < _dim; k++) {
+        double delta = boxTolerance * (box[_dim + k] - box[k]) + 1.0e-12;
+        box[k] -= delta;
+        box[_dim + k] += delta;
+
+        localBox[k] = (box[k] < localBox[k]) ? box[k] : localBox[k];
+        localBox[_dim + k] = (box[_dim + k] > localBox[_dim + k]) ? box[_dim + k] : localBox[_dim + k];
+      }
+    }
+
+    _processBox.resize(2 * _dim * nprocs);
+    MPI_Allgather(&localBox[0], 2 * _dim, MPI_DOUBLE, &_processBox[0], 2 * _dim, MPI_DOUBLE, PETSC_COMM_WORLD);
+    //END
+
+    //BEGIN uniform grid, with about one element per bin
+    double volume = 1.;
+    for(unsigned k = 0; k < _dim; k++) {
+      volume *= (nel > 0) ? localBox[_dim + k] - localBox[k] : 0.;
+    }
+    double h = (nel > 0 && volume > 0.) ? pow(volume / nel, 1. / _dim) : 1.;
+
+    unsigned nBins = 1;
+    for(unsigned k = 0; k < 3; k++) {
+      _gridOrigin[k] = 0.;
+      _binSize[k] = 1.;
+      _nBins[k] = 1;
+    }
+    for(unsigned k = 0; k < _dim; k++) {
+      double length = (nel > 0) ? localBox[_dim + k] - localBox[k] : 0.;
+      _gridOrigin[k] = (nel > 0) ? localBox[k] : 0.;
+      _nBins[k] = (length > 0.) ? static_cast < unsigned >(ceil(length / h)) : 1u;
+      if(_nBins[k] > nel + 1) _nBins[k] = nel + 1; // anisotropic boxes
+      _binSize[k] = (length > 0.) ? length / _nBins[k] : 1.;
+      nBins *= _nBins[k];
+    }
+
+    // count and fill, the bins are ordered with the first direction running fastest
+    std::vector < unsigned > binMin(_dim), binMax(_dim), bin(_dim);
+    _binOffset.assign(nBins + 1, 0);
+
+    for(unsigned fill = 0; fill < 2; fill++) {
+      if(fill == 1) {
+        for(unsigned b = 0; b < nBins; b++) {
+          _binOffset[b + 1] += _binOffset[b];
+        }
+        _binElement.resize(_binOffset[nBins]);
+      }
+      std::vector < unsigned > counter(_binOffset.begin(), _binOffset.end() - 1);
+
+      for(unsigned i = 0; i < nel; i++) {
+        const double *box = &_elementBox[2 * _dim * i];
+        for(unsigned k = 0; k < _dim; k++) {
+          binMin[k] = GetBin(box[k], k);
+          binMax[k] = GetBin(box[_dim + k], k);
+          bin[k] = binMin[k];
+        }
+
+        // loop over the bins overlapped by the box
+        while(true) {
+          unsigned b = 0;
+          for(int k = _dim - 1; k >= 0; k--) {
+            b = b * _nBins[k] + bin[k];
+          }
+
+          if(fill == 0) _binOffset[b + 1]++;
+          else _binElement[counter[b]++] = i;
+
+          unsigned k = 0;
+          while(k < _dim && bin[k] == binMax[k]) {
+            bin[k] = binMin[k];
+            k++;
+          }
+          if(k == _dim) break;
+          bin[k]++;
+        }
+      }
+    }
+    //END
+  }
+
+  // ********************************************
+
+  unsigned ElementSearchGrid::GetBin(const double &x, const unsigned &k) const {
+    double r = (x - _gridOrigin[k]) / _binSize[k];
+    if(r <= 0.) return 0;
+    unsigned b = static_cast < unsigned >(r);
+    return (b < _nBins[k]) ? b : _nBins[k] - 1;
+  }
+
+  // ********************************************
+
+  bool ElementSearchGrid::IsInsideProcessBox(const std::vector < double > &x, const unsigned &jproc) const {
+    const double *box = &_processBox[2 * _dim * jproc];
+    for(unsigned k = 0; k < _dim; k++) {
+      if(x[k] < box[k] || x[k] > box[_dim + k]) return false;
+    }
+    return true;
+  }
+
+  // ********************************************
+
+  unsigned ElementSearchGrid::GetSeedElement(const std::vector < double > &x) const {
+
+    if(_elementBox.size() == 0 || !IsInsideProcessBox(x, _iproc)) return UINT_MAX;
+
+    unsigned b = 0;
+    for(int k = _dim - 1; k >= 0; k--) {
+      b = b * _nBins[k] + GetBin(x[k], k);
+    }
+
+    unsigned seed = UINT_MAX;
+    bool seedContainsX = false;
+    double distance2Min = 1.0e100;
+
+    for(unsigned j = _binOffset[b]; j < _binOffset[b + 1]; j++) {
+      const double *box = &_elementBox[2 * _dim * _binElement[j]];
+
+      bool containsX = true;
+      double distance2 = 0.;
+      for(unsigned k = 0; k < _dim; k++) {
+        if(x[k] < box[k] || x[k] > box[_dim + k]) containsX = false;
+        double dk = 0.5 * (box[k] + box[_dim + k]) - x[k];
+        distance2 += dk * dk;
+      }
+
+      // the boxes that contain x win over the closer ones that do not
+      if((containsX && !seedContainsX) || (containsX == seedContainsX && distance2 < distance2Min)) {
+        seed = _binElement[j];
+        seedContainsX = containsX;
+        distance2Min = distance2;
+      }
+    }
+
+    return (seed != UINT_MAX) ? _elementOffset + seed : UINT_MAX;
+  }
+
+} //end namespace femus
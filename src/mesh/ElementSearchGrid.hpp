@@ -0,0 +1,75 @@
+/*=========================================================================
+
+ Program: FEMUS
+ Module: ElementSearchGrid
+ Authors: Eugenio Aulisa
+
+ Copyright (c) FEMTTU
+ All rights reserved.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+#ifndef __femus_mesh_ElementSearchGrid_hpp__
+#define __femus_mesh_ElementSearchGrid_hpp__
+
+//----------------------------------------------------------------------------
+// includes :
+//----------------------------------------------------------------------------
+#include <vector>
+
+namespace femus {
+
+  class Mesh;
+
+  /**
+   * Point location index of a mesh level.
+   * The bounding boxes of the owned elements, slightly enlarged, are binned in a uniform grid
+   * with about one element per bin, so that the owned elements that may contain a point are found in O(1).
+   * The bounding boxes of the elements of every process are also stored, to know which processes may contain a point.
+   * The boxes refer to the node coordinates at construction, the index has to be rebuilt when they change.
+   * The index gives the seed of the element to element walk of Marker, it does not replace it.
+   */
+  class ElementSearchGrid {
+
+    public:
+
+      /** Constructor, collective on the mesh communicator */
+      ElementSearchGrid(Mesh *msh);
+
+      /** Get the owned element whose box contains x with the closest box center, or, if no box contains x,
+       * the owned element of the bin of x with the closest box center. UINT_MAX if the bin of x is empty or x is outside the process box */
+      unsigned GetSeedElement(const std::vector < double > &x) const;
+
+      /** Return true if x is inside the box of the elements of the process jproc */
+      bool IsInsideProcessBox(const std::vector < double > &x, const unsigned &jproc) const;
+
+    private:
+
+      /** Get the bin index of x in the direction k, clamped to the grid */
+      unsigned GetBin(const double &x, const unsigned &k) const;
+
+      unsigned _dim;
+      unsigned _iproc;
+      unsigned _elementOffset;
+
+      // owned element i: _elementBox[(2 * i) * _dim + k] min, _elementBox[(2 * i + 1) * _dim + k] max
+      std::vector < double > _elementBox;
+
+      // process jproc: _processBox[(2 * jproc) * _dim + k] min, _processBox[(2 * jproc + 1) * _dim + k] max
+      std::vector < double > _processBox;
+
+      // uniform grid, the elements of the bin b are _binElement[_binOffset[b]] ... _binElement[_binOffset[b + 1] - 1]
+      double _gridOrigin[3];
+      double _binSize[3];
+      unsigned _nBins[3];
+      std::vector < unsigned > _binOffset;
+      std::vector < unsigned > _binElement;
+  };
+
+} //end namespace femus
+
+#endif
@@ -20,6 +20,7 @@
 //C++ include
 #include "cstdio"
 #include "fstream"
+#include <mpi.h>
 
 
 namespace femus {
@@ -76,10 +77,26 @@ namespace femus {
 //     {{ -1. / 9., -1. / 9., -1. / 9., 4. / 9., 4. / 9., 4. / 9.}}
 //   };
 
+  bool GambitIO::BroadcastStatus(const bool &ok) const {
+    int status = ok;
+    MPI_Bcast(&status, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    return status;
+  }
+
+  void GambitIO::BroadcastChunk(std::vector < unsigned > &buffer) const {
+    unsigned size = buffer.size();
+    MPI_Bcast(&size, 1, MPI_UNSIGNED, 0, MPI_COMM_WORLD);
+    buffer.resize(size);
+    if(size > 0) MPI_Bcast(&buffer[0], size, MPI_UNSIGNED, 0, MPI_COMM_WORLD);
+  }
+
   void GambitIO::read(const std::string& name, vector < vector < double> > &coords, const double Lref, std::vector<bool> &type_elem_flag) {
 
     Mesh& mesh = GetMesh();
 
+    // only the process 0 parses the file, the other processes receive the parsed data in chunks
+    const bool reader = (mesh.processor_id() == 0);
+
     std::ifstream inf;
     std::string str2;
     unsigned ngroup;
@@ -90,231 +107,288 @@ namespace femus {
     unsigned nvt0;
     unsigned nel;
 
+    std::vector < unsigned > buffer;
+
     mesh.SetLevel(0);
     // read control data ******************** A
-    inf.open(name.c_str());
-    if(!inf) {
-      std::cout << "Generic-mesh file " << name << " can not read parameters\n";
-      exit(0);
+    unsigned control[5] = {0, 0, 0, 0, 0};
+    bool ok = true;
+    if(reader) {
+      inf.open(name.c_str());
+      if(!inf) {
+        std::cout << "Generic-mesh file " << name << " can not read parameters\n";
+        ok = false;
+      }
+      else {
+        str2 = "0";
+        while(str2.compare("NDFVL") != 0) inf >> str2;
+        inf >> control[0] >> control[1] >> control[2] >> control[3] >> control[4] >> str2 ;
+        inf >> str2;
+        if(str2.compare("ENDOFSECTION") != 0) {
+          std::cout << "error control data mesh" << std::endl;
+          ok = false;
+        }
+        inf.close();
+      }
     }
-    str2 = "0";
-    while(str2.compare("NDFVL") != 0) inf >> str2;
-    inf >> nvt >> nel >>  ngroup >> nbcd >> dim >> str2 ;
+    if(!BroadcastStatus(ok)) exit(0);
+    MPI_Bcast(control, 5, MPI_UNSIGNED, 0, MPI_COMM_WORLD);
+    nvt = control[0];
+    nel = control[1];
+    ngroup = control[2];
+    nbcd = control[3];
+    dim = control[4];
     nvt0 = nvt;
     mesh.SetDimension(dim);
     mesh.SetNumberOfElements(nel);
     mesh.SetNumberOfNodes(nvt);
-    inf >> str2;
-    if(str2.compare("ENDOFSECTION") != 0) {
-      std::cout << "error control data mesh" << std::endl;
-      exit(0);
-    }
 //   std::cout << "***************" << _dimension << std::endl;
-    inf.close();
     // end read control data **************** A
     // read ELEMENT/cell ******************** B
-    inf.open(name.c_str());
-    if(!inf) {
-      std::cout << "Generic-mesh file " << name << " cannot read elements\n";
-      exit(0);
-    }
-    mesh.el = new elem(nel);
-    while(str2.compare("ELEMENTS/CELLS") != 0) inf >> str2;
-    inf >> str2;
-    for(unsigned iel = 0; iel < nel; iel++) {
-      mesh.el->SetElementGroup(iel, 1);
-      unsigned nve;
-      unsigned elementType;
-      inf >> str2 >> str2 >> nve;
-      if(nve == 27) {
-        type_elem_flag[0] = type_elem_flag[3] = true;
-        mesh.el->AddToElementNumber(1, "Hex");
-        mesh.el->SetElementType(iel, 0);
-	elementType = 0;
-      }
-      else if(nve == 10) {
-        type_elem_flag[1] = type_elem_flag[4] = true;
-        mesh.el->AddToElementNumber(1, "Tet");
-        mesh.el->SetElementType(iel, 1);
-	elementType = 1;
-      }
-      else if(nve == 18) {
-        type_elem_flag[2] = type_elem_flag[3] = type_elem_flag[4] = true;
-        mesh.el->AddToElementNumber(1, "Wedge");
-        mesh.el->SetElementType(iel, 2);
-	elementType = 2;
-      }
-      else if(nve == 9) {
-        type_elem_flag[3] = true;
-        mesh.el->AddToElementNumber(1, "Quad");
-        mesh.el->SetElementType(iel, 3);
-	elementType = 3;
-      }
-      else if(nve == 6 && mesh.GetDimension() == 2) {
-        type_elem_flag[4] = true;
-        mesh.el->AddToElementNumber(1, "Triangle");
-        mesh.el->SetElementType(iel, 4);
-	elementType = 4;
-      }
-      else if(nve == 3 && mesh.GetDimension() == 1) {
-        mesh.el->AddToElementNumber(1, "Line");
-        mesh.el->SetElementType(iel, 5);
-	elementType = 5;
+    if(reader) {
+      inf.open(name.c_str());
+      if(!inf) {
+        std::cout << "Generic-mesh file " << name << " cannot read elements\n";
+        ok = false;
       }
       else {
-        std::cout << "Error! Invalid element type in reading Gambit File!" << std::endl;
-        std::cout << "Error! Use a second order discretization" << std::endl;
-        exit(0);
+        while(str2.compare("ELEMENTS/CELLS") != 0) inf >> str2;
+        inf >> str2;
+      }
+    }
+    if(!BroadcastStatus(ok)) exit(0);
+    mesh.el = new elem(nel);
+    for(unsigned iel0 = 0; iel0 < nel; iel0 += _chunkSize) {
+      const unsigned iel1 = (nel - iel0 > _chunkSize) ? iel0 + _chunkSize : nel;
+      // chunk: number of nodes and Gambit nodes of each element
+      buffer.resize(0);
+      if(reader) {
+        for(unsigned iel = iel0; iel < iel1; iel++) {
+          unsigned nve;
+          inf >> str2 >> str2 >> nve;
+          buffer.push_back(nve);
+          for(unsigned i = 0; i < nve; i++) {
+            unsigned value;
+            inf >> value;
+            buffer.push_back(value);
+          }
+        }
       }
-      for(unsigned i = 0; i < nve; i++) {
-        unsigned inode = GambitIO::GambitToFemusVertexIndex[mesh.el->GetElementType(iel)][i];
-        unsigned value;
-        inf >> value;
-        mesh.el->SetElementDofIndex(iel, inode, value - 1u);
+      BroadcastChunk(buffer);
+
+      unsigned j = 0;
+      for(unsigned iel = iel0; iel < iel1; iel++) {
+        mesh.el->SetElementGroup(iel, 1);
+        unsigned nve = buffer[j++];
+        if(nve == 27) {
+          type_elem_flag[0] = type_elem_flag[3] = true;
+          mesh.el->AddToElementNumber(1, "Hex");
+          mesh.el->SetElementType(iel, 0);
+        }
+        else if(nve == 10) {
+          type_elem_flag[1] = type_elem_flag[4] = true;
+          mesh.el->AddToElementNumber(1, "Tet");
+          mesh.el->SetElementType(iel, 1);
+        }
+        else if(nve == 18) {
+          type_elem_flag[2] = type_elem_flag[3] = type_elem_flag[4] = true;
+          mesh.el->AddToElementNumber(1, "Wedge");
+          mesh.el->SetElementType(iel, 2);
+        }
+        else if(nve == 9) {
+          type_elem_flag[3] = true;
+          mesh.el->AddToElementNumber(1, "Quad");
+          mesh.el->SetElementType(iel, 3);
+        }
+        else if(nve == 6 && mesh.GetDimension() == 2) {
+          type_elem_flag[4] = true;
+          mesh.el->AddToElementNumber(1, "Triangle");
+          mesh.el->SetElementType(iel, 4);
+        }
+        else if(nve == 3 && mesh.GetDimension() == 1) {
+          mesh.el->AddToElementNumber(1, "Line");
+          mesh.el->SetElementType(iel, 5);
+        }
+        else {
+          std::cout << "Error! Invalid element type in reading Gambit File!" << std::endl;
+          std::cout << "Error! Use a second order discretization" << std::endl;
+          exit(0);
+        }
+        for(unsigned i = 0; i < nve; i++) {
+          unsigned inode = GambitIO::GambitToFemusVertexIndex[mesh.el->GetElementType(iel)][i];
+          mesh.el->SetElementDofIndex(iel, inode, buffer[j++] - 1u);
+        }
       }
     }
-    
-    //GambitIO::BiquadraticNodesNotInGambit(mesh);
-    //nvt = mesh.GetNumberOfNodes();
-       
-    inf >> str2;
-    if(str2.compare("ENDOFSECTION") != 0) {
-      std::cout << "error element data mesh" << std::endl;
-      exit(0);
+
+    if(reader) {
+      inf >> str2;
+      if(str2.compare("ENDOFSECTION") != 0) {
+        std::cout << "error element data mesh" << std::endl;
+        ok = false;
+      }
+      inf.close();
     }
-    inf.close();
+    if(!BroadcastStatus(ok)) exit(0);
 
     // end read  ELEMENT/CELL **************** B
 
     // read NODAL COORDINATES **************** C
-    inf.open(name.c_str());
-    if(!inf) {
-      std::cout << "Generic-mesh file " << name << " cannot read nodes\n";
-      exit(0);
-    }
-    while(str2.compare("COORDINATES") != 0) inf >> str2;
-    inf >> str2;  // 2.0.4
-    coords[0].resize(nvt);
-    coords[1].resize(nvt);
-    coords[2].resize(nvt);
-
-    if(mesh.GetDimension() == 3) {
-      for(unsigned j = 0; j < nvt0; j++) {
-        inf >> str2 >> x >> y >> z;
-        coords[0][j] = x / Lref;
-        coords[1][j] = y / Lref;
-        coords[2][j] = z / Lref;
-      }
-    }
-    else if(mesh.GetDimension() == 2) {
-      for(unsigned j = 0; j < nvt0; j++) {
-        inf >> str2 >> x >> y;
-        coords[0][j] = x / Lref;
-        coords[1][j] = y / Lref;
-        coords[2][j] = 0.;
+    // the coordinates stay on the reader, Mesh scatters them once the nodes are partitioned
+    coords[0].resize(0);
+    coords[1].resize(0);
+    coords[2].resize(0);
+    if(reader) {
+      inf.open(name.c_str());
+      if(!inf) {
+        std::cout << "Generic-mesh file " << name << " cannot read nodes\n";
+        ok = false;
       }
-    }
-    else if(mesh.GetDimension() == 1) {
-      for(unsigned j = 0; j < nvt0; j++) {
-        inf >> str2 >> x;
-        coords[0][j] = x / Lref;
-        coords[1][j] = 0.;
-        coords[2][j] = 0.;
+      else {
+        while(str2.compare("COORDINATES") != 0) inf >> str2;
+        inf >> str2;  // 2.0.4
+        coords[0].resize(nvt);
+        coords[1].resize(nvt);
+        coords[2].resize(nvt);
+
+        if(mesh.GetDimension() == 3) {
+          for(unsigned j = 0; j < nvt0; j++) {
+            inf >> str2 >> x >> y >> z;
+            coords[0][j] = x / Lref;
+            coords[1][j] = y / Lref;
+            coords[2][j] = z / Lref;
+          }
+        }
+        else if(mesh.GetDimension() == 2) {
+          for(unsigned j = 0; j < nvt0; j++) {
+            inf >> str2 >> x >> y;
+            coords[0][j] = x / Lref;
+            coords[1][j] = y / Lref;
+            coords[2][j] = 0.;
+          }
+        }
+        else if(mesh.GetDimension() == 1) {
+          for(unsigned j = 0; j < nvt0; j++) {
+            inf >> str2 >> x;
+            coords[0][j] = x / Lref;
+            coords[1][j] = 0.;
+            coords[2][j] = 0.;
+          }
+        }
+        inf >> str2; // "ENDOFSECTION"
+        if(str2.compare("ENDOFSECTION") != 0) {
+          std::cout << "error node data mesh 1" << std::endl;
+          ok = false;
+        }
+        inf.close();
       }
     }
-    inf >> str2; // "ENDOFSECTION"
-    if(str2.compare("ENDOFSECTION") != 0) {
-      std::cout << "error node data mesh 1" << std::endl;
-      exit(0);
-    }
-    
-    // add the coordinates of the biquadratic nodes not included in gambit
-/*    for(int iel = 0; iel < nel; iel++) {
-      unsigned elementType = mesh.el->GetElementType(iel);
-      
-      unsigned ndof = mesh.el->GetElementDofNumber(iel,2);
-      unsigned jstart = ndof - _numberOfMissedBiquadraticNodes[elementType];
-            
-      for(unsigned j = jstart; j < ndof; j++){
-	
-	unsigned jnode = mesh.el->GetElementDofIndex(iel, j);
-	
-	coords[0][jnode] = 0.;
-        coords[1][jnode] = 0.;
-        coords[2][jnode] = 0.;
-        for(int i = 0; i < jstart; i++) {
-          unsigned inode = mesh.el->GetElementDofIndex(iel, i);
-          for(int k = 0; k < mesh.GetDimension(); k++) {
-	    coords[k][jnode] += coords[k][inode] * _baricentricWeight[ elementType ][j - jstart][i];
-          }          
-        }  
-      }     
-    }*/   
-
-    
-    inf.close();
+    if(!BroadcastStatus(ok)) exit(0);
     // end read NODAL COORDINATES ************* C
 
     // read GROUP **************** E
-    inf.open(name.c_str());
-    if(!inf) {
-      std::cout << "Generic-mesh file " << name << " cannot read group\n";
-      exit(0);
+    if(reader) {
+      inf.open(name.c_str());
+      if(!inf) {
+        std::cout << "Generic-mesh file " << name << " cannot read group\n";
+        ok = false;
+      }
     }
+    if(!BroadcastStatus(ok)) exit(0);
     std::vector < unsigned > materialElementCounter(3,0);
     mesh.el->SetElementGroupNumber(ngroup);
     for(unsigned k = 0; k < ngroup; k++) {
-      int ngel;
-      int gr_name;
-      int gr_mat;
-      while(str2.compare("GROUP:") != 0) inf >> str2;
-      inf >> str2 >> str2 >> ngel >> str2 >> gr_mat >> str2 >> str2 >> gr_name >> str2;
-      for(int i = 0; i < ngel; i++) {
-        int iel;
-        inf >> iel;
-        mesh.el->SetElementGroup(iel - 1, gr_name);
-        mesh.el->SetElementMaterial(iel - 1, gr_mat);
-	if( gr_mat == 2) materialElementCounter[0] += 1;
-	else if(gr_mat == 3 ) materialElementCounter[1] += 1;
-	else materialElementCounter[2] += 1;
+      int group[3] = {0, 0, 0}; // ngel, gr_mat, gr_name
+      if(reader) {
+        while(str2.compare("GROUP:") != 0) inf >> str2;
+        inf >> str2 >> str2 >> group[0] >> str2 >> group[1] >> str2 >> str2 >> group[2] >> str2;
       }
-      inf >> str2;
-      if(str2.compare("ENDOFSECTION") != 0) {
-        std::cout << "error group data mesh" << std::endl;
-        exit(0);
+      MPI_Bcast(group, 3, MPI_INT, 0, MPI_COMM_WORLD);
+      int ngel = group[0];
+      int gr_mat = group[1];
+      int gr_name = group[2];
+      for(int i0 = 0; i0 < ngel; i0 += _chunkSize) {
+        const int i1 = (ngel - i0 > static_cast < int >(_chunkSize)) ? i0 + _chunkSize : ngel;
+        buffer.resize(0);
+        if(reader) {
+          for(int i = i0; i < i1; i++) {
+            unsigned iel;
+            inf >> iel;
+            buffer.push_back(iel);
+          }
+        }
+        BroadcastChunk(buffer);
+        for(unsigned i = 0; i < buffer.size(); i++) {
+          mesh.el->SetElementGroup(buffer[i] - 1, gr_name);
+          mesh.el->SetElementMaterial(buffer[i] - 1, gr_mat);
+          if( gr_mat == 2) materialElementCounter[0] += 1;
+          else if(gr_mat == 3 ) materialElementCounter[1] += 1;
+          else materialElementCounter[2] += 1;
+        }
+      }
+      if(reader) {
+        inf >> str2;
+        if(str2.compare("ENDOFSECTION") != 0) {
+          std::cout << "error group data mesh" << std::endl;
+          ok = false;
+        }
       }
+      if(!BroadcastStatus(ok)) exit(0);
     }
     mesh.el->SetMaterialElementCounter(materialElementCounter);
-    inf.close();
+    if(reader) inf.close();
     // end read GROUP **************** E
 
     // read boundary **************** D
-    inf.open(name.c_str());
-    if(!inf) {
-      std::cout << "Generic-mesh file " << name << " cannot read boudary\n";
-      exit(0);
+    if(reader) {
+      inf.open(name.c_str());
+      if(!inf) {
+        std::cout << "Generic-mesh file " << name << " cannot read boudary\n";
+        ok = false;
+      }
     }
+    if(!BroadcastStatus(ok)) exit(0);
     for(unsigned k = 0; k < nbcd; k++) {
-      while(str2.compare("CONDITIONS") != 0) inf >> str2;
-      inf >> str2;
-      int value;
-      unsigned nface;
-      inf >> value >> str2 >> nface >> str2 >> str2;
-      value = -value - 1;
-      for(unsigned i = 0; i < nface; i++) {
-        unsigned iel, iface;
-        inf >> iel >> str2 >> iface;
-        iel--;
-        iface = GambitIO::GambitToFemusFaceIndex[mesh.el->GetElementType(iel)][iface - 1u];
-        mesh.el->SetFaceElementIndex(iel, iface, value);
+      int condition[2] = {0, 0}; // value, nface
+      if(reader) {
+        while(str2.compare("CONDITIONS") != 0) inf >> str2;
+        inf >> str2;
+        unsigned nface;
+        inf >> condition[0] >> str2 >> nface >> str2 >> str2;
+        condition[1] = nface;
       }
-      inf >> str2;
-      if(str2.compare("ENDOFSECTION") != 0) {
-        std::cout << "error boundary data mesh" << std::endl;
-        exit(0);
+      MPI_Bcast(condition, 2, MPI_INT, 0, MPI_COMM_WORLD);
+      int value = -condition[0] - 1;
+      unsigned nface = condition[1];
+      for(unsigned i0 = 0; i0 < nface; i0 += _chunkSize) {
+        const unsigned i1 = (nface - i0 > _chunkSize) ? i0 + _chunkSize : nface;
+        // chunk: element and Gambit face pairs
+        buffer.resize(0);
+        if(reader) {
+          for(unsigned i = i0; i < i1; i++) {
+            unsigned iel, iface;
+            inf >> iel >> str2 >> iface;
+            buffer.push_back(iel);
+            buffer.push_back(iface);
+          }
+        }
+        BroadcastChunk(buffer);
+        for(unsigned i = 0; i < buffer.size(); i += 2) {
+          unsigned iel = buffer[i] - 1u;
+          unsigned iface = GambitIO::GambitToFemusFaceIndex[mesh.el->GetElementType(iel)][buffer[i + 1] - 1u];
+          mesh.el->SetFaceElementIndex(iel, iface, value);
+        }
+      }
+      if(reader) {
+        inf >> str2;
+        if(str2.compare("ENDOFSECTION") != 0) {
+          std::cout << "error boundary data mesh" << std::endl;
+          ok = false;
+        }
       }
+      if(!BroadcastStatus(ok)) exit(0);
     }
-    inf.close();
+    if(reader) inf.close();
     // end read boundary **************** D
 
   };
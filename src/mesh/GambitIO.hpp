@@ -47,7 +47,10 @@ class GambitIO : public MeshInput<Mesh>
   /**
    * Reads in a mesh in the neutral gambit *.neu format
    * from the ASCII file given by name.
-   *
+   * Only the process 0 parses the file and broadcasts the elements, the groups and the boundary faces in chunks,
+   * the coordinates are returned on the process 0 only.
+   * Every process still stores the connectivity of all the elements, as the mesh setup before ScatterElement*
+   * needs the global element structure: the chunks avoid the parsing on every process, not the memory of the global mesh.
    */
   virtual void read (const std::string& name, vector < vector < double> > &coords, const double Lref, std::vector<bool> &type_elem_flag);
   
@@ -55,6 +58,15 @@ class GambitIO : public MeshInput<Mesh>
 
  private:
    
+   /** Broadcast from the reader the status of the read, false stops all the processes */
+   bool BroadcastStatus(const bool &ok) const;
+
+   /** Broadcast from the reader a chunk of parsed data */
+   void BroadcastChunk(std::vector < unsigned > &buffer) const;
+
+   /** Number of elements, group entries or boundary faces parsed and broadcast at once */
+   static const unsigned _chunkSize = 65536;
+
    /** Map from Gambit vertex index to Femus vertex index */
    static const unsigned GambitToFemusVertexIndex[N_GEOM_ELS][MAX_EL_N_NODES]; 
  
@@ -0,0 +1,120 @@
+/*=========================================================================
+
+ Program: FEMUS
+ Module: GeometryCache
+ Authors: Eugenio Aulisa
+
+ Copyright (c) FEMTTU
+ All rights reserved.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+//----------------------------------------------------------------------------
+// includes :
+//----------------------------------------------------------------------------
+#include "GeometryCache.hpp"
+#include "Mesh.hpp"
+#include "ElementBatch.hpp"
+
+#include <iostream>
+#include <cstdlib>
+
+namespace femus {
+
+  // ********************************************
+
+  GeometryCache::GeometryCache(Mesh *msh, const unsigned &solType, const std::vector < NumericVector* > &displacement) :
+    _msh(msh),
+    _solType(solType) {
+
+    if(solType > 2) {
+      std::cout << "Error in GeometryCache: the geometry can be cached only for the Lagrange families 0, 1 and 2" << std::endl;
+      abort();
+    }
+
+    _dim = msh->GetDimension();
+
+    unsigned iproc = msh->processor_id();
+    _elementOffset = msh->_elementOffset[iproc];
+    unsigned elementEnd = msh->_elementOffset[iproc + 1];
+    unsigned nel = elementEnd - _elementOffset;
+
+    // sizes
+    _gaussOffset.resize(nel + 1);
+    _gaussOffset[0] = 0;
+
+    for(unsigned iel = _elementOffset; iel < elementEnd; iel++) {
+      const elem_type *fe = msh->_finiteElement[msh->GetElementType(iel)][_solType];
+      _gaussOffset[iel - _elementOffset + 1] = _gaussOffset[iel - _elementOffset] + fe->GetGaussPointNumber();
+    }
+
+    unsigned nGauss = _gaussOffset[nel];
+
+    _gradPhiOffset.resize(nGauss + 1);
+    _gradPhiOffset[0] = 0;
+
+    for(unsigned iel = _elementOffset; iel < elementEnd; iel++) {
+      unsigned i = iel - _elementOffset;
+      unsigned gradPhiSize = msh->GetElementDofNumber(iel, _solType) * _dim;
+      for(unsigned k = _gaussOffset[i]; k < _gaussOffset[i + 1]; k++) {
+        _gradPhiOffset[k + 1] = _gradPhiOffset[k] + gradPhiSize;
+      }
+    }
+
+    _weight.resize(nGauss);
+    _inverseJacobian.resize(nGauss * _dim * _dim);
+    _gradPhi.resize(_gradPhiOffset[nGauss]);
+
+    // fill, evaluating blocks of elements of the same type at once
+    ElementBatch batch(msh, _solType, displacement);
+
+    for(unsigned ib = 0; ib < batch.GetNumberOfBlocks(); ib++) {
+      batch.SetBlock(ib);
+      unsigned nDofs = batch.GetFiniteElement()->GetNDofs();
+
+      for(unsigned ig = 0; ig < batch.GetFiniteElement()->GetGaussPointNumber(); ig++) {
+        batch.Evaluate(ig, true);
+
+        for(unsigned e = 0; e < batch.GetBlockSize(); e++) {
+          unsigned k = _gaussOffset[batch.GetElement(e) - _elementOffset] + ig;
+
+          _weight[k] = batch.GetWeight(e);
+
+          for(unsigned i = 0; i < _dim; i++) {
+            for(unsigned j = 0; j < _dim; j++) {
+              _inverseJacobian[(k * _dim + i) * _dim + j] = batch.GetInverseJacobian(e, i, j);
+            }
+          }
+
+          double *gradPhi = &_gradPhi[_gradPhiOffset[k]];
+          for(unsigned i = 0; i < nDofs; i++) {
+            for(unsigned j = 0; j < _dim; j++) {
+              gradPhi[i * _dim + j] = batch.GetGradPhi(e, i, j);
+            }
+          }
+        }
+      }
+    }
+  }
+
+  // ********************************************
+
+  void GeometryCache::Jacobian(const unsigned &iel, const unsigned &ig, double &weight,
+                               std::vector < double > &phi, std::vector < double > &gradphi) const {
+
+    unsigned k = _gaussOffset[Index(iel)] + ig;
+    unsigned gradPhiSize = _gradPhiOffset[k + 1] - _gradPhiOffset[k];
+    unsigned nDofs = gradPhiSize / _dim;
+
+    const double *phiIg = _msh->_finiteElement[_msh->GetElementType(iel)][_solType]->GetPhi(ig);
+
+    weight = _weight[k];
+    phi.assign(phiIg, phiIg + nDofs);
+    gradphi.assign(_gradPhi.begin() + _gradPhiOffset[k], _gradPhi.begin() + _gradPhiOffset[k + 1]);
+  }
+
+} //end namespace femus
@@ -0,0 +1,103 @@
+/*=========================================================================
+
+ Program: FEMUS
+ Module: GeometryCache
+ Authors: Eugenio Aulisa
+
+ Copyright (c) FEMTTU
+ All rights reserved.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+#ifndef __femus_mesh_GeometryCache_hpp__
+#define __femus_mesh_GeometryCache_hpp__
+
+//----------------------------------------------------------------------------
+// includes :
+//----------------------------------------------------------------------------
+#include <vector>
+#include <assert.h>
+
+namespace femus {
+
+  class Mesh;
+  class NumericVector;
+
+  /**
+   * Precomputed geometry of the owned elements of a mesh level for a Lagrange family:
+   * for each element and Gauss point it stores the weight (detJ * w), the inverse coordinate Jacobian
+   * and the physical shape function gradients, as elem_type::Jacobian would compute them from
+   * the element node coordinates. The data are stored element after element in flat arrays.
+   * The node coordinates are those of the mesh plus, for a moving mesh, the displacement given to the constructor;
+   * Mesh::GetGeometryCache takes it from the DX, DY, DZ unknowns of an FSI solution.
+   * A displaced cache has to be freed each time the displacement changes (Mesh::InvalidateDisplacedGeometryCache,
+   * called by Solution::UpdateSol and the prolongation when the solution is FSI).
+   */
+  class GeometryCache {
+
+    public:
+
+      /** Constructor, computes the geometry of the owned elements of msh for the Lagrange solType (0, 1 or 2),
+       * with the node coordinates moved by the biquadratic/triquadratic displacement vectors, if any */
+      GeometryCache(Mesh *msh, const unsigned &solType,
+                    const std::vector < NumericVector* > &displacement = std::vector < NumericVector* > ());
+
+      /** Get the Lagrange family of the cache */
+      unsigned GetSolType() const {
+        return _solType;
+      }
+
+      /** Get the number of Gauss points of the owned element iel */
+      unsigned GetGaussPointNumber(const unsigned &iel) const {
+        unsigned i = Index(iel);
+        return _gaussOffset[i + 1] - _gaussOffset[i];
+      }
+
+      /** Get the weight, detJ times the Gauss weight, of the Gauss point ig of the owned element iel */
+      double GetWeight(const unsigned &iel, const unsigned &ig) const {
+        return _weight[_gaussOffset[Index(iel)] + ig];
+      }
+
+      /** Get the inverse coordinate Jacobian (dim x dim, by row) of the Gauss point ig of the owned element iel */
+      const double* GetInverseJacobian(const unsigned &iel, const unsigned &ig) const {
+        return &_inverseJacobian[(_gaussOffset[Index(iel)] + ig) * _dim * _dim];
+      }
+
+      /** Get the physical shape function gradients (nDofs x dim, by dof) of the Gauss point ig of the owned element iel */
+      const double* GetGradPhi(const unsigned &iel, const unsigned &ig) const {
+        return &_gradPhi[_gradPhiOffset[_gaussOffset[Index(iel)] + ig]];
+      }
+
+      /** Same output of elem_type::Jacobian(x, ig, weight, phi, gradphi) for the owned element iel, without recomputing it */
+      void Jacobian(const unsigned &iel, const unsigned &ig, double &weight, std::vector < double > &phi, std::vector < double > &gradphi) const;
+
+    private:
+
+      /** Local index of the owned element iel */
+      unsigned Index(const unsigned &iel) const {
+        assert(iel >= _elementOffset && iel < _elementOffset + _gaussOffset.size() - 1);
+        return iel - _elementOffset;
+      }
+
+      const Mesh *_msh;
+      unsigned _solType;
+      unsigned _dim;
+      unsigned _elementOffset;
+
+      // the Gauss points of the local element i are _gaussOffset[i] ... _gaussOffset[i + 1] - 1,
+      // the gradients of the Gauss point k start at _gradPhiOffset[k]
+      std::vector < unsigned > _gaussOffset;
+      std::vector < unsigned > _gradPhiOffset;
+
+      std::vector < double > _weight;
+      std::vector < double > _inverseJacobian;
+      std::vector < double > _gradPhi;
+  };
+
+} //end namespace femus
+
+#endif
@@ -19,9 +19,12 @@
 #include "Mesh.hpp"
 #include "MeshGeneration.hpp"
 #include "MeshMetisPartitioning.hpp"
+#include "MeshParMetisPartitioning.hpp"
 #include "GambitIO.hpp"
 #include "SalomeIO.hpp"
 #include "NumericVector.hpp"
+#include "BinaryIO.hpp"
+#include "Solution.hpp"
 
 // C++ includes
 #include <iostream>
@@ -43,6 +46,8 @@ namespace femus
 
   bool Mesh::_IsUserRefinementFunctionDefined = false;
 
+  bool Mesh::_parallelPartitioning = false;
+
   unsigned Mesh::_dimension = 2;
   unsigned Mesh::_ref_index = 4; // 8*DIM[2]+4*DIM[1]+2*DIM[0];
   unsigned Mesh::_face_index = 2; // 4*DIM[2]+2*DIM[1]+1*DIM[0];
@@ -62,6 +67,14 @@ namespace femus
         _ProjQitoQj[itype][jtype] = NULL;
       }
     }
+
+    for(int i = 0; i < 3; i++) {
+      _geometryCache[i] = NULL;
+      _displacedGeometryCache[i] = NULL;
+    }
+
+    _displacementSolution = NULL;
+    _elementSearchGrid = NULL;
   }
 
 
@@ -86,6 +99,8 @@ namespace femus
         _ProjCoarseToFine[i] = NULL;
       }
     }
+
+    InvalidateGeometryCache();
   }
 
 /// print Mesh info
@@ -159,11 +174,19 @@ namespace femus
     std::vector < unsigned > partition;
     partition.reserve(GetNumberOfNodes());
     partition.resize(GetNumberOfElements());
-    MeshMetisPartitioning meshMetisPartitioning(*this);
-    meshMetisPartitioning.DoPartition(partition, false);
+    if(_parallelPartitioning) {
+      MeshParMetisPartitioning meshParMetisPartitioning(*this);
+      meshParMetisPartitioning.DoPartition(partition, false);
+    }
+    else {
+      MeshMetisPartitioning meshMetisPartitioning(*this);
+      meshMetisPartitioning.DoPartition(partition, false);
+    }
     FillISvector(partition);
     partition.resize(0);
 
+    ScatterCoarseCoordinates();
+
     el->BuildElementNearVertex();
 
 
@@ -184,6 +207,11 @@ namespace femus
     _topology->GetSolutionName("Y") = _coords[1];
     _topology->GetSolutionName("Z") = _coords[2];
 
+    // the coordinates live in the topology from now on
+    for(unsigned k = 0; k < 3; k++) {
+      std::vector < double > ().swap(_coords[k]);
+    }
+
 
     _topology->AddSolution("AMR", DISCONTINOUS_POLYNOMIAL, ZERO, 1, 0);
 
@@ -198,10 +226,153 @@ namespace femus
     el->ScatterElementDof();
     el->ScatterElementNearFace();
 
+    BuildElementDofConnectivity();
+
     _amrRestriction.resize(3);
 
   };
 
+  /**
+   *  Scatter the coarse coordinates, stored on the process 0 in the partitioned node order,
+   *  so that each process keeps only the coordinates of its own nodes
+   **/
+  void Mesh::ScatterCoarseCoordinates()
+  {
+    std::vector < int > counts(_nprocs);
+    std::vector < int > displs(_nprocs);
+    for(int jproc = 0; jproc < _nprocs; jproc++) {
+      displs[jproc] = _dofOffset[2][jproc];
+      counts[jproc] = _dofOffset[2][jproc + 1] - _dofOffset[2][jproc];
+    }
+
+    std::vector < double > ownCoords;
+    for(unsigned k = 0; k < 3; k++) {
+      ownCoords.resize(counts[_iproc]);
+      MPI_Scatterv((_iproc == 0) ? _coords[k].data() : NULL, &counts[0], &displs[0], MPI_DOUBLE,
+                   ownCoords.data(), counts[_iproc], MPI_DOUBLE, 0, MPI_COMM_WORLD);
+      _coords[k].swap(ownCoords);
+    }
+  }
+
+  /**
+   *  Write the partitioned mesh of this process: sizes, offsets, ghost maps, element structure,
+   *  dof tables and the owned entries of the topology vectors
+   **/
+  void Mesh::Write(std::ostream& os) const
+  {
+    BinaryWrite(os, _dimension);
+    BinaryWrite(os, _level);
+    BinaryWrite(os, _nelem);
+    BinaryWrite(os, _nnodes);
+    BinaryWrite(os, _meshIsHomogeneous);
+
+    BinaryWrite(os, _elementOffset);
+    for(unsigned i = 0; i < 5; i++) {
+      BinaryWrite(os, _ownSize[i]);
+      BinaryWrite(os, _dofOffset[i]);
+      BinaryWrite(os, _ghostDofs[i]);
+      BinaryWrite(os, _elementDofOffset[i]);
+      BinaryWrite(os, _elementDof[i]);
+    }
+    for(unsigned i = 0; i < 2; i++) {
+      BinaryWrite(os, _ownedGhostMap[i]);
+      BinaryWrite(os, _originalOwnSize[i]);
+    }
+    BinaryWrite(os, _boundaryinfo);
+
+    BinaryWrite(os, _originalElementIndex);
+    BinaryWrite(os, _elementFather);
+    BinaryWrite(os, _elementWeights);
+
+    BinaryWrite(os, _amrRestriction);
+    BinaryWrite(os, _amrSolidMark);
+
+    el->Write(os);
+
+    // X, Y, Z, AMR and solidMrk, in the order of _xIndex ... _solidMarkIndex
+    std::vector < double > ownValues;
+    for(unsigned i = 0; i < 5; i++) {
+      const NumericVector* sol = _topology->_Sol[i];
+      bool allocated = (sol != NULL);
+      BinaryWrite(os, allocated);
+      if(allocated) {
+        ownValues.resize(sol->last_local_index() - sol->first_local_index());
+        for(int j = sol->first_local_index(); j < sol->last_local_index(); j++) {
+          ownValues[j - sol->first_local_index()] = (*sol)(j);
+        }
+        BinaryWrite(os, ownValues);
+      }
+    }
+  }
+
+  /**
+   *  Rebuild the mesh of this process from the stream written by Write, with the same number of processes
+   **/
+  void Mesh::Read(std::istream& is, Mesh* coarseMsh)
+  {
+    _coarseMsh = coarseMsh;
+
+    unsigned dimension = 0;
+    BinaryRead(is, dimension);
+    SetDimension(dimension);
+
+    el = new elem(0);
+
+    _topology = new Solution(this);
+    _topology->AddSolution("X", LAGRANGE, SECOND, 1, 0);
+    _topology->AddSolution("Y", LAGRANGE, SECOND, 1, 0);
+    _topology->AddSolution("Z", LAGRANGE, SECOND, 1, 0);
+    _topology->AddSolution("AMR", DISCONTINOUS_POLYNOMIAL, ZERO, 1, 0);
+    _topology->AddSolution("solidMrk", LAGRANGE, SECOND, 1, 0);
+
+    BinaryRead(is, _level);
+    BinaryRead(is, _nelem);
+    BinaryRead(is, _nnodes);
+    BinaryRead(is, _meshIsHomogeneous);
+
+    BinaryRead(is, _elementOffset);
+    for(unsigned i = 0; i < 5; i++) {
+      BinaryRead(is, _ownSize[i]);
+      BinaryRead(is, _dofOffset[i]);
+      BinaryRead(is, _ghostDofs[i]);
+      BinaryRead(is, _elementDofOffset[i]);
+      BinaryRead(is, _elementDof[i]);
+    }
+    for(unsigned i = 0; i < 2; i++) {
+      BinaryRead(is, _ownedGhostMap[i]);
+      BinaryRead(is, _originalOwnSize[i]);
+    }
+    BinaryRead(is, _boundaryinfo);
+
+    BinaryRead(is, _originalElementIndex);
+    BinaryRead(is, _elementFather);
+    BinaryRead(is, _elementWeights);
+
+    BinaryRead(is, _amrRestriction);
+    BinaryRead(is, _amrSolidMark);
+
+    el->Read(is, (coarseMsh != NULL) ? coarseMsh->el : NULL);
+
+    // the vectors are created collectively: LoadMeshCache checks that the files of all the processes are complete before reading them
+    const char* topologyName[5] = {"X", "Y", "Z", "AMR", "solidMrk"};
+    std::vector < double > ownValues;
+    for(unsigned i = 0; i < 5; i++) {
+      bool allocated = false;
+      BinaryRead(is, allocated);
+      if(allocated) {
+        BinaryRead(is, ownValues);
+        _topology->ResizeSolutionVector(topologyName[i]);
+        if(is && ownValues.size() == static_cast < unsigned >(_topology->_Sol[i]->local_size())) {
+          *_topology->_Sol[i] = ownValues;
+          _topology->_Sol[i]->close();
+        }
+        else {
+          is.setstate(std::ios::failbit);
+        }
+      }
+    }
+  }
+
   /**
    *  This function generates the coarse Box Mesh level using the built-in generator
    **/
@@ -236,8 +407,14 @@ namespace femus
     std::vector < unsigned > partition;
     partition.reserve(GetNumberOfNodes());
     partition.resize(GetNumberOfElements());
-    MeshMetisPartitioning meshMetisPartitioning(*this);
-    meshMetisPartitioning.DoPartition(partition, false);
+    if(_parallelPartitioning) {
+      MeshParMetisPartitioning meshParMetisPartitioning(*this);
+      meshParMetisPartitioning.DoPartition(partition, false);
+    }
+    else {
+      MeshMetisPartitioning meshMetisPartitioning(*this);
+      meshMetisPartitioning.DoPartition(partition, false);
+    }
     FillISvector(partition);
     partition.resize(0);
 
@@ -259,6 +436,11 @@ namespace femus
     _topology->GetSolutionName("Y") = _coords[1];
     _topology->GetSolutionName("Z") = _coords[2];
 
+    // the coordinates live in the topology from now on
+    for(unsigned k = 0; k < 3; k++) {
+      std::vector < double > ().swap(_coords[k]);
+    }
+
     _topology->AddSolution("AMR", DISCONTINOUS_POLYNOMIAL, ZERO, 1, 0);
 
     _topology->ResizeSolutionVector("AMR");
@@ -273,6 +455,8 @@ namespace femus
     el->ScatterElementDof();
     el->ScatterElementNearFace();
 
+    BuildElementDofConnectivity();
+
     _amrRestriction.resize(3);
 
   }
@@ -399,6 +583,11 @@ namespace femus
 
     el->ReorderMeshElements(mapping);
 
+    std::vector < unsigned > originalElementIndex(GetNumberOfElements());
+    for(unsigned iel = 0; iel < GetNumberOfElements(); iel++) {
+      originalElementIndex[mapping[iel]] = iel;
+    }
+
 //     for(int isdom = 0; isdom < _nprocs; isdom++) {
 //       for(unsigned iel = _elementOffset[isdom]; iel < _elementOffset[isdom + 1]; iel++) {
 //         std::cout << el->GetElementMaterial(iel) << " ";
@@ -439,6 +628,11 @@ namespace femus
     }
 	
     std::vector < unsigned > ().swap(imapping);
+
+    _originalElementIndex.resize(GetNumberOfElements());
+    for(unsigned i = 0; i < GetNumberOfElements(); i++) {
+      _originalElementIndex[mapping[i]] = originalElementIndex[i];
+    }
  
     
 //     for(unsigned i = 0; i < GetNumberOfElements(); i++) {
@@ -524,7 +718,7 @@ namespace femus
 
     el->ReorderMeshNodes(mapping);
 
-    if(GetLevel() == 0) {
+    if(GetLevel() == 0 && _coords[0].size() > 0) {  // only the processes that store the coarse coordinates
       vector <double> coords_temp;
 
       for(int i = 0; i < 3; i++) {
@@ -655,11 +849,62 @@ namespace femus
 
     return isdom;
   }
+// *******************************************************
+
+  unsigned Mesh::GetCoarseOriginalElementIndex(const unsigned& iel) const
+  {
+
+    const Mesh* msh = this;
+    unsigned jel = iel;
+    while(msh->_coarseMsh != NULL) {
+      jel = msh->GetElementFather(jel);
+      msh = msh->_coarseMsh;
+    }
+
+    return msh->GetOriginalElementIndex(jel);
+  }
+// *******************************************************
+
+  void Mesh::BuildElementDofConnectivity()
+  {
+
+    unsigned iel0 = _elementOffset[_iproc];
+    unsigned iel1 = _elementOffset[_iproc + 1];
+
+    for(unsigned solType = 0; solType < 5; solType++) {
+
+      vector < unsigned > offset(iel1 - iel0 + 1);
+      vector < unsigned > dof;
+
+      offset[0] = 0;
+      for(unsigned iel = iel0; iel < iel1; iel++) {
+        offset[iel - iel0 + 1] = offset[iel - iel0] + GetElementDofNumber(iel, solType);
+      }
+
+      dof.resize(offset[iel1 - iel0]);
+      _elementDof[solType].resize(0); // GetSolutionDof has to search while the table is built
+
+      for(unsigned iel = iel0; iel < iel1; iel++) {
+        for(unsigned i = 0; i < offset[iel - iel0 + 1] - offset[iel - iel0]; i++) {
+          dof[offset[iel - iel0] + i] = GetSolutionDof(i, iel, solType);
+        }
+      }
+
+      _elementDofOffset[solType].swap(offset);
+      _elementDof[solType].swap(dof);
+    }
+  }
+
 // *******************************************************
 
   unsigned Mesh::GetSolutionDof(const unsigned& i, const unsigned& iel, const short unsigned& solType) const
   {
 
+    // owned elements: read the precomputed table
+    if(_elementDof[solType].size() > 0 && iel >= _elementOffset[_iproc] && iel < _elementOffset[_iproc + 1]) {
+      return _elementDof[solType][_elementDofOffset[solType][iel - _elementOffset[_iproc]] + i];
+    }
+
     unsigned dof;
 
     switch(solType) {
@@ -866,6 +1111,93 @@ namespace femus
     return _ProjCoarseToFine[solType];
   }
 
+// *******************************************************
+
+  const GeometryCache* Mesh::GetGeometryCache(const unsigned& solType, Solution* sol)
+  {
+
+    if(solType >= 3) {
+      std::cout << "Wrong argument range in function \"GetGeometryCache\": "
+                << "solType is not a Lagrange family" << std::endl;
+      abort();
+    }
+
+    if(sol == NULL || !sol->GetIfFSI()) {
+      if(!_geometryCache[solType])
+        _geometryCache[solType] = new GeometryCache(this, solType);
+
+      return _geometryCache[solType];
+    }
+
+    // moving mesh: the nodes are displaced by DX, DY, DZ
+    if(sol != _displacementSolution) {
+      InvalidateDisplacedGeometryCache();
+      _displacementSolution = sol;
+    }
+
+    if(!_displacedGeometryCache[solType]) {
+      const char varname[3][3] = {"DX", "DY", "DZ"};
+      std::vector < NumericVector* > displacement(GetDimension());
+
+      for(unsigned k = 0; k < displacement.size(); k++) {
+        unsigned solIndex = sol->GetIndex(&varname[k][0]);
+
+        if(sol->GetSolutionType(solIndex) != 2) {
+          std::cout << "Error in function \"GetGeometryCache\": "
+                    << "the displacement " << varname[k] << " is not biquadratic/triquadratic" << std::endl;
+          abort();
+        }
+
+        displacement[k] = sol->_Sol[solIndex];
+      }
+
+      _displacedGeometryCache[solType] = new GeometryCache(this, solType, displacement);
+    }
+
+    return _displacedGeometryCache[solType];
+  }
+
+// *******************************************************
+
+  const ElementSearchGrid* Mesh::GetElementSearchGrid()
+  {
+    if(!_elementSearchGrid)
+      _elementSearchGrid = new ElementSearchGrid(this);
+
+    return _elementSearchGrid;
+  }
+
+// *******************************************************
+
+  void Mesh::InvalidateDisplacedGeometryCache()
+  {
+    for(unsigned i = 0; i < 3; i++) {
+      if(_displacedGeometryCache[i]) {
+        delete _displacedGeometryCache[i];
+        _displacedGeometryCache[i] = NULL;
+      }
+    }
+  }
+
+// *******************************************************
+
+  void Mesh::InvalidateGeometryCache()
+  {
+    InvalidateDisplacedGeometryCache();
+
+    for(unsigned i = 0; i < 3; i++) {
+      if(_geometryCache[i]) {
+        delete _geometryCache[i];
+        _geometryCache[i] = NULL;
+      }
+    }
+
+    if(_elementSearchGrid) {
+      delete _elementSearchGrid;
+      _elementSearchGrid = NULL;
+    }
+  }
+
 
 
   void Mesh::BuildCoarseToFineProjection(const unsigned& solType)
@@ -1090,7 +1422,9 @@ namespace femus
     SetNumberOfNodes(nnodes);
 //     std::cout <<"nnodes after="<< nnodes << std::endl;
 
-    // add the coordinates of the biquadratic nodes not included in gambit
+    // add the coordinates of the biquadratic nodes not included in gambit, on the processes that store the coordinates
+    if(_coords[0].size() == 0) return;
+
     _coords[0].resize(nnodes);
     _coords[1].resize(nnodes);
     _coords[2].resize(nnodes);
@@ -24,6 +24,8 @@
 #include "ElemType.hpp"
 #include "ElemTypeEnum.hpp"
 #include "ParallelObject.hpp"
+#include "GeometryCache.hpp"
+#include "ElementSearchGrid.hpp"
 #include <assert.h>
 
 #include "vector"
@@ -144,6 +146,19 @@ public:
 
     unsigned GetSolutionDof(const unsigned &i, const unsigned &iel, const short unsigned &solType) const;
 
+    /** Build the flat (CSR) element to solution dof tables of the owned elements, for all the solution types */
+    void BuildElementDofConnectivity();
+
+    /** Get the solution dofs of the owned element iel, GetElementDofNumber(iel, solType) contiguous entries */
+    const unsigned* GetElementSolutionDofs(const unsigned &iel, const short unsigned &solType) const {
+      return &_elementDof[solType][_elementDofOffset[solType][iel - _elementOffset[_iproc]]];
+    }
+
+    /** Get the position of the first dof of the owned element iel in the flat table of solType */
+    unsigned GetElementDofOffset(const unsigned &iel, const short unsigned &solType) const {
+      return _elementDofOffset[solType][iel - _elementOffset[_iproc]];
+    }
+
     unsigned GetSolutionDof(const unsigned &i0,const unsigned &i1, const unsigned &ielc, const short unsigned &solType, const Mesh* mshc) const ;
 
     /** Performs a bisection search to find the processor of the given dof */
@@ -181,6 +196,17 @@ public:
     void Buildkel();
     
     void BiquadraticNodesNotInGambit();
+
+    /** Scatter the coarse coordinates from the process 0 to the owners of the nodes */
+    void ScatterCoarseCoordinates();
+
+    /** Write the partitioned mesh of this process to the binary stream os, for the mesh cache */
+    void Write(std::ostream& os) const;
+
+    /** Rebuild the mesh of this process from the binary stream written by Write, with the same number of processes.
+     *  coarseMsh is the coarser level, NULL for the coarse level. The projection matrices and the geometry caches
+     *  are not stored, they are built again at their first use */
+    void Read(std::istream& is, Mesh* coarseMsh);
     
     std::vector < std::map < unsigned,  std::map < unsigned, double  > > >& GetAmrRestrictionMap(){
       return _amrRestriction;
@@ -213,11 +239,70 @@ public:
     /** Get the coarse to the fine projection matrix*/
     SparseMatrix* GetCoarseToFineProjection(const unsigned& solType);
 
+    /** Get the geometry cache of the owned elements for the Lagrange solType, built at the first call.
+     * If sol is an FSI solution the nodes are displaced by its DX, DY, DZ unknowns.
+     * Not thread safe: build it before entering a threaded element loop */
+    const GeometryCache* GetGeometryCache(const unsigned& solType, Solution* sol = NULL);
+
+    /** Get the point location index of the mesh, built at the first call, that has to be collective */
+    const ElementSearchGrid* GetElementSearchGrid();
+
+    /** Free the geometry caches and the point location index, to be called each time the node coordinates change */
+    void InvalidateGeometryCache();
+
+    /** Free the displaced geometry caches only, to be called each time the displacement of a moving mesh (FSI, ALE, MPM) changes.
+     * The undisplaced caches and the point location index are kept, with a moving mesh the latter only seeds the search,
+     * and this call is not collective */
+    void InvalidateDisplacedGeometryCache();
+
     /** Set the coarser mesh from which this mesh is generated */
     void SetCoarseMesh( Mesh* otherCoarseMsh ){
       _coarseMsh = otherCoarseMsh;
     };
 
+    /** Get the coarser mesh from which this mesh is generated, NULL for the coarse level */
+    Mesh* GetCoarseMesh() const {
+      return _coarseMsh;
+    }
+
+    /** Get the index of the element iel before the partitioning, i.e. in the order of the mesh file or of the refinement */
+    unsigned GetOriginalElementIndex(const unsigned &iel) const {
+      return _originalElementIndex[iel];
+    }
+
+    /** Set the fathers of the elements generated by refinement, in the order before the partitioning */
+    void SetElementFather(const std::vector < unsigned > &elementFather) {
+      _elementFather = elementFather;
+    }
+
+    /** Get the element of the coarser mesh from which the element iel is generated */
+    unsigned GetElementFather(const unsigned &iel) const {
+      return _elementFather[_originalElementIndex[iel]];
+    }
+
+    /** Get the original index, in the coarse level, of the coarse element that contains the element iel */
+    unsigned GetCoarseOriginalElementIndex(const unsigned &iel) const;
+
+    /** Set the weights of the elements, in the order before the partitioning, used by the next Metis partitioning of this mesh.
+     * An empty vector gives the unweighted partitioning */
+    void SetElementWeights(const std::vector < unsigned > &weights) {
+      _elementWeights = weights;
+    }
+
+    const std::vector < unsigned >& GetElementWeights() const {
+      return _elementWeights;
+    }
+
+    /** Partition the coarse mesh and repartition the AMR levels with ParMetis, in parallel, instead of serial Metis.
+     * To be set before the MultiLevelMesh is built */
+    static void SetParallelPartitioning(const bool &value) {
+      _parallelPartitioning = value;
+    }
+
+    static bool GetParallelPartitioning() {
+      return _parallelPartitioning;
+    }
+
     bool GetIfHomogeneous(){
       return _meshIsHomogeneous;
     }
@@ -236,12 +321,31 @@ private:
     /** Coarser mesh from which this mesh is generated, it equals NULL if _level = 0 */
     Mesh* _coarseMsh;
 
+    /** Original index of each element, and father of each element in the original order (refined levels only) */
+    std::vector < unsigned > _originalElementIndex;
+    std::vector < unsigned > _elementFather;
+
+    /** Weights of the elements for the Metis partitioning, in the original order */
+    std::vector < unsigned > _elementWeights;
+
+    static bool _parallelPartitioning;
+
     /** The projection matrix between Lagrange FEM at the same level mesh */
     SparseMatrix* _ProjQitoQj[3][3];
 
     /** The coarse to the fine projection matrix */
     SparseMatrix* _ProjCoarseToFine[5];
 
+    /** The geometry caches of the Lagrange families */
+    GeometryCache* _geometryCache[3];
+
+    /** The geometry caches of the Lagrange families on the mesh displaced by _displacementSolution */
+    GeometryCache* _displacedGeometryCache[3];
+    const Solution* _displacementSolution;
+
+    /** The point location index */
+    ElementSearchGrid* _elementSearchGrid;
+
     /** Build the projection matrix between Lagrange FEM at the same level mesh*/
     void BuildQitoQjProjection(const unsigned& itype, const unsigned& jtype);
 
@@ -261,6 +365,11 @@ private:
     static unsigned _face_index;
     
     std::map < unsigned, unsigned > _ownedGhostMap[2];
+
+    // element to solution dof tables of the owned elements: the dofs of the local element i
+    // are _elementDof[solType][_elementDofOffset[solType][i]] ... _elementDof[solType][_elementDofOffset[solType][i + 1] - 1]
+    vector < unsigned > _elementDofOffset[5];
+    vector < unsigned > _elementDof[5];
     vector < unsigned > _originalOwnSize[2];
 
     static const unsigned _END_IND[5];
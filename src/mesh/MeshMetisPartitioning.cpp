@@ -113,10 +113,23 @@ namespace femus
         }
 
 
+        // element weights, e.g. the particle load of the elements, in the same order of eptr
+        const std::vector < unsigned > &weights = _mesh.GetElementWeights();
+        vector < idx_t > vwgt;
+        if(weights.size() > 0) {
+          if(weights.size() != nelem) {
+            std::cout << "Error In MeshMetis::DoPartition, the number of element weights " << weights.size()
+                      << " is different from the number of elements " << nelem << std::endl;
+            abort();
+          }
+          vwgt.assign(weights.begin(), weights.end());
+        }
+
         int ncommon = (AMR || _mesh.GetDimension() == 1) ? 1 : _mesh.GetDimension() + 1;
 
         //I call the Mesh partioning function of Metis library (output is epart(own elem) and npart (own nodes))
-        int err = METIS_PartMeshDual(&nelem, &nnodes, &eptr[0], &eind[0], NULL, NULL, &ncommon, &_nprocs, NULL, options, &objval, &epart[0], &npart[0]);
+        int err = METIS_PartMeshDual(&nelem, &nnodes, &eptr[0], &eind[0], (vwgt.size() > 0) ? &vwgt[0] : NULL, NULL,
+                                     &ncommon, &_nprocs, NULL, options, &objval, &epart[0], &npart[0]);
 
         if(err == METIS_OK) {
           std::cout << " METIS PARTITIONING IS OK " << std::endl;
@@ -44,7 +44,7 @@ public:
     ~MeshMetisPartitioning() {};
 
     /** New Metis parallel partitioning:
-     *  for coarse and AMR mesh */
+     *  for coarse and AMR mesh, weighted by the element weights of the mesh if any */
     void DoPartition( std::vector < unsigned > &partition, const bool &AMR );
 
     /** Parallel partitioning imported from coarser mesh partition:
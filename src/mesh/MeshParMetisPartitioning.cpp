@@ -0,0 +1,308 @@
+/*=========================================================================
+
+ Program: FEMUS
+ Module: MeshParMetisPartitioning
+ Authors: Eugenio Aulisa
+
+ Copyright (c) FEMTTU
+ All rights reserved.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+//----------------------------------------------------------------------------
+// includes :
+//----------------------------------------------------------------------------
+#include "MeshParMetisPartitioning.hpp"
+#include "MeshMetisPartitioning.hpp"
+#include "Mesh.hpp"
+#include "FemusConfig.hpp"
+
+#ifdef HAVE_PARMETIS
+#include "parmetis.h"
+#endif
+
+//C++ include
+#include <iostream>
+#include <algorithm>
+#include <mpi.h>
+
+
+namespace femus
+{
+
+  MeshParMetisPartitioning::MeshParMetisPartitioning(Mesh& mesh) : MeshPartitioning(mesh), _itr(1000.)
+  {
+
+  }
+
+
+//------------------------------------------------------------------------------------------------------
+  void MeshParMetisPartitioning::DoPartition(std::vector <unsigned>& partition, const bool& AMR)
+  {
+    unsigned nelem = _mesh.GetNumberOfElements();
+
+    std::vector < unsigned > elementOffset(_nprocs + 1);
+    for(int isdom = 0; isdom <= _nprocs; isdom++) {
+      elementOffset[isdom] = static_cast < unsigned >((static_cast < unsigned long >(nelem) * isdom) / _nprocs);
+    }
+
+    PartitionBlocks(partition, elementOffset, AMR, false);
+  }
+
+//------------------------------------------------------------------------------------------------------
+  void MeshParMetisPartitioning::DoRepartition(std::vector <unsigned>& partition, const std::vector < unsigned > &elementOffset, const bool& AMR)
+  {
+    PartitionBlocks(partition, elementOffset, AMR, true);
+  }
+
+//------------------------------------------------------------------------------------------------------
+  void MeshParMetisPartitioning::PartitionBlocks(std::vector <unsigned>& partition, const std::vector < unsigned > &elementOffset,
+                                                 const bool& AMR, const bool &repartition)
+  {
+
+    unsigned nelem = _mesh.GetNumberOfElements();
+
+    partition.assign(nelem, 0);
+
+    if(_nprocs == 1) {
+      return;
+    }
+    else if(_nprocs > nelem) {
+      std::cout << "Error In MeshParMetis::DoPartition, the number of processes " << _nprocs
+                << " is greater than the number of elements " << nelem << std::endl;
+      abort();
+    }
+
+#ifndef HAVE_PARMETIS
+    std::cout << " ParMetis was not found, the serial Metis partitioning is used " << std::endl;
+    MeshMetisPartitioning(_mesh).DoPartition(partition, AMR);
+#else
+
+    for(int isdom = 0; isdom < _nprocs; isdom++) {
+      if(elementOffset[isdom + 1] <= elementOffset[isdom]) {
+        std::cout << "Error In MeshParMetis::DoPartition, the process " << isdom << " has no elements" << std::endl;
+        abort();
+      }
+    }
+
+    MPI_Comm comm = MPI_COMM_WORLD;
+
+    unsigned elementBegin = elementOffset[_iproc];
+    unsigned nLocalElements = elementOffset[_iproc + 1] - elementBegin;
+
+    std::vector < idx_t > elmdist(elementOffset.begin(), elementOffset.end());
+
+    //BEGIN local block of the mesh
+    std::vector < idx_t > eptr(nLocalElements + 1);
+    std::vector < idx_t > eind;
+    eind.reserve(nLocalElements * NVE[0][2]);
+
+    eptr[0] = 0;
+    for(unsigned i = 0; i < nLocalElements; i++) {
+      unsigned iel = elementBegin + i;
+      unsigned ndofs = _mesh.el->GetElementDofNumber(iel, 2);
+      for(unsigned inode = 0; inode < ndofs; inode++) {
+        eind.push_back(_mesh.el->GetElementDofIndex(iel, inode));
+      }
+      eptr[i + 1] = eind.size();
+    }
+    //END
+
+    //BEGIN distributed dual graph
+    idx_t numflag = 0;
+    idx_t ncommon = (AMR || _mesh.GetDimension() == 1) ? 1 : _mesh.GetDimension() + 1;
+    idx_t *xadj;
+    idx_t *adjncy;
+
+    int err = ParMETIS_V3_Mesh2Dual(&elmdist[0], &eptr[0], &eind[0], &numflag, &ncommon, &xadj, &adjncy, &comm);
+    if(err != METIS_OK) {
+      std::cout << " PARMETIS_MESH2DUAL_ERROR " << std::endl;
+      exit(1);
+    }
+    //END
+
+    //BEGIN nodes of the neighbor elements of the other processes
+    // the neighbors in the block are read from eind, the others are requested to the processes that own them in elmdist
+    std::vector < std::vector < unsigned > > request(_nprocs);
+    for(idx_t k = 0; k < xadj[nLocalElements]; k++) {
+      unsigned jel = adjncy[k];
+      if(jel < elementBegin || jel >= elementBegin + nLocalElements) {
+        unsigned jproc = std::upper_bound(elementOffset.begin(), elementOffset.end(), jel) - elementOffset.begin() - 1;
+        request[jproc].push_back(jel);
+      }
+    }
+
+    std::vector < int > sendCounts(_nprocs);
+    std::vector < int > recvCounts(_nprocs);
+    std::vector < int > sendDispls(_nprocs + 1, 0);
+    std::vector < int > recvDispls(_nprocs + 1, 0);
+
+    // the requests of the blocks are sorted and the blocks are in process order, so haloElements is sorted
+    std::vector < unsigned > haloElements;
+    for(int jproc = 0; jproc < _nprocs; jproc++) {
+      std::sort(request[jproc].begin(), request[jproc].end());
+      request[jproc].erase(std::unique(request[jproc].begin(), request[jproc].end()), request[jproc].end());
+      haloElements.insert(haloElements.end(), request[jproc].begin(), request[jproc].end());
+      sendCounts[jproc] = request[jproc].size();
+      sendDispls[jproc + 1] = sendDispls[jproc] + sendCounts[jproc];
+    }
+
+    MPI_Alltoall(&sendCounts[0], 1, MPI_INT, &recvCounts[0], 1, MPI_INT, comm);
+    for(int jproc = 0; jproc < _nprocs; jproc++) {
+      recvDispls[jproc + 1] = recvDispls[jproc] + recvCounts[jproc];
+    }
+
+    std::vector < unsigned > requested(recvDispls[_nprocs]);
+    MPI_Alltoallv(haloElements.data(), &sendCounts[0], &sendDispls[0], MPI_UNSIGNED,
+                  requested.data(), &recvCounts[0], &recvDispls[0], MPI_UNSIGNED, comm);
+
+    // answer: number of nodes and nodes of each requested element, in the order of the request
+    std::vector < unsigned > answer;
+    std::vector < int > answerCounts(_nprocs);
+    for(int jproc = 0; jproc < _nprocs; jproc++) {
+      unsigned answerBegin = answer.size();
+      for(int j = recvDispls[jproc]; j < recvDispls[jproc + 1]; j++) {
+        unsigned i = requested[j] - elementBegin;
+        answer.push_back(eptr[i + 1] - eptr[i]);
+        answer.insert(answer.end(), eind.begin() + eptr[i], eind.begin() + eptr[i + 1]);
+      }
+      answerCounts[jproc] = answer.size() - answerBegin;
+    }
+
+    std::vector < int > haloCounts(_nprocs);
+    MPI_Alltoall(&answerCounts[0], 1, MPI_INT, &haloCounts[0], 1, MPI_INT, comm);
+
+    std::vector < int > answerDispls(_nprocs + 1, 0);
+    std::vector < int > haloDispls(_nprocs + 1, 0);
+    for(int jproc = 0; jproc < _nprocs; jproc++) {
+      answerDispls[jproc + 1] = answerDispls[jproc] + answerCounts[jproc];
+      haloDispls[jproc + 1] = haloDispls[jproc] + haloCounts[jproc];
+    }
+
+    std::vector < unsigned > haloBuffer(haloDispls[_nprocs]);
+    MPI_Alltoallv(answer.data(), &answerCounts[0], &answerDispls[0], MPI_UNSIGNED,
+                  haloBuffer.data(), &haloCounts[0], &haloDispls[0], MPI_UNSIGNED, comm);
+
+    std::vector < unsigned > haloPtr(haloElements.size() + 1);
+    std::vector < unsigned > haloDofs;
+    haloDofs.reserve(haloBuffer.size() - haloElements.size());
+    haloPtr[0] = 0;
+    unsigned position = 0;
+    for(unsigned h = 0; h < haloElements.size(); h++) {
+      unsigned ndofs = haloBuffer[position];
+      haloDofs.insert(haloDofs.end(), haloBuffer.begin() + position + 1, haloBuffer.begin() + position + 1 + ndofs);
+      position += ndofs + 1;
+      haloPtr[h + 1] = haloDofs.size();
+    }
+    //END
+
+    //BEGIN weights
+    // edge weights: number of nodes shared by the two elements
+    std::vector < idx_t > adjwgt(xadj[nLocalElements]);
+    std::vector < unsigned > idofs;
+    std::vector < unsigned > jdofs;
+    for(unsigned i = 0; i < nLocalElements; i++) {
+      idofs.assign(eind.begin() + eptr[i], eind.begin() + eptr[i + 1]);
+      std::sort(idofs.begin(), idofs.end());
+
+      for(idx_t k = xadj[i]; k < xadj[i + 1]; k++) {
+        unsigned jel = adjncy[k];
+        if(jel >= elementBegin && jel < elementBegin + nLocalElements) {
+          unsigned j = jel - elementBegin;
+          jdofs.assign(eind.begin() + eptr[j], eind.begin() + eptr[j + 1]);
+        }
+        else {
+          unsigned h = std::lower_bound(haloElements.begin(), haloElements.end(), jel) - haloElements.begin();
+          jdofs.assign(haloDofs.begin() + haloPtr[h], haloDofs.begin() + haloPtr[h + 1]);
+        }
+        std::sort(jdofs.begin(), jdofs.end());
+
+        idx_t shared = 0;
+        std::vector < unsigned >::const_iterator ii = idofs.begin();
+        std::vector < unsigned >::const_iterator jj = jdofs.begin();
+        while(ii != idofs.end() && jj != jdofs.end()) {
+          if(*ii < *jj) ii++;
+          else if(*jj < *ii) jj++;
+          else {
+            shared++;
+            ii++;
+            jj++;
+          }
+        }
+        adjwgt[k] = shared;
+      }
+    }
+
+    // vertex weights: element weights of the mesh, e.g. the particle load of the elements
+    const std::vector < unsigned > &weights = _mesh.GetElementWeights();
+    std::vector < idx_t > vwgt;
+    if(weights.size() > 0) {
+      if(weights.size() != nelem) {
+        std::cout << "Error In MeshParMetis::DoPartition, the number of element weights " << weights.size()
+                  << " is different from the number of elements " << nelem << std::endl;
+        abort();
+      }
+      vwgt.assign(weights.begin() + elementBegin, weights.begin() + elementBegin + nLocalElements);
+    }
+    //END
+
+    //BEGIN partitioning
+    idx_t wgtflag = (vwgt.size() > 0) ? 3 : 1;
+    idx_t ncon = 1;
+    idx_t nparts = _nprocs;
+    std::vector < real_t > tpwgts(nparts, 1. / nparts);
+    real_t ubvec = 1.05;
+    idx_t edgecut;
+    std::vector < idx_t > part(nLocalElements, _iproc);
+
+    if(repartition) {
+      // the current partition is the block distribution: elements move only to balance the load
+      idx_t options[4] = {1, 0, 15, PARMETIS_PSR_COUPLED};
+      real_t itr = _itr;
+      err = ParMETIS_V3_AdaptiveRepart(&elmdist[0], xadj, adjncy, (vwgt.size() > 0) ? &vwgt[0] : NULL, NULL, adjwgt.data(),
+                                       &wgtflag, &numflag, &ncon, &nparts, &tpwgts[0], &ubvec, &itr, options, &edgecut, &part[0], &comm);
+    }
+    else {
+      idx_t options[3] = {0, 0, 0};
+      err = ParMETIS_V3_PartKway(&elmdist[0], xadj, adjncy, (vwgt.size() > 0) ? &vwgt[0] : NULL, adjwgt.data(),
+                                 &wgtflag, &numflag, &ncon, &nparts, &tpwgts[0], &ubvec, options, &edgecut, &part[0], &comm);
+    }
+
+    METIS_Free(xadj);
+    METIS_Free(adjncy);
+
+    if(err == METIS_OK) {
+      if(_iproc == 0) std::cout << " PARMETIS PARTITIONING IS OK " << std::endl;
+    }
+    else {
+      std::cout << " PARMETIS_GENERIC_ERROR " << std::endl;
+      exit(3);
+    }
+    //END
+
+    //BEGIN gather the partition of all the elements
+    std::vector < int > localPartition(part.begin(), part.end());
+    std::vector < int > globalPartition(nelem);
+    std::vector < int > counts(_nprocs);
+    std::vector < int > displs(_nprocs);
+    for(int isdom = 0; isdom < _nprocs; isdom++) {
+      displs[isdom] = elementOffset[isdom];
+      counts[isdom] = elementOffset[isdom + 1] - elementOffset[isdom];
+    }
+    MPI_Allgatherv(&localPartition[0], nLocalElements, MPI_INT, &globalPartition[0], &counts[0], &displs[0], MPI_INT, comm);
+
+    for(unsigned i = 0; i < nelem; i++) {
+      partition[i] = globalPartition[i];
+    }
+    //END
+
+#endif
+
+    return;
+  }
+
+}
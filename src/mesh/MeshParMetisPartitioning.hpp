@@ -0,0 +1,78 @@
+/*=========================================================================
+
+ Program: FEMuS
+ Module: MeshParMetisPartitioning
+ Authors: Eugenio Aulisa
+
+ Copyright (c) FEMuS
+ All rights reserved.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+#ifndef __femus_mesh_MeshParMetisPartitioning_hpp__
+#define __femus_mesh_MeshParMetisPartitioning_hpp__
+
+//----------------------------------------------------------------------------
+// includes :
+//----------------------------------------------------------------------------
+#include <vector>
+#include "MeshPartitioning.hpp"
+
+namespace femus {
+
+
+class Mesh;
+
+
+/**
+ * This is the \p MeshParMetisPartitioning class.  This class calls the ParMetis algorithms for
+ * parallel mesh partitioning: each process builds the dual graph of a contiguous block of elements only,
+ * the vertex weights are the element weights of the mesh, if any, and the edge weights are the numbers of nodes
+ * shared by the two elements, i.e. the communication volume if the edge is cut. The nodes of the neighbor elements
+ * of the other blocks are exchanged with the processes that own them, the global element structure is not read.
+ * Without ParMetis the serial Metis partitioning is used.
+*/
+
+class MeshParMetisPartitioning : public MeshPartitioning {
+
+public:
+
+    /** Constructor */
+    MeshParMetisPartitioning(Mesh& mesh);
+
+    /** destructor */
+    ~MeshParMetisPartitioning() {};
+
+    /** Parallel partitioning from scratch (ParMETIS_V3_PartKway) of the elements split in even blocks:
+     *  for coarse and AMR mesh */
+    void DoPartition( std::vector < unsigned > &partition, const bool &AMR );
+
+    /** Parallel repartitioning (ParMETIS_V3_AdaptiveRepart) of the elements currently distributed
+     *  in the blocks elementOffset[isdom] ... elementOffset[isdom + 1] - 1: for AMR mesh */
+    void DoRepartition( std::vector < unsigned > &partition, const std::vector < unsigned > &elementOffset, const bool &AMR );
+
+    /** Ratio between the interprocess communication time and the data redistribution time used by the repartitioning,
+     *  small values favor less element migration */
+    void SetRedistributionCost(const double &itr) {
+      _itr = itr;
+    }
+
+private:
+
+    /** Build the dual graph of the elements of the block elementOffset[_iproc] ... elementOffset[_iproc + 1] - 1,
+     *  partition it and gather the partition of all the elements */
+    void PartitionBlocks( std::vector < unsigned > &partition, const std::vector < unsigned > &elementOffset,
+                          const bool &AMR, const bool &repartition );
+
+    double _itr;
+
+};
+
+
+}
+
+#endif
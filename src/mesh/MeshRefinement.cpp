@@ -19,6 +19,7 @@
 
 #include "Mesh.hpp"
 #include "MeshMetisPartitioning.hpp"
+#include "MeshParMetisPartitioning.hpp"
 #include "MeshRefinement.hpp"
 #include "NumericVector.hpp"
 #include "GeomElTypeEnum.hpp"
@@ -212,6 +213,8 @@ namespace femus {
 
     _mesh.el = new elem(elc, _mesh.GetRefIndex(), coarseLocalizedAmrVector);
 
+    std::vector < unsigned > elementFather(nelem);
+
     unsigned jel = 0;
     //divide each coarse element in 8(3D), 4(2D) or 2(1D) fine elements and find all the vertices
 
@@ -220,8 +223,12 @@ namespace femus {
     bool AMR = false;
 
     std::vector < unsigned > materialElementCounter(3,0);
-    
+
+    // the fine elements of the coarse elements of each process are contiguous, the current distribution for the repartitioning
+    std::vector < unsigned > fineElementOffset(_nprocs + 1);
+
     for(unsigned isdom = 0; isdom < _nprocs; isdom++) {
+      fineElementOffset[isdom] = jel;
       elc->LocalizeElementDof(isdom);
       elc->LocalizeElementNearFace(isdom);
       elc->LocalizeElementQuantities(isdom);
@@ -240,6 +247,7 @@ namespace femus {
 	    else materialElementCounter[2] += 1;
 	        
             _mesh.el->SetElementLevel(jel + j, elc->GetElementLevel(iel) + 1);
+            elementFather[jel + j] = iel;
             if(iel >= elementOffsetCoarse && iel < elementOffsetCoarseP1) {
               elc->SetChildElement(iel, j, jel + j);
             }
@@ -280,6 +288,7 @@ namespace femus {
 	  else materialElementCounter[2] += 1;
 	  
           _mesh.el->SetElementLevel(jel, elc->GetElementLevel(iel));
+          elementFather[jel] = iel;
           if(iel >= elementOffsetCoarse && iel < elementOffsetCoarseP1) {
             elc->SetChildElement(iel, 0, jel);
           }
@@ -306,8 +315,10 @@ namespace femus {
       elc->FreeLocalizedElementNearFace();
       elc->FreeLocalizedElementQuantities();
     }
-    
+    fineElementOffset[_nprocs] = jel;
+
     _mesh.el->SetMaterialElementCounter(materialElementCounter);
+    _mesh.SetElementFather(elementFather);
     
     
     std::vector<unsigned> MaterialElementCounter = _mesh.el->GetMaterialElementCounter();
@@ -398,7 +409,11 @@ namespace femus {
 
     MeshMetisPartitioning meshMetisPartitioning(_mesh);
 
-    if(AMR == true) {
+    if(AMR == true && Mesh::GetParallelPartitioning()) {
+      MeshParMetisPartitioning meshParMetisPartitioning(_mesh);
+      meshParMetisPartitioning.DoRepartition(partition, fineElementOffset, AMR);
+    }
+    else if(AMR == true) {
       meshMetisPartitioning.DoPartition(partition, AMR);
     }
     else {
@@ -447,6 +462,8 @@ namespace femus {
     _mesh.el->ScatterElementDof();
     _mesh.el->ScatterElementNearFace();
 
+    _mesh.BuildElementDofConnectivity();
+
     std::vector < std::map < unsigned,  std::map < unsigned, double  > > >& restriction = _mesh.GetAmrRestrictionMap();
     if(AMR) {
       _mesh.el->GetAMRRestriction(&_mesh);
@@ -24,10 +24,16 @@
 #include "FemusConfig.hpp"
 #include "MeshRefinement.hpp"
 #include "Domain.hpp"
+#include "BinaryIO.hpp"
 
 
 //C++ include
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <sys/stat.h>
+#include <mpi.h>
 
 
 namespace femus {
@@ -53,7 +59,7 @@ MultiLevelMesh::~MultiLevelMesh() {
 }
 
 //---------------------------------------------------------------------------------------------------
-MultiLevelMesh::MultiLevelMesh(): _gridn0(0)
+MultiLevelMesh::MultiLevelMesh(): _gridn0(0), _lref(1.), _gridr(0)
   {
 
   _finiteElementGeometryFlag.resize(6,false);
@@ -119,7 +125,7 @@ MultiLevelMesh::MultiLevelMesh(const unsigned short &igridn,const unsigned short
 			       const char mesh_file[], const char GaussOrder[], const double Lref,
 			       bool (* SetRefinementFlag)(const std::vector < double > &x,
 							  const int &ElemGroupNumber,const int &level) ):
-    _gridn0(igridn)
+    _gridn0(igridn), _meshFile(mesh_file), _gaussOrder(GaussOrder), _lref(Lref), _gridr(igridr)
     {
 
 
@@ -128,6 +134,7 @@ MultiLevelMesh::MultiLevelMesh(const unsigned short &igridn,const unsigned short
 
     //coarse mesh
     _level0[0] = new Mesh();
+    _level0[0]->SetElementWeights(_coarseElementWeights);
     std::cout << " Reading corse mesh from file: " << mesh_file << std::endl;
     _level0[0]->ReadCoarseMesh(mesh_file, Lref,_finiteElementGeometryFlag);
 
@@ -182,11 +189,16 @@ void MultiLevelMesh::ReadCoarseMesh(const char mesh_file[], const char GaussOrde
 {
     _gridn0 = 1;
 
+    _meshFile = mesh_file;
+    _gaussOrder = GaussOrder;
+    _lref = Lref;
+
     _level0.resize(_gridn0);
     _finiteElementGeometryFlag.resize(5,false);
 
     //coarse mesh
     _level0[0] = new Mesh();
+    _level0[0]->SetElementWeights(_coarseElementWeights);
     std::cout << " Reading corse mesh from file: " << mesh_file << std::endl;
     _level0[0]->ReadCoarseMesh(mesh_file, Lref,_finiteElementGeometryFlag);
 
@@ -207,11 +219,14 @@ void MultiLevelMesh::GenerateCoarseBoxMesh(
 {
     _gridn0 = 1;
 
+    _meshFile.clear();
+
     _level0.resize(_gridn0);
     _finiteElementGeometryFlag.resize(5,false);
 
     //coarse mesh
     _level0[0] = new Mesh();
+    _level0[0]->SetElementWeights(_coarseElementWeights);
     std::cout << " Building brick mesh using the built-in mesh generator" << std::endl;
 
     _level0[0]->GenerateCoarseBoxMesh(nx,ny,nz,xmin,xmax,ymin,ymax,zmin,zmax,type,_finiteElementGeometryFlag);
@@ -231,6 +246,7 @@ void MultiLevelMesh::RefineMesh( const unsigned short &igridn, const unsigned sh
 {
 
     _gridn0 = igridn;
+    _gridr = igridr;
 
     _level0.resize(_gridn0);
 
@@ -301,6 +317,218 @@ void MultiLevelMesh::AddAMRMeshLevel()
 }
 
 
+//---------------------------------------------------------------------------------------------
+
+bool MultiLevelMesh::BuildMeshCacheKey(std::string &key, const char mesh_file[], const unsigned short &igridn, const unsigned short &igridr,
+                                       const char GaussOrder[], const double Lref) const {
+
+  struct stat meshFileStatus;
+  if(stat(mesh_file, &meshFileStatus) != 0) return false;
+
+  int iproc, nprocs;
+  MPI_Comm_rank(MPI_COMM_WORLD, &iproc);
+  MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+
+  std::ostringstream os;
+  BinaryWrite(os, std::string("FEMUS_MESH_CACHE"));
+  BinaryWrite(os, _meshCacheVersion);
+  // byte order and type sizes of the machine that wrote the cache
+  BinaryWrite(os, 0x01020304u);
+  BinaryWrite(os, static_cast < unsigned >(sizeof(unsigned long)));
+  BinaryWrite(os, static_cast < unsigned >(sizeof(std::size_t)));
+
+  BinaryWrite(os, nprocs);
+  BinaryWrite(os, iproc);
+
+  BinaryWrite(os, std::string(mesh_file));
+  BinaryWrite(os, static_cast < long long >(meshFileStatus.st_size));
+  BinaryWrite(os, static_cast < long long >(meshFileStatus.st_mtime));
+
+  BinaryWrite(os, std::string(GaussOrder));
+  BinaryWrite(os, Lref);
+  BinaryWrite(os, igridn);
+  BinaryWrite(os, igridr);
+  BinaryWrite(os, _coarseElementWeights);
+  BinaryWrite(os, Mesh::GetParallelPartitioning());
+
+  key = os.str();
+  return true;
+}
+
+//---------------------------------------------------------------------------------------------
+
+bool MultiLevelMesh::LoadMeshCache(const char cacheFile[], const char mesh_file[], const unsigned short &igridn, const unsigned short &igridr,
+                                   const char GaussOrder[], const double Lref) {
+
+  if(_level0.size() != 0) {
+    cout << "Error in MultiLevelMesh::LoadMeshCache, the multilevel mesh has already been built" << endl;
+    abort();
+  }
+
+  int iproc, nprocs;
+  MPI_Comm_rank(MPI_COMM_WORLD, &iproc);
+  MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+
+  std::ostringstream fileName;
+  fileName << cacheFile << "." << nprocs << "." << iproc;
+
+  //BEGIN check the key of the cache of each process
+  std::string key;
+  std::string cacheKey;
+  std::ifstream fin;
+
+  // each file is checked to be complete before any collective object is built,
+  // so that all the processes either read their cache or all give it up
+  int valid = BuildMeshCacheKey(key, mesh_file, igridn, igridr, GaussOrder, Lref);
+  if(valid) {
+    fin.open(fileName.str().c_str(), std::ios::in | std::ios::binary);
+    valid = CheckMeshCacheTrailer(fin);
+  }
+  if(valid) {
+    fin.seekg(0, std::ios::beg);
+    BinaryRead(fin, cacheKey);
+    valid = (fin && cacheKey == key);
+  }
+  MPI_Allreduce(MPI_IN_PLACE, &valid, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+
+  if(!valid) {
+    if(iproc == 0) cout << " Mesh cache " << cacheFile << " not found or not valid for the mesh file " << mesh_file << endl;
+    return false;
+  }
+  //END
+
+  //BEGIN read the levels
+  std::vector < bool > finiteElementGeometryFlag;
+  BinaryRead(fin, finiteElementGeometryFlag);
+
+  std::vector < Mesh* > level(igridn);
+  for(unsigned i = 0; i < igridn; i++) {
+    level[i] = new Mesh();
+    level[i]->Read(fin, (i > 0) ? level[i - 1] : NULL);
+  }
+
+  // the data have to end exactly at the trailer
+  unsigned long long dataSize = 0;
+  BinaryRead(fin, dataSize);
+
+  valid = (fin && static_cast < unsigned long long >(fin.tellg()) == dataSize + sizeof(dataSize));
+  MPI_Allreduce(MPI_IN_PLACE, &valid, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+
+  if(!valid) {
+    if(iproc == 0) cout << " Mesh cache " << cacheFile << " is corrupted" << endl;
+    for(unsigned i = 0; i < igridn; i++) {
+      delete level[i];
+    }
+    return false;
+  }
+  //END
+
+  _gridn0 = igridn;
+  _level0.swap(level);
+  _finiteElementGeometryFlag.swap(finiteElementGeometryFlag);
+
+  BuildElemType(GaussOrder);
+  for(unsigned i = 1; i < _gridn0; i++) {
+    _level0[i]->SetFiniteElementPtr(_finiteElement);
+  }
+
+  unsigned refindex = _level0[0]->GetRefIndex();
+  elem_type::_refindex = refindex;
+
+  _gridn = _gridn0;
+  _level.resize(_gridn);
+  for(int i = 0; i < _gridn; i++)
+    _level[i] = _level0[i];
+
+  _meshFile = mesh_file;
+  _gaussOrder = GaussOrder;
+  _lref = Lref;
+  _gridr = igridr;
+
+  if(iproc == 0) cout << " Mesh read from the cache " << cacheFile << endl;
+
+  return true;
+}
+
+//---------------------------------------------------------------------------------------------
+
+void MultiLevelMesh::SaveMeshCache(const char cacheFile[]) const {
+
+  int iproc, nprocs;
+  MPI_Comm_rank(MPI_COMM_WORLD, &iproc);
+  MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+
+  std::string key;
+  if(_meshFile.empty() || !BuildMeshCacheKey(key, _meshFile.c_str(), _gridn0, _gridr, _gaussOrder.c_str(), _lref)) {
+    key.clear();
+  }
+
+  std::ostringstream fileName;
+  fileName << cacheFile << "." << nprocs << "." << iproc;
+  std::string tmpFileName = fileName.str() + ".tmp";
+
+  //BEGIN write the temporary file of each process
+  int written = !key.empty();
+  if(written) {
+    std::ofstream fout(tmpFileName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+
+    BinaryWrite(fout, key);
+    BinaryWrite(fout, _finiteElementGeometryFlag);
+    for(unsigned i = 0; i < _gridn0; i++) {
+      _level0[i]->Write(fout);
+    }
+
+    // trailer: the size of the data before it and the end marker
+    unsigned long long dataSize = static_cast < unsigned long long >(fout.tellp());
+    BinaryWrite(fout, dataSize);
+    BinaryWrite(fout, std::string("END_OF_MESH_CACHE"));
+
+    fout.close();
+    written = !fout.fail();
+  }
+  MPI_Allreduce(MPI_IN_PLACE, &written, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+  //END
+
+  //BEGIN replace the previous cache only if all the processes have written it
+  if(written) {
+    written = (std::rename(tmpFileName.c_str(), fileName.str().c_str()) == 0);
+    if(!written) cout << " Warning: the mesh cache file " << fileName.str() << " cannot be replaced" << endl;
+  }
+  else {
+    std::remove(tmpFileName.c_str());
+    if(iproc == 0) {
+      if(key.empty()) cout << " Warning: the mesh cache is written only for meshes read from a file, " << cacheFile << " not written" << endl;
+      else cout << " Warning: the mesh cache " << cacheFile << " cannot be written" << endl;
+    }
+  }
+  //END
+}
+
+//---------------------------------------------------------------------------------------------
+
+bool MultiLevelMesh::CheckMeshCacheTrailer(std::istream &is) {
+
+  const std::string endOfCache("END_OF_MESH_CACHE");
+  const long long trailerSize = sizeof(unsigned long long) + sizeof(unsigned long) + endOfCache.size();
+
+  is.seekg(0, std::ios::end);
+  long long fileSize = static_cast < long long >(is.tellg());
+  if(!is || fileSize < trailerSize) return false;
+
+  is.seekg(fileSize - trailerSize, std::ios::beg);
+
+  unsigned long long dataSize = 0;
+  unsigned long markerSize = 0;
+  BinaryRead(is, dataSize);
+  BinaryRead(is, markerSize);
+  if(!is || markerSize != endOfCache.size()) return false;
+
+  std::string marker(markerSize, ' ');
+  is.read(&marker[0], markerSize);
+
+  return (is && marker == endOfCache && dataSize + trailerSize == static_cast < unsigned long long >(fileSize));
+}
+
 //---------------------------------------------------------------------------------------------
 
 void MultiLevelMesh::EraseCoarseLevels(unsigned levels_to_be_erased) {
@@ -320,6 +548,12 @@ void MultiLevelMesh::PrintInfo() {
     }
 }
 
+void MultiLevelMesh::InvalidateGeometryCache() {
+    for(int i=0; i<_gridn; i++) {
+      _level[i]->InvalidateGeometryCache();
+    }
+}
+
     /** Get the dimension of the problem (1D, 2D, 3D) from one Mesh (level 0 always exists, after initialization) */
     const unsigned MultiLevelMesh::GetDimension() const {
       return _level0[LEV_PICK]->GetDimension();
@@ -18,6 +18,7 @@ PURPOSE.  See the above copyright notice for more information.
 
 
 #include <vector>
+#include <string>
 #include "ElemTypeEnum.hpp"
 #include "GeomElTypeEnum.hpp"
 #include "WriterEnum.hpp"
@@ -52,6 +53,12 @@ public:
     /** Destructor */
     ~MultiLevelMesh();
 
+    /** Set the weights of the coarse elements, in the order of the mesh file or of the generator, used to partition
+     *  the coarse mesh read or generated next, e.g. the particle load given by Line::GetCoarseElementWeights */
+    void SetCoarseElementWeights(const std::vector < unsigned > &weights) {
+      _coarseElementWeights = weights;
+    }
+
     /** Read the coarse-mesh from an input file (call the right reader from the extension) */
     void ReadCoarseMesh(const char mesh_file[], const char GaussOrder[], const double Lref);
 
@@ -73,6 +80,19 @@ public:
 
     /** Add a partially refined mesh level in the AMR alghorithm **/
     void AddAMRMeshLevel();
+
+    /** Rebuild the partitioned multilevel mesh from the binary cache written by SaveMeshCache, one file per process
+     *  named cacheFile.nprocs.iproc, instead of reading, partitioning and refining the mesh again.
+     *  The cache is used only if it was written from the same mesh file (name, size and modification time) with the same
+     *  GaussOrder, Lref, igridn, igridr, coarse element weights, partitioning and number of processes, otherwise it returns false
+     *  and the mesh has to be built with ReadCoarseMesh and RefineMesh. The SetRefinementFlag function of the partially refined
+     *  levels is not part of the key. To be called on an empty MultiLevelMesh, collective */
+    bool LoadMeshCache(const char cacheFile[], const char mesh_file[], const unsigned short &igridn, const unsigned short &igridr,
+                       const char GaussOrder[], const double Lref);
+
+    /** Write the binary cache of all the levels of the multilevel mesh read with ReadCoarseMesh and refined with RefineMesh, collective.
+     *  Each process writes a temporary file, and the files are renamed to their names only when all the processes have written them */
+    void SaveMeshCache(const char cacheFile[]) const;
     
     
     /** Get the mesh pointer to level i */
@@ -91,6 +111,9 @@ public:
     /** Print the mesh info for each level */
     void PrintInfo();
 
+    /** Free the geometry caches of all the levels, to be called after moving the mesh */
+    void InvalidateGeometryCache();
+
     // data
     const elem_type *_finiteElement[6][5];
     
@@ -114,6 +137,14 @@ protected:
 private:
     
     void BuildElemType(const char GaussOrder[]);
+
+    /** Build the key that identifies a mesh cache: format, number of processes, input mesh file and build parameters.
+     *  Returns false if the mesh file cannot be found */
+    bool BuildMeshCacheKey(std::string &key, const char mesh_file[], const unsigned short &igridn, const unsigned short &igridr,
+                           const char GaussOrder[], const double Lref) const;
+
+    /** Check that the cache stream is complete, reading its trailer: the size of the data written before it and the end marker */
+    static bool CheckMeshCacheTrailer(std::istream &is);
     
     /**  */
     unsigned short _gridn0;
@@ -124,6 +155,18 @@ private:
     std::vector <Mesh*> _level;
 
     std::vector <bool> _finiteElementGeometryFlag;
+
+    /** Weights for the partitioning of the coarse mesh */
+    std::vector <unsigned> _coarseElementWeights;
+
+    /** Input of the mesh, for the mesh cache: mesh file, Gauss order, Lref and number of totally refined levels */
+    std::string _meshFile;
+    std::string _gaussOrder;
+    double _lref;
+    unsigned short _gridr;
+
+    /** Format version of the mesh cache, to be increased each time Mesh::Write or the cache layout change */
+    static const unsigned _meshCacheVersion = 2;
     
     /** MultilevelMesh  writer */
     Writer* _writer;
@@ -24,6 +24,7 @@
 #include <boost/mpi/datatype.hpp>
 
 #include "MyMatrix.hpp"
+#include "BinaryIO.hpp"
 
 namespace femus {
 
@@ -403,6 +404,36 @@ namespace femus {
     return _status;
   }
 
+  // ******************
+  template <class Type> void MyMatrix<Type>::write(std::ostream &os) const {
+    BinaryWrite(os, _serial);
+    BinaryWrite(os, _matIsAllocated);
+    BinaryWrite(os, _begin);
+    BinaryWrite(os, _end);
+    BinaryWrite(os, _size);
+    BinaryWrite(os, _mat);
+    BinaryWrite(os, _offset);
+    _rowOffset.write(os);
+    _rowSize.write(os);
+    _matSize.write(os);
+  }
+
+  // ******************
+  template <class Type> void MyMatrix<Type>::read(std::istream &is) {
+    std::vector<Type>().swap(_mat2);
+    BinaryRead(is, _serial);
+    BinaryRead(is, _matIsAllocated);
+    BinaryRead(is, _begin);
+    BinaryRead(is, _end);
+    BinaryRead(is, _size);
+    BinaryRead(is, _mat);
+    BinaryRead(is, _offset);
+    _rowOffset.read(is);
+    _rowSize.read(is);
+    _matSize.read(is);
+    _lproc = _iproc;
+  }
+
   // ******************
 
   // Explicit template instantiation
@@ -105,6 +105,12 @@ namespace femus {
       // ****************
       const std::string &status();
 
+      // ******************
+      void write(std::ostream &os) const;
+
+      // ******************
+      void read(std::istream &is);
+
       // ******************
 
       Type* operator[](const unsigned &i);
@@ -24,6 +24,7 @@
 #include <boost/mpi/datatype.hpp>
 
 #include "MyVector.hpp"
+#include "BinaryIO.hpp"
 
 namespace femus {
 
@@ -267,6 +268,30 @@ namespace femus {
     return _status;
   }
 
+  // ******************
+  template <class Type> void MyVector<Type>::write(std::ostream &os) const {
+    BinaryWrite(os, _serial);
+    BinaryWrite(os, _vecIsAllocated);
+    BinaryWrite(os, _begin);
+    BinaryWrite(os, _end);
+    BinaryWrite(os, _size);
+    BinaryWrite(os, _vec);
+    BinaryWrite(os, _offset);
+  }
+
+  // ******************
+  template <class Type> void MyVector<Type>::read(std::istream &is) {
+    std::vector<Type>().swap(_vec2);
+    BinaryRead(is, _serial);
+    BinaryRead(is, _vecIsAllocated);
+    BinaryRead(is, _begin);
+    BinaryRead(is, _end);
+    BinaryRead(is, _size);
+    BinaryRead(is, _vec);
+    BinaryRead(is, _offset);
+    _lproc = _iproc;
+  }
+
   // ******************
   template <class Type> Type& MyVector<Type>::operator[](const unsigned &i) {
     return _vec[i - _begin];
@@ -26,6 +26,7 @@
 #include <algorithm>
 #include <cstring>
 #include "Files.hpp"
+#include "Profiler.hpp"
 
 
 namespace femus {
@@ -44,6 +45,8 @@ namespace femus {
 
   void GMVWriter::Write( const std::string output_path, const char order[], const std::vector<std::string>& vars, const unsigned time_step ) {
 
+    ProfileRegion region("output");
+
     // ********** linear -> index==0 *** quadratic -> index==1 **********
     unsigned index = ( strcmp( order, "linear" ) ) ? 1 : 0;
 
@@ -23,6 +23,7 @@ PURPOSE.  See the above copyright notice for more information.
 #include "FemusConfig.hpp"
 #include "FemusDefault.hpp"
 #include "ParsedFunction.hpp"
+#include "Profiler.hpp"
 
 
 
@@ -513,6 +514,8 @@ namespace femus
   void MultiLevelSolution::GenerateBdc(const unsigned int k, const unsigned int grid0, const double time)
   {
 
+    ProfileRegion region("bc generation");
+
     // 2 Default Neumann
     // 1 AMR artificial Dirichlet = 0 BC
     // 0 Dirichlet
@@ -360,6 +360,9 @@ namespace femus {
 
     }
 
+    // the mesh displacement may have changed
+    if(_FSI) _msh->InvalidateDisplacedGeometryCache();
+
   }
 
 
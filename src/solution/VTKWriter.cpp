@@ -28,6 +28,7 @@
 #include <iomanip>
 #include <algorithm>
 #include "Files.hpp"
+#include "Profiler.hpp"
 
 namespace femus {
 
@@ -48,6 +49,8 @@ namespace femus {
 
   void VTKWriter::Write( const std::string output_path, const char order[], const std::vector < std::string >& vars, const unsigned time_step ) {
 
+    ProfileRegion region("output");
+
     // *********** open vtu files *************
     std::ofstream fout;
 
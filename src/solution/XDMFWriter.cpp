@@ -20,6 +20,7 @@
 #include "XDMFWriter.hpp"
 #include "MultiLevelProblem.hpp"
 #include "NumericVector.hpp"
+#include "Profiler.hpp"
 #include <cstdio>
 #include <fstream>
 #include <iostream>
@@ -55,16 +56,22 @@ namespace femus {
 
   XDMFWriter::XDMFWriter( MultiLevelSolution* ml_sol ) : Writer( ml_sol ) {
     _debugOutput = false;
+    _parallelHDF5 = false;
+    _timeSeries = false;
   }
 
   XDMFWriter::XDMFWriter( MultiLevelMesh* ml_mesh ) : Writer( ml_mesh ) {
     _debugOutput = false;
+    _parallelHDF5 = false;
+    _timeSeries = false;
   }
 
   XDMFWriter::~XDMFWriter() {}
 
   void XDMFWriter::Write( const std::string output_path, const char order[], const std::vector<std::string>& vars, const unsigned time_step ) {
 
+    ProfileRegion region("output");
+
 #ifdef HAVE_HDF5
 
     bool print_all = 0;
@@ -84,7 +91,7 @@ namespace femus {
     }
 
     Mesh* mesh = _ml_mesh->GetLevel( _gridn - 1 );
-    Solution* solution = _ml_sol->GetSolutionLevel( _gridn - 1 );
+    Solution* solution = ( _ml_sol != NULL ) ? _ml_sol->GetSolutionLevel( _gridn - 1 ) : NULL;
 
     /// @todo I assume that the mesh is not mixed
     std::string type_elem;
@@ -102,82 +109,81 @@ namespace femus {
     unsigned nvt = mesh->_dofOffset[index_nd][_nprocs];
     unsigned nel = mesh->GetNumberOfElements();
     unsigned dim = mesh->GetDimension();
-    unsigned maxDim = ( nvt > ( dim + 1 ) * nel ) ? nvt : ( dim + 1 ) * nel;
     unsigned ndofs = mesh->el->GetNVE( elemtype, index_nd );
 
-    std::vector < int > var_conn( nel * ndofs );
-
-    std::vector < double > vector1;
-    vector1.reserve( nvt );
-
-    std::vector < double > vector2;
-    vector2.reserve( maxDim );
-
-    NumericVector* numVector = NumericVector::build().release();
-    numVector->init( nvt, mesh->_ownSize[index_nd][_iproc], true, AUTOMATIC );
-
-    //BEGIN XMF FILE PRINT
+    bool parallel = _parallelHDF5;
+#ifndef H5_HAVE_PARALLEL
+    if( parallel ) {
+      if( _iproc == 0 ) {
+        std::cout << " Warning in XDMFWriter::Write(): HDF5 has been built without MPI-IO, the output is gathered on the process 0" << std::endl;
+      }
+      parallel = false;
+    }
+#endif
 
     std::string filename_prefix;
     if( _ml_sol != NULL ) filename_prefix = "sol";
     else filename_prefix = "mesh";
 
-    std::ostringstream xdmf_filename;
-    xdmf_filename << output_path << "/" << filename_prefix << ".level" << _gridn << "." << time_step << "." << order << ".xmf";
-
-    std::ofstream fout;
-
-    if( _iproc != 0 ) {
-      fout.rdbuf();   //redirect to dev_null
+    // The HDF5 files: the topology (connectivity and partitions) goes in meshFile, the fields of the step
+    // in the group fieldGroup of fieldFile, the node coordinates in the mesh file or, if the mesh moves, with the fields
+    std::ostringstream series;
+    series << filename_prefix << ".level" << _gridn << "." << order;
+
+    std::string meshFile;
+    std::string fieldFile;
+    std::string fieldGroup;
+    bool writeTopology = true;
+
+    if( _timeSeries ) {
+      meshFile = series.str() + ".mesh.h5";
+      fieldFile = series.str() + ".h5";
+      std::ostringstream group;
+      group << "/STEP" << time_step;
+      fieldGroup = group.str();
+      writeTopology = ( _timeSeriesGrids.find( series.str() ) == _timeSeriesGrids.end() );
     }
     else {
-      fout.open( xdmf_filename.str().c_str() );
-      if( fout.is_open() ) {
-        std::cout << std::endl << " The output is printed to file " << xdmf_filename.str() << " in XDMF-HDF5 format" << std::endl;
-      }
-      else {
-        std::cout << std::endl << " The output file " << xdmf_filename.str() << " cannot be opened.\n";
-        abort();
-      }
+      std::ostringstream hdf5_filename;
+      hdf5_filename << filename_prefix << ".level" << _gridn << "." << time_step << "." << order << ".h5";
+      meshFile = hdf5_filename.str();
+      fieldFile = hdf5_filename.str();
     }
 
-    // The HDF5 file name
-    std::ostringstream hdf5_filename;
-    std::ostringstream hdf5_filename2;
-    hdf5_filename2 << filename_prefix << ".level" << _gridn << "." << time_step << "." << order << ".h5";
-    hdf5_filename << output_path << "/" <<  hdf5_filename2.str();
-
-    // head ************************************************
-    fout << "<?xml version=\"1.0\" ?>" << std::endl;
-    fout << "<!DOCTYPE Xdmf SYSTEM \"Xdmf.dtd []\">" << std::endl;
-    fout << "<Xdmf>" << std::endl;
-    fout << "<Domain>" << std::endl;
+    bool movingGeometry = ( _ml_sol != NULL && _moving_mesh );
+    std::string geometryFile = ( movingGeometry ) ? fieldFile : meshFile;
+    std::string geometryGroup = ( movingGeometry ) ? fieldGroup : "";
+
+    //BEGIN XMF FILE PRINT
+
+    std::ostringstream fout;
+
     fout << "<Grid Name=\"Mesh\">" << std::endl;
     fout << "<Time Value =\"" << time_step << "\" />" << std::endl;
     fout << "<Topology Type=\"" << type_elem << "\" Dimensions=\"" << nel << "\">" << std::endl;
     //Connectivity
     fout << "<DataStructure DataType=\"Int\" Dimensions=\"" << nel << " " << ndofs << "\"" << "  Format=\"HDF\">" << std::endl;
-    fout << hdf5_filename2.str() << ":/CONNECTIVITY" << std::endl;
+    fout << meshFile << ":/CONNECTIVITY" << std::endl;
     fout << "</DataStructure>" << std::endl;
     fout << "</Topology>" << std::endl;
     fout << "<Geometry Type=\"X_Y_Z\">" << std::endl;
     //Node_X
     fout << "<DataStructure DataType=\"Double\" Precision=\"8\" Dimensions=\"" << nvt << "  1\"" << "  Format=\"HDF\">" << std::endl;
-    fout << hdf5_filename2.str() << ":/NODES_X1" << std::endl;
+    fout << geometryFile << ":" << geometryGroup << "/NODES_X1" << std::endl;
     fout << "</DataStructure>" << std::endl;
     //Node_Y
     fout << "<DataStructure DataType=\"Double\" Precision=\"8\" Dimensions=\"" << nvt << "  1\"" << "  Format=\"HDF\">" << std::endl;
-    fout << hdf5_filename2.str() << ":/NODES_X2" << std::endl;
+    fout << geometryFile << ":" << geometryGroup << "/NODES_X2" << std::endl;
     fout << "</DataStructure>" << std::endl;
     //Node_Z
     fout << "<DataStructure DataType=\"Double\" Precision=\"8\" Dimensions=\"" << nvt << "  1\"" << "  Format=\"HDF\">" << std::endl;
-    fout << hdf5_filename2.str() << ":/NODES_X3" << std::endl;
+    fout << geometryFile << ":" << geometryGroup << "/NODES_X3" << std::endl;
     fout << "</DataStructure>" << std::endl;
     fout << "</Geometry>" << std::endl;
     //Metis partitions
     fout << "<Attribute Name=\"" << "Domain_partitions" << "\" AttributeType=\"Scalar\" Center=\"Cell\">" << std::endl;
     fout << "<DataItem DataType=\"Double\" Dimensions=\"" << nel << "  1\""  << "  Format=\"HDF\">" << std::endl;
-    fout << hdf5_filename2.str() << ":/DOMAIN_PARTITIONS" << std::endl;
+    fout << meshFile << ":/DOMAIN_PARTITIONS" << std::endl;
     fout << "</DataItem>" << std::endl;
     fout << "</Attribute>" << std::endl;
 
@@ -196,7 +202,7 @@ namespace femus {
             else printName = "Eps" + solName;
             fout << "<Attribute Name=\"" << printName << "\" AttributeType=\"Scalar\" Center=\"Node\">" << std::endl;
             fout << "<DataItem DataType=\"Double\" Precision=\"8\" Dimensions=\"" << nvt << "  1\"" << "  Format=\"HDF\">" << std::endl;
-            fout << hdf5_filename2.str() << ":/" << printName << std::endl;
+            fout << fieldFile << ":" << fieldGroup << "/" << printName << std::endl;
             fout << "</DataItem>" << std::endl;
             fout << "</Attribute>" << std::endl;
           }
@@ -211,7 +217,7 @@ namespace femus {
             else printName = "Eps" + solName;
             fout << "<Attribute Name=\"" << printName << "\" AttributeType=\"Scalar\" Center=\"Cell\">" << std::endl;
             fout << "<DataItem DataType=\"Double\" Precision=\"8\" Dimensions=\"" << nel << "  1\"" << "  Format=\"HDF\">" << std::endl;
-            fout << hdf5_filename2.str() << ":/" << printName << std::endl;
+            fout << fieldFile << ":" << fieldGroup << "/" << printName << std::endl;
             fout << "</DataItem>" << std::endl;
             fout << "</Attribute>" << std::endl;
           }
@@ -221,194 +227,235 @@ namespace femus {
     //end ml_sol
 
     fout << "</Grid>" << std::endl;
-    fout << "</Domain>" << std::endl;
-    fout << "</Xdmf>" << std::endl;
-    fout.close();
+
+    // in the time series the xmf file lists the grids of all the steps written so far
+    std::string grids = fout.str();
+    std::ostringstream xdmf_filename;
+    if( _timeSeries ) {
+      _timeSeriesGrids[series.str()] += grids;
+      grids = _timeSeriesGrids[series.str()];
+      xdmf_filename << output_path << "/" << series.str() << ".xmf";
+    }
+    else {
+      xdmf_filename << output_path << "/" << filename_prefix << ".level" << _gridn << "." << time_step << "." << order << ".xmf";
+    }
+
+    if( _iproc == 0 ) {
+      std::ofstream xmf( xdmf_filename.str().c_str() );
+      if( xmf.is_open() ) {
+        std::cout << std::endl << " The output is printed to file " << xdmf_filename.str() << " in XDMF-HDF5 format" << std::endl;
+      }
+      else {
+        std::cout << std::endl << " The output file " << xdmf_filename.str() << " cannot be opened.\n";
+        abort();
+      }
+
+      // head ************************************************
+      xmf << "<?xml version=\"1.0\" ?>" << std::endl;
+      xmf << "<!DOCTYPE Xdmf SYSTEM \"Xdmf.dtd []\">" << std::endl;
+      xmf << "<Xdmf>" << std::endl;
+      xmf << "<Domain>" << std::endl;
+      if( _timeSeries ) xmf << "<Grid Name=\"TimeSeries\" GridType=\"Collection\" CollectionType=\"Temporal\">" << std::endl;
+      xmf << grids;
+      if( _timeSeries ) xmf << "</Grid>" << std::endl;
+      xmf << "</Domain>" << std::endl;
+      xmf << "</Xdmf>" << std::endl;
+      xmf.close();
+    }
     //END XMF FILE PRINT
 
     //BEGIN HD5 FILE PRINT
-    hid_t file_id;
-    if( _iproc == 0 ) file_id = H5Fcreate( hdf5_filename.str().c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT );
-    hsize_t dimsf[2];
-    herr_t status;
-    hid_t dataspace;
-    hid_t dataset;
 
-    //BEGIN COORDINATES
-    for( int i = 0; i < 3; i++ ) {
-      numVector->matrix_mult( *mesh->_topology->_Sol[i], *mesh->GetQitoQjProjection( index_nd, 2 ) );
-      numVector->localize_to_one( vector1, 0 );
-
-      if( _ml_sol != NULL && _moving_mesh && dim > i ) {
-        unsigned varind_DXDYDZ = _ml_sol->GetIndex( _moving_vars[i].c_str() );
-        numVector->matrix_mult( *solution->_Sol[varind_DXDYDZ],
-                                *mesh->GetQitoQjProjection( index_nd, _ml_sol->GetSolutionType( varind_DXDYDZ ) ) );
-        numVector->localize_to_one( vector2, 0 );
-        if( _iproc == 0 ) {
-          for( unsigned ii = 0; ii < nvt; ii++ ) vector1[ii] += vector2[ii];
-        }
+    // in parallel each process writes its owned nodes and elements, the global numberings being contiguous by process,
+    // otherwise the data are gathered and written by the process 0
+    bool writer = ( parallel || _iproc == 0 );
+
+    unsigned nodeOffset = 0;
+    unsigned nodeSize = ( _iproc == 0 ) ? nvt : 0;
+    unsigned elementOffset = 0;
+    unsigned elementSize = ( _iproc == 0 ) ? nel : 0;
+    if( parallel ) {
+      nodeOffset = mesh->_dofOffset[index_nd][_iproc];
+      nodeSize = mesh->_dofOffset[index_nd][_iproc + 1] - nodeOffset;
+      elementOffset = mesh->_elementOffset[_iproc];
+      elementSize = mesh->_elementOffset[_iproc + 1] - elementOffset;
+    }
+
+    hid_t field_file_id = -1;
+    hid_t mesh_file_id = -1;
+    hid_t xfer_plist = H5P_DEFAULT;
+
+    if( writer ) {
+      field_file_id = OpenHDF5File( output_path + "/" + fieldFile, !_timeSeries || writeTopology, parallel );
+      if( writeTopology ) {
+        mesh_file_id = ( meshFile == fieldFile ) ? field_file_id : OpenHDF5File( output_path + "/" + meshFile, true, parallel );
       }
+      if( !fieldGroup.empty() ) CreateHDF5Group( field_file_id, fieldGroup );
 
-      if( _iproc == 0 ) {
-        dimsf[0] = nvt ;
-        dimsf[1] = 1;
-        std::ostringstream Name;
-        Name << "/NODES_X" << i + 1;
-        dataspace = H5Screate_simple( 2, dimsf, NULL );
-        dataset   = H5Dcreate( file_id, Name.str().c_str(), H5T_NATIVE_DOUBLE,
-                               dataspace, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT );
-        status = H5Dwrite( dataset, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, &vector1[0] );
-        H5Sclose( dataspace );
-        H5Dclose( dataset );
+#ifdef H5_HAVE_PARALLEL
+      if( parallel ) {
+        xfer_plist = H5Pcreate( H5P_DATASET_XFER );
+        H5Pset_dxpl_mpio( xfer_plist, H5FD_MPIO_COLLECTIVE );
       }
-    } //end 3d loop
+#endif
+    }
+
+    NumericVector* numVector = NumericVector::build().release();
+    numVector->init( nvt, mesh->_ownSize[index_nd][_iproc], true, AUTOMATIC );
+
+    std::vector < double > vector1;
+    std::vector < double > vector2;
+
+    //BEGIN COORDINATES
+    if( writeTopology || movingGeometry ) {
+      hid_t geometry_file_id = ( movingGeometry ) ? field_file_id : mesh_file_id;
+
+      for( int i = 0; i < 3; i++ ) {
+        numVector->matrix_mult( *mesh->_topology->_Sol[i], *mesh->GetQitoQjProjection( index_nd, 2 ) );
+        LocalizeNodeValues( numVector, parallel, nodeOffset, nodeSize, vector1 );
+
+        if( movingGeometry && dim > i ) {
+          unsigned varind_DXDYDZ = _ml_sol->GetIndex( _moving_vars[i].c_str() );
+          numVector->matrix_mult( *solution->_Sol[varind_DXDYDZ],
+                                  *mesh->GetQitoQjProjection( index_nd, _ml_sol->GetSolutionType( varind_DXDYDZ ) ) );
+          LocalizeNodeValues( numVector, parallel, nodeOffset, nodeSize, vector2 );
+          for( unsigned ii = 0; ii < nodeSize; ii++ ) vector1[ii] += vector2[ii];
+        }
+
+        if( writer ) {
+          std::ostringstream Name;
+          Name << geometryGroup << "/NODES_X" << i + 1;
+          WriteHDF5Hyperslab( geometry_file_id, Name.str(), H5T_NATIVE_DOUBLE, xfer_plist, nvt, nodeOffset, nodeSize,
+                              ( nodeSize > 0 ) ? &vector1[0] : NULL );
+        }
+      } //end 3d loop
+    }
     //END COORDINATES
 
-    //BEGIN CONNETTIVITY
-    unsigned icount = 0;
-    for( unsigned isdom = 0; isdom < _nprocs; isdom++ ) {
-      mesh->el->LocalizeElementDof( isdom );
-      if( _iproc == 0 ) {
-        for( unsigned iel = mesh->_elementOffset[isdom]; iel < mesh->_elementOffset[isdom + 1]; iel++ ) {
+    if( writeTopology ) {
+      //BEGIN CONNETTIVITY
+      std::vector < int > var_conn( elementSize * ndofs );
+
+      if( parallel ) {
+        for( unsigned iel = elementOffset; iel < elementOffset + elementSize; iel++ ) {
           for( unsigned j = 0; j < ndofs; j++ ) {
-            unsigned vtk_loc_conn = FemusToVTKorToXDMFConn[j];
-            var_conn[icount] = mesh->GetSolutionDof( vtk_loc_conn, iel, index_nd );
-            icount++;
+            var_conn[( iel - elementOffset ) * ndofs + j] = mesh->GetSolutionDof( FemusToVTKorToXDMFConn[j], iel, index_nd );
           }
         }
       }
-      mesh->el->FreeLocalizedElementDof();
-    }
-
-    if(_iproc == 0) {
-      dimsf[0] = nel * ndofs ;
-      dimsf[1] = 1;
-      dataspace = H5Screate_simple( 2, dimsf, NULL );
-      dataset   = H5Dcreate( file_id, "/CONNECTIVITY", H5T_NATIVE_INT,
-                             dataspace, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT );
-      status   = H5Dwrite( dataset, H5T_NATIVE_INT, H5S_ALL, H5S_ALL, H5P_DEFAULT, &var_conn[0] );
-      H5Sclose( dataspace );
-      H5Dclose( dataset );
-    }
+      else {
+        unsigned icount = 0;
+        for( unsigned isdom = 0; isdom < _nprocs; isdom++ ) {
+          mesh->el->LocalizeElementDof( isdom );
+          if( _iproc == 0 ) {
+            for( unsigned iel = mesh->_elementOffset[isdom]; iel < mesh->_elementOffset[isdom + 1]; iel++ ) {
+              for( unsigned j = 0; j < ndofs; j++ ) {
+                unsigned vtk_loc_conn = FemusToVTKorToXDMFConn[j];
+                var_conn[icount] = mesh->GetSolutionDof( vtk_loc_conn, iel, index_nd );
+                icount++;
+              }
+            }
+          }
+          mesh->el->FreeLocalizedElementDof();
+        }
+      }
 
-    //END CONNETTIVITY
+      if( writer ) {
+        WriteHDF5Hyperslab( mesh_file_id, "/CONNECTIVITY", H5T_NATIVE_INT, xfer_plist, nel * ndofs, elementOffset * ndofs, elementSize * ndofs,
+                            ( elementSize > 0 ) ? &var_conn[0] : NULL );
+      }
+      //END CONNETTIVITY
 
-    //BEGIN METIS PARTITIONING
-    if( _iproc == 0 ) {
-      unsigned icount = 0;
-      for( int isdom = 0; isdom < _nprocs; isdom++ ) {
-        for( unsigned ii = mesh->_elementOffset[isdom]; ii < mesh->_elementOffset[isdom + 1]; ii++ ) {
-          vector1[icount] = isdom;
-          icount++;
+      //BEGIN METIS PARTITIONING
+      vector1.resize( elementSize );
+      if( parallel ) {
+        vector1.assign( elementSize, _iproc );
+      }
+      else if( _iproc == 0 ) {
+        unsigned icount = 0;
+        for( int isdom = 0; isdom < _nprocs; isdom++ ) {
+          for( unsigned ii = mesh->_elementOffset[isdom]; ii < mesh->_elementOffset[isdom + 1]; ii++ ) {
+            vector1[icount] = isdom;
+            icount++;
+          }
         }
       }
-      dimsf[0] = nel;
-      dimsf[1] = 1;
-      dataspace = H5Screate_simple( 2, dimsf, NULL );
-      dataset   = H5Dcreate( file_id, "/DOMAIN_PARTITIONS", H5T_NATIVE_DOUBLE,
-                             dataspace, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT );
-      status   = H5Dwrite( dataset, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, &vector1[0] );
-      H5Sclose( dataspace );
-      H5Dclose( dataset );
+
+      if( writer ) {
+        WriteHDF5Hyperslab( mesh_file_id, "/DOMAIN_PARTITIONS", H5T_NATIVE_DOUBLE, xfer_plist, nel, elementOffset, elementSize,
+                            ( elementSize > 0 ) ? &vector1[0] : NULL );
+      }
+      //END METIS PARTITIONING
     }
-    //END METIS PARTITIONING
 
     //BEGIN SOLUTION
     if( _ml_sol != NULL )  {
-      //BEGIN DISCONTINUOUS Fem SOLUTION
       for( unsigned i = 0; i < ( 1 - print_all ) *vars.size() + print_all * _ml_sol->GetSolutionSize(); i++ ) {
         unsigned indx = ( print_all == 0 ) ? _ml_sol->GetIndex( vars[i].c_str() ) : i;
-        if( _ml_sol->GetSolutionType( indx ) >= 3 ) {
-          for( int name = 0; name < 1 + 3 * _debugOutput * solution->_ResEpsBdcFlag[i]; name++ ) {
-
-            std::string solName =  _ml_sol->GetSolutionName( indx );
-            std::string printName;
-            if( name == 0 ) {
-              solution->_Sol[indx]->localize_to_one( vector2, 0 );
-              printName = solName;
-            }
-            else if( name == 1 ) {
-              solution->_Bdc[indx]->localize_to_one( vector2, 0 );
-              printName = "Bdc" + solName;
-            }
-            else if( name == 2 ) {
-              solution->_Res[indx]->localize_to_one( vector2, 0 );
-              printName = "Res" + solName;
-            }
-            else {
-              solution->_Eps[indx]->localize_to_one( vector2, 0 );
-              printName = "Eps" + solName;
-            }
+        unsigned solType = _ml_sol->GetSolutionType( indx );
 
-            vector1.resize( nel );
-            for( unsigned ii = 0; ii < nel; ii++ ) {
-              vector1[ii] = vector2[ mesh->GetSolutionDof( 0, ii, _ml_sol->GetSolutionType( indx ) ) ];
-            }
+        for( int name = 0; name < 1 + 3 * _debugOutput * solution->_ResEpsBdcFlag[i]; name++ ) {
 
-            if( _iproc == 0 ) {
-              dimsf[0] = nel;
-              dimsf[1] = 1;
-              dataspace = H5Screate_simple( 2, dimsf, NULL );
-              dataset   = H5Dcreate( file_id, printName.c_str(), H5T_NATIVE_DOUBLE,
-                                     dataspace, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT );
-              status   = H5Dwrite( dataset, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, &vector1[0] );
-              H5Sclose( dataspace );
-              H5Dclose( dataset );
-            }
+          std::string solName =  _ml_sol->GetSolutionName( indx );
+          std::string printName;
+          NumericVector* printVector;
+          if( name == 0 ) {
+            printVector = solution->_Sol[indx];
+            printName = solName;
+          }
+          else if( name == 1 ) {
+            printVector = solution->_Bdc[indx];
+            printName = "Bdc" + solName;
+          }
+          else if( name == 2 ) {
+            printVector = solution->_Res[indx];
+            printName = "Res" + solName;
+          }
+          else {
+            printVector = solution->_Eps[indx];
+            printName = "Eps" + solName;
           }
-        }
-      }
-      //END DISCONTINUOUS Fem SOLUTION
 
-      //BEGIN LAGRANGIAN Fem SOLUTION
-      for( unsigned i = 0; i < ( 1 - print_all ) *vars.size() + print_all * _ml_sol->GetSolutionSize(); i++ ) {
-        unsigned indx = ( print_all == 0 ) ? _ml_sol->GetIndex( vars[i].c_str() ) : i;
-        if( _ml_sol->GetSolutionType( indx ) < 3 ) {
-          for( int name = 0; name < 1 + 3 * _debugOutput * solution->_ResEpsBdcFlag[i]; name++ ) {
+          if( solType < 3 ) { //BEGIN LAGRANGIAN Fem SOLUTION
+            numVector->matrix_mult( *printVector, *mesh->GetQitoQjProjection( index_nd, solType ) );
+            LocalizeNodeValues( numVector, parallel, nodeOffset, nodeSize, vector1 );
 
-            std::string solName =  _ml_sol->GetSolutionName( indx );
-            std::string printName;
-            if( name == 0 ) {
-              numVector->matrix_mult( *solution->_Sol[indx],
-                                      *mesh->GetQitoQjProjection( index_nd, _ml_sol->GetSolutionType( indx ) ) );
-              printName = solName;
+            if( writer ) {
+              WriteHDF5Hyperslab( field_file_id, fieldGroup + "/" + printName, H5T_NATIVE_DOUBLE, xfer_plist, nvt, nodeOffset, nodeSize,
+                                  ( nodeSize > 0 ) ? &vector1[0] : NULL );
             }
-            else if( name == 1 ) {
-              numVector->matrix_mult( *solution->_Bdc[indx],
-                                      *mesh->GetQitoQjProjection( index_nd, _ml_sol->GetSolutionType( indx ) ) );
-              printName = "Bdc" + solName;
-            }
-            else if( name == 2 ) {
-              numVector->matrix_mult( *solution->_Res[indx],
-                                      *mesh->GetQitoQjProjection( index_nd, _ml_sol->GetSolutionType( indx ) ) );
-              printName = "Res" + solName;
+          }
+          else { //BEGIN DISCONTINUOUS Fem SOLUTION, the dofs are owned with the element
+            vector1.resize( elementSize );
+            if( parallel ) {
+              for( unsigned iel = elementOffset; iel < elementOffset + elementSize; iel++ ) {
+                vector1[iel - elementOffset] = ( *printVector )( mesh->GetSolutionDof( 0, iel, solType ) );
+              }
             }
             else {
-              numVector->matrix_mult( *solution->_Eps[indx],
-                                      *mesh->GetQitoQjProjection( index_nd, _ml_sol->GetSolutionType( indx ) ) );
-              printName = "Eps" + solName;
+              printVector->localize_to_one( vector2, 0 );
+              if( _iproc == 0 ) {
+                for( unsigned ii = 0; ii < nel; ii++ ) {
+                  vector1[ii] = vector2[ mesh->GetSolutionDof( 0, ii, solType ) ];
+                }
+              }
             }
 
-            numVector->localize_to_one( vector1, 0 );
-
-            if( _iproc == 0 ) {
-              dimsf[0] = nvt;
-              dimsf[1] = 1;
-              dataspace = H5Screate_simple( 2, dimsf, NULL );
-              dataset   = H5Dcreate( file_id, printName.c_str(), H5T_NATIVE_DOUBLE,
-                                     dataspace, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT );
-              status   = H5Dwrite( dataset, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, &vector1[0] );
-              H5Sclose( dataspace );
-              H5Dclose( dataset );
+            if( writer ) {
+              WriteHDF5Hyperslab( field_file_id, fieldGroup + "/" + printName, H5T_NATIVE_DOUBLE, xfer_plist, nel, elementOffset, elementSize,
+                                  ( elementSize > 0 ) ? &vector1[0] : NULL );
             }
           }
         }
       }
-      //END LAGRANGIAN Fem SOLUTION
     }
     //END SOLUTION
 
-    if( _iproc == 0 ) H5Fclose( file_id );
+    if( writer ) {
+      if( xfer_plist != H5P_DEFAULT ) H5Pclose( xfer_plist );
+      if( mesh_file_id >= 0 && mesh_file_id != field_file_id ) H5Fclose( mesh_file_id );
+      H5Fclose( field_file_id );
+    }
 
     //END HD5 FILE PRINT
 
@@ -419,6 +466,83 @@ namespace femus {
     return;
   }
 
+#ifdef HAVE_HDF5
+
+  hid_t XDMFWriter::OpenHDF5File( const std::string& filename, const bool& create, const bool& parallel ) {
+
+    hid_t fapl_id = H5P_DEFAULT;
+
+#ifdef H5_HAVE_PARALLEL
+    if( parallel ) {
+      fapl_id = H5Pcreate( H5P_FILE_ACCESS );
+      H5Pset_fapl_mpio( fapl_id, MPI_COMM_WORLD, MPI_INFO_NULL );
+    }
+#endif
+
+    hid_t file_id = ( create ) ? H5Fcreate( filename.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, fapl_id ) :
+                    H5Fopen( filename.c_str(), H5F_ACC_RDWR, fapl_id );
+
+    if( fapl_id != H5P_DEFAULT ) H5Pclose( fapl_id );
+
+    if( file_id < 0 ) {
+      std::cout << std::endl << " The HDF5 file " << filename << " cannot be opened.\n";
+      abort();
+    }
+
+    return file_id;
+  }
+
+  void XDMFWriter::CreateHDF5Group( hid_t file_id, const std::string& group ) {
+
+    // a step written again replaces the previous one
+    if( H5Lexists( file_id, group.c_str(), H5P_DEFAULT ) > 0 ) {
+      H5Ldelete( file_id, group.c_str(), H5P_DEFAULT );
+    }
+
+    hid_t group_id = H5Gcreate( file_id, group.c_str(), H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT );
+    H5Gclose( group_id );
+  }
+
+  void XDMFWriter::WriteHDF5Hyperslab( hid_t file_id, const std::string& name, hid_t type, hid_t xfer_plist,
+                                       const hsize_t& global_size, const hsize_t& offset, const hsize_t& local_size, const void* data ) {
+
+    hsize_t dimsf[2] = {global_size, 1};
+    hid_t filespace = H5Screate_simple( 2, dimsf, NULL );
+    hid_t dataset = H5Dcreate( file_id, name.c_str(), type, filespace, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT );
+
+    hsize_t start[2] = {offset, 0};
+    hsize_t count[2] = {local_size, 1};
+    hid_t memspace = H5Screate_simple( 2, count, NULL );
+
+    // with a collective write every process takes part, also the ones with nothing to write
+    if( local_size > 0 ) {
+      H5Sselect_hyperslab( filespace, H5S_SELECT_SET, start, NULL, count, NULL );
+    }
+    else {
+      H5Sselect_none( filespace );
+      H5Sselect_none( memspace );
+    }
+
+    H5Dwrite( dataset, type, memspace, filespace, xfer_plist, data );
+
+    H5Sclose( memspace );
+    H5Sclose( filespace );
+    H5Dclose( dataset );
+  }
+
+#endif
+
+  void XDMFWriter::LocalizeNodeValues( NumericVector* numVector, const bool& parallel, const unsigned& nodeOffset, const unsigned& nodeSize,
+                                       std::vector < double >& values ) const {
+    if( parallel ) {
+      values.resize( nodeSize );
+      for( unsigned ii = 0; ii < nodeSize; ii++ ) values[ii] = ( *numVector )( nodeOffset + ii );
+    }
+    else {
+      numVector->localize_to_one( values, 0 );
+    }
+  }
+
   void XDMFWriter::write_solution_wrapper( const std::string output_path, const char type[] ) const {
 
 #ifdef HAVE_HDF5
@@ -19,6 +19,8 @@
 //----------------------------------------------------------------------------
 // includes :
 //----------------------------------------------------------------------------
+#include <map>
+
 #include "Writer.hpp"
 #include "MultiLevelMeshTwo.hpp"
 #include "MultiLevelProblem.hpp"
@@ -144,9 +146,41 @@ namespace femus {
         _debugOutput = value;
       }
 
+      /** Set if each process writes its own part of the HDF5 file with collective MPI-IO,
+       * instead of gathering all the data on the process 0. It requires HDF5 built with parallel support */
+      void SetParallelHDF5( bool value ) {
+        _parallelHDF5 = value;
+      }
+
+      /** Set if to write a time series for a static mesh: the topology and the node coordinates are written once in
+       * <prefix>.mesh.h5, the fields of each step in the group /STEP<time_step> of a single <prefix>.h5 file,
+       * and <prefix>.xmf is a temporal collection of all the steps written so far */
+      void SetTimeSeries( bool value ) {
+        _timeSeries = value;
+      }
+
     private:
 
+      /** Open the HDF5 file filename, creating it if create, with MPI-IO if parallel */
+      static hid_t OpenHDF5File( const std::string& filename, const bool& create, const bool& parallel );
+
+      /** Create the group in the HDF5 file, replacing an existing one with the same name */
+      static void CreateHDF5Group( hid_t file_id, const std::string& group );
+
+      /** Write the entries offset ... offset + local_size - 1 of the global_size x 1 dataset name, collective with a MPI-IO transfer list */
+      static void WriteHDF5Hyperslab( hid_t file_id, const std::string& name, hid_t type, hid_t xfer_plist,
+                                      const hsize_t& global_size, const hsize_t& offset, const hsize_t& local_size, const void* data );
+
+      /** Get the owned entries of the node vector if parallel, otherwise all of them on the process 0 */
+      void LocalizeNodeValues( NumericVector* numVector, const bool& parallel, const unsigned& nodeOffset, const unsigned& nodeSize,
+                               std::vector < double >& values ) const;
+
       bool _debugOutput;
+      bool _parallelHDF5;
+      bool _timeSeries;
+
+      /** xmf grids written so far by each time series, the key being the file name prefix */
+      std::map < std::string, std::string > _timeSeriesGrids;
 
       static const std::string type_el[3][N_GEOM_ELS];
 
@@ -0,0 +1,455 @@
+#include "MonteCarloSampler.hpp"
+
+#include <iostream>
+#include <cstdlib>
+
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/seed_seq.hpp>
+#include <boost/random/normal_distribution.hpp>
+#include <boost/random/uniform_real_distribution.hpp>
+
+namespace femus {
+
+  void StreamingMoments::Add (const double &x) {
+
+    double n1 = _n;
+    _n += 1.;
+
+    double delta = x - _mean;
+    double deltaN = delta / _n;
+    double deltaN2 = deltaN * deltaN;
+    double term1 = delta * deltaN * n1;
+
+    _mean += deltaN;
+    _M4 += term1 * deltaN2 * (_n * _n - 3. * _n + 3.) + 6. * deltaN2 * _M2 - 4. * deltaN * _M3;
+    _M3 += term1 * deltaN * (_n - 2.) - 3. * deltaN * _M2;
+    _M2 += term1;
+
+  }
+
+  void StreamingMoments::Merge (const StreamingMoments &b) {
+
+    if (b._n == 0.) return;
+
+    if (_n == 0.) {
+      *this = b;
+      return;
+    }
+
+    double na = _n;
+    double nb = b._n;
+    double n = na + nb;
+
+    double delta = b._mean - _mean;
+    double delta2 = delta * delta;
+    double delta3 = delta2 * delta;
+    double delta4 = delta2 * delta2;
+
+    double M2 = _M2 + b._M2 + delta2 * na * nb / n;
+
+    double M3 = _M3 + b._M3 + delta3 * na * nb * (na - nb) / (n * n)
+                + 3. * delta * (na * b._M2 - nb * _M2) / n;
+
+    double M4 = _M4 + b._M4 + delta4 * na * nb * (na * na - na * nb + nb * nb) / (n * n * n)
+                + 6. * delta2 * (na * na * b._M2 + nb * nb * _M2) / (n * n)
+                + 4. * delta * (na * b._M3 - nb * _M3) / n;
+
+    _mean = (na * _mean + nb * b._mean) / n;
+    _n = n;
+    _M2 = M2;
+    _M3 = M3;
+    _M4 = M4;
+
+  }
+
+  void StreamingMoments::Pack (double *buffer) const {
+    buffer[0] = _n;
+    buffer[1] = _mean;
+    buffer[2] = _M2;
+    buffer[3] = _M3;
+    buffer[4] = _M4;
+  }
+
+  void StreamingMoments::Unpack (const double *buffer) {
+    _n = buffer[0];
+    _mean = buffer[1];
+    _M2 = buffer[2];
+    _M3 = buffer[3];
+    _M4 = buffer[4];
+  }
+
+  ////////////////////////////////////////////
+
+  MonteCarloSampler::MonteCarloSampler (MultiLevelProblem &ml_prob, MonteCarloSampleFunction sampleFunction,
+                                        const unsigned &numberOfRandomVariables, const unsigned &numberOfQoIs,
+                                        const UqQuadratureType &distribution, const unsigned &processesPerGroup,
+                                        const bool &groupLocal) :
+    _ml_prob (&ml_prob),
+    _sampleFunction (sampleFunction),
+    _numberOfRandomVariables (numberOfRandomVariables),
+    _numberOfQoIs (numberOfQoIs),
+    _distribution (distribution),
+    _seed (0),
+    _histogramMin (0.),
+    _histogramMax (0.) {
+
+    MPI_Comm_rank (MPI_COMM_WORLD, &_iproc);
+    MPI_Comm_size (MPI_COMM_WORLD, &_nprocs);
+
+    unsigned groupSize = (processesPerGroup == 0 || processesPerGroup > static_cast < unsigned > (_nprocs)) ? _nprocs : processesPerGroup;
+
+    _group = _iproc / groupSize;
+    _numberOfGroups = (_nprocs + groupSize - 1) / groupSize;
+
+    //the groups evaluate different samples at the same time, a sample function solving on ml_prob would deadlock
+    if (_numberOfGroups > 1 && !groupLocal) {
+      std::cout << "Error in MonteCarloSampler: " << _numberOfGroups << " sample groups require a group local sample function" << std::endl;
+      abort();
+    }
+
+    MPI_Comm_split (MPI_COMM_WORLD, _group, _iproc, &_groupComm);
+
+    int groupRank;
+    MPI_Comm_rank (_groupComm, &groupRank);
+
+    //the root of group 0 is the process 0 of MPI_COMM_WORLD and of _leaderComm
+    MPI_Comm_split (MPI_COMM_WORLD, (groupRank == 0) ? 0 : MPI_UNDEFINED, _iproc, &_leaderComm);
+
+    Clear();
+
+  }
+
+  MonteCarloSampler::~MonteCarloSampler() {
+
+    int finalized;
+    MPI_Finalized (&finalized);
+
+    if (!finalized) {
+      MPI_Comm_free (&_groupComm);
+
+      if (_leaderComm != MPI_COMM_NULL) MPI_Comm_free (&_leaderComm);
+    }
+
+  }
+
+  void MonteCarloSampler::SetHistogram (const double &xmin, const double &xmax, const unsigned &nBins) {
+
+    if (xmax <= xmin || nBins == 0) {
+      std::cout << "Error in MonteCarloSampler::SetHistogram: empty histogram interval or no bins" << std::endl;
+      abort();
+    }
+
+    _histogramMin = xmin;
+    _histogramMax = xmax;
+    _histogram.assign (_numberOfQoIs, std::vector < double > (nBins, 0.));
+
+  }
+
+  void MonteCarloSampler::Clear() {
+
+    _sampleCounter = 0;
+    _moments.assign (_numberOfQoIs, StreamingMoments());
+    _time = 0.;
+
+    for (unsigned q = 0; q < _histogram.size(); q++) {
+      _histogram[q].assign (_histogram[q].size(), 0.);
+    }
+
+    _levelSampleCounter.clear();
+    _levelMoments.clear();
+    _levelTime.clear();
+
+  }
+
+  void MonteCarloSampler::DrawSample (std::vector < double > &y, const bool &multilevel, const unsigned &level, const unsigned &s) const {
+
+    boost::random::seed_seq seq { _seed, static_cast < unsigned > (multilevel), level, s };
+    boost::random::mt19937 rng (seq);
+
+    y.resize (_numberOfRandomVariables);
+
+    if (_distribution == UQ_HERMITE) {
+      boost::random::normal_distribution<> nd (0., 1.);
+
+      for (unsigned i = 0; i < _numberOfRandomVariables; i++) {
+        y[i] = nd (rng);
+      }
+    }
+    else {
+      boost::random::uniform_real_distribution<> un (-1., 1.);
+
+      for (unsigned i = 0; i < _numberOfRandomVariables; i++) {
+        y[i] = un (rng);
+      }
+    }
+
+  }
+
+  void MonteCarloSampler::Run (const unsigned &numberOfSamples, const unsigned &level) {
+
+    unsigned nBins = (_histogram.size() > 0) ? _histogram[0].size() : 0;
+    double deltaBin = (nBins > 0) ? (_histogramMax - _histogramMin) / nBins : 0.;
+
+    std::vector < StreamingMoments > localMoments (_numberOfQoIs);
+    std::vector < std::vector < double > > localHistogram (_histogram.size(), std::vector < double > (nBins, 0.));
+    double localTime = 0.;
+
+    std::vector < double > y;
+    std::vector < double > qoi;
+
+    for (unsigned m = 0; m < numberOfSamples; m++) {
+
+      unsigned s = _sampleCounter + m;
+
+      if (s % _numberOfGroups != _group) continue;
+
+      double start = MPI_Wtime();
+
+      DrawSample (y, false, level, s);
+      qoi.assign (_numberOfQoIs, 0.);
+      _sampleFunction (*_ml_prob, level, y, qoi);
+
+      localTime += MPI_Wtime() - start;
+
+      for (unsigned q = 0; q < _numberOfQoIs; q++) {
+        localMoments[q].Add (qoi[q]);
+
+        if (nBins > 0 && qoi[q] >= _histogramMin && qoi[q] <= _histogramMax) {
+          unsigned i = static_cast < unsigned > ((qoi[q] - _histogramMin) / deltaBin);
+          localHistogram[q][(i < nBins) ? i : nBins - 1] += 1.;
+        }
+      }
+    }
+
+    _sampleCounter += numberOfSamples;
+
+    ReduceStatistics (localMoments, _moments, (nBins > 0) ? &localHistogram : NULL, localTime, _time);
+
+  }
+
+  void MonteCarloSampler::RunMultilevel (const std::vector < unsigned > &numberOfSamples) {
+
+    unsigned numberOfLevels = numberOfSamples.size();
+
+    if (_levelMoments.size() < numberOfLevels) {
+      _levelSampleCounter.resize (numberOfLevels, 0);
+      _levelMoments.resize (numberOfLevels, std::vector < StreamingMoments > (_numberOfQoIs));
+      _levelTime.resize (numberOfLevels, 0.);
+    }
+
+    std::vector < double > y;
+    std::vector < double > qoiFine;
+    std::vector < double > qoiCoarse;
+
+    for (unsigned l = 0; l < numberOfLevels; l++) {
+
+      std::vector < StreamingMoments > localMoments (_numberOfQoIs);
+      double localTime = 0.;
+
+      for (unsigned m = 0; m < numberOfSamples[l]; m++) {
+
+        unsigned s = _levelSampleCounter[l] + m;
+
+        if (s % _numberOfGroups != _group) continue;
+
+        double start = MPI_Wtime();
+
+        //the two levels of the correction see the same realization
+        DrawSample (y, true, l, s);
+
+        qoiFine.assign (_numberOfQoIs, 0.);
+        _sampleFunction (*_ml_prob, l, y, qoiFine);
+
+        qoiCoarse.assign (_numberOfQoIs, 0.);
+
+        if (l > 0) _sampleFunction (*_ml_prob, l - 1, y, qoiCoarse);
+
+        localTime += MPI_Wtime() - start;
+
+        for (unsigned q = 0; q < _numberOfQoIs; q++) {
+          localMoments[q].Add (qoiFine[q] - qoiCoarse[q]);
+        }
+      }
+
+      _levelSampleCounter[l] += numberOfSamples[l];
+
+      ReduceStatistics (localMoments, _levelMoments[l], NULL, localTime, _levelTime[l]);
+    }
+
+  }
+
+  void MonteCarloSampler::ReduceStatistics (std::vector < StreamingMoments > &localMoments, std::vector < StreamingMoments > &moments,
+                                            std::vector < std::vector < double > > *localHistogram, double &localTime, double &time) {
+
+    unsigned packSize = StreamingMoments::_packSize;
+    unsigned nBins = (localHistogram) ? _histogram[0].size() : 0;
+    unsigned size = 1 + _numberOfQoIs * (packSize + nBins);
+
+    //layout: time, then for each quantity its moments and its histogram
+    std::vector < double > buffer (size);
+    buffer[0] = localTime;
+
+    for (unsigned q = 0; q < _numberOfQoIs; q++) {
+      double *bq = &buffer[1 + q * (packSize + nBins)];
+      localMoments[q].Pack (bq);
+
+      for (unsigned i = 0; i < nBins; i++) {
+        bq[packSize + i] = (*localHistogram) [q][i];
+      }
+    }
+
+    std::vector < double > runBuffer (size, 0.);
+
+    if (_leaderComm != MPI_COMM_NULL) {
+      int leaderRank;
+      int nLeaders;
+      MPI_Comm_rank (_leaderComm, &leaderRank);
+      MPI_Comm_size (_leaderComm, &nLeaders);
+
+      std::vector < double > gathered ((leaderRank == 0) ? size * nLeaders : 0);
+      MPI_Gather (&buffer[0], size, MPI_DOUBLE, (leaderRank == 0) ? &gathered[0] : NULL, size, MPI_DOUBLE, 0, _leaderComm);
+
+      if (leaderRank == 0) {
+        //merge the groups always in the same order, so that the result does not depend on the message timing
+        for (int jgroup = 0; jgroup < nLeaders; jgroup++) {
+          const double *bj = &gathered[jgroup * size];
+          runBuffer[0] += bj[0];
+
+          for (unsigned q = 0; q < _numberOfQoIs; q++) {
+            double *rq = &runBuffer[1 + q * (packSize + nBins)];
+            const double *bq = &bj[1 + q * (packSize + nBins)];
+
+            StreamingMoments run;
+            StreamingMoments group;
+            run.Unpack (rq);
+            group.Unpack (bq);
+            run.Merge (group);
+            run.Pack (rq);
+
+            for (unsigned i = 0; i < nBins; i++) {
+              rq[packSize + i] += bq[packSize + i];
+            }
+          }
+        }
+      }
+    }
+
+    MPI_Bcast (&runBuffer[0], size, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+
+    time += runBuffer[0];
+
+    for (unsigned q = 0; q < _numberOfQoIs; q++) {
+      const double *rq = &runBuffer[1 + q * (packSize + nBins)];
+
+      StreamingMoments run;
+      run.Unpack (rq);
+      moments[q].Merge (run);
+
+      for (unsigned i = 0; i < nBins; i++) {
+        _histogram[q][i] += rq[packSize + i];
+      }
+    }
+
+  }
+
+  void MonteCarloSampler::GetOptimalNumberOfSamples (std::vector < unsigned > &numberOfSamples, const double &tolerance, const unsigned &iqoi) const {
+
+    unsigned numberOfLevels = _levelMoments.size();
+
+    double sum = 0.;
+
+    for (unsigned l = 0; l < numberOfLevels; l++) {
+      sum += sqrt (_levelMoments[l][iqoi].GetVariance() * GetLevelCost (l));
+    }
+
+    numberOfSamples.resize (numberOfLevels);
+
+    for (unsigned l = 0; l < numberOfLevels; l++) {
+      double cost = GetLevelCost (l);
+
+      if (cost > 0.) {
+        numberOfSamples[l] = static_cast < unsigned > (ceil (2. / (tolerance * tolerance) * sqrt (_levelMoments[l][iqoi].GetVariance() / cost) * sum));
+      }
+      else {
+        numberOfSamples[l] = _levelSampleCounter[l];
+      }
+    }
+
+  }
+
+  double MonteCarloSampler::GetMultilevelMean (const unsigned &iqoi) const {
+
+    double mean = 0.;
+
+    for (unsigned l = 0; l < _levelMoments.size(); l++) {
+      mean += _levelMoments[l][iqoi].GetMean();
+    }
+
+    return mean;
+
+  }
+
+  double MonteCarloSampler::GetMultilevelEstimatorVariance (const unsigned &iqoi) const {
+
+    double variance = 0.;
+
+    for (unsigned l = 0; l < _levelMoments.size(); l++) {
+      double n = _levelMoments[l][iqoi].GetCount();
+
+      if (n > 0.) variance += _levelMoments[l][iqoi].GetVariance() / n;
+    }
+
+    return variance;
+
+  }
+
+  void MonteCarloSampler::GetHistogram (std::vector < double > &pdf, const unsigned &iqoi) const {
+
+    if (_histogram.size() == 0) {
+      pdf.clear();
+      return;
+    }
+
+    unsigned nBins = _histogram[iqoi].size();
+    double deltaBin = (_histogramMax - _histogramMin) / nBins;
+    double n = _moments[iqoi].GetCount();
+
+    pdf.assign (nBins, 0.);
+
+    if (n > 0.) {
+      for (unsigned i = 0; i < nBins; i++) {
+        pdf[i] = _histogram[iqoi][i] / (n * deltaBin);
+      }
+    }
+
+  }
+
+  void MonteCarloSampler::PrintStatistics() const {
+
+    std::cout << " MonteCarloSampler: " << _numberOfGroups << " sample groups" << std::endl;
+
+    for (unsigned q = 0; q < _numberOfQoIs; q++) {
+      if (_moments[q].GetCount() > 0.) {
+        std::cout << " QoI " << q << " MC samples = " << _moments[q].GetCount()
+                  << " mean = " << _moments[q].GetMean()
+                  << " variance = " << _moments[q].GetVariance()
+                  << " skewness = " << _moments[q].GetSkewness()
+                  << " kurtosis = " << _moments[q].GetKurtosis() << std::endl;
+      }
+
+      if (_levelMoments.size() > 0) {
+        for (unsigned l = 0; l < _levelMoments.size(); l++) {
+          std::cout << " QoI " << q << " level " << l << " samples = " << _levelMoments[l][q].GetCount()
+                    << " mean correction = " << _levelMoments[l][q].GetMean()
+                    << " variance correction = " << _levelMoments[l][q].GetVariance()
+                    << " cost = " << GetLevelCost (l) << std::endl;
+        }
+
+        std::cout << " QoI " << q << " MLMC mean = " << GetMultilevelMean (q)
+                  << " estimator variance = " << GetMultilevelEstimatorVariance (q) << std::endl;
+      }
+    }
+
+  }
+
+}
@@ -0,0 +1,197 @@
+#ifndef __MonteCarloSampler_hpp__
+#define __MonteCarloSampler_hpp__
+
+#include <vector>
+#include <cmath>
+#include <mpi.h>
+
+#include "UqQuadratureTypeEnum.hpp"
+
+namespace femus {
+
+  class MultiLevelProblem;
+
+  /// Streaming (Welford) mean and central moments up to the fourth order of a scalar quantity,
+  /// with the pairwise merge of Chan et al. and Pebay to combine the statistics of different processes
+  class StreamingMoments {
+
+    public:
+      StreamingMoments() {
+        Clear();
+      };
+
+      void Clear() {
+        _n = 0.;
+        _mean = 0.;
+        _M2 = 0.;
+        _M3 = 0.;
+        _M4 = 0.;
+      }
+
+      /// Add the value x
+      void Add (const double &x);
+
+      /// Add all the values of b
+      void Merge (const StreamingMoments &b);
+
+      double GetCount() const {
+        return _n;
+      }
+
+      double GetMean() const {
+        return _mean;
+      }
+
+      /// Unbiased sample variance
+      double GetVariance() const {
+        return (_n > 1.) ? _M2 / (_n - 1.) : 0.;
+      }
+
+      double GetSkewness() const {
+        return (_M2 > 0.) ? sqrt (_n) * _M3 / pow (_M2, 1.5) : 0.;
+      }
+
+      /// Kurtosis (3 for a Gaussian)
+      double GetKurtosis() const {
+        return (_M2 > 0.) ? _n * _M4 / (_M2 * _M2) : 0.;
+      }
+
+      /// Number of doubles written by Pack
+      static const unsigned _packSize = 5;
+
+      void Pack (double *buffer) const;
+
+      void Unpack (const double *buffer);
+
+    private:
+      double _n;
+      double _mean;
+      double _M2;
+      double _M3;
+      double _M4;
+  };
+
+  /// Sample function: compute the quantities of interest qoi on the MultiLevelMesh level level
+  /// for the realization y of the random variables
+  typedef void (*MonteCarloSampleFunction) (MultiLevelProblem &ml_prob, const unsigned &level,
+                                            const std::vector < double > &y, std::vector < double > &qoi);
+
+  /// Monte Carlo and multilevel Monte Carlo sampling driver.
+  /// MPI_COMM_WORLD is split into sample groups of contiguous processes, the samples are dealt round robin to the groups
+  /// and all the processes of a group evaluate the same samples. The random variables of the sample s are drawn from a stream
+  /// seeded with (seed, level, s), so every process generates them locally and the runs are reproducible for any number of groups.
+  /// The problem ml_prob is set up once and shared by all the samples: the sample function only reassembles the random part,
+  /// e.g. with LinearImplicitSystem::SetCoarseOperatorReuse the MG hierarchy and the symbolic coarse products are kept (see UQ ex2).
+  /// The FEM objects live on MPI_COMM_WORLD, so sample functions that solve on ml_prob require one group (the default);
+  /// more groups are allowed only for sample functions declared groupLocal, which communicate on GetGroupCommunicator() only.
+  /// The statistics are streamed per group and merged over the groups at the end of each run, and they accumulate over the runs.
+  class MonteCarloSampler {
+
+    public:
+      /// processesPerGroup = 0 uses one group with all the processes, more than one group aborts unless groupLocal is set
+      MonteCarloSampler (MultiLevelProblem &ml_prob, MonteCarloSampleFunction sampleFunction,
+                         const unsigned &numberOfRandomVariables, const unsigned &numberOfQoIs,
+                         const UqQuadratureType &distribution, const unsigned &processesPerGroup = 0,
+                         const bool &groupLocal = false);
+
+      ~MonteCarloSampler();
+
+      /// Set the seed of the sample streams, Hermite: standard Gaussian, Legendre: uniform in [-1, 1]
+      void SetSeed (const unsigned &seed) {
+        _seed = seed;
+      }
+
+      /// Collect the histogram of the quantities of interest of Run with nBins bins in [xmin, xmax]
+      void SetHistogram (const double &xmin, const double &xmax, const unsigned &nBins);
+
+      /// Reset all the statistics and the sample counters
+      void Clear();
+
+      /// Monte Carlo: add numberOfSamples samples of the quantities of interest on the level level, collective
+      void Run (const unsigned &numberOfSamples, const unsigned &level);
+
+      /// Multilevel Monte Carlo: add numberOfSamples[l] samples of the corrections Q_l - Q_{l-1} (Q_{-1} = 0) on the levels l, collective
+      void RunMultilevel (const std::vector < unsigned > &numberOfSamples);
+
+      /// Number of samples per level for which the variance of the multilevel estimator of the quantity iqoi is tolerance^2 / 2,
+      /// N_l = 2 / tolerance^2 sqrt(V_l / C_l) sum_k sqrt(V_k C_k), from the variances V_l and costs C_l of the previous RunMultilevel
+      void GetOptimalNumberOfSamples (std::vector < unsigned > &numberOfSamples, const double &tolerance, const unsigned &iqoi = 0) const;
+
+      /// Statistics of the quantity iqoi of Run
+      const StreamingMoments & GetMoments (const unsigned &iqoi) const {
+        return _moments[iqoi];
+      }
+
+      /// Statistics of the correction of the quantity iqoi on the level l of RunMultilevel
+      const StreamingMoments & GetLevelMoments (const unsigned &l, const unsigned &iqoi) const {
+        return _levelMoments[l][iqoi];
+      }
+
+      /// Multilevel estimate of the mean of the quantity iqoi, sum of the means of the corrections
+      double GetMultilevelMean (const unsigned &iqoi) const;
+
+      /// Variance of the multilevel estimator of the quantity iqoi, sum_l V_l / N_l
+      double GetMultilevelEstimatorVariance (const unsigned &iqoi) const;
+
+      /// Average wall time of a sample of RunMultilevel on the level l
+      double GetLevelCost (const unsigned &l) const {
+        return (_levelMoments[l][0].GetCount() > 0.) ? _levelTime[l] / _levelMoments[l][0].GetCount() : 0.;
+      }
+
+      /// Probability density of the quantity iqoi of Run on the histogram bins, samples outside [xmin, xmax] count in the normalization
+      void GetHistogram (std::vector < double > &pdf, const unsigned &iqoi) const;
+
+      MPI_Comm GetGroupCommunicator() const {
+        return _groupComm;
+      }
+
+      unsigned GetGroup() const {
+        return _group;
+      }
+
+      unsigned GetNumberOfGroups() const {
+        return _numberOfGroups;
+      }
+
+      void PrintStatistics() const;
+
+    private:
+      /// Draw the random variables of the sample s of the level level, of RunMultilevel if multilevel, of Run otherwise
+      void DrawSample (std::vector < double > &y, const bool &multilevel, const unsigned &level, const unsigned &s) const;
+
+      /// Merge over the groups the statistics of this run and add them to the accumulated ones, collective
+      void ReduceStatistics (std::vector < StreamingMoments > &localMoments, std::vector < StreamingMoments > &moments,
+                             std::vector < std::vector < double > > *localHistogram, double &localTime, double &time);
+
+      MultiLevelProblem *_ml_prob;
+      MonteCarloSampleFunction _sampleFunction;
+      unsigned _numberOfRandomVariables;
+      unsigned _numberOfQoIs;
+      UqQuadratureType _distribution;
+      unsigned _seed;
+
+      int _iproc;
+      int _nprocs;
+      unsigned _group;
+      unsigned _numberOfGroups;
+      MPI_Comm _groupComm;
+      MPI_Comm _leaderComm; // group roots only, MPI_COMM_NULL on the other processes
+
+      // Monte Carlo
+      unsigned _sampleCounter;
+      std::vector < StreamingMoments > _moments;
+      double _time;
+
+      double _histogramMin;
+      double _histogramMax;
+      std::vector < std::vector < double > > _histogram;
+
+      // multilevel Monte Carlo
+      std::vector < unsigned > _levelSampleCounter;
+      std::vector < std::vector < StreamingMoments > > _levelMoments;
+      std::vector < double > _levelTime;
+  };
+
+}
+
+#endif
@@ -0,0 +1,70 @@
+#include "StochasticGalerkinOperator.hpp"
+#include "uq.hpp"
+#include "SparseMatrix.hpp"
+#include "NumericVector.hpp"
+
+#include <iostream>
+#include <cstdlib>
+
+namespace femus {
+
+  StochasticGalerkinOperator::StochasticGalerkinOperator (const SparseStochasticTensor &G, const std::vector < SparseMatrix* > &K) :
+    _G (G),
+    _K (K) {
+
+    if (_K.size() != _G.GetNumberOfModes()) {
+      std::cout << "Error in StochasticGalerkinOperator: " << _K.size() << " spatial matrices for "
+                << _G.GetNumberOfModes() << " stochastic modes" << std::endl;
+      abort();
+    }
+
+  }
+
+  StochasticGalerkinOperator::~StochasticGalerkinOperator() {
+  }
+
+  void StochasticGalerkinOperator::Apply (const std::vector < NumericVector* > &x, const std::vector < NumericVector* > &y) {
+
+    if (x.size() != _G.size() || y.size() != _G.size()) {
+      std::cout << "Error in StochasticGalerkinOperator::Apply: the stochastic dimension is " << _G.size() << std::endl;
+      abort();
+    }
+
+    if (!_work) {
+      _work = NumericVector::build();
+      _work->init (*x[0], false);
+    }
+
+    for (unsigned p1 = 0; p1 < y.size(); p1++) {
+      y[p1]->zero();
+    }
+
+    //blocks (q1, p2) in Kronecker order: one spatial product, added to all the rows p1 of the block
+    for (unsigned b = 0; b < _G.GetNumberOfBlocks(); b++) {
+      _work->matrix_mult (*x[_G.GetBlockColumn (b)], *_K[_G.GetBlockMode (b)]);
+
+      for (unsigned k = _G.GetBlockBegin (b); k < _G.GetBlockEnd (b); k++) {
+        y[_G.GetRow (k)]->add (_G.GetValue (k), *_work);
+      }
+    }
+
+    for (unsigned p1 = 0; p1 < y.size(); p1++) {
+      y[p1]->close();
+    }
+
+  }
+
+  void StochasticGalerkinOperator::Residual (const std::vector < NumericVector* > &b, const std::vector < NumericVector* > &x,
+                                             const std::vector < NumericVector* > &r) {
+
+    Apply (x, r);
+
+    for (unsigned p1 = 0; p1 < r.size(); p1++) {
+      r[p1]->scale (-1.);
+      r[p1]->add (*b[p1]);
+      r[p1]->close();
+    }
+
+  }
+
+}
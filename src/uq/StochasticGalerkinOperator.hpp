@@ -0,0 +1,40 @@
+#ifndef __StochasticGalerkinOperator_hpp__
+#define __StochasticGalerkinOperator_hpp__
+
+#include <vector>
+#include <memory>
+
+namespace femus {
+
+  class SparseStochasticTensor;
+  class SparseMatrix;
+  class NumericVector;
+
+  /// Matrix free stochastic Galerkin operator A = sum_q1 G[q1] (x) K[q1], acting on the vector of the polynomial chaos coefficients
+  /// x[p2] of the solution: (A x)[p1] = sum_q1 sum_p2 G[q1][p1][p2] K[q1] x[p2].
+  /// Only the Jq spatial matrices K[q1] are stored, instead of the Jp^2 blocks of the assembled system,
+  /// and one spatial product K[q1] x[p2] is done for each block (q1, p2) of the sparse tensor G
+  class StochasticGalerkinOperator {
+
+    public:
+      /// K[q1] is the spatial operator of the q1-th polynomial chaos coefficient of the random field, e.g. int a_q1 grad(phi_i) grad(phi_j)
+      StochasticGalerkinOperator (const SparseStochasticTensor &G, const std::vector < SparseMatrix* > &K);
+
+      ~StochasticGalerkinOperator();
+
+      /// y[p1] = (A x)[p1], all the vectors have the layout of the spatial matrices, y is closed
+      void Apply (const std::vector < NumericVector* > &x, const std::vector < NumericVector* > &y);
+
+      /// r[p1] = b[p1] - (A x)[p1]
+      void Residual (const std::vector < NumericVector* > &b, const std::vector < NumericVector* > &x,
+                     const std::vector < NumericVector* > &r);
+
+    private:
+      const SparseStochasticTensor &_G;
+      std::vector < SparseMatrix* > _K;
+      std::unique_ptr < NumericVector > _work;
+  };
+
+}
+
+#endif
@@ -287,7 +287,7 @@ namespace femus
         else phi = 0.;
     }
 
-    void sparseGrid::EvaluatePhi ( double &phi, const std::vector <double> &x, std::vector < std::vector < unsigned > > identifier, const bool &scale )
+    void sparseGrid::EvaluatePhi ( double &phi, const std::vector <double> &x, const std::vector < std::vector < unsigned > > &identifier, const bool &scale )
     {
 
         //identifier tells us what one dimensional phis to multiply in order to get the desired phi
@@ -318,7 +318,7 @@ namespace femus
 
     }
 
-    void sparseGrid::InSupport ( unsigned &isIt, const std::vector <double> &x, std::vector < std::vector < unsigned > > identifier )
+    void sparseGrid::InSupport ( unsigned &isIt, const std::vector <double> &x, const std::vector < std::vector < unsigned > > &identifier )
     {
 
         std::vector < unsigned > isItOneDim ( _N, 0. );
@@ -337,7 +337,7 @@ namespace femus
         }
     }
 
-    void sparseGrid::PiecewiseConstPhi ( double &phi, const std::vector <double> &x, std::vector < std::vector < unsigned > > identifier )
+    void sparseGrid::PiecewiseConstPhi ( double &phi, const std::vector <double> &x, const std::vector < std::vector < unsigned > > &identifier )
     {
 
         unsigned checkSupport = 0;
@@ -349,6 +349,66 @@ namespace femus
 
     }
 
+    bool sparseGrid::GetSupportingCellOneDimensional ( unsigned &j, const double &x, const unsigned &n, const unsigned &l )
+    {
+
+        //the hierarchical dof j of level l is the node 2j, its support (x_2j - h, x_2j + h] = (a + 2j h, a + (2j + 2) h]
+        //is the j-th cell of size 2h of the interval, so j comes directly from the coordinate
+
+        unsigned dofsHierarchical = _hierarchicalDofs[n][l].size();
+
+        double s = ( x - _intervals[n][0] ) / ( 2. * _hs[n][l] );
+
+        if ( ! ( s > -1. && s < dofsHierarchical + 1. ) ) return false;
+
+        int jj = static_cast<int> ( ceil ( s ) ) - 1;
+
+        if ( jj < 0 ) jj = 0;
+
+        else if ( jj >= static_cast<int> ( dofsHierarchical ) ) jj = dofsHierarchical - 1;
+
+        //same bounds as InSupportOneDimensional, to be consistent with it also for x on the cell boundaries
+        double node = _nodes[n][l][_hierarchicalDofs[n][l][jj]];
+
+        if ( x <= node - _hs[n][l] ) jj--;
+
+        else if ( x > node + _hs[n][l] ) jj++;
+
+        if ( jj < 0 || jj >= static_cast<int> ( dofsHierarchical ) ) return false;
+
+        node = _nodes[n][l][_hierarchicalDofs[n][l][jj]];
+
+        if ( x > node - _hs[n][l] && x <= node + _hs[n][l] ) {
+            j = jj;
+            return true;
+        }
+
+        return false;
+
+    }
+
+    bool sparseGrid::GetSupportingDof ( unsigned &i, const std::vector <double> &x, const unsigned &w )
+    {
+
+        //the dofs of W are the Cartesian product of the one dimensional hierarchical dofs, with the last dimension running fastest
+
+        i = 0;
+
+        for ( unsigned n = 0; n < _N; n++ ) {
+
+            unsigned l = _indexSetW[w][n];
+
+            unsigned j;
+
+            if ( !GetSupportingCellOneDimensional ( j, x[n], n, l ) ) return false;
+
+            i = i * _hierarchicalDofs[n][l].size() + j;
+        }
+
+        return true;
+
+    }
+
     void sparseGrid::EvaluateNodalValuesPDF ( std::vector < std::vector < double > >  &samples )
     {
 
@@ -374,14 +434,15 @@ namespace femus
         for ( unsigned w = 1; w < _numberOfWs; w++ ) {
             unsigned dofsOfW =  _nodalValuesPDF[w].size();
 
-            for ( unsigned i = 0; i < dofsOfW; i++ ) {
-                for ( unsigned m = 0; m < _M; m++ ) {
+            //each sample is counted by the only dof of W whose support contains it
+            for ( unsigned m = 0; m < _M; m++ ) {
 
-                    unsigned isThere;
-                    InSupport ( isThere, samples[m], _dofIdentifier[w][i] );
+                unsigned i;
 
-                    if ( isThere == 1 ) _nodalValuesPDF[w][i]++;
-                }
+                if ( GetSupportingDof ( i, samples[m], w ) ) _nodalValuesPDF[w][i]++;
+            }
+
+            for ( unsigned i = 0; i < dofsOfW; i++ ) {
 
                 double supportMeasure = 1.;
                 unsigned levelOfPhi = _dofIdentifier[w][i][0][1];
@@ -477,23 +538,15 @@ namespace femus
 
     }
 
-    void sparseGrid::EvaluatePDF ( double &pdfValue, std::vector < double >  &x, const bool &print )
+    void sparseGrid::EvaluatePDF ( double &pdfValue, const std::vector < double >  &x, const bool &print )
     {
         pdfValue = 0.;
 
-        std::vector<std::vector<double>> phiFncts ( _numberOfWs );
-
+        //only the supporting dof of each W has a nonzero piecewise constant phi at x
         for ( unsigned w = 0; w < _numberOfWs; w++ ) {
-            phiFncts[w].resize ( _nodalValuesPDF[w].size() );
-
-            for ( unsigned i = 0; i < _nodalValuesPDF[w].size(); i++ ) {
-                double valuePhi;
-                PiecewiseConstPhi ( valuePhi, x, _dofIdentifier[w][i] );
-                pdfValue += _nodalValuesPDF[w][i] * valuePhi;
-//                 phiFncts[w][i]  = _nodalValuesPDF[w][i] * valuePhi;
+            unsigned i;
 
-//                 if ( print == true )      std::cout << phiFncts[w][i] << "," ;
-            }
+            if ( GetSupportingDof ( i, x, w ) ) pdfValue += _nodalValuesPDF[w][i];
         }
 
         if ( print == true )     std::cout << pdfValue;
@@ -501,14 +554,30 @@ namespace femus
         if ( print == true )   std::cout << std::endl;
     }
 
+    void sparseGrid::EvaluatePDF ( std::vector < double > &pdfValues, const std::vector < std::vector < double > >  &samples )
+    {
+        pdfValues.assign ( samples.size(), 0. );
+
+        //W outermost, so that the nodal values of one W are reused by all the samples
+        for ( unsigned w = 0; w < _numberOfWs; w++ ) {
+            for ( unsigned m = 0; m < samples.size(); m++ ) {
+                unsigned i;
+
+                if ( GetSupportingDof ( i, samples[m], w ) ) pdfValues[m] += _nodalValuesPDF[w][i];
+            }
+        }
+    }
+
     void sparseGrid::ComputeAvgL2Error ( double &aL2E, std::vector < std::vector < double > >  &samples, const unsigned &analyticPdfType )
     {
 
         aL2E = 0.;
 
+        std::vector < double > pdfValues;
+        EvaluatePDF ( pdfValues, samples );
+
         for ( unsigned m = 0; m < samples.size(); m++ ) {
-            double pdfValue;
-            EvaluatePDF ( pdfValue, samples[m], false );
+            double pdfValue = pdfValues[m];
 
             double analyticValue = 1.;
 
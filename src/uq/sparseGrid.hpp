@@ -19,17 +19,24 @@ namespace femus
 
         void EvaluateOneDimensionalPhi ( double &phi, const double &x, const unsigned &n, const unsigned &l, const unsigned &i, const bool &scale );
 
-        void EvaluatePhi ( double &phi, const std::vector <double> &x, std::vector < std::vector < unsigned > > identifier, const bool &scale );
+        void EvaluatePhi ( double &phi, const std::vector <double> &x, const std::vector < std::vector < unsigned > > &identifier, const bool &scale );
         
         void InSupportOneDimensional ( unsigned &maybeThere, const double &x, const unsigned &n, const unsigned &l, const unsigned &i );
         
-        void InSupport ( unsigned &isIt, const std::vector <double> &x, std::vector < std::vector < unsigned > > identifier );
+        void InSupport ( unsigned &isIt, const std::vector <double> &x, const std::vector < std::vector < unsigned > > &identifier );
         
-        void PiecewiseConstPhi( double &phi, const std::vector <double> &x, std::vector < std::vector < unsigned > > identifier );
+        void PiecewiseConstPhi( double &phi, const std::vector <double> &x, const std::vector < std::vector < unsigned > > &identifier );
+
+        //the supports of the hierarchical dofs of a level are disjoint, so x is in the support of at most one dof of each W
+        bool GetSupportingCellOneDimensional ( unsigned &j, const double &x, const unsigned &n, const unsigned &l );
+
+        bool GetSupportingDof ( unsigned &i, const std::vector <double> &x, const unsigned &w );
 
         void EvaluateNodalValuesPDF ( std::vector < std::vector < double > >  &samples );
         
-        void EvaluatePDF (double &pdfValue, std::vector < double >  &x, const bool &print);
+        void EvaluatePDF (double &pdfValue, const std::vector < double >  &x, const bool &print);
+
+        void EvaluatePDF (std::vector < double > &pdfValues, const std::vector < std::vector < double > >  &samples);
         
         void ComputeAvgL2Error( double &aL2E, std::vector < std::vector < double > >  &samples, const unsigned &analyticPdfType);
         
@@ -43,6 +50,22 @@ namespace femus
         
         void CartesianProduct ( std::vector<std::vector<int> >& inputCartesian, std::vector<std::vector<unsigned> >& dofsWi );
 
+        unsigned GetNumberOfWs() const
+        {
+            return _numberOfWs;
+        }
+
+        //identifiers of the dofs of the W subspace w, see _dofIdentifier
+        const std::vector < std::vector < std::vector < unsigned > > > & GetDofIdentifiers ( const unsigned &w ) const
+        {
+            return _dofIdentifier[w];
+        }
+
+        const std::vector < double > & GetNodalValuesPDF ( const unsigned &w ) const
+        {
+            return _nodalValuesPDF[w];
+        }
+
     private:
         //defining parameters
         unsigned _N; //number of dimensions of the parameter space
@@ -1,6 +1,8 @@
 
 #include "uq.hpp"
 
+#include <algorithm>
+
 namespace femus {
 
   const double uq::_hermiteQuadrature[16][2][16] = { //Number of quadrature points, first row: weights, second row: coordinates
@@ -645,39 +647,32 @@ namespace femus {
       Jp[i].resize (numberOfEigPairs);
     }
 
-    unsigned index = 0;
-    unsigned counters[numberOfEigPairs + 1];
-    memset (counters, 0, sizeof (counters));
-
-    while (!counters[numberOfEigPairs]) {
+    //only the multi-indices with entry sum <= p are visited, in lexicographic order (the last entry runs fastest),
+    //instead of filtering the (p + 1)^numberOfEigPairs tensor product set
+    std::vector < unsigned > counters (numberOfEigPairs, 0);
+    unsigned entrySum = 0;
 
-//     for(unsigned i = numberOfEigPairs; i-- > 0;) {
-//       std::cout << counters[i] << " ";
-//     }
-//     std::cout << std::endl;
+    for (unsigned index = 0; index < dimJp; index++) {
 
-      unsigned entrySum = 0;
       for (unsigned j = 0; j < numberOfEigPairs; j++) {
-        entrySum += counters[j];
-      }
-
-      if (entrySum <= p) {
-        for (unsigned j = 0; j < numberOfEigPairs; j++) {
-          Jp[index][j] = counters[numberOfEigPairs - 1 - j];
-          if (_output) {
-            std::cout << " Jp[" << index << "][" << j << "]= " << Jp[index][j] ;
-          }
-        }
+        Jp[index][j] = counters[j];
         if (_output) {
-          std::cout << std::endl;
+          std::cout << " Jp[" << index << "][" << j << "]= " << Jp[index][j] ;
         }
-        index++;
       }
-      unsigned i;
-      for (i = 0; counters[i] == p; i++) {   // inner loops that are at maxval restart at zero
-        counters[i] = 0;
+      if (_output) {
+        std::cout << std::endl;
+      }
+
+      for (unsigned j = numberOfEigPairs; j-- > 0;) {
+        if (entrySum < p) {  // the innermost entry that can still grow advances by 1
+          counters[j]++;
+          entrySum++;
+          break;
+        }
+        entrySum -= counters[j];  // inner entries that are at maxval restart at zero
+        counters[j] = 0;
       }
-      ++counters[i];  // the innermost loop that isn't yet at maxval, advances by 1
     }
   }
 
@@ -846,6 +841,144 @@ namespace femus {
     _stochasticMassMatrix.clear();
   }
 
+///////////////////////////////////////////
+
+/// Add the nonzero entries G[q1][p1][p2] of the row p1 of the mode q1, choosing the entries of p2 from the dimension i on.
+/// The one dimensional integrals are nonzero only for few p2[i], e.g. only p2[i] = p1[i] if q1[i] = 0
+  static void AddSparseStochasticEntries (const unsigned & i, const std::vector <unsigned> & q1, const std::vector <unsigned> & p1,
+                                          std::vector <unsigned> & p2, const unsigned & p2Sum, const double & value,
+                                          const std::vector < std::vector < std::vector < double > > > & integralMatrix,
+                                          const unsigned & p0, std::vector < std::pair < std::vector <unsigned>, double > > & row) {
+
+    if (i == q1.size()) {
+      if (fabs (value) >= 1.e-14) row.push_back (std::make_pair (p2, value));
+      return;
+    }
+
+    for (unsigned k = 0; k + p2Sum <= p0; k++) {
+      double integral = integralMatrix[q1[i]][p1[i]][k];
+      if (fabs (integral) >= 1.e-14) {
+        p2[i] = k;
+        AddSparseStochasticEntries (i + 1, q1, p1, p2, p2Sum + k, value * integral, integralMatrix, p0, row);
+      }
+    }
+    p2[i] = 0;
+  }
+
+/// Compute the sparse Stochastic Mass Matrix at the key < q0, p0, numberOfEigPairs>
+  void uq::ComputeSparseStochasticMassMatrix (SparseStochasticTensor & G,
+                                              const unsigned & q0, const unsigned & p0, const unsigned & numberOfEigPairs) {
+
+    const std::vector < std::vector < std::vector < double > > > & integralMatrix = GetIntegralMatrix (q0, p0);
+
+    const std::vector < std::vector <unsigned> > &Jq = GetIndexSet (q0, numberOfEigPairs);
+    const std::vector < std::vector <unsigned> > &Jp = GetIndexSet (p0, numberOfEigPairs);
+
+    std::map < std::vector <unsigned>, unsigned > JpIndex;
+    for (unsigned p1 = 0; p1 < Jp.size(); p1++) {
+      JpIndex[Jp[p1]] = p1;
+    }
+
+    //nonzero entries ((q1, p2), (p1, value)), sorted in Kronecker order
+    std::vector < std::pair < std::pair < unsigned, unsigned >, std::pair < unsigned, double > > > entries;
+
+    std::vector <unsigned> p2 (numberOfEigPairs, 0);
+    std::vector < std::pair < std::vector <unsigned>, double > > row;
+
+    for (unsigned q1 = 0; q1 < Jq.size(); q1++) {
+      for (unsigned p1 = 0; p1 < Jp.size(); p1++) {
+        row.resize (0);
+        AddSparseStochasticEntries (0, Jq[q1], Jp[p1], p2, 0, 1., integralMatrix, p0, row);
+        for (unsigned k = 0; k < row.size(); k++) {
+          entries.push_back (std::make_pair (std::make_pair (q1, JpIndex[row[k].first]), std::make_pair (p1, row[k].second)));
+        }
+      }
+    }
+
+    std::sort (entries.begin(), entries.end());
+
+    unsigned nnz = entries.size();
+
+    G._numberOfModes = Jq.size();
+    G._size = Jp.size();
+
+    G._mode.resize (nnz);
+    G._row.resize (nnz);
+    G._value.resize (nnz);
+    G._blockMode.resize (0);
+    G._blockColumn.resize (0);
+    G._blockOffset.assign (1, 0);
+
+    //(p1, p2) pattern, collected by row
+    std::vector < std::vector <unsigned> > patternRows (Jp.size());
+
+    for (unsigned k = 0; k < nnz; k++) {
+      unsigned q1 = entries[k].first.first;
+      unsigned p2k = entries[k].first.second;
+
+      if (G._blockMode.size() == 0 || q1 != G._blockMode.back() || p2k != G._blockColumn.back()) {
+        if (G._blockMode.size() > 0) G._blockOffset.push_back (k);
+        G._blockMode.push_back (q1);
+        G._blockColumn.push_back (p2k);
+      }
+
+      G._mode[k] = q1;
+      G._row[k] = entries[k].second.first;
+      G._value[k] = entries[k].second.second;
+
+      patternRows[G._row[k]].push_back (p2k);
+    }
+    if (nnz > 0) G._blockOffset.push_back (nnz);
+
+    G._patternOffset.assign (Jp.size() + 1, 0);
+    G._patternColumn.resize (0);
+    for (unsigned p1 = 0; p1 < Jp.size(); p1++) {
+      std::sort (patternRows[p1].begin(), patternRows[p1].end());
+      patternRows[p1].erase (std::unique (patternRows[p1].begin(), patternRows[p1].end()), patternRows[p1].end());
+      G._patternColumn.insert (G._patternColumn.end(), patternRows[p1].begin(), patternRows[p1].end());
+      G._patternOffset[p1 + 1] = G._patternColumn.size();
+    }
+
+    G._patternIndex.resize (nnz);
+    for (unsigned k = 0; k < nnz; k++) {
+      std::vector <unsigned>::const_iterator begin = G._patternColumn.begin() + G._patternOffset[G._row[k]];
+      std::vector <unsigned>::const_iterator end = G._patternColumn.begin() + G._patternOffset[G._row[k] + 1];
+      G._patternIndex[k] = std::lower_bound (begin, end, entries[k].first.second) - G._patternColumn.begin();
+    }
+
+    if (_output) {
+      std::cout << " sparse stochastic mass matrix: " << nnz << " nonzero entries of " << Jq.size() << " x " << Jp.size() << " x " << Jp.size()
+                << ", " << G._blockMode.size() << " blocks, " << G._patternColumn.size() << " pattern entries" << std::endl;
+    }
+
+  }
+
+/// Return the sparse Stochastic Mass Matrix at the key < q0, p0, numberOfEigPairs>
+  const SparseStochasticTensor & uq::GetSparseStochasticMassMatrix (const unsigned & q0, const unsigned & p0,
+                                                                    const unsigned & numberOfEigPairs) {
+
+    std::pair < std::pair<unsigned, unsigned>, unsigned> stochasticMassMatrixIndex = std::make_pair (std::make_pair (q0, p0), numberOfEigPairs);
+
+    std::map<std::pair < std::pair<unsigned, unsigned>, unsigned>, SparseStochasticTensor >::iterator it;
+
+    it = _sparseStochasticMassMatrix.find (stochasticMassMatrixIndex);
+    if (it == _sparseStochasticMassMatrix.end()) {
+      ComputeSparseStochasticMassMatrix (_sparseStochasticMassMatrix[stochasticMassMatrixIndex], q0, p0, numberOfEigPairs);
+    }
+    return _sparseStochasticMassMatrix[stochasticMassMatrixIndex];
+  }
+
+/// Erase the sparse Stochastic Mass Matrix at the key < q0, p0, numberOfEigPairs>
+  void uq::EraseSparseStochasticMassMatrix (const unsigned & q0, const unsigned & p0,
+                                            const unsigned & numberOfEigPairs) {
+    _sparseStochasticMassMatrix.erase (std::make_pair (std::make_pair (q0, p0), numberOfEigPairs));
+  }
+
+/// Clear all stored sparse Stochastic Mass Matrices
+  void uq::ClearSparseStochasticMassMatrix() {
+    _sparseStochasticMassMatrix.clear();
+  }
+
 
 /////////////////////////////////////////// MULTIVARIATE HERMITE STUFF
 
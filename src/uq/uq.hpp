@@ -13,6 +13,107 @@
 
 namespace femus {
 
+  /// Sparse storage of the stochastic Galerkin tensor G[q1][p1][p2], only the nonzero entries are kept in flat arrays.
+  /// The entries are sorted by q1, then p2, then p1 (Kronecker order): the block b collects the entries
+  /// GetBlockBegin(b) ... GetBlockEnd(b) - 1 of the column GetBlockColumn(b) of G[GetBlockMode(b)],
+  /// so that the operator sum_q1 G[q1] (x) K[q1] needs one spatial product K[q1] x[p2] per block.
+  /// The (p1, p2) pattern of sum_q1 G[q1] is stored in CSR form, to assemble or contract it without the dense Jp x Jp matrix
+  class SparseStochasticTensor {
+
+    public:
+      SparseStochasticTensor() :
+        _numberOfModes (0),
+        _size (0)
+      {};
+
+      /// Number of q1 indices
+      unsigned GetNumberOfModes() const {
+        return _numberOfModes;
+      }
+
+      /// Number of p1 (and p2) indices
+      unsigned size() const {
+        return _size;
+      }
+
+      unsigned GetNumberOfNonZeros() const {
+        return _value.size();
+      }
+
+      unsigned GetNumberOfBlocks() const {
+        return _blockMode.size();
+      }
+
+      unsigned GetBlockMode (const unsigned &b) const {
+        return _blockMode[b];
+      }
+
+      unsigned GetBlockColumn (const unsigned &b) const {
+        return _blockColumn[b];
+      }
+
+      unsigned GetBlockBegin (const unsigned &b) const {
+        return _blockOffset[b];
+      }
+
+      unsigned GetBlockEnd (const unsigned &b) const {
+        return _blockOffset[b + 1];
+      }
+
+      /// Row p1 of the nonzero entry k
+      unsigned GetRow (const unsigned &k) const {
+        return _row[k];
+      }
+
+      double GetValue (const unsigned &k) const {
+        return _value[k];
+      }
+
+      /// The pattern entries of the row p1 are GetPatternRowBegin(p1) ... GetPatternRowEnd(p1) - 1
+      unsigned GetPatternRowBegin (const unsigned &p1) const {
+        return _patternOffset[p1];
+      }
+
+      unsigned GetPatternRowEnd (const unsigned &p1) const {
+        return _patternOffset[p1 + 1];
+      }
+
+      unsigned GetPatternColumn (const unsigned &k) const {
+        return _patternColumn[k];
+      }
+
+      unsigned GetPatternSize() const {
+        return _patternColumn.size();
+      }
+
+      /// C[k] = sum_q1 a[q1] G[q1][p1][p2] on the pattern entries k = (p1, p2)
+      void Contract (const std::vector < double > &a, std::vector < double > &C) const {
+        C.assign (_patternColumn.size(), 0.);
+        for (unsigned k = 0; k < _value.size(); k++) {
+          C[_patternIndex[k]] += a[_mode[k]] * _value[k];
+        }
+      }
+
+    private:
+      friend class uq;
+
+      unsigned _numberOfModes;
+      unsigned _size;
+
+      // nonzero entries in Kronecker order
+      std::vector < unsigned > _mode;
+      std::vector < unsigned > _row;
+      std::vector < double > _value;
+      std::vector < unsigned > _patternIndex;
+
+      std::vector < unsigned > _blockMode;
+      std::vector < unsigned > _blockColumn;
+      std::vector < unsigned > _blockOffset;
+
+      std::vector < unsigned > _patternOffset;
+      std::vector < unsigned > _patternColumn;
+  };
+
   class uq {
 
     public:
@@ -120,6 +221,23 @@ namespace femus {
 
       /////////////////////////////////////////////////
 
+      /// Compute the sparse Stochastic Mass Matrix at the key < q0, p0, numberOfEigPairs>, visiting only its nonzero entries
+      void ComputeSparseStochasticMassMatrix (SparseStochasticTensor & G, const unsigned & q0, const unsigned & p0,
+                                              const unsigned & numberOfEigPairs);
+
+      /// Return the sparse Stochastic Mass Matrix at the key < q0, p0, numberOfEigPairs>
+      const SparseStochasticTensor & GetSparseStochasticMassMatrix (const unsigned & q0, const unsigned & p0,
+                                                                    const unsigned & numberOfEigPairs);
+
+      /// Erase the sparse Stochastic Mass Matrix at the key < q0, p0, numberOfEigPairs>
+      void EraseSparseStochasticMassMatrix (const unsigned & q0, const unsigned & p0,
+                                            const unsigned & numberOfEigPairs);
+
+      /// Clear all stored sparse Stochastic Mass Matrices
+      void ClearSparseStochasticMassMatrix();
+
+      /////////////////////////////////////////////////
+
       /// Compute the Multivariate prescribed polynomials and weights at the key < numberOfQuadraturePoints, p,numberOfEigPairs>
       void ComputeMultivariate (
         std::vector < std::vector < double > >  & multivariatePoly,
@@ -151,6 +269,7 @@ namespace femus {
         ClearIndexSet();
         ClearIntegralMatrix();
         ClearStochasticMassMatrix();
+        ClearSparseStochasticMassMatrix();
         ClearMultivariate();
         ClearPolynomialHistogram();
         ClearPolynomial();
@@ -205,6 +324,7 @@ namespace femus {
       std::vector < std::vector < double > >  _polynomialHistogram;
       std::map<std::pair<unsigned, unsigned>, std::vector < std::vector < std::vector < double > > > > _integralMatrix;
       std::map<std::pair < std::pair<unsigned, unsigned>, unsigned >, std::vector < std::vector < std::vector < double > > > > _stochasticMassMatrix;
+      std::map<std::pair < std::pair<unsigned, unsigned>, unsigned >, SparseStochasticTensor > _sparseStochasticMassMatrix;
       std::map<std::pair < std::pair<unsigned, unsigned>, unsigned >, std::vector < std::vector < double > > >  _multivariatePolynomial;
       std::map<std::pair < std::pair<unsigned, unsigned>, unsigned >, std::vector < double > > _multivariateWeight;
       bool _output = false;
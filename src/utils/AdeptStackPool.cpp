@@ -0,0 +1,107 @@
+/*=========================================================================
+
+ Program: FEMUS
+ Module: AdeptStackPool
+ Authors: Eugenio Aulisa
+
+ Copyright (c) FEMTTU
+ All rights reserved.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+//----------------------------------------------------------------------------
+// includes :
+//----------------------------------------------------------------------------
+#include "AdeptStackPool.hpp"
+
+#include <iostream>
+#include <cstdlib>
+
+namespace femus {
+
+  // ********************************************
+
+  AdeptStackPool::AdeptStackPool(adept::Stack &masterStack) :
+    _nStatements(0),
+    _nOperations(0) {
+    _stack.assign(1, &masterStack);
+  }
+
+  // ********************************************
+
+  AdeptStackPool::~AdeptStackPool() {
+    for(unsigned i = 1; i < _stack.size(); i++) {
+      delete _stack[i];
+    }
+  }
+
+  // ********************************************
+
+  void AdeptStackPool::Resize(const unsigned &nThreads) {
+
+    unsigned n = (nThreads > 0) ? nThreads : 1;
+
+#ifdef ADEPT_STACK_THREAD_UNSAFE
+    if(n > 1) {
+      std::cout << "Warning in AdeptStackPool::Resize(): adept has been built without thread-local storage, "
+                << "automatic differentiation is not safe with " << n << " threads" << std::endl;
+    }
+#endif
+
+    for(unsigned i = n; i < _stack.size(); i++) {
+      delete _stack[i];
+    }
+
+    unsigned n0 = _stack.size();
+    _stack.resize(n);
+
+    for(unsigned i = n0; i < n; i++) {
+      _stack[i] = new adept::Stack(false);
+      ReserveStack(*_stack[i]);
+    }
+  }
+
+  // ********************************************
+
+  void AdeptStackPool::Activate(const unsigned &ithread) {
+
+    adept::Stack *active = adept::active_stack();
+
+    if(active != NULL && active != _stack[ithread]) {
+      std::cout << "Error in AdeptStackPool::Activate(): another adept stack is already active on this thread" << std::endl;
+      abort();
+    }
+
+    _stack[ithread]->activate();
+  }
+
+  // ********************************************
+
+  void AdeptStackPool::Deactivate(const unsigned &ithread) {
+    _stack[ithread]->deactivate();
+  }
+
+  // ********************************************
+
+  void AdeptStackPool::Reserve(const unsigned &nStatements, const unsigned &nOperations) {
+
+    if(nStatements > _nStatements) _nStatements = nStatements;
+    if(nOperations > _nOperations) _nOperations = nOperations;
+
+    for(unsigned i = 0; i < _stack.size(); i++) {
+      ReserveStack(*_stack[i]);
+    }
+  }
+
+  // ********************************************
+
+  void AdeptStackPool::ReserveStack(adept::Stack &s) {
+    if(_nStatements > 0) s.preallocate_statements(_nStatements);
+    if(_nOperations > 0) s.preallocate_operations(_nOperations);
+  }
+
+} //end namespace femus
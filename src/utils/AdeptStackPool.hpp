@@ -0,0 +1,80 @@
+/*=========================================================================
+
+ Program: FEMUS
+ Module: AdeptStackPool
+ Authors: Eugenio Aulisa
+
+ Copyright (c) FEMTTU
+ All rights reserved.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+#ifndef __femus_utils_AdeptStackPool_hpp__
+#define __femus_utils_AdeptStackPool_hpp__
+
+//----------------------------------------------------------------------------
+// includes :
+//----------------------------------------------------------------------------
+#include <vector>
+#include "adept.h"
+
+namespace femus {
+
+  /**
+   * Pool of adept stacks, one for each thread of an element loop.
+   * Stack 0 is the stack of the main thread (FemusInit::_adeptStack), the others are created inactive
+   * and must be activated on the thread that records into them. adept binds the adouble variables to
+   * the stack active at their construction, so the recording objects must live on the same thread.
+   * The memory of a stack survives new_recording(): reserving it once for the largest element avoids
+   * any reallocation in the element loop.
+   */
+  class AdeptStackPool {
+
+    public:
+
+      /** Constructor, masterStack is the stack of the main thread */
+      AdeptStackPool(adept::Stack &masterStack);
+
+      /** Destructor */
+      ~AdeptStackPool();
+
+      /** Set the number of stacks, the master stack included */
+      void Resize(const unsigned &nThreads);
+
+      /** Get the number of stacks */
+      unsigned GetNumberOfStacks() const {
+        return _stack.size();
+      }
+
+      /** Get the stack of the thread ithread */
+      adept::Stack & GetStack(const unsigned &ithread) {
+        return *_stack[ithread];
+      }
+
+      /** Activate the stack of the thread ithread on the calling thread */
+      void Activate(const unsigned &ithread);
+
+      /** Deactivate the stack of the thread ithread on the calling thread */
+      void Deactivate(const unsigned &ithread);
+
+      /** Preallocate nStatements statements and nOperations operations on all the stacks,
+       * also on the ones created by a later Resize */
+      void Reserve(const unsigned &nStatements, const unsigned &nOperations);
+
+    private:
+
+      /** Preallocate the reserved memory on the stack s */
+      void ReserveStack(adept::Stack &s);
+
+      std::vector < adept::Stack* > _stack;
+      unsigned _nStatements;
+      unsigned _nOperations;
+  };
+
+} //end namespace femus
+
+#endif
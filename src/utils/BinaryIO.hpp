@@ -0,0 +1,141 @@
+/*=========================================================================
+
+ Program: FEMuS
+ Module: BinaryIO
+ Authors: Eugenio Aulisa
+
+ Copyright (c) FEMuS
+ All rights reserved.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+#ifndef __femus_utils_BinaryIO_hpp__
+#define __femus_utils_BinaryIO_hpp__
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <type_traits>
+
+namespace femus {
+
+  /**
+   * Raw binary write and read, in the native byte order, of plain data, strings, vectors and maps, as used by the binary caches.
+   * Strings, vectors and maps are written with their size first, vectors of arithmetic types with a single write.
+   * The files are meant to be read back on the same machine type only.
+   */
+
+  template <class Type> void BinaryWrite(std::ostream &os, const Type &value);
+  template <class Type> void BinaryRead(std::istream &is, Type &value);
+
+  inline void BinaryWrite(std::ostream &os, const std::string &s);
+  inline void BinaryRead(std::istream &is, std::string &s);
+
+  inline void BinaryWrite(std::ostream &os, const std::vector < bool > &v);
+  inline void BinaryRead(std::istream &is, std::vector < bool > &v);
+
+  template <class Type> void BinaryWrite(std::ostream &os, const std::vector < Type > &v);
+  template <class Type> void BinaryRead(std::istream &is, std::vector < Type > &v);
+
+  template <class Key, class Type> void BinaryWrite(std::ostream &os, const std::map < Key, Type > &m);
+  template <class Key, class Type> void BinaryRead(std::istream &is, std::map < Key, Type > &m);
+
+  //BEGIN plain data
+  template <class Type> void BinaryWrite(std::ostream &os, const Type &value) {
+    os.write(reinterpret_cast < const char* >(&value), sizeof(Type));
+  }
+
+  template <class Type> void BinaryRead(std::istream &is, Type &value) {
+    is.read(reinterpret_cast < char* >(&value), sizeof(Type));
+  }
+  //END
+
+  //BEGIN strings
+  inline void BinaryWrite(std::ostream &os, const std::string &s) {
+    unsigned long size = s.size();
+    BinaryWrite(os, size);
+    os.write(s.data(), size);
+  }
+
+  inline void BinaryRead(std::istream &is, std::string &s) {
+    unsigned long size = 0;
+    BinaryRead(is, size);
+    if(!is) return;
+    s.resize(size);
+    if(size > 0) is.read(&s[0], size);
+  }
+  //END
+
+  //BEGIN vectors
+  inline void BinaryWrite(std::ostream &os, const std::vector < bool > &v) {
+    std::vector < char > w(v.begin(), v.end());
+    BinaryWrite(os, w);
+  }
+
+  inline void BinaryRead(std::istream &is, std::vector < bool > &v) {
+    std::vector < char > w;
+    BinaryRead(is, w);
+    v.assign(w.begin(), w.end());
+  }
+
+  template <class Type> void BinaryWriteElements(std::ostream &os, const std::vector < Type > &v, std::true_type) {
+    if(v.size() > 0) os.write(reinterpret_cast < const char* >(&v[0]), v.size() * sizeof(Type));
+  }
+
+  template <class Type> void BinaryWriteElements(std::ostream &os, const std::vector < Type > &v, std::false_type) {
+    for(unsigned long i = 0; i < v.size(); i++) BinaryWrite(os, v[i]);
+  }
+
+  template <class Type> void BinaryReadElements(std::istream &is, std::vector < Type > &v, std::true_type) {
+    if(v.size() > 0) is.read(reinterpret_cast < char* >(&v[0]), v.size() * sizeof(Type));
+  }
+
+  template <class Type> void BinaryReadElements(std::istream &is, std::vector < Type > &v, std::false_type) {
+    for(unsigned long i = 0; i < v.size() && is; i++) BinaryRead(is, v[i]);
+  }
+
+  template <class Type> void BinaryWrite(std::ostream &os, const std::vector < Type > &v) {
+    unsigned long size = v.size();
+    BinaryWrite(os, size);
+    BinaryWriteElements(os, v, typename std::is_arithmetic < Type >::type());
+  }
+
+  template <class Type> void BinaryRead(std::istream &is, std::vector < Type > &v) {
+    unsigned long size = 0;
+    BinaryRead(is, size);
+    if(!is) return;
+    v.resize(size);
+    BinaryReadElements(is, v, typename std::is_arithmetic < Type >::type());
+  }
+  //END
+
+  //BEGIN maps
+  template <class Key, class Type> void BinaryWrite(std::ostream &os, const std::map < Key, Type > &m) {
+    unsigned long size = m.size();
+    BinaryWrite(os, size);
+    for(typename std::map < Key, Type >::const_iterator it = m.begin(); it != m.end(); it++) {
+      BinaryWrite(os, it->first);
+      BinaryWrite(os, it->second);
+    }
+  }
+
+  template <class Key, class Type> void BinaryRead(std::istream &is, std::map < Key, Type > &m) {
+    unsigned long size = 0;
+    BinaryRead(is, size);
+    m.clear();
+    for(unsigned long i = 0; i < size && is; i++) {
+      Key key;
+      BinaryRead(is, key);
+      BinaryRead(is, m[key]);
+    }
+  }
+  //END
+
+}
+
+#endif
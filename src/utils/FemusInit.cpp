@@ -17,12 +17,16 @@
 // includes :
 //----------------------------------------------------------------------------
 #include <iostream>
+#include <cstdlib>
+#include <cstring>
 #include "FemusInit.hpp"
+#include "Profiler.hpp"
 #include "UqQuadratureTypeEnum.hpp"
 
 namespace femus {
 
 adept::Stack FemusInit::_adeptStack;
+AdeptStackPool FemusInit::_adeptStackPool(FemusInit::_adeptStack);
 
 uq FemusInit::_uqHermite(UQ_HERMITE); 
 uq FemusInit::_uqLegendre(UQ_LEGENDRE); 
@@ -56,12 +60,28 @@ FemusInit::FemusInit(
 
    std::cout << " FemusInit(): PETSC_COMM_WORLD initialized" << std::endl << std::endl;
 
+    _profileReport = false;
+    for(int k = 1; k < argc; k++) {
+      if(!strcmp(argv[k], "-femus_profile")) {
+        _profileReport = true;
+      }
+      else if(!strcmp(argv[k], "-femus_profile_json") && k + 1 < argc) {
+        _profileJsonFile = argv[k + 1];
+      }
+      else if(!strcmp(argv[k], "-femus_profile_log_stages")) {
+        Profiler::SetPetscLogStages(true);
+      }
+    }
+
     return;
 }
 
 
 FemusInit::~FemusInit() {
 
+    if(_profileReport) Profiler::PrintReport(MPI_COMM_WORLD);
+    if(!_profileJsonFile.empty()) Profiler::WriteJsonReport(_profileJsonFile, MPI_COMM_WORLD);
+
 #ifdef HAVE_PETSC
     PetscFinalize();
     std::cout << std::endl << " ~FemusInit(): PETSC_COMM_WORLD ends" << std::endl;
@@ -70,6 +90,19 @@ FemusInit::~FemusInit() {
     return;
 }
 
+// =======================================================
+adept::Stack & FemusInit::GetAdeptStack() {
+
+  adept::Stack *s = adept::active_stack();
+
+  if(s == NULL) {
+    std::cout << " FemusInit::GetAdeptStack(): no adept stack is active on this thread" << std::endl;
+    abort();
+  }
+
+  return *s;
+}
+
 
 } //end namespace femus
 
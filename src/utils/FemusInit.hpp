@@ -40,8 +40,11 @@
 // ========================================
 
 #include "adept.h"
+#include "AdeptStackPool.hpp"
 #include "uq.hpp"
 
+#include <string>
+
 namespace femus {
 
 
@@ -56,9 +59,21 @@ public:
     /// Destructor
     ~FemusInit();
     
+    /** Get the adept stack active on the calling thread: _adeptStack on the main thread,
+     * the _adeptStackPool stack of the thread inside a threaded element loop */
+    static adept::Stack & GetAdeptStack();
+
     static adept::Stack _adeptStack; 
+    static AdeptStackPool _adeptStackPool;
     static uq _uqHermite; 
     static uq _uqLegendre; 
+
+private:
+
+    /// Profiler options: -femus_profile prints the report, -femus_profile_json <file> writes it in JSON,
+    /// -femus_profile_log_stages pushes the profiler regions as PETSc log stages
+    bool _profileReport;
+    std::string _profileJsonFile;
      
 };
 
@@ -0,0 +1,295 @@
+/*=========================================================================
+
+ Program: FEMUS
+ Module: Profiler
+ Authors: Eugenio Aulisa
+
+ Copyright (c) FEMTTU
+ All rights reserved.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+//----------------------------------------------------------------------------
+// includes :
+//----------------------------------------------------------------------------
+#include "Profiler.hpp"
+#include "FemusConfig.hpp"
+
+#ifdef HAVE_PETSC
+#include <petsc.h>
+#endif
+
+#include <fstream>
+#include <iomanip>
+#include <cstdlib>
+
+namespace femus {
+
+  std::vector < Profiler::Region > Profiler::_region;
+  std::vector < unsigned > Profiler::_open;
+  bool Profiler::_logStages = false;
+
+  // ********************************************
+
+  void Profiler::Start(const std::string &name) {
+
+    if(_region.empty()) {
+      Region root;
+      root.depth = 0;
+      root.calls = 0;
+      root.totalTime = 0.;
+      root.startTime = 0.;
+      root.stage = -1;
+      _region.push_back(root);
+      _open.assign(1, 0);
+    }
+
+    unsigned parent = _open.back();
+
+    unsigned ir;
+    std::map < std::string, unsigned >::iterator it = _region[parent].children.find(name);
+    if(it != _region[parent].children.end()) {
+      ir = it->second;
+    }
+    else {
+      ir = _region.size();
+      _region[parent].children[name] = ir;
+
+      Region region;
+      region.name = name;
+      region.path = (parent == 0) ? name : _region[parent].path + "/" + name;
+      region.depth = _region[parent].depth + 1;
+      region.calls = 0;
+      region.totalTime = 0.;
+      region.stage = -1;
+      _region.push_back(region);
+    }
+
+#ifdef HAVE_PETSC
+    if(_logStages) {
+      if(_region[ir].stage < 0) {
+        PetscLogStage stage;
+        PetscLogStageRegister(_region[ir].path.c_str(), &stage);
+        _region[ir].stage = stage;
+      }
+      PetscLogStagePush(_region[ir].stage);
+    }
+#endif
+
+    _open.push_back(ir);
+    _region[ir].startTime = MPI_Wtime();
+  }
+
+  // ********************************************
+
+  double Profiler::Stop(const std::string &name) {
+
+    double time = MPI_Wtime();
+
+    if(_open.size() < 2) {
+      std::cout << "Error in Profiler::Stop(): the region " << name << " is not open" << std::endl;
+      abort();
+    }
+
+    Region &region = _region[_open.back()];
+
+    if(region.name != name) {
+      std::cout << "Error in Profiler::Stop(): closing the region " << name << " while the region " << region.path << " is open" << std::endl;
+      abort();
+    }
+
+    time -= region.startTime;
+    region.calls++;
+    region.totalTime += time;
+
+#ifdef HAVE_PETSC
+    if(_logStages) {
+      PetscLogStagePop();
+    }
+#endif
+
+    _open.pop_back();
+
+    return time;
+  }
+
+  // ********************************************
+
+  void Profiler::SetPetscLogStages(const bool &logStages) {
+
+    if(_open.size() > 1) {
+      std::cout << "Error in Profiler::SetPetscLogStages(): the region " << _region[_open.back()].path << " is open" << std::endl;
+      abort();
+    }
+
+    _logStages = logStages;
+  }
+
+  // ********************************************
+
+  void Profiler::Reset() {
+
+    if(_open.size() > 1) {
+      std::cout << "Error in Profiler::Reset(): the region " << _region[_open.back()].path << " is still open" << std::endl;
+      abort();
+    }
+
+    for(unsigned ir = 1; ir < _region.size(); ir++) {
+      _region[ir].calls = 0;
+      _region[ir].totalTime = 0.;
+    }
+  }
+
+  // ********************************************
+
+  void Profiler::ReduceRegions(MPI_Comm comm, std::vector < std::string > &path, std::vector < unsigned > &calls,
+                               std::vector < double > &minTime, std::vector < double > &maxTime, std::vector < double > &avgTime) {
+
+    int iproc, nprocs;
+    MPI_Comm_rank(comm, &iproc);
+    MPI_Comm_size(comm, &nprocs);
+
+    // the processes may have entered different regions: build the union of the region paths
+    std::string localPaths;
+    for(unsigned ir = 1; ir < _region.size(); ir++) {
+      localPaths += _region[ir].path;
+      localPaths += '\n';
+    }
+
+    int localSize = localPaths.size();
+    std::vector < int > size(nprocs);
+    MPI_Allgather(&localSize, 1, MPI_INT, &size[0], 1, MPI_INT, comm);
+
+    std::vector < int > offset(nprocs + 1, 0);
+    for(int jproc = 0; jproc < nprocs; jproc++) {
+      offset[jproc + 1] = offset[jproc] + size[jproc];
+    }
+
+    std::vector < char > allPaths(offset[nprocs] + 1);
+    MPI_Allgatherv(const_cast < char * >(localPaths.c_str()), localSize, MPI_CHAR, &allPaths[0], &size[0], &offset[0], MPI_CHAR, comm);
+
+    std::map < std::string, unsigned > pathIndex;
+    unsigned begin = 0;
+    for(int i = 0; i < offset[nprocs]; i++) {
+      if(allPaths[i] == '\n') {
+        pathIndex[std::string(&allPaths[begin], i - begin)] = 0;
+        begin = i + 1;
+      }
+    }
+
+    // sorting the paths lists each region right after its parent
+    path.resize(pathIndex.size());
+    unsigned n = 0;
+    for(std::map < std::string, unsigned >::iterator it = pathIndex.begin(); it != pathIndex.end(); it++) {
+      it->second = n;
+      path[n] = it->first;
+      n++;
+    }
+
+    // the regions never entered by a process count zero time
+    std::vector < double > localTime(n, 0.);
+    std::vector < unsigned > localCalls(n, 0);
+    for(unsigned ir = 1; ir < _region.size(); ir++) {
+      unsigned i = pathIndex[_region[ir].path];
+      localTime[i] = _region[ir].totalTime;
+      localCalls[i] = _region[ir].calls;
+    }
+
+    calls.resize(n);
+    minTime.resize(n);
+    maxTime.resize(n);
+    avgTime.resize(n);
+
+    if(n == 0) return;
+
+    MPI_Reduce(&localCalls[0], &calls[0], n, MPI_UNSIGNED, MPI_MAX, 0, comm);
+    MPI_Reduce(&localTime[0], &minTime[0], n, MPI_DOUBLE, MPI_MIN, 0, comm);
+    MPI_Reduce(&localTime[0], &maxTime[0], n, MPI_DOUBLE, MPI_MAX, 0, comm);
+    MPI_Reduce(&localTime[0], &avgTime[0], n, MPI_DOUBLE, MPI_SUM, 0, comm);
+
+    for(unsigned i = 0; i < n; i++) {
+      avgTime[i] /= nprocs;
+    }
+  }
+
+  // ********************************************
+
+  void Profiler::PrintReport(MPI_Comm comm, std::ostream &out) {
+
+    std::vector < std::string > path;
+    std::vector < unsigned > calls;
+    std::vector < double > minTime, maxTime, avgTime;
+    ReduceRegions(comm, path, calls, minTime, maxTime, avgTime);
+
+    int iproc;
+    MPI_Comm_rank(comm, &iproc);
+    if(iproc != 0) return;
+
+    out << std::endl << " *** Profiler report, wall time in seconds ***" << std::endl;
+    out << std::setw(50) << std::left << " region" << std::right << std::setw(10) << "calls"
+        << std::setw(14) << "min" << std::setw(14) << "max" << std::setw(14) << "avg" << std::endl;
+
+    for(unsigned i = 0; i < path.size(); i++) {
+      // indent the region name by its depth
+      unsigned depth = 0;
+      size_t slash = path[i].rfind('/');
+      for(unsigned j = 0; j < path[i].size(); j++) {
+        if(path[i][j] == '/') depth++;
+      }
+      std::string name = std::string(2 * depth + 1, ' ') + ((slash == std::string::npos) ? path[i] : path[i].substr(slash + 1));
+
+      out << std::setw(50) << std::left << name << std::right << std::setw(10) << calls[i] << std::scientific << std::setprecision(4)
+          << std::setw(14) << minTime[i] << std::setw(14) << maxTime[i] << std::setw(14) << avgTime[i] << std::endl;
+    }
+    out.unsetf(std::ios::floatfield);
+  }
+
+  // ********************************************
+
+  void Profiler::WriteJsonReport(const std::string &filename, MPI_Comm comm) {
+
+    std::vector < std::string > path;
+    std::vector < unsigned > calls;
+    std::vector < double > minTime, maxTime, avgTime;
+    ReduceRegions(comm, path, calls, minTime, maxTime, avgTime);
+
+    int iproc, nprocs;
+    MPI_Comm_rank(comm, &iproc);
+    MPI_Comm_size(comm, &nprocs);
+    if(iproc != 0) return;
+
+    std::ofstream fout(filename.c_str());
+    if(!fout.is_open()) {
+      std::cout << "Warning in Profiler::WriteJsonReport(): cannot open the file " << filename << std::endl;
+      return;
+    }
+
+    fout << std::setprecision(9);
+    fout << "{" << std::endl;
+    fout << "  \"nprocs\": " << nprocs << "," << std::endl;
+    fout << "  \"unit\": \"s\"," << std::endl;
+    fout << "  \"regions\": [" << std::endl;
+
+    for(unsigned i = 0; i < path.size(); i++) {
+      std::string escaped;
+      for(unsigned j = 0; j < path[i].size(); j++) {
+        if(path[i][j] == '"' || path[i][j] == '\\') escaped += '\\';
+        escaped += path[i][j];
+      }
+
+      fout << "    { \"path\": \"" << escaped << "\", \"calls\": " << calls[i]
+           << ", \"min\": " << minTime[i] << ", \"max\": " << maxTime[i] << ", \"avg\": " << avgTime[i] << " }"
+           << ((i + 1 < path.size()) ? "," : "") << std::endl;
+    }
+
+    fout << "  ]" << std::endl;
+    fout << "}" << std::endl;
+
+    fout.close();
+  }
+
+} //end namespace femus
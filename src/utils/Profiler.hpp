@@ -0,0 +1,120 @@
+/*=========================================================================
+
+ Program: FEMUS
+ Module: Profiler
+ Authors: Eugenio Aulisa
+
+ Copyright (c) FEMTTU
+ All rights reserved.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+#ifndef __femus_utils_Profiler_hpp__
+#define __femus_utils_Profiler_hpp__
+
+//----------------------------------------------------------------------------
+// includes :
+//----------------------------------------------------------------------------
+#include <mpi.h>
+
+#include <string>
+#include <vector>
+#include <map>
+#include <iostream>
+
+namespace femus {
+
+  /**
+   * Wall clock profiler of named, nested regions.
+   * Start(name) opens a region inside the region currently open, Stop(name) closes it and returns the
+   * wall time (MPI_Wtime) spent in it. Each region is identified by its path, e.g. "nonlinear solve/assembly",
+   * and accumulates the number of calls and the total time. Optionally each region is also pushed as a PETSc log stage,
+   * so that -log_view splits the PETSc events in the same regions.
+   * The reports reduce the times across the processes (min, max, avg) and are collective on the communicator.
+   * Regions have to be opened and closed by the main thread only.
+   */
+  class Profiler {
+
+    public:
+
+      /** Open the region name inside the region currently open */
+      static void Start(const std::string &name);
+
+      /** Close the region name, that has to be the region currently open, and return the wall time of this call */
+      static double Stop(const std::string &name);
+
+      /** Wall clock time */
+      static double GetTime() {
+        return MPI_Wtime();
+      }
+
+      /** If true, the regions are also pushed as PETSc log stages, to be set when no region is open */
+      static void SetPetscLogStages(const bool &logStages);
+
+      /** Clear all the timings, no region can be open */
+      static void Reset();
+
+      /** Print on the process 0 the table of the regions, with min, max and avg times across the processes */
+      static void PrintReport(MPI_Comm comm = MPI_COMM_WORLD, std::ostream &out = std::cout);
+
+      /** Write on the process 0 the JSON report of the regions, with min, max and avg times across the processes */
+      static void WriteJsonReport(const std::string &filename, MPI_Comm comm = MPI_COMM_WORLD);
+
+    private:
+
+      struct Region {
+        std::string name;
+        std::string path;
+        unsigned depth;
+        unsigned calls;
+        double totalTime;
+        double startTime;
+        int stage; // PetscLogStage, -1 if not registered
+        std::map < std::string, unsigned > children;
+      };
+
+      /** Time statistics of all the regions of all the processes, on the process 0 */
+      static void ReduceRegions(MPI_Comm comm, std::vector < std::string > &path, std::vector < unsigned > &calls,
+                                std::vector < double > &minTime, std::vector < double > &maxTime, std::vector < double > &avgTime);
+
+      // _region[0] is the root, never closed
+      static std::vector < Region > _region;
+      static std::vector < unsigned > _open;
+      static bool _logStages;
+  };
+
+  /**
+   * Profiler region open from the construction to the destruction of the object
+   */
+  class ProfileRegion {
+    public:
+      ProfileRegion(const std::string &name) : _name(name), _open(true) {
+        Profiler::Start(_name);
+      }
+
+      ~ProfileRegion() {
+        Stop();
+      }
+
+      /** Close the region before the destruction, returns the wall time of the region */
+      double Stop() {
+        double time = 0.;
+        if(_open) {
+          time = Profiler::Stop(_name);
+          _open = false;
+        }
+        return time;
+      }
+
+    private:
+      std::string _name;
+      bool _open;
+  };
+
+} //end namespace femus
+
+#endif
@@ -0,0 +1,151 @@
+#include "FemusInit.hpp"
+#include "MultiLevelProblem.hpp"
+#include "MultiLevelMesh.hpp"
+#include "LinearImplicitSystem.hpp"
+#include "NumericVector.hpp"
+#include "SparseMatrix.hpp"
+#include "PetscMatrix.hpp"
+
+#include <algorithm>
+
+using std::cout;
+using std::endl;
+using namespace femus;
+
+/*
+  The element matrices added with the direct insertion of PetscMatrix have to give the same matrix as MatSetValues.
+  The same element matrices are assembled in a matrix with direct insertion and in a reference matrix:
+  the first assembly records the positions, the second one replays them in the reverse element order,
+  the third one also adds again the matrix of the first element.
+*/
+
+bool SetBoundaryCondition(const std::vector < double >& x, const char name[], double& value, const int facename, const double time) {
+  value = 0.;
+  return true;
+}
+
+void Assemble(LinearImplicitSystem& system, MultiLevelSolution& mlSol, const unsigned& level, const unsigned& pass) {
+
+  Mesh* msh = mlSol._mlMesh->GetLevel(level);
+  LinearEquationSolver* pdeSys = system._LinSolver[level];
+  SparseMatrix* KK = pdeSys->_KK;
+
+  unsigned iproc = msh->processor_id();
+
+  const char* names[2] = {"u", "p"};
+  unsigned solIndex[2];
+  unsigned solPdeIndex[2];
+  unsigned solType[2];
+
+  for(unsigned k = 0; k < 2; k++) {
+    solIndex[k] = mlSol.GetIndex(names[k]);
+    solPdeIndex[k] = system.GetSolPdeIndex(names[k]);
+    solType[k] = mlSol.GetSolutionType(solIndex[k]);
+  }
+
+  std::vector < int > l2GMap;
+  std::vector < double > Jac;
+
+  std::vector < int > elements;
+
+  for(int iel = msh->_elementOffset[iproc]; iel < msh->_elementOffset[iproc + 1]; iel++) {
+    elements.push_back(iel);
+  }
+
+  if(pass > 0) std::reverse(elements.begin(), elements.end());
+
+  if(pass > 1 && elements.size() > 0) elements.push_back(elements[0]);
+
+  KK->zero();
+
+  for(unsigned e = 0; e < elements.size(); e++) {
+    int iel = elements[e];
+
+    l2GMap.resize(0);
+
+    for(unsigned k = 0; k < 2; k++) {
+      unsigned nDofs = msh->GetElementDofNumber(iel, solType[k]);
+
+      for(unsigned i = 0; i < nDofs; i++) {
+        l2GMap.push_back(pdeSys->GetSystemDof(solIndex[k], solPdeIndex[k], i, iel));
+      }
+    }
+
+    unsigned n = l2GMap.size();
+    Jac.resize(n * n);
+
+    for(unsigned i = 0; i < n; i++) {
+      for(unsigned j = 0; j < n; j++) {
+        Jac[i * n + j] = (pass + 1.) * (1. + 0.001 * iel + 0.01 * i) / (1. + j);
+      }
+    }
+
+    KK->add_matrix_blocked(Jac, l2GMap, l2GMap);
+  }
+
+  KK->close();
+}
+
+int main(int argc, char** args) {
+
+  FemusInit mpinit(argc, args, MPI_COMM_WORLD);
+
+  MultiLevelMesh mlMsh;
+  mlMsh.GenerateCoarseBoxMesh(4, 4, 0, 0., 1., 0., 1., 0., 0., QUAD9, "seventh");
+  unsigned numberOfUniformLevels = 2;
+  mlMsh.RefineMesh(numberOfUniformLevels, numberOfUniformLevels, NULL);
+
+  MultiLevelSolution mlSol(&mlMsh);
+  mlSol.AddSolution("u", LAGRANGE, SECOND);
+  mlSol.AddSolution("p", LAGRANGE, FIRST);
+  mlSol.Initialize("All");
+  mlSol.AttachSetBoundaryConditionFunction(SetBoundaryCondition);
+  mlSol.GenerateBdc("All");
+
+  MultiLevelProblem mlProb(&mlSol);
+
+  LinearImplicitSystem& direct = mlProb.add_system < LinearImplicitSystem > ("Direct");
+  direct.AddSolutionToSystemPDE("u");
+  direct.AddSolutionToSystemPDE("p");
+  direct.SetDirectMatrixInsertion(true);
+  direct.init();
+
+  LinearImplicitSystem& reference = mlProb.add_system < LinearImplicitSystem > ("Reference");
+  reference.AddSolutionToSystemPDE("u");
+  reference.AddSolutionToSystemPDE("p");
+  reference.init();
+
+  unsigned level = numberOfUniformLevels - 1;
+
+  bool equal = true;
+
+  for(unsigned pass = 0; pass < 3; pass++) {
+
+    Assemble(direct, mlSol, level, pass);
+    Assemble(reference, mlSol, level, pass);
+
+    Mat A = (static_cast< PetscMatrix* >(direct._LinSolver[level]->_KK))->mat();
+    Mat B = (static_cast< PetscMatrix* >(reference._LinSolver[level]->_KK))->mat();
+
+    Mat difference;
+    MatDuplicate(A, MAT_COPY_VALUES, &difference);
+    MatAXPY(difference, -1., B, DIFFERENT_NONZERO_PATTERN);
+
+    PetscReal norm;
+    PetscReal normB;
+    MatNorm(difference, NORM_INFINITY, &norm);
+    MatNorm(B, NORM_INFINITY, &normB);
+    MatDestroy(&difference);
+
+    cout << "pass " << pass << ": || A_direct - A_MatSetValues ||_inf / || A_MatSetValues ||_inf = " << norm / normB << endl;
+
+    if(norm > 1.0e-12 * normB) equal = false;
+  }
+
+  if(!equal) {
+    cout << "The direct insertion does not match MatSetValues" << endl;
+    exit(1);
+  }
+
+  return 0;
+}
@@ -0,0 +1,169 @@
+#include "FemusInit.hpp"
+#include "MultiLevelMesh.hpp"
+#include "Mesh.hpp"
+#include "NumericVector.hpp"
+#include "PolynomialBases.hpp"
+#include "GeomElTypeEnum.hpp"
+
+using std::cout;
+using std::endl;
+using namespace femus;
+
+/*
+  The allocation free inverse mapping (GetInverseMapping, ElementInverseMapping) against the Newton iteration with
+  GetPolynomialShapeFunctionGradient and GetNewLocalCoordinates it replaced. On curved QUAD9, TRI6 and HEX27 elements and
+  for the mappings of order 0, 1, 2, the point x = F(xi) of a given xi is located by both, starting from the element center:
+  both have to converge and to recover xi.
+*/
+
+const double center[6][3] = {{0., 0., 0.}, {0.25, 0.25, 0.25}, {1. / 3., 1. / 3., 0.}, {0., 0., 0.}, {1. / 3., 1. / 3., 0.}, {0., 0., 0.}};
+
+const double points[6][2][3] = {{{0.3, -0.2, 0.5}, { -0.6, 0.1, -0.4}},
+  {{0.2, 0.1, 0.3}, {0.1, 0.5, 0.2}},
+  {{0.2, 0.3, -0.5}, {0.5, 0.1, 0.4}},
+  {{0.3, -0.2, 0.}, { -0.7, 0.6, 0.}},
+  {{0.2, 0.3, 0.}, {0.6, 0.1, 0.}},
+  {{0.3, 0., 0.}, { -0.7, 0., 0.}}
+};
+
+bool OldInverseMapping(const unsigned& solType, short unsigned& ielType, const std::vector < std::vector < std::vector <double > > >& aP,
+                       const std::vector <double >& x, std::vector <double >& xi) {
+
+  std::vector < double > phi;
+  std::vector < std::vector < double > > gradPhi;
+
+  for(unsigned jtype = 0; jtype < solType + 1; jtype++) {
+    bool convergence = false;
+
+    for(unsigned it = 0; it < 100 && !convergence; it++) {
+      GetPolynomialShapeFunctionGradient(phi, gradPhi, xi, ielType, jtype);
+      convergence = GetNewLocalCoordinates(xi, x, phi, gradPhi, aP[jtype]);
+    }
+
+    if(jtype == solType) return convergence;
+  }
+
+  return false;
+}
+
+bool CheckMesh(const ElemType& elemType, const unsigned& dim) {
+
+  MultiLevelMesh mlMsh;
+  mlMsh.GenerateCoarseBoxMesh(2, 2, (dim == 3) ? 2 : 0, 0., 1., 0., 1., 0., (dim == 3) ? 1. : 0., elemType, "seventh");
+  mlMsh.RefineMesh(2, 2, NULL);
+
+  Mesh* msh = mlMsh.GetLevel(1);
+  unsigned iproc = msh->processor_id();
+
+  double pi = acos(-1.);
+
+  std::vector < std::vector < double > > xv(dim);
+  std::vector < std::vector < std::vector < double > > > aP(3);
+  std::vector < double > phi;
+  std::vector < double > xiExact(dim);
+  std::vector < double > x(dim);
+  std::vector < double > xiNew(dim);
+  std::vector < double > xiOld(dim);
+
+  bool passed = true;
+
+  for(int iel = msh->_elementOffset[iproc]; iel < msh->_elementOffset[iproc + 1]; iel++) {
+
+    short unsigned ielType = msh->GetElementType(iel);
+    unsigned nDofs = msh->GetElementDofNumber(iel, 2);
+
+    for(unsigned k = 0; k < dim; k++) {
+      xv[k].resize(nDofs);
+    }
+
+    // nodes moved by a smooth distortion, so that the quadratic mappings are curved
+    for(unsigned i = 0; i < nDofs; i++) {
+      unsigned xDof = msh->GetSolutionDof(i, iel, 2);
+      std::vector < double > X(dim);
+
+      for(unsigned k = 0; k < dim; k++) {
+        X[k] = (*msh->_topology->_Sol[k])(xDof);
+      }
+
+      double bump = 0.05;
+
+      for(unsigned k = 0; k < dim; k++) {
+        bump *= sin(pi * X[k]);
+      }
+
+      for(unsigned k = 0; k < dim; k++) {
+        xv[k][i] = X[k] + bump;
+      }
+    }
+
+    for(unsigned j = 0; j < 3; j++) {
+      ProjectNodalToPolynomialCoefficients(aP[j], xv, ielType, j);
+    }
+
+    for(unsigned solType = 0; solType < 3; solType++) {
+      for(unsigned ip = 0; ip < 2; ip++) {
+
+        for(unsigned k = 0; k < dim; k++) {
+          xiExact[k] = points[ielType][ip][k];
+        }
+
+        GetPolynomialShapeFunction(phi, xiExact, ielType, solType);
+
+        for(unsigned k = 0; k < dim; k++) {
+          x[k] = 0.;
+
+          for(unsigned i = 0; i < phi.size(); i++) {
+            x[k] += aP[solType][k][i] * phi[i];
+          }
+        }
+
+        for(unsigned k = 0; k < dim; k++) {
+          xiNew[k] = xiOld[k] = center[ielType][k];
+        }
+
+        bool newConvergence = GetInverseMapping(solType, ielType, aP, x, xiNew);
+        bool oldConvergence = OldInverseMapping(solType, ielType, aP, x, xiOld);
+
+        double errorNew = 0.;
+        double errorOld = 0.;
+
+        for(unsigned k = 0; k < dim; k++) {
+          errorNew = std::max(errorNew, fabs(xiNew[k] - xiExact[k]));
+          errorOld = std::max(errorOld, fabs(xiOld[k] - xiNew[k]));
+        }
+
+        if(!newConvergence || !oldConvergence || errorNew > 1.0e-9 || errorOld > 1.0e-9) {
+          cout << "element " << iel << " type " << ielType << " order " << solType << " point " << ip
+               << ": convergence new = " << newConvergence << " old = " << oldConvergence
+               << " |xi_new - xi| = " << errorNew << " |xi_old - xi_new| = " << errorOld << endl;
+          passed = false;
+        }
+      }
+    }
+  }
+
+  return passed;
+}
+
+int main(int argc, char** args) {
+
+  FemusInit mpinit(argc, args, MPI_COMM_WORLD);
+
+  int passed = 1;
+
+  if(!CheckMesh(QUAD9, 2)) passed = 0;
+
+  if(!CheckMesh(TRI6, 2)) passed = 0;
+
+  if(!CheckMesh(HEX27, 3)) passed = 0;
+
+  int allPassed;
+  MPI_Allreduce(&passed, &allPassed, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+
+  if(!allPassed) {
+    cout << "The inverse mapping does not match the previous Newton iteration" << endl;
+    exit(1);
+  }
+
+  return 0;
+}
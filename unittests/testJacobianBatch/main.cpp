@@ -0,0 +1,242 @@
+#include "FemusInit.hpp"
+#include "MultiLevelMesh.hpp"
+#include "Mesh.hpp"
+#include "ElementBatch.hpp"
+#include "GeometryCache.hpp"
+#include "NumericVector.hpp"
+
+#include <cmath>
+
+using std::cout;
+using std::endl;
+using namespace femus;
+
+/*
+  The batched geometry of ElementBatch and the precomputed one of GeometryCache against elem_type::Jacobian and
+  elem_type::GetJacobian, element by element and Gauss point by Gauss point: weights, inverse coordinate Jacobians
+  and physical shape function gradients of the Lagrange families 0, 1 and 2 have to agree. The meshes are distorted by
+  a smooth map, so that the Jacobians are not constant, and cover QUAD9, TRI6, HEX27 and a mixed hex, wedge and tet mesh.
+*/
+
+const char geomName[6][6] = {"hex", "tet", "wedge", "quad", "tri", "line"};
+
+bool Different(const double &a, const double &b) {
+  return fabs(a - b) > 1.0e-10 * (1. + fabs(b));
+}
+
+// smooth map with a displacement gradient smaller than one, so that the distorted elements stay valid
+void DistortMesh(Mesh* msh) {
+
+  unsigned dim = msh->GetDimension();
+  NumericVector* x0 = msh->_topology->_Sol[0];
+
+  std::vector < std::vector < double > > x(dim);
+  for(unsigned k = 0; k < dim; k++) {
+    for(int i = x0->first_local_index(); i < x0->last_local_index(); i++) {
+      x[k].push_back((*msh->_topology->_Sol[k])(i));
+    }
+  }
+
+  for(unsigned k = 0; k < dim; k++) {
+    unsigned l = (k + 1) % dim;
+    for(int i = x0->first_local_index(); i < x0->last_local_index(); i++) {
+      unsigned j = i - x0->first_local_index();
+      msh->_topology->_Sol[k]->set(i, x[k][j] + 0.05 * sin(2. * x[l][j] + 1.) * cos(3. * x[k][j]));
+    }
+    msh->_topology->_Sol[k]->close();
+  }
+
+  msh->InvalidateGeometryCache();
+}
+
+unsigned CompareGeometry(Mesh* msh, const char name[], std::vector < unsigned > &checkedElements) {
+
+  unsigned errors = 0;
+  unsigned iproc = msh->processor_id();
+  unsigned dim = msh->GetDimension();
+
+  std::vector < std::vector < double > > x(dim);
+  std::vector < std::vector < double > > invJ;
+  std::vector < double > phi;
+  std::vector < double > gradPhi;
+  double weight, weightInvJ;
+
+  checkedElements.assign(6, 0);
+
+  for(unsigned solType = 0; solType < 3; solType++) {
+
+    const GeometryCache* geometry = msh->GetGeometryCache(solType);
+
+    for(int iel = msh->_elementOffset[iproc]; iel < msh->_elementOffset[iproc + 1]; iel++) {
+      short unsigned ielGeom = msh->GetElementType(iel);
+      const elem_type* fe = msh->_finiteElement[ielGeom][solType];
+      unsigned nDofs = msh->GetElementDofNumber(iel, solType);
+
+      for(unsigned k = 0; k < dim; k++) {
+        x[k].resize(nDofs);
+        for(unsigned i = 0; i < nDofs; i++) {
+          x[k][i] = (*msh->_topology->_Sol[k])(msh->GetSolutionDof(i, iel, 2));
+        }
+      }
+
+      if(geometry->GetGaussPointNumber(iel) != fe->GetGaussPointNumber()) {
+        cout << name << " element " << iel << " solType " << solType << ": different number of Gauss points in the cache" << endl;
+        errors++;
+        continue;
+      }
+
+      for(unsigned ig = 0; ig < fe->GetGaussPointNumber(); ig++) {
+        fe->Jacobian(x, ig, weight, phi, gradPhi);
+        fe->GetJacobian(x, ig, weightInvJ, invJ);
+
+        bool ok = !Different(geometry->GetWeight(iel, ig), weight);
+
+        const double* cacheInvJ = geometry->GetInverseJacobian(iel, ig);
+        for(unsigned k = 0; k < dim; k++) {
+          for(unsigned l = 0; l < dim; l++) {
+            ok = ok && !Different(cacheInvJ[k * dim + l], invJ[k][l]);
+          }
+        }
+
+        const double* cacheGradPhi = geometry->GetGradPhi(iel, ig);
+        for(unsigned i = 0; i < nDofs * dim; i++) {
+          ok = ok && !Different(cacheGradPhi[i], gradPhi[i]);
+        }
+
+        if(!ok) {
+          cout << name << " " << geomName[ielGeom] << " element " << iel << " solType " << solType << " Gauss point " << ig
+               << ": the geometry cache differs from elem_type::Jacobian" << endl;
+          errors++;
+        }
+      }
+
+      checkedElements[ielGeom]++;
+    }
+
+    ElementBatch batch(msh, solType);
+
+    for(unsigned ib = 0; ib < batch.GetNumberOfBlocks(); ib++) {
+      batch.SetBlock(ib);
+      const elem_type* fe = batch.GetFiniteElement();
+      unsigned nDofs = fe->GetNDofs();
+
+      for(unsigned ig = 0; ig < fe->GetGaussPointNumber(); ig++) {
+        batch.Evaluate(ig, true);
+
+        for(unsigned e = 0; e < batch.GetBlockSize(); e++) {
+          unsigned iel = batch.GetElement(e);
+
+          for(unsigned k = 0; k < dim; k++) {
+            x[k].resize(nDofs);
+            for(unsigned i = 0; i < nDofs; i++) {
+              x[k][i] = (*msh->_topology->_Sol[k])(msh->GetSolutionDof(i, iel, 2));
+            }
+          }
+
+          fe->Jacobian(x, ig, weight, phi, gradPhi);
+          fe->GetJacobian(x, ig, weightInvJ, invJ);
+
+          bool ok = !Different(batch.GetWeight(e), weight);
+
+          for(unsigned k = 0; k < dim; k++) {
+            for(unsigned l = 0; l < dim; l++) {
+              ok = ok && !Different(batch.GetInverseJacobian(e, k, l), invJ[k][l]);
+            }
+          }
+
+          for(unsigned i = 0; i < nDofs; i++) {
+            for(unsigned k = 0; k < dim; k++) {
+              ok = ok && !Different(batch.GetGradPhi(e, i, k), gradPhi[i * dim + k]);
+            }
+          }
+
+          if(!ok) {
+            cout << name << " " << geomName[msh->GetElementType(iel)] << " element " << iel << " solType " << solType
+                 << " Gauss point " << ig << ": the element batch differs from elem_type::Jacobian" << endl;
+            errors++;
+          }
+        }
+      }
+    }
+  }
+
+  // every process has checked its owned elements three times, once for each Lagrange family
+  std::vector < unsigned > allChecked(6);
+  MPI_Allreduce(&checkedElements[0], &allChecked[0], 6, MPI_UNSIGNED, MPI_SUM, MPI_COMM_WORLD);
+  checkedElements = allChecked;
+
+  return errors;
+}
+
+int main(int argc, char** args) {
+
+  FemusInit mpinit(argc, args, MPI_COMM_WORLD);
+
+  unsigned errors = 0;
+  std::vector < unsigned > checkedElements;
+
+  // 2D
+  {
+    MultiLevelMesh mlMsh;
+    mlMsh.GenerateCoarseBoxMesh(4, 4, 0, 0., 1., 0., 1., 0., 0., QUAD9, "fifth");
+    mlMsh.RefineMesh(2, 2, NULL);
+    Mesh* msh = mlMsh.GetLevel(1);
+    DistortMesh(msh);
+    errors += CompareGeometry(msh, "QUAD9", checkedElements);
+    if(checkedElements[3] == 0) {
+      cout << "QUAD9: no quadrilateral has been checked" << endl;
+      errors++;
+    }
+  }
+
+  {
+    MultiLevelMesh mlMsh;
+    mlMsh.GenerateCoarseBoxMesh(4, 4, 0, 0., 1., 0., 1., 0., 0., TRI6, "fifth");
+    mlMsh.RefineMesh(2, 2, NULL);
+    Mesh* msh = mlMsh.GetLevel(1);
+    DistortMesh(msh);
+    errors += CompareGeometry(msh, "TRI6", checkedElements);
+    if(checkedElements[4] == 0) {
+      cout << "TRI6: no triangle has been checked" << endl;
+      errors++;
+    }
+  }
+
+  // 3D
+  {
+    MultiLevelMesh mlMsh;
+    mlMsh.GenerateCoarseBoxMesh(3, 3, 3, 0., 1., 0., 1., 0., 1., HEX27, "fifth");
+    Mesh* msh = mlMsh.GetLevel(0);
+    DistortMesh(msh);
+    errors += CompareGeometry(msh, "HEX27", checkedElements);
+    if(checkedElements[0] == 0) {
+      cout << "HEX27: no hexahedron has been checked" << endl;
+      errors++;
+    }
+  }
+
+  {
+    MultiLevelMesh mlMsh;
+    mlMsh.ReadCoarseMesh("./input/cube_all_shapes.neu", "fifth", 1.);
+    mlMsh.RefineMesh(2, 2, NULL);
+    Mesh* msh = mlMsh.GetLevel(1);
+    DistortMesh(msh);
+    errors += CompareGeometry(msh, "mixed", checkedElements);
+    for(unsigned ielGeom = 0; ielGeom < 3; ielGeom++) {
+      if(checkedElements[ielGeom] == 0) {
+        cout << "mixed: no " << geomName[ielGeom] << " has been checked" << endl;
+        errors++;
+      }
+    }
+  }
+
+  unsigned allErrors;
+  MPI_Allreduce(&errors, &allErrors, 1, MPI_UNSIGNED, MPI_SUM, MPI_COMM_WORLD);
+
+  if(allErrors > 0) {
+    cout << allErrors << " differences between the batched or cached geometry and elem_type::Jacobian" << endl;
+    exit(1);
+  }
+
+  return 0;
+}
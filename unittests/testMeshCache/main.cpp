@@ -0,0 +1,153 @@
+#include "FemusInit.hpp"
+#include "MultiLevelMesh.hpp"
+#include "Mesh.hpp"
+#include "NumericVector.hpp"
+
+#include <fstream>
+#include <sstream>
+
+using std::cout;
+using std::endl;
+using namespace femus;
+
+/*
+  Round trip of the binary mesh cache: the multilevel mesh rebuilt by LoadMeshCache from the files written by SaveMeshCache
+  has to match the one read, partitioned and refined, level by level: offsets, element types, groups and fathers,
+  element dofs of all the solution types and owned coordinates. A cache with a different number of levels is rejected,
+  and so is, by all the processes, a cache whose file has been truncated on the process 0 only.
+*/
+
+unsigned CompareLevels(Mesh* msh, Mesh* cached, const unsigned& level) {
+
+  unsigned errors = 0;
+  unsigned iproc = msh->processor_id();
+
+  if(msh->GetNumberOfElements() != cached->GetNumberOfElements() || msh->GetNumberOfNodes() != cached->GetNumberOfNodes() ||
+      msh->_elementOffset != cached->_elementOffset) {
+    cout << "level " << level << ": different numbers of elements, nodes or element offsets" << endl;
+    return 1;
+  }
+
+  for(unsigned k = 0; k < 5; k++) {
+    if(msh->_dofOffset[k] != cached->_dofOffset[k] || msh->_ownSize[k] != cached->_ownSize[k]) {
+      cout << "level " << level << ": different dof offsets of the solution type " << k << endl;
+      errors++;
+    }
+  }
+
+  for(int iel = msh->_elementOffset[iproc]; iel < msh->_elementOffset[iproc + 1]; iel++) {
+
+    if(msh->GetElementType(iel) != cached->GetElementType(iel) || msh->GetElementGroup(iel) != cached->GetElementGroup(iel) ||
+        (level > 0 && msh->GetElementFather(iel) != cached->GetElementFather(iel))) {
+      cout << "level " << level << " element " << iel << ": different type, group or father" << endl;
+      errors++;
+    }
+
+    for(unsigned k = 0; k < 5; k++) {
+      unsigned nDofs = msh->GetElementDofNumber(iel, k);
+
+      if(nDofs != cached->GetElementDofNumber(iel, k)) {
+        cout << "level " << level << " element " << iel << ": different number of dofs of the solution type " << k << endl;
+        errors++;
+        continue;
+      }
+
+      for(unsigned i = 0; i < nDofs; i++) {
+        if(msh->GetSolutionDof(i, iel, k) != cached->GetSolutionDof(i, iel, k)) {
+          cout << "level " << level << " element " << iel << ": different dof " << i << " of the solution type " << k << endl;
+          errors++;
+        }
+      }
+    }
+  }
+
+  for(unsigned k = 0; k < msh->GetDimension(); k++) {
+    NumericVector* x = msh->_topology->_Sol[k];
+    NumericVector* xCached = cached->_topology->_Sol[k];
+
+    for(int i = x->first_local_index(); i < x->last_local_index(); i++) {
+      if((*x)(i) != (*xCached)(i)) {
+        cout << "level " << level << ": different coordinate " << k << " of the node " << i << endl;
+        errors++;
+      }
+    }
+  }
+
+  return errors;
+}
+
+int main(int argc, char** args) {
+
+  FemusInit mpinit(argc, args, MPI_COMM_WORLD);
+
+  const char meshFile[] = "./input/square.neu";
+  const char cacheFile[] = "./output/squareCache";
+  unsigned numberOfUniformLevels = 3;
+  double scalingFactor = 1.;
+
+  MultiLevelMesh mlMsh;
+  mlMsh.ReadCoarseMesh(meshFile, "seventh", scalingFactor);
+  mlMsh.RefineMesh(numberOfUniformLevels, numberOfUniformLevels, NULL);
+  mlMsh.SaveMeshCache(cacheFile);
+
+  MultiLevelMesh mlMshCached;
+
+  if(!mlMshCached.LoadMeshCache(cacheFile, meshFile, numberOfUniformLevels, numberOfUniformLevels, "seventh", scalingFactor)) {
+    cout << "The mesh cache written by SaveMeshCache has been rejected" << endl;
+    exit(1);
+  }
+
+  unsigned errors = 0;
+
+  if(mlMshCached.GetNumberOfLevels() != mlMsh.GetNumberOfLevels()) {
+    cout << "The cached multilevel mesh has " << mlMshCached.GetNumberOfLevels() << " levels instead of " << mlMsh.GetNumberOfLevels() << endl;
+    errors++;
+  }
+  else {
+    for(unsigned level = 0; level < mlMsh.GetNumberOfLevels(); level++) {
+      errors += CompareLevels(mlMsh.GetLevel(level), mlMshCached.GetLevel(level), level);
+    }
+  }
+
+  MultiLevelMesh mlMshOther;
+
+  if(mlMshOther.LoadMeshCache(cacheFile, meshFile, numberOfUniformLevels + 1, numberOfUniformLevels + 1, "seventh", scalingFactor)) {
+    cout << "The mesh cache has been accepted for a different number of levels" << endl;
+    errors++;
+  }
+
+  // a job killed while saving: the file of the process 0 keeps only the first half of its data
+  int iproc, nprocs;
+  MPI_Comm_rank(MPI_COMM_WORLD, &iproc);
+  MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+
+  if(iproc == 0) {
+    std::ostringstream fileName;
+    fileName << cacheFile << "." << nprocs << "." << iproc;
+
+    std::ifstream fin(fileName.str().c_str(), std::ios::in | std::ios::binary);
+    std::string data((std::istreambuf_iterator < char >(fin)), std::istreambuf_iterator < char >());
+    fin.close();
+
+    std::ofstream fout(fileName.str().c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    fout.write(data.data(), data.size() / 2);
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+
+  MultiLevelMesh mlMshTruncated;
+
+  if(mlMshTruncated.LoadMeshCache(cacheFile, meshFile, numberOfUniformLevels, numberOfUniformLevels, "seventh", scalingFactor)) {
+    cout << "The truncated mesh cache has been accepted" << endl;
+    errors++;
+  }
+
+  unsigned allErrors;
+  MPI_Allreduce(&errors, &allErrors, 1, MPI_UNSIGNED, MPI_SUM, MPI_COMM_WORLD);
+
+  if(allErrors > 0) {
+    cout << allErrors << " differences between the cached and the built multilevel mesh" << endl;
+    exit(1);
+  }
+
+  return 0;
+}
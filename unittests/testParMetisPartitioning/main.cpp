@@ -0,0 +1,125 @@
+#include "FemusInit.hpp"
+#include "FemusConfig.hpp"
+#include "MultiLevelMesh.hpp"
+#include "Mesh.hpp"
+#include "NumericVector.hpp"
+
+using std::cout;
+using std::endl;
+using namespace femus;
+
+/*
+  Smoke test of the ParMetis partitioner: the same box meshes are built with the serial Metis partitioning and with
+  Mesh::SetParallelPartitioning(true). On one process, or without ParMetis where the serial Metis partitioning is used,
+  the two meshes have to be identical: element offsets, dof offsets, element dofs of all the solution types and owned
+  coordinates. With ParMetis on more processes the partitions differ, and only the number of elements and nodes and
+  a non empty block of elements on every process are checked.
+*/
+
+unsigned CompareMeshes(Mesh* msh, Mesh* parMsh, const char name[]) {
+
+  unsigned errors = 0;
+  unsigned iproc = msh->processor_id();
+  unsigned nprocs = msh->n_processors();
+
+  if(msh->GetNumberOfElements() != parMsh->GetNumberOfElements() || msh->GetNumberOfNodes() != parMsh->GetNumberOfNodes()) {
+    cout << name << ": different numbers of elements or nodes" << endl;
+    return 1;
+  }
+
+  if(parMsh->_elementOffset[iproc + 1] <= parMsh->_elementOffset[iproc]) {
+    cout << name << ": the process " << iproc << " has no elements" << endl;
+    errors++;
+  }
+
+  bool samePartition = (nprocs == 1);
+#ifndef HAVE_PARMETIS
+  samePartition = true;
+#endif
+
+  if(!samePartition) return errors;
+
+  if(msh->_elementOffset != parMsh->_elementOffset) {
+    cout << name << ": different element offsets" << endl;
+    return errors + 1;
+  }
+
+  for(unsigned k = 0; k < 5; k++) {
+    if(msh->_dofOffset[k] != parMsh->_dofOffset[k] || msh->_ownSize[k] != parMsh->_ownSize[k]) {
+      cout << name << ": different dof offsets of the solution type " << k << endl;
+      errors++;
+    }
+  }
+
+  for(int iel = msh->_elementOffset[iproc]; iel < msh->_elementOffset[iproc + 1]; iel++) {
+    for(unsigned k = 0; k < 5; k++) {
+      unsigned nDofs = msh->GetElementDofNumber(iel, k);
+
+      for(unsigned i = 0; i < nDofs; i++) {
+        if(msh->GetSolutionDof(i, iel, k) != parMsh->GetSolutionDof(i, iel, k)) {
+          cout << name << " element " << iel << ": different dof " << i << " of the solution type " << k << endl;
+          errors++;
+        }
+      }
+    }
+  }
+
+  for(unsigned k = 0; k < msh->GetDimension(); k++) {
+    NumericVector* x = msh->_topology->_Sol[k];
+    NumericVector* xPar = parMsh->_topology->_Sol[k];
+
+    for(int i = x->first_local_index(); i < x->last_local_index(); i++) {
+      if((*x)(i) != (*xPar)(i)) {
+        cout << name << ": different coordinate " << k << " of the node " << i << endl;
+        errors++;
+      }
+    }
+  }
+
+  return errors;
+}
+
+int main(int argc, char** args) {
+
+  FemusInit mpinit(argc, args, MPI_COMM_WORLD);
+
+  unsigned errors = 0;
+
+  // 2D
+  {
+    Mesh::SetParallelPartitioning(false);
+    MultiLevelMesh mlMsh;
+    mlMsh.GenerateCoarseBoxMesh(8, 8, 0, 0., 1., 0., 1., 0., 0., QUAD9, "seventh");
+
+    Mesh::SetParallelPartitioning(true);
+    MultiLevelMesh mlMshPar;
+    mlMshPar.GenerateCoarseBoxMesh(8, 8, 0, 0., 1., 0., 1., 0., 0., QUAD9, "seventh");
+
+    errors += CompareMeshes(mlMsh.GetLevel(0), mlMshPar.GetLevel(0), "QUAD9");
+  }
+
+  // 3D
+  {
+    Mesh::SetParallelPartitioning(false);
+    MultiLevelMesh mlMsh;
+    mlMsh.GenerateCoarseBoxMesh(4, 4, 4, 0., 1., 0., 1., 0., 1., HEX27, "seventh");
+
+    Mesh::SetParallelPartitioning(true);
+    MultiLevelMesh mlMshPar;
+    mlMshPar.GenerateCoarseBoxMesh(4, 4, 4, 0., 1., 0., 1., 0., 1., HEX27, "seventh");
+
+    errors += CompareMeshes(mlMsh.GetLevel(0), mlMshPar.GetLevel(0), "HEX27");
+  }
+
+  Mesh::SetParallelPartitioning(false);
+
+  unsigned allErrors;
+  MPI_Allreduce(&errors, &allErrors, 1, MPI_UNSIGNED, MPI_SUM, MPI_COMM_WORLD);
+
+  if(allErrors > 0) {
+    cout << allErrors << " differences between the serial Metis and the ParMetis partitioned meshes" << endl;
+    exit(1);
+  }
+
+  return 0;
+}
@@ -0,0 +1,149 @@
+#include "FemusInit.hpp"
+#include "MultiLevelMesh.hpp"
+#include "MultiLevelSolution.hpp"
+#include "NumericVector.hpp"
+#include "Marker.hpp"
+#include "ParticleArrays.hpp"
+#include "ParticleGridTransfer.hpp"
+
+using std::cout;
+using std::endl;
+using namespace femus;
+
+/*
+  The element-bucketed particle to grid of ParticleGridTransfer against the per-marker scatter it replaces: the mass and the
+  momentum of three particles in each owned element, at given local coordinates, are distributed to the biquadratic grid
+  by both, that have to give the same nodal values. The total grid mass has to be the total particle mass.
+*/
+
+int main(int argc, char** args) {
+
+  FemusInit mpinit(argc, args, MPI_COMM_WORLD);
+
+  MultiLevelMesh mlMsh;
+  mlMsh.GenerateCoarseBoxMesh(4, 4, 0, 0., 1., 0., 1., 0., 0., QUAD9, "seventh");
+  mlMsh.RefineMesh(2, 2, NULL);
+  mlMsh.EraseCoarseLevels(1);
+
+  unsigned dim = mlMsh.GetDimension();
+
+  MultiLevelSolution mlSol(&mlMsh);
+  const char name[6][4] = {"M", "PX", "PY", "MR", "PXR", "PYR"};
+  for(unsigned c = 0; c < 6; c++) {
+    mlSol.AddSolution(name[c], LAGRANGE, SECOND, 0, false);
+  }
+  mlSol.Initialize("All");
+
+  Solution* sol = mlSol.GetSolutionLevel(0);
+  Mesh* msh = mlMsh.GetLevel(0);
+  unsigned iproc = msh->processor_id();
+  unsigned solType = 2;
+
+  //BEGIN three particles in each owned element, in element order
+  const double xiParticle[3][2] = {{ -0.7, 0.3}, {0.2, -0.1}, {0.5, 0.9}};
+
+  std::vector < Marker* > particles;
+  for(int iel = msh->_elementOffset[iproc]; iel < msh->_elementOffset[iproc + 1]; iel++) {
+    for(unsigned j = 0; j < 3; j++) {
+      std::vector < double > x(dim, 0.);
+      particles.push_back(new Marker(x, 0.1 + 0.01 * ((iel + j) % 7), VOLUME, solType, iel, sol));
+    }
+  }
+
+  ParticleArrays arrays;
+  arrays.Build(particles, dim);
+
+  for(unsigned i = 0; i < arrays.size(); i++) {
+    for(unsigned k = 0; k < dim; k++) {
+      arrays.GetLocalCoordinates(k)[i] = xiParticle[i % 3][k];
+      arrays.GetVelocity(k)[i] = (k == 0) ? 1. + 0.1 * (i % 5) : -0.5 + 0.2 * (i % 3);
+    }
+  }
+  //END
+
+  //BEGIN particle to grid of the mass and of the momentum
+  std::vector < std::vector < double > > momentum(dim, std::vector < double > (arrays.size()));
+  for(unsigned k = 0; k < dim; k++) {
+    for(unsigned i = 0; i < arrays.size(); i++) {
+      momentum[k][i] = arrays.GetMass()[i] * arrays.GetVelocity(k)[i];
+    }
+  }
+
+  std::vector < const double* > q(3);
+  q[0] = arrays.GetMass();
+  q[1] = &momentum[0][0];
+  q[2] = &momentum[1][0];
+
+  std::vector < unsigned > solIndex(3);
+  std::vector < unsigned > solIndexReference(3);
+  for(unsigned c = 0; c < 3; c++) {
+    solIndex[c] = mlSol.GetIndex(name[c]);
+    solIndexReference[c] = mlSol.GetIndex(name[c + 3]);
+  }
+
+  ParticleGridTransfer transfer(sol, solType);
+  transfer.ParticleToGrid(arrays, q, solIndex);
+  //END
+
+  //BEGIN per-marker reference
+  std::vector < double > xi(dim);
+  for(unsigned c = 0; c < 3; c++) {
+    sol->_Sol[solIndexReference[c]]->zero();
+  }
+
+  for(unsigned i = 0; i < arrays.size(); i++) {
+    unsigned iel = particles[arrays.GetMarkerIndex(i)]->GetMarkerElement();
+    const basis* pt_basis = msh->_finiteElement[msh->GetElementType(iel)][solType]->GetBasis();
+
+    for(unsigned k = 0; k < dim; k++) {
+      xi[k] = arrays.GetLocalCoordinates(k)[i];
+    }
+
+    for(unsigned a = 0; a < msh->GetElementDofNumber(iel, solType); a++) {
+      unsigned idof = msh->GetSolutionDof(a, iel, solType);
+      double phi = pt_basis->eval_phi(a, xi);
+      for(unsigned c = 0; c < 3; c++) {
+        sol->_Sol[solIndexReference[c]]->add(idof, phi * q[c][i]);
+      }
+    }
+  }
+
+  for(unsigned c = 0; c < 3; c++) {
+    sol->_Sol[solIndexReference[c]]->close();
+  }
+  //END
+
+  bool passed = true;
+
+  for(unsigned c = 0; c < 3; c++) {
+    double norm = sol->_Sol[solIndexReference[c]]->linfty_norm();
+    sol->_Sol[solIndexReference[c]]->add(-1., *sol->_Sol[solIndex[c]]);
+    sol->_Sol[solIndexReference[c]]->close();
+    double error = sol->_Sol[solIndexReference[c]]->linfty_norm();
+
+    if(error > 1.0e-12 * norm) {
+      if(iproc == 0) cout << "The particle to grid of " << name[c] << " differs from the per-marker scatter by " << error << endl;
+      passed = false;
+    }
+  }
+
+  double particleMass = 0.;
+  for(unsigned i = 0; i < arrays.size(); i++) {
+    particleMass += arrays.GetMass()[i];
+  }
+  MPI_Allreduce(MPI_IN_PLACE, &particleMass, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+
+  double gridMass = sol->_Sol[solIndex[0]]->sum();
+  if(fabs(gridMass - particleMass) > 1.0e-12 * particleMass) {
+    if(iproc == 0) cout << "The grid mass " << gridMass << " is not the particle mass " << particleMass << endl;
+    passed = false;
+  }
+
+  for(unsigned j = 0; j < particles.size(); j++) {
+    delete particles[j];
+  }
+
+  if(!passed) exit(1);
+
+  return 0;
+}
@@ -0,0 +1,108 @@
+#include "FemusInit.hpp"
+#include "sparseGrid.hpp"
+
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_real_distribution.hpp>
+
+using std::cout;
+using std::endl;
+using namespace femus;
+
+/*
+  sparseGrid::GetSupportingDof, which finds the supporting dof of a point from its coordinates, against the scan of all
+  the dofs of each W with InSupport it replaced, on random points and on a grid that contains all the cell boundaries.
+  The PDF evaluated with the supporting dofs, pointwise and batched, has to match the sum over all the dofs of PiecewiseConstPhi.
+*/
+
+int main(int argc, char** args) {
+
+  FemusInit mpinit(argc, args, MPI_COMM_WORLD);
+
+  unsigned N = 2;
+  unsigned M = 1000;
+  double xmin = -1.;
+  double xmax = 1.;
+
+  boost::random::mt19937 rng(1);
+  boost::random::uniform_real_distribution<> un(xmin, xmax);
+
+  std::vector < std::vector < double > > samples(M, std::vector < double > (N));
+
+  for(unsigned m = 0; m < M; m++) {
+    for(unsigned n = 0; n < N; n++) {
+      samples[m][n] = un(rng);
+    }
+  }
+
+  sparseGrid spg(samples, xmin, xmax, false);
+  spg.EvaluateNodalValuesPDF(samples);
+
+  // test points: the samples, then a grid of step 1/16 that covers the interval, its outside and all the cell boundaries
+  std::vector < std::vector < double > > points = samples;
+
+  for(int i = -20; i <= 20; i++) {
+    for(int j = -20; j <= 20; j++) {
+      std::vector < double > x(N);
+      x[0] = i / 16.;
+      x[1] = j / 16.;
+      points.push_back(x);
+    }
+  }
+
+  std::vector < double > pdfBatched;
+  spg.EvaluatePDF(pdfBatched, points);
+
+  unsigned errors = 0;
+
+  for(unsigned m = 0; m < points.size(); m++) {
+
+    double pdfScan = 0.;
+
+    for(unsigned w = 0; w < spg.GetNumberOfWs(); w++) {
+
+      const std::vector < std::vector < std::vector < unsigned > > > &identifiers = spg.GetDofIdentifiers(w);
+
+      unsigned count = 0;
+      unsigned iScan = 0;
+
+      for(unsigned i = 0; i < identifiers.size(); i++) {
+        unsigned isIt;
+        spg.InSupport(isIt, points[m], identifiers[i]);
+
+        if(isIt == 1) {
+          count++;
+          iScan = i;
+        }
+
+        double phi;
+        spg.PiecewiseConstPhi(phi, points[m], identifiers[i]);
+        pdfScan += spg.GetNodalValuesPDF(w)[i] * phi;
+      }
+
+      unsigned i;
+      bool found = spg.GetSupportingDof(i, points[m], w);
+
+      if(count > 1 || found != (count == 1) || (found && i != iScan)) {
+        cout << "point (" << points[m][0] << ", " << points[m][1] << ") W " << w << ": scan count = " << count << " dof = " << iScan
+             << ", supporting dof found = " << found << " dof = " << i << endl;
+        errors++;
+      }
+    }
+
+    double pdfValue;
+    spg.EvaluatePDF(pdfValue, points[m], false);
+
+    if(fabs(pdfValue - pdfScan) > 1.0e-12 * (1. + fabs(pdfScan)) || fabs(pdfBatched[m] - pdfScan) > 1.0e-12 * (1. + fabs(pdfScan))) {
+      cout << "point (" << points[m][0] << ", " << points[m][1] << "): pdf scan = " << pdfScan << " pointwise = " << pdfValue
+           << " batched = " << pdfBatched[m] << endl;
+      errors++;
+    }
+  }
+
+  if(errors > 0) {
+    cout << errors << " mismatches between the supporting dof lookup and the scan of the dofs" << endl;
+    exit(1);
+  }
+
+  return 0;
+}
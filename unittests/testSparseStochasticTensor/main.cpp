@@ -0,0 +1,115 @@
+#include "FemusInit.hpp"
+#include "uq.hpp"
+
+using std::cout;
+using std::endl;
+using namespace femus;
+
+/*
+  The sparse stochastic Galerkin tensor against the dense one, G[q1][p1][p2] = E[psi_q1 psi_p1 psi_p2],
+  for Hermite and Legendre polynomials: the entries rebuilt from the blocks (q1, p2) of the sparse tensor, as
+  StochasticGalerkinOperator visits them, have to match the dense tensor, and Contract has to match the dense
+  contraction sum_q1 a[q1] G[q1][p1][p2] on its pattern, with no nonzero of the dense contraction outside it.
+*/
+
+unsigned CheckTensor(uq& myuq, const unsigned& qIndex, const unsigned& pIndex, const unsigned& numberOfEigPairs) {
+
+  const std::vector < std::vector < std::vector < double > > > &G = myuq.GetStochasticMassMatrix(qIndex, pIndex, numberOfEigPairs);
+  const SparseStochasticTensor &S = myuq.GetSparseStochasticMassMatrix(qIndex, pIndex, numberOfEigPairs);
+
+  unsigned Jq = G.size();
+  unsigned Jp = G[0].size();
+
+  unsigned errors = 0;
+
+  if(S.GetNumberOfModes() != Jq || S.size() != Jp) {
+    cout << "q = " << qIndex << " p = " << pIndex << " M = " << numberOfEigPairs << ": sparse sizes " << S.GetNumberOfModes() << " x " << S.size()
+         << ", dense sizes " << Jq << " x " << Jp << endl;
+    return 1;
+  }
+
+  std::vector < std::vector < std::vector < double > > > D(Jq, std::vector < std::vector < double > > (Jp, std::vector < double > (Jp, 0.)));
+
+  for(unsigned b = 0; b < S.GetNumberOfBlocks(); b++) {
+    for(unsigned k = S.GetBlockBegin(b); k < S.GetBlockEnd(b); k++) {
+      D[S.GetBlockMode(b)][S.GetRow(k)][S.GetBlockColumn(b)] += S.GetValue(k);
+    }
+  }
+
+  for(unsigned q1 = 0; q1 < Jq; q1++) {
+    for(unsigned p1 = 0; p1 < Jp; p1++) {
+      for(unsigned p2 = 0; p2 < Jp; p2++) {
+        if(fabs(D[q1][p1][p2] - G[q1][p1][p2]) > 1.0e-12) {
+          cout << "q = " << qIndex << " p = " << pIndex << " M = " << numberOfEigPairs << ": G[" << q1 << "][" << p1 << "][" << p2 << "] dense = "
+               << G[q1][p1][p2] << " sparse = " << D[q1][p1][p2] << endl;
+          errors++;
+        }
+      }
+    }
+  }
+
+  std::vector < double > a(Jq);
+
+  for(unsigned q1 = 0; q1 < Jq; q1++) {
+    a[q1] = 1. / (1. + q1);
+  }
+
+  std::vector < double > C;
+  S.Contract(a, C);
+
+  std::vector < std::vector < double > > denseC(Jp, std::vector < double > (Jp, 0.));
+
+  for(unsigned q1 = 0; q1 < Jq; q1++) {
+    for(unsigned p1 = 0; p1 < Jp; p1++) {
+      for(unsigned p2 = 0; p2 < Jp; p2++) {
+        denseC[p1][p2] += a[q1] * G[q1][p1][p2];
+      }
+    }
+  }
+
+  for(unsigned p1 = 0; p1 < Jp; p1++) {
+    for(unsigned k = S.GetPatternRowBegin(p1); k < S.GetPatternRowEnd(p1); k++) {
+      unsigned p2 = S.GetPatternColumn(k);
+
+      if(fabs(C[k] - denseC[p1][p2]) > 1.0e-12) {
+        cout << "q = " << qIndex << " p = " << pIndex << " M = " << numberOfEigPairs << ": contraction (" << p1 << ", " << p2 << ") dense = "
+             << denseC[p1][p2] << " sparse = " << C[k] << endl;
+        errors++;
+      }
+
+      denseC[p1][p2] = 0.;
+    }
+
+    for(unsigned p2 = 0; p2 < Jp; p2++) {
+      if(fabs(denseC[p1][p2]) > 1.0e-12) {
+        cout << "q = " << qIndex << " p = " << pIndex << " M = " << numberOfEigPairs << ": contraction (" << p1 << ", " << p2
+             << ") = " << denseC[p1][p2] << " outside the sparse pattern" << endl;
+        errors++;
+      }
+    }
+  }
+
+  return errors;
+}
+
+int main(int argc, char** args) {
+
+  FemusInit mpinit(argc, args, MPI_COMM_WORLD);
+
+  unsigned errors = 0;
+
+  uq* families[2] = {&FemusInit::_uqHermite, &FemusInit::_uqLegendre};
+
+  for(unsigned f = 0; f < 2; f++) {
+    errors += CheckTensor(*families[f], 2, 2, 2);
+    errors += CheckTensor(*families[f], 5, 4, 2);
+    errors += CheckTensor(*families[f], 3, 2, 4);
+  }
+
+  if(errors > 0) {
+    cout << errors << " mismatches between the sparse and the dense stochastic Galerkin tensor" << endl;
+    exit(1);
+  }
+
+  return 0;
+}
@@ -0,0 +1,123 @@
+#include "FemusInit.hpp"
+#include "MultiLevelProblem.hpp"
+#include "MultiLevelMesh.hpp"
+#include "LinearImplicitSystem.hpp"
+#include "NumericVector.hpp"
+#include "SparseMatrix.hpp"
+#include "PetscMatrix.hpp"
+
+using std::cout;
+using std::endl;
+using namespace femus;
+
+/*
+  The preallocation d_nnz, o_nnz computed by LinearEquation::GetSparsityPatternSize has to be exact:
+  after adding every element dof pair of a coupled P2-P1 system, PETSc must report no mallocs
+  and as many used nonzeros as the allocated ones, on every level and every process.
+*/
+
+bool SetBoundaryCondition(const std::vector < double >& x, const char name[], double& value, const int facename, const double time) {
+  value = 0.;
+  return true;
+}
+
+bool CheckLevel(LinearImplicitSystem& system, Mesh* msh, MultiLevelSolution& mlSol, const unsigned& level) {
+
+  LinearEquationSolver* pdeSys = system._LinSolver[level];
+  SparseMatrix* KK = pdeSys->_KK;
+
+  unsigned iproc = msh->processor_id();
+
+  const char* names[2] = {"u", "p"};
+  unsigned solIndex[2];
+  unsigned solPdeIndex[2];
+  unsigned solType[2];
+
+  for(unsigned k = 0; k < 2; k++) {
+    solIndex[k] = mlSol.GetIndex(names[k]);
+    solPdeIndex[k] = system.GetSolPdeIndex(names[k]);
+    solType[k] = mlSol.GetSolutionType(solIndex[k]);
+  }
+
+  std::vector < int > l2GMap;
+  std::vector < double > Jac;
+
+  KK->zero();
+
+  for(int iel = msh->_elementOffset[iproc]; iel < msh->_elementOffset[iproc + 1]; iel++) {
+    l2GMap.resize(0);
+
+    for(unsigned k = 0; k < 2; k++) {
+      unsigned nDofs = msh->GetElementDofNumber(iel, solType[k]);
+
+      for(unsigned i = 0; i < nDofs; i++) {
+        l2GMap.push_back(pdeSys->GetSystemDof(solIndex[k], solPdeIndex[k], i, iel));
+      }
+    }
+
+    Jac.assign(l2GMap.size() * l2GMap.size(), 1.);
+    KK->add_matrix_blocked(Jac, l2GMap, l2GMap);
+  }
+
+  KK->close();
+
+  MatInfo info;
+  MatGetInfo((static_cast< PetscMatrix* >(KK))->mat(), MAT_LOCAL, &info);
+
+  double preallocated = 0.;
+
+  for(unsigned i = 0; i < pdeSys->d_nnz.size(); i++) {
+    preallocated += pdeSys->d_nnz[i] + pdeSys->o_nnz[i];
+  }
+
+  bool exact = (info.mallocs == 0. && info.nz_used == info.nz_allocated && info.nz_used == preallocated);
+
+  if(!exact) {
+    cout << "level " << level << " process " << iproc << ": mallocs = " << info.mallocs << " nz_used = " << info.nz_used
+         << " nz_allocated = " << info.nz_allocated << " d_nnz + o_nnz = " << preallocated << endl;
+  }
+
+  return exact;
+}
+
+int main(int argc, char** args) {
+
+  FemusInit mpinit(argc, args, MPI_COMM_WORLD);
+
+  MultiLevelMesh mlMsh;
+  mlMsh.GenerateCoarseBoxMesh(4, 4, 0, 0., 1., 0., 1., 0., 0., QUAD9, "seventh");
+  unsigned numberOfUniformLevels = 3;
+  mlMsh.RefineMesh(numberOfUniformLevels, numberOfUniformLevels, NULL);
+
+  MultiLevelSolution mlSol(&mlMsh);
+  mlSol.AddSolution("u", LAGRANGE, SECOND);
+  mlSol.AddSolution("p", LAGRANGE, FIRST);
+  mlSol.Initialize("All");
+  mlSol.AttachSetBoundaryConditionFunction(SetBoundaryCondition);
+  mlSol.GenerateBdc("All");
+
+  MultiLevelProblem mlProb(&mlSol);
+
+  LinearImplicitSystem& system = mlProb.add_system < LinearImplicitSystem > ("Test");
+  system.AddSolutionToSystemPDE("u");
+  system.AddSolutionToSystemPDE("p");
+  system.init();
+
+  int exact = 1;
+
+  for(unsigned level = 0; level < numberOfUniformLevels; level++) {
+    if(!CheckLevel(system, mlMsh.GetLevel(level), mlSol, level)) exact = 0;
+  }
+
+  int allExact;
+  MPI_Allreduce(&exact, &allExact, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+
+  if(!allExact) {
+    cout << "The preallocation of the sparsity pattern is not exact" << endl;
+    exit(1);
+  }
+
+  cout << "The preallocation of the sparsity pattern is exact" << endl;
+
+  return 0;
+}